@@ -8,6 +8,7 @@
 #pragma once
 
 #include <algorithm>
+#include <numeric>
 #include <optional>
 #include <unordered_map>
 
@@ -136,3 +137,139 @@ static void makeUnique(Container &container)
 	std::sort(container.begin(), container.end());
 	container.erase(std::unique(container.begin(), container.end()), container.end());
 }
+
+/**
+ * Inserts items into a sorted list while keeping it sorted.
+ *
+ * Items that are equal in order to items of the list are inserted after them.
+ * Items ending up next to each other are inserted as one range so that a model only needs to
+ * announce one change per range.
+ *
+ * @param list list sorted by lessThan
+ * @param items items to be inserted
+ * @param lessThan function returning whether its first argument is ordered before its second one
+ * @param beginInsert function called with the first and the last index of each range before
+ *        inserting it
+ * @param endInsert function called after inserting each range
+ */
+template<typename T, typename LessThan, typename BeginInsert, typename EndInsert>
+void insertSorted(QVector<T> &list, QVector<T> items, LessThan lessThan, BeginInsert beginInsert, EndInsert endInsert)
+{
+	std::stable_sort(items.begin(), items.end(), lessThan);
+
+	// The ranges are inserted from the end of the list so that the positions of the preceding
+	// ranges stay unchanged.
+	int rangeEnd = items.size();
+
+	while (rangeEnd > 0) {
+		const int position = std::upper_bound(list.cbegin(), list.cend(), items.at(rangeEnd - 1), lessThan) - list.cbegin();
+		auto rangeStart = rangeEnd - 1;
+
+		while (rangeStart > 0 && (position == 0 || !lessThan(items.at(rangeStart - 1), list.at(position - 1)))) {
+			--rangeStart;
+		}
+
+		const auto count = rangeEnd - rangeStart;
+
+		beginInsert(position, position + count - 1);
+		list.insert(list.begin() + position, count, T());
+		std::move(items.begin() + rangeStart, items.begin() + rangeEnd, list.begin() + position);
+		endInsert();
+
+		rangeEnd = rangeStart;
+	}
+}
+
+/**
+ * Moves items whose order changed to their sorted positions.
+ *
+ * The positions are determined by binary search over the unchanged items, which stay sorted.
+ * Each changed item is moved right behind the item that precedes it in the sorted list.
+ * Changed items that are already there are not moved.
+ *
+ * @param list list sorted by lessThan except for the changed items
+ * @param changedIndexes indexes of the items whose order changed
+ * @param lessThan function returning whether its first argument is ordered before its second one
+ * @param move function called with the index of an item and the index of the item it has to be
+ *        moved before (as for QAbstractItemModel::beginMoveRows()), moving the item within list
+ */
+template<typename T, typename LessThan, typename Move>
+void moveToSortedPositions(const QVector<T> &list, QVector<int> changedIndexes, LessThan lessThan, Move move)
+{
+	makeUnique(changedIndexes);
+
+	if (changedIndexes.isEmpty()) {
+		return;
+	}
+
+	const int count = list.size();
+
+	QVector<bool> changed(count, false);
+	for (const auto index : std::as_const(changedIndexes)) {
+		changed[index] = true;
+	}
+
+	QVector<int> unchangedIndexes;
+	unchangedIndexes.reserve(count - changedIndexes.size());
+	for (int i = 0; i < count; i++) {
+		if (!changed.at(i)) {
+			unchangedIndexes.append(i);
+		}
+	}
+
+	std::stable_sort(changedIndexes.begin(), changedIndexes.end(), [&](int left, int right) {
+		return lessThan(list.at(left), list.at(right));
+	});
+
+	// Determine the item that precedes each changed item in the sorted list (-1 for none) by the
+	// initial indexes.
+	QVector<int> precedingIndexes;
+	precedingIndexes.reserve(changedIndexes.size());
+	int previousUnchangedCount = -1;
+
+	for (int i = 0; i < changedIndexes.size(); i++) {
+		const int unchangedCount = std::upper_bound(unchangedIndexes.cbegin(), unchangedIndexes.cend(), changedIndexes.at(i), [&](int item, int unchangedIndex) {
+			return lessThan(list.at(item), list.at(unchangedIndex));
+		}) - unchangedIndexes.cbegin();
+
+		if (unchangedCount == previousUnchangedCount) {
+			precedingIndexes.append(changedIndexes.at(i - 1));
+		} else {
+			precedingIndexes.append(unchangedCount == 0 ? -1 : unchangedIndexes.at(unchangedCount - 1));
+		}
+
+		previousUnchangedCount = unchangedCount;
+	}
+
+	// Track the current indexes of the items by their initial indexes while moving them.
+	QVector<int> currentIndexes(count);
+	QVector<int> initialIndexes(count);
+	std::iota(currentIndexes.begin(), currentIndexes.end(), 0);
+	std::iota(initialIndexes.begin(), initialIndexes.end(), 0);
+
+	for (int i = 0; i < changedIndexes.size(); i++) {
+		const auto from = currentIndexes.at(changedIndexes.at(i));
+		const auto precedingIndex = precedingIndexes.at(i);
+		const auto destination = precedingIndex == -1 ? 0 : currentIndexes.at(precedingIndex) + 1;
+
+		if (from == destination) {
+			continue;
+		}
+
+		move(from, destination);
+
+		const auto to = from < destination ? destination - 1 : destination;
+		const auto first = std::min(from, to);
+		const auto last = std::max(from, to);
+
+		if (from < to) {
+			std::rotate(initialIndexes.begin() + from, initialIndexes.begin() + from + 1, initialIndexes.begin() + to + 1);
+		} else {
+			std::rotate(initialIndexes.begin() + to, initialIndexes.begin() + from, initialIndexes.begin() + from + 1);
+		}
+
+		for (int j = first; j <= last; j++) {
+			currentIndexes[initialIndexes.at(j)] = j;
+		}
+	}
+}
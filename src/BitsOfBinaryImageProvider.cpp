@@ -9,10 +9,12 @@
 // Qt
 #include <QImageReader>
 #include <QMimeType>
-#include <QMutexLocker>
 // QXmpp
 #include <QXmppBitsOfBinaryContentId.h>
 
+// Maximum size of all decoded images in bytes
+constexpr qsizetype MAX_DECODED_IMAGES_SIZE = 8 * 1024 * 1024;
+
 BitsOfBinaryImageProvider *BitsOfBinaryImageProvider::s_instance;
 
 BitsOfBinaryImageProvider *BitsOfBinaryImageProvider::instance()
@@ -37,47 +39,99 @@ BitsOfBinaryImageProvider::~BitsOfBinaryImageProvider()
 
 QImage BitsOfBinaryImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
 {
-	QMutexLocker locker(&m_cacheMutex);
+	const DecodedImageKey key { id, requestedSize.isValid() ? requestedSize : QSize() };
+	QByteArray data;
+
+	{
+		QReadLocker locker(&m_cacheLock);
+
+		if (const auto itr = m_decodedImages.constFind(key); itr != m_decodedImages.cend()) {
+			const auto &decodedImage = *itr;
+			decodedImage->lastUse = ++m_useCounter;
+			*size = decodedImage->originalSize;
+			return decodedImage->image;
+		}
 
-	const auto item = std::find_if(m_cache.begin(), m_cache.end(), [&](const QXmppBitsOfBinaryData &item) {
-		return item.cid().toCidUrl() == id;
-	});
+		data = m_data.value(id);
+	}
 
-	if (item == m_cache.end())
+	if (data.isEmpty())
 		return {};
 
-	QImage image = QImage::fromData((*item).data());
-	size->setWidth(image.width());
-	size->setHeight(image.height());
+	// The image is decoded without holding the lock so that other images can be requested in the
+	// meantime.
+	QImage image = QImage::fromData(data);
+	const auto originalSize = image.size();
+	*size = originalSize;
+
+	if (key.size.isValid())
+		image = image.scaled(key.size);
 
-	if (requestedSize.isValid())
-		image = image.scaled(requestedSize);
+	if (!image.isNull())
+		cacheImage(key, image, originalSize);
 
 	return image;
 }
 
 bool BitsOfBinaryImageProvider::addImage(const QXmppBitsOfBinaryData &data)
 {
-	QMutexLocker locker(&m_cacheMutex);
-
 	if (!QImageReader::supportedMimeTypes().contains(data.contentType().name().toUtf8())) {
 		return false;
 	}
 
-	m_cache.push_back(data);
+	QWriteLocker locker(&m_cacheLock);
+	m_data.insert(data.cid().toCidUrl(), data.data());
 	return true;
 }
 
 bool BitsOfBinaryImageProvider::removeImage(const QXmppBitsOfBinaryContentId &cid)
 {
-	QMutexLocker locker(&m_cacheMutex);
-
-	auto endItr = std::remove_if(m_cache.begin(), m_cache.end(), [&](const QXmppBitsOfBinaryData &item) {
-		return item.cid() == cid;
-	});
-	// check whether anything was removed
-	bool success = endItr != m_cache.end();
-	// resize container
-	m_cache.erase(endItr, m_cache.end());
-	return success;
+	const auto cidUrl = cid.toCidUrl();
+
+	QWriteLocker locker(&m_cacheLock);
+
+	for (auto itr = m_decodedImages.begin(); itr != m_decodedImages.end();) {
+		if (itr.key().cidUrl == cidUrl) {
+			m_decodedImagesSize -= (*itr)->image.sizeInBytes();
+			itr = m_decodedImages.erase(itr);
+		} else {
+			++itr;
+		}
+	}
+
+	return m_data.remove(cidUrl);
+}
+
+void BitsOfBinaryImageProvider::cacheImage(const DecodedImageKey &key, const QImage &image, const QSize &originalSize)
+{
+	const auto imageSize = image.sizeInBytes();
+
+	if (imageSize > MAX_DECODED_IMAGES_SIZE) {
+		return;
+	}
+
+	QWriteLocker locker(&m_cacheLock);
+
+	// The image may have been decoded by another thread or removed in the meantime.
+	if (m_decodedImages.contains(key) || !m_data.contains(key.cidUrl)) {
+		return;
+	}
+
+	// Remove the least recently used images until the new one fits in.
+	while (m_decodedImagesSize + imageSize > MAX_DECODED_IMAGES_SIZE) {
+		const auto leastRecentlyUsed = std::min_element(m_decodedImages.begin(), m_decodedImages.end(), [](const auto &left, const auto &right) {
+			return left->lastUse < right->lastUse;
+		});
+
+		m_decodedImagesSize -= (*leastRecentlyUsed)->image.sizeInBytes();
+		m_decodedImages.erase(leastRecentlyUsed);
+	}
+
+	auto decodedImage = std::make_shared<DecodedImage>();
+	decodedImage->image = image;
+	decodedImage->originalSize = originalSize;
+	decodedImage->lastUse = ++m_useCounter;
+
+	m_decodedImages.insert(key, std::move(decodedImage));
+	m_decodedImagesSize += imageSize;
 }
@@ -6,16 +6,22 @@
 
 #pragma once
 
+// std
+#include <atomic>
+#include <memory>
 // Qt
+#include <QHash>
 #include <QQuickImageProvider>
-#include <QMutex>
-#include <QVector>
+#include <QReadWriteLock>
 // QXmpp
 #include <QXmppBitsOfBinaryData.h>
 
 /**
  * Provider for images received via XEP-0231: Bits of Binary
  *
+ * The decoded images are cached per requested size.
+ * The least recently used ones are removed once their total size exceeds a limit.
+ *
  * @note This class is thread-safe.
  */
 class BitsOfBinaryImageProvider : public QQuickImageProvider
@@ -57,7 +63,36 @@ public:
 	bool removeImage(const QXmppBitsOfBinaryContentId &cid);
 
 private:
+	struct DecodedImageKey
+	{
+		QString cidUrl;
+		QSize size;
+
+		bool operator==(const DecodedImageKey &other) const = default;
+	};
+
+	struct DecodedImage
+	{
+		QImage image;
+		QSize originalSize;
+		// Value of m_useCounter when the image was requested last
+		std::atomic<quint64> lastUse;
+	};
+
+	friend uint qHash(const DecodedImageKey &key, uint seed)
+	{
+		return qHash(key.cidUrl, seed) ^ qHash(key.size.width(), seed) ^ qHash(key.size.height() << 16, seed);
+	}
+
+	void cacheImage(const DecodedImageKey &key, const QImage &image, const QSize &originalSize);
+
 	static BitsOfBinaryImageProvider *s_instance;
-	QMutex m_cacheMutex;
-	std::vector<QXmppBitsOfBinaryData> m_cache;
+
+	// Readers only look up entries and update their atomic usage counters.
+	QReadWriteLock m_cacheLock;
+	// Encoded data of the images mapped to their content URLs
+	QHash<QString, QByteArray> m_data;
+	QHash<DecodedImageKey, std::shared_ptr<DecodedImage>> m_decodedImages;
+	qsizetype m_decodedImagesSize = 0;
+	std::atomic<quint64> m_useCounter = 0;
 };
@@ -44,14 +44,14 @@
 #include "VCardManager.h"
 #include "VersionManager.h"
 #include "Settings.h"
-#include "MediaUtils.h"
+#include "UploadPreparation.h"
 
 ClientWorker::Caches::Caches(QObject *parent)
 	: settings(new Settings(parent)),
 	  vCardCache(new VCardCache(parent)),
 	  accountManager(new AccountManager(settings, vCardCache, parent)),
 	  presenceCache(new PresenceCache(parent)),
-	  msgModel(new MessageModel(parent)),
+	  msgModel(new MessageModel(settings, parent)),
 	  rosterModel(new RosterModel(parent)),
 	  omemoCache(new OmemoCache(parent)),
 	  avatarStorage(new AvatarFileStorage(parent)),
@@ -85,7 +85,11 @@ ClientWorker::ClientWorker(Caches *caches, Database *database, bool enableLoggin
 
 	// file sharing manager
 	m_fileSharingManager = m_client->addNewExtension<QXmppFileSharingManager>();
-	m_fileSharingManager->setMetadataGenerator(MediaUtils::generateMetadata);
+	m_fileSharingManager->setMetadataGenerator(UploadPreparation::generateMetadata);
+	UploadPreparation::instance().setMaxThumbnailJobs(m_caches->settings->maxThumbnailJobs());
+	connect(m_caches->settings, &Settings::maxThumbnailJobsChanged, this, [settings = m_caches->settings]() {
+		UploadPreparation::instance().setMaxThumbnailJobs(settings->maxThumbnailJobs());
+	});
 	m_httpProvider = std::make_shared<QXmppHttpFileSharingProvider>(uploadManager, m_networkManager);
 	m_encryptedProvider = std::make_shared<QXmppEncryptedFileSharingProvider>(m_fileSharingManager, m_httpProvider);
 	m_fileSharingManager->registerProvider(m_httpProvider);
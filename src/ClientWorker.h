@@ -157,6 +157,11 @@ public:
 		return m_client;
 	}
 
+	QNetworkAccessManager *networkManager() const
+	{
+		return m_networkManager;
+	}
+
 	/**
 	 * Starts or enqueues a task which will be executed after successful login (e.g. a
 	 * nickname change).
@@ -15,7 +15,12 @@
 #include "Kaidan.h"
 #include "SqlUtils.h"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+
 #include <QDir>
+#include <QLoggingCategory>
 #include <QMutex>
 #include <QRandomGenerator>
 #include <QSqlDriver>
@@ -37,14 +42,24 @@
 
 using namespace SqlUtils;
 
+Q_LOGGING_CATEGORY(database_migration, "database.migration", QtMsgType::QtWarningMsg)
+
 #define DATABASE_CONVERT_TO_VERSION(n) \
 	if (d->version < n) { \
 		convertDatabaseToV##n(); \
 	}
 
 // Both need to be updated on version bump:
-#define DATABASE_LATEST_VERSION 39
-#define DATABASE_CONVERT_TO_LATEST_VERSION() DATABASE_CONVERT_TO_VERSION(39)
+#define DATABASE_LATEST_VERSION 44
+#define DATABASE_CONVERT_TO_LATEST_VERSION() DATABASE_CONVERT_TO_VERSION(44)
+
+// Connection tuning
+// Size of the memory-mapped I/O region in bytes
+#define DB_MMAP_SIZE "67108864"
+// Size of the page cache in KiB (negative values are interpreted as KiB by SQLite)
+#define DB_CACHE_SIZE "-8192"
+// Maximum number of threads reading in parallel to the writing database thread
+#define DB_MAX_READER_THREADS 4
 
 #define SQL_BOOL "BOOL"
 #define SQL_BOOL_NOT_NULL "BOOL NOT NULL"
@@ -64,6 +79,9 @@ using namespace SqlUtils;
 #define SQL_ATTRIBUTE(name, dataType) \
 	SQL_LAST_ATTRIBUTE(name, dataType) ","
 
+#define SQL_CREATE_INDEX(indexName, tableName, columns) \
+	"CREATE INDEX '" indexName "' ON '" tableName "' (" columns ")"
+
 class DbConnection;
 
 static QThreadStorage<DbConnection *> dbConnections;
@@ -112,10 +130,14 @@ public:
 		if (!database.open()) {
 			qFatal("Cannot open database: %s", qPrintable(database.lastError().text()));
 		}
+
+		applyTuningProfile(database);
 	}
 
 	~DbConnection()
 	{
+		// Cached queries must be removed before their connection is removed.
+		clearCachedQueries();
 		QSqlDatabase::removeDatabase(m_name);
 	}
 
@@ -125,6 +147,23 @@ public:
 	}
 
 private:
+	/**
+	 * Configures the connection for fast writes and reads.
+	 *
+	 * The write-ahead log allows reading while writing and, in combination with
+	 * "synchronous = NORMAL", avoids syncing the database file on every commit.
+	 * The database is still consistent after a power loss but the latest commits may be lost.
+	 */
+	static void applyTuningProfile(const QSqlDatabase &database)
+	{
+		QSqlQuery query(database);
+		execQuery(query, QStringLiteral("PRAGMA journal_mode = WAL"));
+		execQuery(query, QStringLiteral("PRAGMA synchronous = NORMAL"));
+		execQuery(query, QStringLiteral("PRAGMA mmap_size = " DB_MMAP_SIZE));
+		execQuery(query, QStringLiteral("PRAGMA cache_size = " DB_CACHE_SIZE));
+		execQuery(query, QStringLiteral("PRAGMA temp_store = MEMORY"));
+	}
+
 	QString m_name;
 };
 
@@ -138,10 +177,11 @@ struct DatabasePrivate
 {
 	QThread dbThread;
 	QObject *dbWorker = new QObject();
+	QThreadPool readerPool;
 	QMutex tableCreationMutex;
 	int version = DbNotLoaded;
 	int transactions = 0;
-	bool tablesCreated = false;
+	std::atomic_bool tablesCreated = false;
 };
 
 Database::Database(QObject *parent)
@@ -155,10 +195,18 @@ Database::Database(QObject *parent)
 	d->dbWorker->moveToThread(&d->dbThread);
 	connect(&d->dbThread, &QThread::finished, d->dbWorker, &QObject::deleteLater);
 
+	// Each reader thread opens its own connection on first use.
+	// The threads are kept alive so that their connections and cached queries are reused.
+	d->readerPool.setMaxThreadCount(std::clamp(QThread::idealThreadCount() / 2, 1, DB_MAX_READER_THREADS));
+	d->readerPool.setExpiryTimeout(-1);
+
 #ifdef DB_UNIT_TEST
-	QFile file(TEST_DB_FILENAME);
-	if (file.exists()) {
-		file.remove();
+	// Remove the database file including the files of its write-ahead log.
+	for (const auto &suffix : { QString(), QStringLiteral("-wal"), QStringLiteral("-shm") }) {
+		QFile file(TEST_DB_FILENAME + suffix);
+		if (file.exists()) {
+			file.remove();
+		}
 	}
 #endif
 }
@@ -166,6 +214,7 @@ Database::Database(QObject *parent)
 Database::~Database()
 {
 	// wait for finished
+	d->readerPool.waitForDone();
 	d->dbThread.quit();
 	d->dbThread.wait();
 }
@@ -240,6 +289,11 @@ QObject *Database::dbWorker() const
 	return d->dbWorker;
 }
 
+QThreadPool *Database::readerPool() const
+{
+	return &d->readerPool;
+}
+
 QSqlDatabase Database::currentDatabase()
 {
 	if (!dbConnections.hasLocalData()) {
@@ -407,7 +461,7 @@ void Database::createNewDatabase()
 			SQL_ATTRIBUTE(originId, SQL_TEXT)
 			SQL_ATTRIBUTE(stanzaId, SQL_TEXT)
 			SQL_ATTRIBUTE(replaceId, SQL_TEXT)
-			SQL_ATTRIBUTE(timestamp, SQL_TEXT)
+			SQL_ATTRIBUTE(timestamp, SQL_INTEGER)
 			SQL_ATTRIBUTE(body, SQL_TEXT)
 			SQL_ATTRIBUTE(encryption, SQL_INTEGER)
 			SQL_ATTRIBUTE(senderKey, SQL_BLOB)
@@ -598,10 +652,34 @@ void Database::createNewDatabase()
 		)
 	);
 
-	execQuery(query, "CREATE VIEW " DB_VIEW_CHAT_MESSAGES " AS SELECT * FROM " DB_TABLE_MESSAGES
-					 " WHERE deliveryState != 4 AND removed != 1");
-	execQuery(query, "CREATE VIEW " DB_VIEW_DRAFT_MESSAGES " AS SELECT * FROM " DB_TABLE_MESSAGES
-					 " WHERE deliveryState = 4");
+	createMessagesViews(query);
+
+	// full-text search
+	// The external content table stores no copy of the bodies but refers to the messages by their
+	// rowids.
+	if (isFullTextSearchSupported()) {
+		execQuery(
+			query,
+			"CREATE VIRTUAL TABLE " DB_TABLE_MESSAGES_FTS " USING fts5("
+			"body, content='" DB_TABLE_MESSAGES "', content_rowid='rowid', "
+			"tokenize='unicode61 remove_diacritics 2')"
+		);
+		createMessagesFtsTriggers(query);
+	}
+
+	// indexes
+	execQuery(query, SQL_CREATE_INDEX("rosterJidIndex", DB_TABLE_ROSTER, "jid"));
+	execQuery(query, SQL_CREATE_INDEX("messagesChatTimestampIndex", DB_TABLE_MESSAGES, "accountJid, chatJid, timestamp, id"));
+	execQuery(query, SQL_CREATE_INDEX("messagesTimestampIndex", DB_TABLE_MESSAGES, "timestamp"));
+	execQuery(query, SQL_CREATE_INDEX("messagesIdIndex", DB_TABLE_MESSAGES, "id"));
+	execQuery(query, SQL_CREATE_INDEX("messagesReplaceIdIndex", DB_TABLE_MESSAGES, "replaceId"));
+	execQuery(query, SQL_CREATE_INDEX("messagesStanzaIdIndex", DB_TABLE_MESSAGES, "stanzaId"));
+	execQuery(query, SQL_CREATE_INDEX("messagesOriginIdIndex", DB_TABLE_MESSAGES, "originId"));
+	execQuery(query, SQL_CREATE_INDEX("messagesFileGroupIdIndex", DB_TABLE_MESSAGES, "fileGroupId"));
+	execQuery(query, SQL_CREATE_INDEX("messageReactionsMessageIdIndex", DB_TABLE_MESSAGE_REACTIONS, "accountJid, chatJid, messageId"));
+	execQuery(query, SQL_CREATE_INDEX("filesFileGroupIdIndex", DB_TABLE_FILES, "fileGroupId"));
+	execQuery(query, SQL_CREATE_INDEX("filesLocalFilePathIndex", DB_TABLE_FILES, "localFilePath"));
+	execQuery(query, SQL_CREATE_INDEX("fileHashesHashValueIndex", DB_TABLE_FILE_HASHES, "hashValue"));
 
 	d->version = DATABASE_LATEST_VERSION;
 }
@@ -1876,3 +1954,250 @@ void Database::convertDatabaseToV39()
 
 	d->version = 39;
 }
+
+void Database::convertDatabaseToV40()
+{
+	DATABASE_CONVERT_TO_VERSION(39)
+	QSqlQuery query(currentDatabase());
+
+	// Create indexes for the columns used by the most frequent queries in order to avoid
+	// scanning whole tables.
+	execQuery(query, SQL_CREATE_INDEX("rosterJidIndex", DB_TABLE_ROSTER, "jid"));
+	execQuery(query, SQL_CREATE_INDEX("messagesChatTimestampIndex", DB_TABLE_MESSAGES, "accountJid, chatJid, timestamp"));
+	execQuery(query, SQL_CREATE_INDEX("messagesTimestampIndex", DB_TABLE_MESSAGES, "timestamp"));
+	execQuery(query, SQL_CREATE_INDEX("messagesIdIndex", DB_TABLE_MESSAGES, "id"));
+	execQuery(query, SQL_CREATE_INDEX("messagesReplaceIdIndex", DB_TABLE_MESSAGES, "replaceId"));
+	execQuery(query, SQL_CREATE_INDEX("messagesStanzaIdIndex", DB_TABLE_MESSAGES, "stanzaId"));
+	execQuery(query, SQL_CREATE_INDEX("messagesOriginIdIndex", DB_TABLE_MESSAGES, "originId"));
+	execQuery(query, SQL_CREATE_INDEX("messageReactionsMessageIdIndex", DB_TABLE_MESSAGE_REACTIONS, "accountJid, chatJid, messageId"));
+	execQuery(query, SQL_CREATE_INDEX("filesFileGroupIdIndex", DB_TABLE_FILES, "fileGroupId"));
+
+	d->version = 40;
+}
+
+void Database::convertDatabaseToV41()
+{
+	DATABASE_CONVERT_TO_VERSION(40)
+	QSqlQuery query(currentDatabase());
+
+	// Extend the index by the message ID in order to page through a chat by (timestamp, id)
+	// without sorting messages with equal timestamps.
+	execQuery(query, "DROP INDEX messagesChatTimestampIndex");
+	execQuery(query, SQL_CREATE_INDEX("messagesChatTimestampIndex", DB_TABLE_MESSAGES, "accountJid, chatJid, timestamp, id"));
+
+	d->version = 41;
+}
+
+void Database::convertDatabaseToV42()
+{
+	DATABASE_CONVERT_TO_VERSION(41)
+	QSqlQuery query(currentDatabase());
+
+	// Index the message bodies for the full-text search.
+	// The external content table stores no copy of the bodies but refers to the messages by their
+	// rowids.
+	// If SQLite does not support it, messages are searched without the index.
+	if (isFullTextSearchSupported()) {
+		execQuery(
+			query,
+			"CREATE VIRTUAL TABLE " DB_TABLE_MESSAGES_FTS " USING fts5("
+			"body, content='" DB_TABLE_MESSAGES "', content_rowid='rowid', "
+			"tokenize='unicode61 remove_diacritics 2')"
+		);
+		createMessagesFtsTriggers(query);
+		execQuery(query, "INSERT INTO " DB_TABLE_MESSAGES_FTS " (" DB_TABLE_MESSAGES_FTS ") VALUES ('rebuild')");
+	}
+
+	d->version = 42;
+}
+
+void Database::convertDatabaseToV43()
+{
+	DATABASE_CONVERT_TO_VERSION(42)
+	QSqlQuery query(currentDatabase());
+
+	// Store the timestamps of messages and message reactions as milliseconds since the epoch
+	// instead of ISO 8601 strings so that they do not need to be parsed when fetching messages.
+	//
+	// The timestamps of messages are stored in a column of the type TEXT which would convert
+	// integers into strings.
+	// Thus, the table is recreated by copying the messages once into a new table that replaces the
+	// old one.
+	// The rowids are kept because the full-text search index refers to them.
+	// Since neither the rowids nor the bodies change, the index stays valid.
+	execQuery(
+		query,
+		SQL_CREATE_TABLE(
+			"messages_new",
+			SQL_ATTRIBUTE(accountJid, SQL_TEXT_NOT_NULL)
+			SQL_ATTRIBUTE(chatJid, SQL_TEXT_NOT_NULL)
+			SQL_ATTRIBUTE(senderId, SQL_TEXT)
+			SQL_ATTRIBUTE(id, SQL_TEXT)
+			SQL_ATTRIBUTE(originId, SQL_TEXT)
+			SQL_ATTRIBUTE(stanzaId, SQL_TEXT)
+			SQL_ATTRIBUTE(replaceId, SQL_TEXT)
+			SQL_ATTRIBUTE(timestamp, SQL_INTEGER)
+			SQL_ATTRIBUTE(body, SQL_TEXT)
+			SQL_ATTRIBUTE(encryption, SQL_INTEGER)
+			SQL_ATTRIBUTE(senderKey, SQL_BLOB)
+			SQL_ATTRIBUTE(deliveryState, SQL_INTEGER)
+			SQL_ATTRIBUTE(isSpoiler, SQL_BOOL)
+			SQL_ATTRIBUTE(spoilerHint, SQL_TEXT)
+			SQL_ATTRIBUTE(fileGroupId, SQL_INTEGER)
+			SQL_ATTRIBUTE(errorText, SQL_TEXT)
+			SQL_ATTRIBUTE(removed, SQL_BOOL_NOT_NULL)
+			"FOREIGN KEY(accountJid, chatJid) REFERENCES roster (accountJid, jid)"
+		)
+	);
+
+	execQuery(
+		query,
+		"INSERT INTO messages_new (rowid, accountJid, chatJid, senderId, id, originId, stanzaId, "
+		"replaceId, timestamp, body, encryption, senderKey, deliveryState, isSpoiler, spoilerHint, "
+		"fileGroupId, errorText, removed) "
+		"SELECT rowid, accountJid, chatJid, senderId, id, originId, stanzaId, "
+		"replaceId, timestamp, body, encryption, senderKey, deliveryState, isSpoiler, spoilerHint, "
+		"fileGroupId, errorText, removed FROM messages"
+	);
+
+	convertTimestampsToIntegers(QStringLiteral("messages_new"));
+
+	// SQLite refuses to rename a table while views refer to a missing table.
+	// Thus, the views are dropped before the tables are swapped and created again afterwards.
+	execQuery(query, "DROP VIEW " DB_VIEW_CHAT_MESSAGES);
+	execQuery(query, "DROP VIEW " DB_VIEW_DRAFT_MESSAGES);
+
+	// Dropping the table drops its indexes and triggers as well.
+	execQuery(query, "DROP TABLE messages");
+	execQuery(query, "ALTER TABLE messages_new RENAME TO " DB_TABLE_MESSAGES);
+
+	createMessagesViews(query);
+
+	// The triggers updating the full-text search index have been dropped with the table.
+	if (currentDatabase().tables().contains(QStringLiteral(DB_TABLE_MESSAGES_FTS))) {
+		createMessagesFtsTriggers(query);
+	}
+
+	execQuery(query, SQL_CREATE_INDEX("messagesChatTimestampIndex", DB_TABLE_MESSAGES, "accountJid, chatJid, timestamp, id"));
+	execQuery(query, SQL_CREATE_INDEX("messagesTimestampIndex", DB_TABLE_MESSAGES, "timestamp"));
+	execQuery(query, SQL_CREATE_INDEX("messagesIdIndex", DB_TABLE_MESSAGES, "id"));
+	execQuery(query, SQL_CREATE_INDEX("messagesReplaceIdIndex", DB_TABLE_MESSAGES, "replaceId"));
+	execQuery(query, SQL_CREATE_INDEX("messagesStanzaIdIndex", DB_TABLE_MESSAGES, "stanzaId"));
+	execQuery(query, SQL_CREATE_INDEX("messagesOriginIdIndex", DB_TABLE_MESSAGES, "originId"));
+
+	// The column of message reactions already has the type INTEGER but contains strings.
+	convertTimestampsToIntegers(QStringLiteral(DB_TABLE_MESSAGE_REACTIONS));
+
+	d->version = 43;
+}
+
+void Database::convertDatabaseToV44()
+{
+	DATABASE_CONVERT_TO_VERSION(43)
+	QSqlQuery query(currentDatabase());
+
+	// Index the hashes of files, their local paths and the file groups of messages so that
+	// already downloaded files of an account with the same content can be found and the files
+	// referring to a local file can be counted.
+	execQuery(query, SQL_CREATE_INDEX("filesLocalFilePathIndex", DB_TABLE_FILES, "localFilePath"));
+	execQuery(query, SQL_CREATE_INDEX("fileHashesHashValueIndex", DB_TABLE_FILE_HASHES, "hashValue"));
+	execQuery(query, SQL_CREATE_INDEX("messagesFileGroupIdIndex", DB_TABLE_MESSAGES, "fileGroupId"));
+
+	d->version = 44;
+}
+
+void Database::createMessagesViews(QSqlQuery &query)
+{
+	execQuery(query, "CREATE VIEW " DB_VIEW_CHAT_MESSAGES " AS SELECT * FROM " DB_TABLE_MESSAGES
+					 " WHERE deliveryState != 4 AND removed != 1");
+	execQuery(query, "CREATE VIEW " DB_VIEW_DRAFT_MESSAGES " AS SELECT * FROM " DB_TABLE_MESSAGES
+					 " WHERE deliveryState = 4");
+}
+
+void Database::createMessagesFtsTriggers(QSqlQuery &query)
+{
+	execQuery(
+		query,
+		"CREATE TRIGGER messagesFtsInsert AFTER INSERT ON " DB_TABLE_MESSAGES " BEGIN "
+		"INSERT INTO " DB_TABLE_MESSAGES_FTS " (rowid, body) VALUES (new.rowid, new.body); "
+		"END"
+	);
+	execQuery(
+		query,
+		"CREATE TRIGGER messagesFtsDelete AFTER DELETE ON " DB_TABLE_MESSAGES " BEGIN "
+		"INSERT INTO " DB_TABLE_MESSAGES_FTS " (" DB_TABLE_MESSAGES_FTS ", rowid, body) VALUES ('delete', old.rowid, old.body); "
+		"END"
+	);
+	execQuery(
+		query,
+		"CREATE TRIGGER messagesFtsUpdate AFTER UPDATE OF body ON " DB_TABLE_MESSAGES " BEGIN "
+		"INSERT INTO " DB_TABLE_MESSAGES_FTS " (" DB_TABLE_MESSAGES_FTS ", rowid, body) VALUES ('delete', old.rowid, old.body); "
+		"INSERT INTO " DB_TABLE_MESSAGES_FTS " (rowid, body) VALUES (new.rowid, new.body); "
+		"END"
+	);
+}
+
+bool Database::isFullTextSearchSupported()
+{
+	QSqlQuery query(currentDatabase());
+	execQuery(query, "SELECT sqlite_compileoption_used('ENABLE_FTS5')");
+	return query.next() && query.value(0).toBool();
+}
+
+void Database::convertTimestampsToIntegers(const QString &table)
+{
+	// Convert the timestamps in chunks so that not all of them are held in memory at once.
+	constexpr int chunkSize = 10000;
+
+	enum { RowId, Timestamp };
+
+	QSqlQuery selectQuery(currentDatabase());
+	QSqlQuery updateQuery(currentDatabase());
+	prepareQuery(updateQuery, QStringLiteral("UPDATE ") + table + QStringLiteral(" SET timestamp = :timestamp WHERE rowid = :rowid"));
+
+	QVector<std::pair<qint64, QVariant>> timestamps;
+	timestamps.reserve(chunkSize);
+	auto lastRowId = std::numeric_limits<qint64>::min();
+	int rowCount = 0;
+
+	do {
+		timestamps.clear();
+		rowCount = 0;
+
+		execQuery(
+			selectQuery,
+			QStringLiteral("SELECT rowid, timestamp FROM ") + table + QStringLiteral(" WHERE rowid > :rowid ORDER BY rowid LIMIT :limit"),
+			{
+				{ u":rowid", lastRowId },
+				{ u":limit", chunkSize },
+			}
+		);
+
+		while (selectQuery.next()) {
+			lastRowId = selectQuery.value(RowId).toLongLong();
+			rowCount++;
+
+			const auto timestamp = selectQuery.value(Timestamp);
+
+			// Missing and already converted timestamps are kept.
+			if (timestamp.isNull() || timestamp.userType() == QMetaType::LongLong) {
+				continue;
+			}
+
+			// Invalid timestamps are stored as NULL instead of the start of the epoch so that they
+			// are not mistaken for real ones.
+			if (const auto dateTime = QDateTime::fromString(timestamp.toString(), Qt::ISODate); dateTime.isValid()) {
+				timestamps.append({ lastRowId, serialize(dateTime) });
+			} else {
+				qCWarning(database_migration) << "Invalid timestamp in" << table << "at rowid" << lastRowId << "replaced by NULL:" << timestamp.toString();
+				timestamps.append({ lastRowId, QVariant() });
+			}
+		}
+
+		// The whole chunk is read before updating it in order not to change the rows being read.
+		for (const auto &[rowId, timestamp] : std::as_const(timestamps)) {
+			bindValues(updateQuery, { { u":timestamp", timestamp }, { u":rowid", rowId } });
+			execQuery(updateQuery);
+		}
+	} while (rowCount == chunkSize);
+}
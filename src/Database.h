@@ -44,6 +44,7 @@ public:
 
 private:
 	QObject *dbWorker() const;
+	QThreadPool *readerPool() const;
 	QSqlDatabase currentDatabase();
 	QSqlQuery createQuery();
 
@@ -121,6 +122,36 @@ private:
 	void convertDatabaseToV37();
 	void convertDatabaseToV38();
 	void convertDatabaseToV39();
+	void convertDatabaseToV40();
+	void convertDatabaseToV41();
+	void convertDatabaseToV42();
+	void convertDatabaseToV43();
+	void convertDatabaseToV44();
+
+	/**
+	 * Converts the timestamps of a table from ISO 8601 strings into milliseconds since the epoch.
+	 *
+	 * @param table table whose column "timestamp" is converted
+	 */
+	void convertTimestampsToIntegers(const QString &table);
+
+	/**
+	 * Creates the views of the chat messages and the draft messages.
+	 */
+	void createMessagesViews(QSqlQuery &query);
+
+	/**
+	 * Creates the triggers keeping the full-text search index in sync with the messages.
+	 */
+	void createMessagesFtsTriggers(QSqlQuery &query);
+
+	/**
+	 * Returns whether the SQLite library supports full-text search indexes (FTS5).
+	 *
+	 * Without that support, the database is created without the index and messages are searched
+	 * without it.
+	 */
+	bool isFullTextSearchSupported();
 
 	std::unique_ptr<DatabasePrivate> d;
 };
@@ -46,3 +46,8 @@ QObject *DatabaseComponent::dbWorker() const
 {
 	return m_database->dbWorker();
 }
+
+QThreadPool *DatabaseComponent::readerPool() const
+{
+	return m_database->readerPool();
+}
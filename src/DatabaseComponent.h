@@ -6,8 +6,11 @@
 
 // Qt
 #include <QObject>
+#include <QScopeGuard>
+#include <QtConcurrent/QtConcurrentRun>
 // Kaidan
 #include "FutureUtils.h"
+#include "SqlUtils.h"
 
 class QThreadPool;
 class QSqlQuery;
@@ -30,11 +33,58 @@ public:
 	template<typename Functor>
 	auto run(Functor function) const
 	{
-		return runAsync(dbWorker(), function);
+		return runAsync(dbWorker(), measuringQueueWait(SqlUtils::JobQueue::Database, finishingCachedQueries(std::move(function))));
+	}
+
+	/**
+	 * Runs a function that only reads from the database on one of the reader threads.
+	 *
+	 * In contrast to run(), the function is not blocked by writes on the database thread.
+	 * But it may run before writes that have been requested earlier are finished.
+	 * Thus, it must not depend on such writes.
+	 */
+	template<typename Functor>
+	auto runRead(Functor function) const
+	{
+		return QtConcurrent::run(readerPool(), measuringQueueWait(SqlUtils::JobQueue::Readers, finishingCachedQueries(std::move(function))));
 	}
 
 protected:
 	QObject *dbWorker() const;
+	QThreadPool *readerPool() const;
+
+	/**
+	 * Wraps a function for running it on the database thread so that the cached queries used by
+	 * it are finished afterwards and do not hold read locks until their next execution.
+	 */
+	template<typename Functor>
+	static auto finishingCachedQueries(Functor function)
+	{
+		return [function = std::move(function)]() mutable {
+			const auto finishCachedQueries = qScopeGuard([] {
+				SqlUtils::finishCachedQueries();
+			});
+			return function();
+		};
+	}
+
+	/**
+	 * Wraps a function so that the time between requesting and starting it is recorded if the
+	 * SQL instrumentation is enabled.
+	 */
+	template<typename Functor>
+	static auto measuringQueueWait(SqlUtils::JobQueue queue, Functor function)
+	{
+		using Clock = std::chrono::steady_clock;
+		const auto requestTime = SqlUtils::isInstrumentationEnabled() ? std::optional(Clock::now()) : std::nullopt;
+
+		return [queue, requestTime, function = std::move(function)]() mutable {
+			if (requestTime) {
+				SqlUtils::recordQueueWait(queue, Clock::now() - *requestTime);
+			}
+			return function();
+		};
+	}
 
 private:
 	Database *m_database;
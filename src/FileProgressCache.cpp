@@ -6,6 +6,7 @@
 #include "FileProgressCache.h"
 
 #include <QCoreApplication>
+#include <QTimer>
 
 FileProgressWatcher::FileProgressWatcher(QObject *parent)
 	: QObject(parent)
@@ -71,8 +72,63 @@ void FileProgressCache::reportProgress(qint64 fileId, std::optional<FileProgress
 	} else {
 		m_files.erase(fileId);
 	}
-	// watchers live on main thread
-	QMetaObject::invokeMethod(QCoreApplication::instance(), [fileId, progress] {
+
+	// Only the latest progress of a file is notified.
+	m_pendingNotifications.insert_or_assign(fileId, progress);
+
+	// The end of a transfer is notified without delay so that it is displayed as finished right
+	// away.
+	scheduleNotification(!progress);
+}
+
+void FileProgressCache::scheduleNotification(bool immediately)
+{
+	if (immediately) {
+		// Notifications scheduled before find nothing left to notify.
+		QMetaObject::invokeMethod(QCoreApplication::instance(), [this] {
+			notifyWatchers();
+		}, Qt::QueuedConnection);
+		return;
+	}
+
+	if (m_notificationScheduled) {
+		return;
+	}
+
+	m_notificationScheduled = true;
+
+	// Watchers live on the main thread.
+	// The timer is started there as well because the reporting thread may have no event loop.
+	QMetaObject::invokeMethod(QCoreApplication::instance(), [this] {
+		const auto elapsed = m_notificationTimer.isValid() ? std::chrono::milliseconds(m_notificationTimer.elapsed()) : NOTIFICATION_INTERVAL;
+
+		if (elapsed >= NOTIFICATION_INTERVAL) {
+			notifyWatchers();
+		} else {
+			QTimer::singleShot(NOTIFICATION_INTERVAL - elapsed, QCoreApplication::instance(), [this] {
+				notifyWatchers();
+			});
+		}
+	}, Qt::QueuedConnection);
+}
+
+void FileProgressCache::notifyWatchers()
+{
+	std::unordered_map<qint64, std::optional<FileProgress>> notifications;
+
+	{
+		std::scoped_lock locker(m_mutex);
+		std::swap(notifications, m_pendingNotifications);
+		m_notificationScheduled = false;
+	}
+
+	if (notifications.empty()) {
+		return;
+	}
+
+	m_notificationTimer.start();
+
+	for (const auto &[fileId, progress] : notifications) {
 		FileProgressNotifier::instance().notifyWatchers(fileId, progress);
-	});
+	}
 }
@@ -5,7 +5,9 @@
 
 #pragma once
 
+#include <QElapsedTimer>
 #include <QObject>
+#include <chrono>
 #include <mutex>
 
 #include "AbstractNotifier.h"
@@ -50,19 +52,66 @@ private:
 	FileProgress m_progress;
 };
 
+/**
+ * Cache for the progress of file transfers
+ *
+ * Progress can be reported from any thread.
+ * The watchers are notified on the main thread.
+ * Since transfers may report their progress thousands of times per second, the reported progress
+ * is coalesced per file and the watchers are notified at most once per
+ * FileProgressCache::NOTIFICATION_INTERVAL.
+ * The end of a transfer is always notified right away.
+ */
 class FileProgressCache
 {
 public:
+	/**
+	 * Minimum interval between notifications of watchers about intermediate progress, which
+	 * corresponds to one frame at 60 Hz
+	 */
+	static constexpr std::chrono::milliseconds NOTIFICATION_INTERVAL = std::chrono::milliseconds(16);
+
 	~FileProgressCache();
 
 	static FileProgressCache &instance();
 
 	std::optional<FileProgress> progress(qint64 fileId);
+
+	/**
+	 * Reports the progress of a file transfer.
+	 *
+	 * @param fileId ID of the transferred file
+	 * @param progress progress of the transfer or an empty optional if it has finished
+	 */
 	void reportProgress(qint64 fileId, std::optional<FileProgress> progress);
 
 private:
 	FileProgressCache();
 
+	/**
+	 * Schedules notifying the watchers.
+	 *
+	 * Must be called with the mutex locked.
+	 *
+	 * @param immediately whether to notify the watchers without waiting for the rest of the
+	 *        notification interval
+	 */
+	void scheduleNotification(bool immediately);
+
+	/**
+	 * Notifies the watchers about all progress reported since the last notification.
+	 *
+	 * Must be called on the main thread.
+	 */
+	void notifyWatchers();
+
 	std::mutex m_mutex;
 	std::unordered_map<qint64, FileProgress> m_files;
+
+	// latest progress per file that has not been notified yet
+	std::unordered_map<qint64, std::optional<FileProgress>> m_pendingNotifications;
+	bool m_notificationScheduled = false;
+
+	// only accessed on the main thread
+	QElapsedTimer m_notificationTimer;
 };
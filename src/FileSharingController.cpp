@@ -6,15 +6,22 @@
 #include "FileSharingController.h"
 
 // std
+#include <algorithm>
 #include <array>
+#include <optional>
 
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFile>
 #include <QMimeDatabase>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPointer>
 #include <QRandomGenerator>
 #include <QImage>
 #include <QStandardPaths>
 #include <QStringBuilder>
+#include <QtConcurrent>
 
 #include <QXmppError.h>
 #include <QXmppFileMetadata.h>
@@ -135,8 +142,226 @@ static std::optional<std::pair<QString, QString>> sanitizeFilename(QStringView f
 	return std::make_pair(filename, fileExtension);
 }
 
+// Host used for scheduling uploads, which all go to the upload service of the user's server
+const auto UPLOAD_SERVICE_HOST = QStringLiteral("upload-service");
+
+static QString downloadDirPath()
+{
+	return QStandardPaths::writableLocation(QStandardPaths::DownloadLocation) +
+		QDir::separator() + APPLICATION_DISPLAY_NAME;
+}
+
+///
+/// Returns a unique path in the download directory for a file to be downloaded.
+///
+static QString downloadFilePath(const QXmppFileShare &fileShare)
+{
+	const auto dirPath = downloadDirPath();
+
+	if (auto dir = QDir(dirPath); !dir.exists()) {
+		dir.mkpath(QStringLiteral("."));
+	}
+
+	// Sanitize file name, if given
+	auto maybeFileName = andThen(fileShare.metadata().filename(), sanitizeFilename);
+
+	// Add fallback file name, so we always have a file name
+	auto filename = [&]() {
+		if (maybeFileName) {
+			return maybeFileName->first;
+		}
+		return QDateTime::currentDateTime().toString();
+	}();
+
+	const auto fileExtension = [&]() {
+		auto extension = fileShare.metadata().mediaType()->preferredSuffix();
+		if (!extension.isEmpty()) {
+			return extension;
+		}
+		if (maybeFileName) {
+			return maybeFileName->second;
+		}
+		return QString();
+	}();
+
+	auto makeFileName = [&]() -> QString {
+		return dirPath % QDir::separator() % filename % "." % fileExtension;
+	};
+
+	QString filePath = makeFileName();
+
+	// Check if the file name is already taken, and propose one that is unique
+	if (QFile::exists(filePath)) {
+		filename = KFileUtils::suggestName(QUrl::fromLocalFile(dirPath), filename);
+		filePath = makeFileName();
+	}
+
+	return filePath;
+}
+
+///
+/// Returns the path of the file containing the data of an unfinished download.
+///
+/// The path only depends on the file ID so that the download can be resumed.
+///
+static QString partialDownloadFilePath(qint64 fileId)
+{
+	const QString dirPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) % QDir::separator() % QStringLiteral("downloads");
+
+	if (auto dir = QDir(dirPath); !dir.exists()) {
+		dir.mkpath(QStringLiteral("."));
+	}
+
+	return dirPath % QDir::separator() % QString::number(fileId) % QStringLiteral(".part");
+}
+
+///
+/// Returns the path of the file containing the validator of an unfinished download.
+///
+/// The validator is the entity tag or the date of the last modification sent by the server.
+/// It is used for resuming the download only if the file on the server has not changed.
+///
+static QString partialDownloadValidatorFilePath(qint64 fileId)
+{
+	return partialDownloadFilePath(fileId) % QStringLiteral(".validator");
+}
+
+///
+/// Returns the validator of an unfinished download or an empty byte array if there is none.
+///
+static QByteArray partialDownloadValidator(qint64 fileId)
+{
+	QFile validatorFile(partialDownloadValidatorFilePath(fileId));
+
+	if (!validatorFile.open(QIODevice::ReadOnly)) {
+		return {};
+	}
+
+	return validatorFile.readAll();
+}
+
+///
+/// Stores the validator of a download's response so that the download can be resumed safely.
+///
+static void storePartialDownloadValidator(qint64 fileId, const QNetworkReply *reply)
+{
+	// Weak entity tags cannot be used for resuming downloads.
+	auto validator = reply->rawHeader(QByteArrayLiteral("ETag"));
+	if (validator.isEmpty() || validator.startsWith("W/")) {
+		validator = reply->rawHeader(QByteArrayLiteral("Last-Modified"));
+	}
+
+	if (validator.isEmpty()) {
+		QFile::remove(partialDownloadValidatorFilePath(fileId));
+		return;
+	}
+
+	QFile validatorFile(partialDownloadValidatorFilePath(fileId));
+
+	if (validatorFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		validatorFile.write(validator);
+	}
+}
+
+///
+/// Deletes the data of an unfinished download.
+///
+static void removePartialDownload(qint64 fileId)
+{
+	QFile::remove(partialDownloadFilePath(fileId));
+	QFile::remove(partialDownloadValidatorFilePath(fileId));
+}
+
+///
+/// Returns the algorithm of QCryptographicHash for a hash algorithm used by XMPP or an empty
+/// optional if Qt does not support it.
+///
+static std::optional<QCryptographicHash::Algorithm> cryptographicHashAlgorithm(QXmpp::HashAlgorithm algorithm)
+{
+	switch (algorithm) {
+	case QXmpp::HashAlgorithm::Sha256:
+		return QCryptographicHash::Sha256;
+	case QXmpp::HashAlgorithm::Sha384:
+		return QCryptographicHash::Sha384;
+	case QXmpp::HashAlgorithm::Sha512:
+		return QCryptographicHash::Sha512;
+	case QXmpp::HashAlgorithm::Sha3_256:
+		return QCryptographicHash::Sha3_256;
+	case QXmpp::HashAlgorithm::Sha3_384:
+		return QCryptographicHash::Sha3_384;
+	case QXmpp::HashAlgorithm::Sha3_512:
+		return QCryptographicHash::Sha3_512;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+	case QXmpp::HashAlgorithm::Blake2b_256:
+		return QCryptographicHash::Blake2b_256;
+	case QXmpp::HashAlgorithm::Blake2b_384:
+		return QCryptographicHash::Blake2b_384;
+	case QXmpp::HashAlgorithm::Blake2b_512:
+		return QCryptographicHash::Blake2b_512;
+#endif
+	default:
+		return {};
+	}
+}
+
+///
+/// Returns whether the file has a hash whose algorithm is supported for verifying its data.
+///
+/// Blake2 hashes are only supported with Qt 6.
+///
+static bool hasVerifiableHash(const File &file)
+{
+	return std::any_of(file.hashes.cbegin(), file.hashes.cend(), [](const FileHash &hash) {
+		return cryptographicHashAlgorithm(hash.hashType).has_value();
+	});
+}
+
+///
+/// Returns whether the data of an unfinished download matches all hashes of the file whose
+/// algorithms are supported.
+///
+static bool verifyPartialDownload(const File &file)
+{
+	QFile partialFile(partialDownloadFilePath(file.id));
+
+	if (!partialFile.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	for (const auto &expectedHash : file.hashes) {
+		if (const auto algorithm = cryptographicHashAlgorithm(expectedHash.hashType)) {
+			QCryptographicHash hash(*algorithm);
+
+			if (!partialFile.seek(0) || !hash.addData(&partialFile) || hash.result() != expectedHash.hashValue) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+///
+/// Deletes a local file if it has been downloaded by us.
+///
+static void removeDownloadedFile(const QString &filePath)
+{
+	// don't delete files not downloaded by us
+	if (filePath.startsWith(downloadDirPath())) {
+		QFile::remove(filePath);
+	}
+}
+
 FileSharingController::FileSharingController(QXmppClient *client)
+	: m_transferScheduler(new TransferScheduler(this))
 {
+	// Downloaded files are deleted once no file refers to them anymore.
+	connect(MessageDb::instance(), &MessageDb::localFilesUnreferenced, this, [](const QVector<QString> &localFilePaths) {
+		for (const auto &localFilePath : localFilePaths) {
+			removeDownloadedFile(localFilePath);
+		}
+	});
+
 	runOnThread(client, [client]() {
 		auto reqMan = client->findExtension<QXmppUploadRequestManager>();
 		Q_ASSERT(reqMan);
@@ -178,7 +403,12 @@ auto FileSharingController::sendFiles(QVector<File> files, bool encrypt)
 				auto &[id, uploadResult] = result;
 				return std::holds_alternative<QXmppError>(uploadResult);
 			});
-			Q_ASSERT(errorIt != uploadResults.end());
+
+			// The uploads without errors were cancelled.
+			if (errorIt == uploadResults.end()) {
+				promise.finish(QXmppError { tr("The upload was cancelled"), QXmpp::Cancelled() });
+				return;
+			}
 
 			// currently this only gives the error of the first failed upload
 			promise.finish(std::get<QXmppError>(std::get<1>(std::move(*errorIt))));
@@ -229,6 +459,7 @@ auto FileSharingController::sendFiles(QVector<File> files, bool encrypt)
 				};
 			});
 
+			// The hashes are calculated while the file is uploaded.
 			file.hashes = transform(fileResult->second.fileShare.metadata().hashes(), [&](const auto &hash) {
 				return FileHash { file.id, hash.algorithm(), hash.hash() };
 			});
@@ -245,42 +476,64 @@ auto FileSharingController::sendFile(const File &file, bool encrypt)
 {
 	QFutureInterface<UploadResult> interface;
 
-	auto *client = Kaidan::instance()->client();
+	FileProgressCache::instance()
+		.reportProgress(file.id, FileProgress { 0, quint64(file.size.value_or(0)), 0.0F });
 
-	runOnThread(client, [this, client, file, encrypt, interface]() mutable {
-		auto provider = encrypt
-				? std::static_pointer_cast<QXmppFileSharingProvider>(client->encryptedHttpFileSharingProvider())
-				: std::static_pointer_cast<QXmppFileSharingProvider>(client->httpFileSharingProvider());
+	// All uploads go to the upload service of the user's server.
+	m_transferScheduler->schedule(file.id, UPLOAD_SERVICE_HOST, TransferScheduler::Priority::UserInitiated, [this, file, encrypt, interface](const std::shared_ptr<TransferHandle> &handle) mutable {
+		if (handle->isCancelled()) {
+			FileProgressCache::instance().reportProgress(file.id, std::nullopt);
+			reportFinishedResult(interface, { file.id, QXmpp::Cancelled() });
+			handle->finish();
+			return;
+		}
 
-		auto upload = client->fileSharingManager()->uploadFile(
-					provider,
-					file.localFilePath,
-					file.description);
+		auto *client = Kaidan::instance()->client();
 
-		FileProgressCache::instance()
-			.reportProgress(file.id, FileProgress { 0, quint64(upload->bytesTotal()), 0.0F });
+		runOnThread(client, [this, client, file, encrypt, interface, handle]() mutable {
+			auto provider = encrypt
+					? std::static_pointer_cast<QXmppFileSharingProvider>(client->encryptedHttpFileSharingProvider())
+					: std::static_pointer_cast<QXmppFileSharingProvider>(client->httpFileSharingProvider());
 
-		std::weak_ptr<QXmppFileUpload> uploadPtr = upload;
-		connect(upload.get(), &QXmppFileUpload::progressChanged, this, [id = file.id, uploadPtr] {
-			if (auto upload = uploadPtr.lock()) {
-				FileProgressCache::instance()
-					.reportProgress(id, FileProgress { upload->bytesTransferred(), quint64(upload->bytesTotal()), upload->progress() });
-			}
-		});
+			auto upload = client->fileSharingManager()->uploadFile(
+						provider,
+						file.localFilePath,
+						file.description);
 
-		connect(upload.get(), &QXmppFileUpload::finished, this, [this, upload, id = file.id, interface]() mutable {
-			auto result = upload->result();
+			FileProgressCache::instance()
+				.reportProgress(file.id, FileProgress { 0, quint64(upload->bytesTotal()), 0.0F });
 
-			FileProgressCache::instance().reportProgress(id, std::nullopt);
+			std::weak_ptr<QXmppFileUpload> uploadPtr = upload;
+			connect(upload.get(), &QXmppFileUpload::progressChanged, this, [id = file.id, uploadPtr] {
+				if (auto upload = uploadPtr.lock()) {
+					FileProgressCache::instance()
+						.reportProgress(id, FileProgress { upload->bytesTransferred(), quint64(upload->bytesTotal()), upload->progress() });
+				}
+			});
 
-			if (std::holds_alternative<QXmppError>(result)) {
-				Q_EMIT errorOccured(id, std::get<QXmppError>(result));
-			}
+			connect(upload.get(), &QXmppFileUpload::finished, this, [this, upload, id = file.id, interface, handle]() mutable {
+				auto result = upload->result();
 
-			interface.reportResult({id, result});
-			interface.reportFinished();
-			// reduce ref count
-			upload.reset();
+				FileProgressCache::instance().reportProgress(id, std::nullopt);
+
+				if (std::holds_alternative<QXmppError>(result)) {
+					Q_EMIT errorOccured(id, std::get<QXmppError>(result));
+				}
+
+				interface.reportResult({id, result});
+				interface.reportFinished();
+				handle->finish();
+				// reduce ref count
+				upload.reset();
+			});
+
+			handle->setCanceller([client, uploadPtr]() {
+				runOnThread(client, [uploadPtr]() {
+					if (auto upload = uploadPtr.lock()) {
+						upload->cancel();
+					}
+				});
+			});
 		});
 	});
 
@@ -289,55 +542,86 @@ auto FileSharingController::sendFile(const File &file, bool encrypt)
 
 void FileSharingController::downloadFile(const QString &messageId, const File &file)
 {
-	auto *client = Kaidan::instance()->client();
+	downloadFile(messageId, file, TransferScheduler::Priority::UserInitiated);
+}
 
-	runOnThread(client, [this, client, messageId, fileId = file.id, fileShare = file.toQXmpp()] {
-		QString dirPath = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation) +
-						  QDir::separator() + APPLICATION_DISPLAY_NAME;
+void FileSharingController::downloadFile(const QString &messageId, const File &file, TransferScheduler::Priority priority)
+{
+	const auto host = [&file]() {
+		if (!file.httpSources.isEmpty()) {
+			return file.httpSources.constFirst().url.host();
+		}
+		if (!file.encryptedSources.isEmpty()) {
+			return file.encryptedSources.constFirst().url.host();
+		}
+		return QString();
+	}();
+
+	const auto scheduled = m_transferScheduler->schedule(file.id, host, priority, [this, messageId, file](const std::shared_ptr<TransferHandle> &handle) {
+		startDownload(messageId, file, handle);
+	});
 
-		if (auto dir = QDir(dirPath); !dir.exists()) {
-			dir.mkpath(QStringLiteral("."));
+	// Pending downloads are displayed as loading.
+	if (scheduled && !m_transferScheduler->isRunning(file.id)) {
+		FileProgressCache::instance()
+			.reportProgress(file.id, FileProgress { 0, quint64(file.size.value_or(0)), 0.0F });
+	}
+}
+
+void FileSharingController::downloadFileAutomatically(const QString &accountJid, const QString &messageId, const File &file)
+{
+	if (file.hashes.isEmpty()) {
+		downloadFile(messageId, file, TransferScheduler::Priority::Automatic);
+		return;
+	}
+
+	// A file with the same content that has already been downloaded, e.g., for a forwarded
+	// message, is referenced instead of downloading it again.
+	await(MessageDb::instance()->referenceLocalFile(accountJid, messageId, file.id, file.hashes), this, [this, messageId, file](bool referenced) {
+		if (!referenced) {
+			downloadFile(messageId, file, TransferScheduler::Priority::Automatic);
 		}
+	});
+}
 
-		// Sanitize file name, if given
-		auto maybeFileName = andThen(fileShare.metadata().filename(), sanitizeFilename);
+void FileSharingController::cancelTransfer(const File &file)
+{
+	m_transferScheduler->cancel(file.id);
+}
 
-		// Add fallback file name, so we always have a file name
-		auto filename = [&]() {
-			if (maybeFileName) {
-				return maybeFileName->first;
-			}
-			return QDateTime::currentDateTime().toString();
-		}();
+void FileSharingController::setFileVisible(const File &file, bool visible)
+{
+	m_transferScheduler->setVisible(file.id, visible);
+}
 
-		const auto fileExtension = [&]() {
-			auto extension = fileShare.metadata().mediaType()->preferredSuffix();
-			if (!extension.isEmpty()) {
-				return extension;
-			}
-			if (maybeFileName) {
-				return maybeFileName->second;
-			}
-			return QString();
-		}();
+void FileSharingController::startDownload(const QString &messageId, const File &file, const std::shared_ptr<TransferHandle> &handle)
+{
+	if (handle->isCancelled()) {
+		FileProgressCache::instance().reportProgress(file.id, std::nullopt);
+		handle->finish();
+		return;
+	}
 
-		auto makeFileName = [&]() -> QString {
-			return dirPath % QDir::separator() % filename % "." % fileExtension;
-		};
+	// Unencrypted files are downloaded directly so that interrupted downloads can be resumed.
+	// Encrypted files are decrypted while they are downloaded by QXmpp, which does not support
+	// resuming.
+	if (!file.httpSources.isEmpty() && file.encryptedSources.isEmpty()) {
+		startResumableDownload(messageId, file, handle);
+		return;
+	}
 
-		QString filePath = makeFileName();
+	auto *client = Kaidan::instance()->client();
 
-		// Check if the file name is already taken, and propose one that is unique
-		if (QFile::exists(filePath)) {
-			filename = KFileUtils::suggestName(QUrl::fromLocalFile(dirPath), filename);
-			filePath = makeFileName();
-		}
+	runOnThread(client, [this, client, messageId, fileId = file.id, fileShare = file.toQXmpp(), handle] {
+		const auto filePath = downloadFilePath(fileShare);
 
 		// Open the file at the resulting path
 		auto output = std::make_unique<QFile>(filePath);
 
 		if (!output->open(QIODevice::WriteOnly)) {
 			qDebug() << "Failed to open output file at" << filePath;
+			FileProgressCache::instance().reportProgress(fileId, {});
+			handle->finish();
 			return;
 		}
 
@@ -360,23 +644,206 @@ void FileSharingController::downloadFile(const QString &messageId, const File &f
 				Q_EMIT Kaidan::instance()->passiveNotificationRequested(
 					tr("Couldn't download file: %1").arg(errorText));
 			} else if (std::holds_alternative<QXmppFileDownload::Downloaded>(result)) {
-				MessageDb::instance()->updateMessage(messageId, [=](Message &message) {
-					auto *file = find_if(message.files, [=](const auto &file) {
-						return file.id == fileId;
-					});
-
-					if (file != message.files.cend()) {
-						file->localFilePath = filePath;
-					}
-					// TODO: generate possibly missing metadata
-					// metadata may be missing if the sender only used out of band urls
-				});
+				setDownloadedFilePath(messageId, fileId, filePath);
+			} else {
+				QFile::remove(filePath);
 			}
 
 			FileProgressCache::instance().reportProgress(fileId, {});
+			handle->finish();
 			// reduce ref count
 			download.reset();
 		});
+
+		handle->setCanceller([client, downloadPtr]() {
+			runOnThread(client, [downloadPtr]() {
+				if (auto download = downloadPtr.lock()) {
+					download->cancel();
+				}
+			});
+		});
+	});
+}
+
+void FileSharingController::startResumableDownload(const QString &messageId, const File &file, const std::shared_ptr<TransferHandle> &handle)
+{
+	auto *client = Kaidan::instance()->client();
+
+	runOnThread(client, [this, client, messageId, file, handle]() {
+		auto output = std::make_shared<QFile>(partialDownloadFilePath(file.id));
+
+		if (!output->open(QIODevice::ReadWrite | QIODevice::Append)) {
+			qDebug() << "[FileSharingController] Failed to open partial download file at" << output->fileName();
+			FileProgressCache::instance().reportProgress(file.id, {});
+			handle->finish();
+			return;
+		}
+
+		// The download is continued after the data that was downloaded before.
+		auto offset = output->size();
+		const auto validator = partialDownloadValidator(file.id);
+
+		// Without hashes whose algorithms are supported, the combined data cannot be verified once
+		// the download is finished.
+		// In that case, the download is only resumed if the server can ensure via the validator
+		// that the file has not changed in the meantime.
+		// Otherwise, the whole file is downloaded again.
+		if (offset > 0 && !hasVerifiableHash(file) && validator.isEmpty()) {
+			output->resize(0);
+			offset = 0;
+		}
+
+		QNetworkRequest request(file.httpSources.constFirst().url);
+
+		// Redirects are followed unless they lead from HTTPS to HTTP.
+		request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+
+		if (offset > 0) {
+			request.setRawHeader(QByteArrayLiteral("Range"), QByteArrayLiteral("bytes=") + QByteArray::number(offset) + '-');
+
+			// If the file has changed, the server sends the whole new file.
+			if (!validator.isEmpty()) {
+				request.setRawHeader(QByteArrayLiteral("If-Range"), validator);
+			}
+		}
+
+		auto *reply = client->networkManager()->get(request);
+
+		const auto reportProgress = [fileId = file.id, fileSize = file.size, output, reply]() {
+			const auto bytesReceived = quint64(output->size());
+			const auto bytesTotal = fileSize ? quint64(*fileSize) : quint64(std::max<qint64>(0, reply->header(QNetworkRequest::ContentLengthHeader).toLongLong()));
+			const auto progress = bytesTotal == 0 ? 0.0F : float(bytesReceived) / float(bytesTotal);
+			FileProgressCache::instance().reportProgress(fileId, FileProgress { bytesReceived, bytesTotal, progress });
+		};
+
+		// Only the data of a complete file (200) or of the requested range (206) is written.
+		// Other responses such as errors must neither be written nor replace the data and the
+		// validator of the unfinished download.
+		const auto isFileData = [reply]() {
+			const auto statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+			return statusCode == 200 || statusCode == 206;
+		};
+
+		connect(reply, &QNetworkReply::metaDataChanged, reply, [fileId = file.id, reply, output]() {
+			switch (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt()) {
+			case 200:
+				// If the server does not support ranges or the file has changed, it sends the
+				// whole file.
+				output->resize(0);
+				storePartialDownloadValidator(fileId, reply);
+				break;
+			case 206:
+				// The requested range is appended to the data downloaded before.
+				break;
+			case 301:
+			case 302:
+			case 303:
+			case 307:
+			case 308:
+				// The redirect is followed and the status of its target is evaluated once the
+				// target's metadata is received.
+				break;
+			default:
+				reply->abort();
+			}
+		});
+
+		connect(reply, &QNetworkReply::readyRead, reply, [reply, output, reportProgress, isFileData]() {
+			if (isFileData()) {
+				output->write(reply->readAll());
+				reportProgress();
+			}
+		});
+
+		connect(reply, &QNetworkReply::finished, reply, [this, reply, output, messageId, file, handle, isFileData]() {
+			if (isFileData()) {
+				output->write(reply->readAll());
+			}
+			output->close();
+			reply->deleteLater();
+
+			if (handle->isCancelled()) {
+				removePartialDownload(file.id);
+				FileProgressCache::instance().reportProgress(file.id, {});
+				handle->finish();
+				return;
+			}
+
+			if (reply->error() != QNetworkReply::NoError) {
+				// The partial file is kept for resuming the download later unless its range is
+				// invalid.
+				if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 416) {
+					removePartialDownload(file.id);
+				}
+
+				// A reply with an unexpected status is aborted so that its error is replaced by the
+				// cancellation.
+				const auto errorText = isFileData() ? reply->errorString() : reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute).toString();
+
+				qDebug() << "[FileSharingController] Couldn't download file:" << errorText;
+				Q_EMIT Kaidan::instance()->passiveNotificationRequested(
+					tr("Couldn't download file: %1").arg(errorText));
+
+				FileProgressCache::instance().reportProgress(file.id, {});
+				handle->finish();
+				return;
+			}
+
+			runOnThread(this, [this, messageId, file, handle]() {
+				finishResumableDownload(messageId, file, handle);
+			});
+		});
+
+		handle->setCanceller([client, reply = QPointer(reply)]() {
+			runOnThread(client, [reply]() {
+				if (reply) {
+					reply->abort();
+				}
+			});
+		});
+	});
+}
+
+void FileSharingController::finishResumableDownload(const QString &messageId, const File &file, const std::shared_ptr<TransferHandle> &handle)
+{
+	const auto partialFilePath = partialDownloadFilePath(file.id);
+
+	// Since the data may have been downloaded in several parts, it is verified completely.
+	await(QtConcurrent::run(verifyPartialDownload, file), this, [this, messageId, file, handle, partialFilePath](bool verified) {
+		if (!verified) {
+			removePartialDownload(file.id);
+
+			qDebug() << "[FileSharingController] Couldn't download file: Hash mismatch";
+			Q_EMIT Kaidan::instance()->passiveNotificationRequested(
+				tr("Couldn't download file: %1").arg(tr("The file is corrupted")));
+		} else {
+			const auto filePath = downloadFilePath(file.toQXmpp());
+
+			if (QFile::rename(partialFilePath, filePath) || (QFile::copy(partialFilePath, filePath) && QFile::remove(partialFilePath))) {
+				QFile::remove(partialDownloadValidatorFilePath(file.id));
+				setDownloadedFilePath(messageId, file.id, filePath);
+			} else {
+				qDebug() << "[FileSharingController] Failed to move downloaded file to" << filePath;
+			}
+		}
+
+		FileProgressCache::instance().reportProgress(file.id, {});
+		handle->finish();
+	});
+}
+
+void FileSharingController::setDownloadedFilePath(const QString &messageId, qint64 fileId, const QString &filePath)
+{
+	MessageDb::instance()->updateMessage(messageId, [=](Message &message) {
+		auto *file = find_if(message.files, [=](const auto &file) {
+			return file.id == fileId;
+		});
+
+		if (file != message.files.cend()) {
+			file->localFilePath = filePath;
+		}
+		// TODO: generate possibly missing metadata
+		// metadata may be missing if the sender only used out of band urls
 	});
 }
 
@@ -391,9 +858,13 @@ void FileSharingController::deleteFile(const QString &messageId, const File &fil
 		}
 	});
 
-	// don't delete files not downloaded by us
-	const auto downloadsFolder = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation) + QDir::separator() + APPLICATION_DISPLAY_NAME;
-	if (file.localFilePath.startsWith(downloadsFolder)) {
-		QFile::remove(file.localFilePath);
+	// The local file is kept as long as files of other messages with the same content refer to
+	// it.
+	if (!file.localFilePath.isEmpty()) {
+		await(MessageDb::instance()->isLocalFileReferenced(file.localFilePath), this, [localFilePath = file.localFilePath](bool referenced) {
+			if (!referenced) {
+				removeDownloadedFile(localFilePath);
+			}
+		});
 	}
 }
@@ -10,6 +10,8 @@
 
 #include <QXmppFileSharingManager.h>
 
+#include "TransferScheduler.h"
+
 struct File;
 struct Message;
 class QXmppFileSharingManager;
@@ -29,10 +31,41 @@ public:
 
 	auto sendFiles(QVector<File> files, bool encrypt) -> QXmppTask<SendFilesResult>;
 	Q_INVOKABLE void downloadFile(const QString &messageId, const File &file);
+	void downloadFile(const QString &messageId, const File &file, TransferScheduler::Priority priority);
+
+	/**
+	 * Downloads a file automatically unless an already downloaded file of the same account has
+	 * the same content.
+	 *
+	 * In that case, the file refers to the existing local file instead of downloading it again.
+	 * As a trade-off for the saved traffic and storage, the host of the file can notice the
+	 * missing download and infer that the file has already been received by the account.
+	 * Thus, only automatic downloads are deduplicated while files downloaded on request are
+	 * always downloaded.
+	 */
+	void downloadFileAutomatically(const QString &accountJid, const QString &messageId, const File &file);
 	Q_INVOKABLE void deleteFile(const QString &messageId, const File &file);
 
+	/**
+	 * Cancels the pending or running upload or download of a file.
+	 */
+	Q_INVOKABLE void cancelTransfer(const File &file);
+
+	/**
+	 * Sets whether a file is displayed so that its pending transfer is started before others.
+	 *
+	 * Each call with visible set to true must be followed by one with visible set to false.
+	 */
+	Q_INVOKABLE void setFileVisible(const File &file, bool visible);
+
 	Q_SIGNAL void errorOccured(qint64, QXmppError);
 
 private:
 	QFuture<UploadResult> sendFile(const File &file, bool encrypt);
+	void startDownload(const QString &messageId, const File &file, const std::shared_ptr<TransferHandle> &handle);
+	void startResumableDownload(const QString &messageId, const File &file, const std::shared_ptr<TransferHandle> &handle);
+	void finishResumableDownload(const QString &messageId, const File &file, const std::shared_ptr<TransferHandle> &handle);
+	void setDownloadedFilePath(const QString &messageId, qint64 fileId, const QString &filePath);
+
+	TransferScheduler *m_transferScheduler;
 };
@@ -82,14 +82,33 @@ void await(Runner *runner, Functor function, QObject *context, Handler handler)
 	});
 }
 
-template<typename T>
-void reportFinishedResult(QFutureInterface<T> &interface, const T &result)
+// Moves a result into a future.
+//
+// QFutureInterface of Qt 5 can only store copies of results.
+// Large results should therefore be implicitly shared (e.g., QVector instead of std::vector) so
+// that storing them only increases their reference counts.
+// They are shared with all handlers receiving them and must not be modified by the handlers
+// because that would copy all their data.
+template<typename T, typename Result = T>
+void reportMovedResult(QFutureInterface<T> &interface, Result &&result)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+	interface.reportResult(T(std::forward<Result>(result)));
+#else
+	interface.reportResult(static_cast<const T &>(result));
+#endif
+}
+
+template<typename T, typename Result = T>
+void reportFinishedResult(QFutureInterface<T> &interface, Result &&result)
 {
-	interface.reportResult(result);
+	reportMovedResult(interface, std::forward<Result>(result));
 	interface.reportFinished();
 }
 
 // Runs a function on targetObject's thread and returns the result via QFuture.
+//
+// The result is moved into the future (see reportMovedResult()).
 template<typename Function>
 auto runAsync(QObject *targetObject, Function function)
 {
@@ -102,7 +121,7 @@ auto runAsync(QObject *targetObject, Function function)
 			function();
 		}
 		if constexpr (!std::is_same_v<ValueType, void>) {
-			interface.reportResult(function());
+			reportMovedResult(interface, function());
 		}
 		interface.reportFinished();
 	});
@@ -111,6 +130,7 @@ auto runAsync(QObject *targetObject, Function function)
 
 // Runs a function on targetObject's thread and reports the result on callerObject's thread.
 // This is useful / required because QXmppTasks are not thread-safe.
+// In contrast to runAsync(), the result is moved to the caller's thread and into the task.
 template<typename Function>
 auto runAsyncTask(QObject *callerObject, QObject *targetObject, Function function)
 {
@@ -191,12 +211,11 @@ QFuture<QVector<T>> join(QObject *context, QVector<QFuture<T>> &&futures)
 
 	QFutureInterface<QVector<T>> interface;
 
-	for (auto future : futures) {
+	for (const auto &future : futures) {
 		await(future, context, [=](auto result) mutable {
-			results->push_back(result);
+			results->push_back(std::move(result));
 			if (results->size() == futureCount) {
-				interface.reportResult(*results);
-				interface.reportFinished();
+				reportFinishedResult(interface, std::move(*results));
 			}
 		});
 	}
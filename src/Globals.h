@@ -26,6 +26,8 @@
 #define KAIDAN_SETTINGS_WINDOW_SIZE "window/size"
 #define KAIDAN_SETTINGS_AUTOMATIC_MEDIA_DOWNLOADS_RULE "media/automaticDownloadsRule"
 #define KAIDAN_SETTINGS_HELP_VISIBILITY_QR_CODE_PAGE "helpVisibility/qrCodePage"
+#define KAIDAN_SETTINGS_MESSAGE_WINDOW_SIZE "messages/windowSize"
+#define KAIDAN_SETTINGS_MAX_THUMBNAIL_JOBS "media/maxThumbnailJobs"
 
 #define KAIDAN_JID_RESOURCE_DEFAULT_PREFIX APPLICATION_DISPLAY_NAME
 
@@ -46,6 +48,7 @@ constexpr auto MESSAGE_MAX_CHARS = 1e4;
 #define DB_TABLE_MESSAGES "messages"
 #define DB_VIEW_CHAT_MESSAGES "chatMessages"
 #define DB_VIEW_DRAFT_MESSAGES "draftMessages"
+#define DB_TABLE_MESSAGES_FTS "messagesFts"
 #define DB_TABLE_FILES "files"
 #define DB_TABLE_FILE_HASHES "fileHashes"
 #define DB_TABLE_FILE_HTTP_SOURCES "fileHttpSources"
@@ -62,6 +65,11 @@ constexpr auto MESSAGE_MAX_CHARS = 1e4;
 #define DB_TABLE_OMEMO_SIGNED_PRE_KEY_PAIRS "omemoPreKeyPairsSigned"
 #define DB_TABLE_ROSTER_GROUPS "rosterGroups"
 #define DB_QUERY_LIMIT_MESSAGES 20
+#define DB_QUERY_LIMIT_MESSAGE_SEARCH_RESULTS 50
+// Maximum number of values bound to one query (SQLite's default limit is 999 for old versions)
+#define DB_MAX_BOUND_VALUES_PER_QUERY 500
+// Default maximum number of completely loaded messages of the open chat
+#define DEFAULT_MESSAGE_WINDOW_SIZE 200
 
 //
 // Credential generation
@@ -109,11 +117,21 @@ constexpr auto PROVIDER_LIST_MIN_PROVIDERS_FROM_COUNTRY = 2;
  */
 #define BITS_OF_BINARY_IMAGE_PROVIDER_NAME "bits-of-binary"
 
+/**
+ * Name of the @c QQuickImageProvider for file thumbnails stored in the database.
+ */
+#define THUMBNAIL_IMAGE_PROVIDER_NAME "thumbnail"
+
 // JPEG export quality used when saving images lossy (e.g. when saving images from clipboard)
 constexpr auto JPEG_EXPORT_QUALITY = 85;
 // Maximum file size for reading files just to generate an image thumbnail.
 constexpr auto THUMBNAIL_GENERATION_MAX_FILE_SIZE = 10 * 1024 * 1024;
 // Width and height of generated file thumbnails.
 constexpr auto THUMBNAIL_PIXEL_SIZE = 50;
+// Maximum size of encoded file thumbnails in bytes so that they can be embedded into messages.
+constexpr auto MAX_THUMBNAIL_DATA_SIZE = 8 * 1024;
+// Maximum number of thumbnails generated in parallel by default since each decoded image may
+// occupy a lot of memory.
+constexpr auto DEFAULT_MAX_THUMBNAIL_JOBS = 2;
 
 #endif // GLOBALS_H
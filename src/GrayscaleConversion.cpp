@@ -0,0 +1,353 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "GrayscaleConversion.h"
+
+// std
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GRAYSCALE_CONVERSION_SSE2
+#include <emmintrin.h>
+// AVX2 functions are compiled via the target attribute and only called if the CPU supports them.
+#if defined(__GNUC__) || defined(__clang__)
+#define GRAYSCALE_CONVERSION_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON)
+#define GRAYSCALE_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace GrayscaleConversion {
+
+// Weights of the color channels (ITU-R BT.601) in units of 1/1024
+constexpr int RED_WEIGHT = 306;
+constexpr int GREEN_WEIGHT = 601;
+constexpr int BLUE_WEIGHT = 117;
+constexpr int ROUNDING = 0x200;
+
+static inline uchar gray(uint red, uint green, uint blue)
+{
+	return uchar((RED_WEIGHT * red + GREEN_WEIGHT * green + BLUE_WEIGHT * blue + ROUNDING) >> 10);
+}
+
+static void rgb32ToGrayScalar(const uchar *source, uchar *target, int width, ChannelOffsets offsets)
+{
+	for (int x = 0; x < width; ++x, source += 4) {
+		target[x] = gray(source[offsets.red], source[offsets.green], source[offsets.blue]);
+	}
+}
+
+static void rgb24ToGrayScalar(const uchar *source, uchar *target, int width, ChannelOffsets offsets)
+{
+	for (int x = 0; x < width; ++x, source += 3) {
+		target[x] = gray(source[offsets.red], source[offsets.green], source[offsets.blue]);
+	}
+}
+
+static void yuyvToGrayScalar(const uchar *source, uchar *target, int width)
+{
+	for (int x = 0; x < width; ++x) {
+		target[x] = source[2 * x];
+	}
+}
+
+#ifdef GRAYSCALE_CONVERSION_SSE2
+// Converts 4 pixels to 4 gray values in the lowest bytes of 32-bit integers.
+static inline __m128i rgb32ToGraySse2(__m128i pixels, __m128i redShift, __m128i greenShift, __m128i blueShift)
+{
+	const auto byteMask = _mm_set1_epi32(0xFF);
+	const auto red = _mm_and_si128(_mm_srl_epi32(pixels, redShift), byteMask);
+	const auto green = _mm_and_si128(_mm_srl_epi32(pixels, greenShift), byteMask);
+	const auto blue = _mm_and_si128(_mm_srl_epi32(pixels, blueShift), byteMask);
+
+	// Each 32-bit integer contains two 16-bit factors that are multiplied with the weights and
+	// summed up by _mm_madd_epi16().
+	const auto redGreen = _mm_or_si128(red, _mm_slli_epi32(green, 16));
+	const auto blueOne = _mm_or_si128(blue, _mm_set1_epi32(1 << 16));
+	const auto sum = _mm_add_epi32(
+		_mm_madd_epi16(redGreen, _mm_set1_epi32(RED_WEIGHT | (GREEN_WEIGHT << 16))),
+		_mm_madd_epi16(blueOne, _mm_set1_epi32(BLUE_WEIGHT | (ROUNDING << 16)))
+	);
+
+	return _mm_srli_epi32(sum, 10);
+}
+
+static void rgb32ToGraySse2(const uchar *source, uchar *target, int width, ChannelOffsets offsets)
+{
+	const auto redShift = _mm_cvtsi32_si128(offsets.red * 8);
+	const auto greenShift = _mm_cvtsi32_si128(offsets.green * 8);
+	const auto blueShift = _mm_cvtsi32_si128(offsets.blue * 8);
+	const auto *pixels = reinterpret_cast<const __m128i *>(source);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16, pixels += 4) {
+		const auto gray0 = rgb32ToGraySse2(_mm_loadu_si128(pixels), redShift, greenShift, blueShift);
+		const auto gray1 = rgb32ToGraySse2(_mm_loadu_si128(pixels + 1), redShift, greenShift, blueShift);
+		const auto gray2 = rgb32ToGraySse2(_mm_loadu_si128(pixels + 2), redShift, greenShift, blueShift);
+		const auto gray3 = rgb32ToGraySse2(_mm_loadu_si128(pixels + 3), redShift, greenShift, blueShift);
+
+		const auto gray = _mm_packus_epi16(_mm_packs_epi32(gray0, gray1), _mm_packs_epi32(gray2, gray3));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(target + x), gray);
+	}
+
+	rgb32ToGrayScalar(source + 4 * x, target + x, width - x, offsets);
+}
+
+static void yuyvToGraySse2(const uchar *source, uchar *target, int width)
+{
+	const auto lumaMask = _mm_set1_epi16(0xFF);
+	const auto *pixels = reinterpret_cast<const __m128i *>(source);
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16, pixels += 2) {
+		const auto luma0 = _mm_and_si128(_mm_loadu_si128(pixels), lumaMask);
+		const auto luma1 = _mm_and_si128(_mm_loadu_si128(pixels + 1), lumaMask);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(target + x), _mm_packus_epi16(luma0, luma1));
+	}
+
+	yuyvToGrayScalar(source + 2 * x, target + x, width - x);
+}
+#endif
+
+#ifdef GRAYSCALE_CONVERSION_AVX2
+__attribute__((target("avx2")))
+static inline __m256i rgb32ToGrayAvx2(__m256i pixels, __m128i redShift, __m128i greenShift, __m128i blueShift)
+{
+	const auto byteMask = _mm256_set1_epi32(0xFF);
+	const auto red = _mm256_and_si256(_mm256_srl_epi32(pixels, redShift), byteMask);
+	const auto green = _mm256_and_si256(_mm256_srl_epi32(pixels, greenShift), byteMask);
+	const auto blue = _mm256_and_si256(_mm256_srl_epi32(pixels, blueShift), byteMask);
+
+	const auto redGreen = _mm256_or_si256(red, _mm256_slli_epi32(green, 16));
+	const auto blueOne = _mm256_or_si256(blue, _mm256_set1_epi32(1 << 16));
+	const auto sum = _mm256_add_epi32(
+		_mm256_madd_epi16(redGreen, _mm256_set1_epi32(RED_WEIGHT | (GREEN_WEIGHT << 16))),
+		_mm256_madd_epi16(blueOne, _mm256_set1_epi32(BLUE_WEIGHT | (ROUNDING << 16)))
+	);
+
+	return _mm256_srli_epi32(sum, 10);
+}
+
+__attribute__((target("avx2")))
+static void rgb32ToGrayAvx2(const uchar *source, uchar *target, int width, ChannelOffsets offsets)
+{
+	const auto redShift = _mm_cvtsi32_si128(offsets.red * 8);
+	const auto greenShift = _mm_cvtsi32_si128(offsets.green * 8);
+	const auto blueShift = _mm_cvtsi32_si128(offsets.blue * 8);
+	// The packing instructions work within 128-bit lanes.
+	// Thus, the groups of 4 gray values end up interleaved and need to be reordered.
+	const auto order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	const auto *pixels = reinterpret_cast<const __m256i *>(source);
+
+	int x = 0;
+	for (; x + 32 <= width; x += 32, pixels += 4) {
+		const auto gray0 = rgb32ToGrayAvx2(_mm256_loadu_si256(pixels), redShift, greenShift, blueShift);
+		const auto gray1 = rgb32ToGrayAvx2(_mm256_loadu_si256(pixels + 1), redShift, greenShift, blueShift);
+		const auto gray2 = rgb32ToGrayAvx2(_mm256_loadu_si256(pixels + 2), redShift, greenShift, blueShift);
+		const auto gray3 = rgb32ToGrayAvx2(_mm256_loadu_si256(pixels + 3), redShift, greenShift, blueShift);
+
+		const auto gray = _mm256_packus_epi16(_mm256_packs_epi32(gray0, gray1), _mm256_packs_epi32(gray2, gray3));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(target + x), _mm256_permutevar8x32_epi32(gray, order));
+	}
+
+	rgb32ToGraySse2(source + 4 * x, target + x, width - x, offsets);
+}
+#endif
+
+#ifdef GRAYSCALE_CONVERSION_NEON
+static inline uint8x8_t grayNeon(uint8x8_t red, uint8x8_t green, uint8x8_t blue)
+{
+	const auto red16 = vmovl_u8(red);
+	const auto green16 = vmovl_u8(green);
+	const auto blue16 = vmovl_u8(blue);
+
+	auto low = vmull_n_u16(vget_low_u16(red16), RED_WEIGHT);
+	low = vmlal_n_u16(low, vget_low_u16(green16), GREEN_WEIGHT);
+	low = vmlal_n_u16(low, vget_low_u16(blue16), BLUE_WEIGHT);
+
+	auto high = vmull_n_u16(vget_high_u16(red16), RED_WEIGHT);
+	high = vmlal_n_u16(high, vget_high_u16(green16), GREEN_WEIGHT);
+	high = vmlal_n_u16(high, vget_high_u16(blue16), BLUE_WEIGHT);
+
+	// The rounding shift adds ROUNDING before shifting.
+	return vmovn_u16(vcombine_u16(vrshrn_n_u32(low, 10), vrshrn_n_u32(high, 10)));
+}
+
+static inline uint8x16_t grayNeon(uint8x16_t red, uint8x16_t green, uint8x16_t blue)
+{
+	return vcombine_u8(
+		grayNeon(vget_low_u8(red), vget_low_u8(green), vget_low_u8(blue)),
+		grayNeon(vget_high_u8(red), vget_high_u8(green), vget_high_u8(blue))
+	);
+}
+
+static void rgb32ToGrayNeon(const uchar *source, uchar *target, int width, ChannelOffsets offsets)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		// The channels are loaded into separate registers.
+		const auto pixels = vld4q_u8(source + 4 * x);
+		vst1q_u8(target + x, grayNeon(pixels.val[offsets.red], pixels.val[offsets.green], pixels.val[offsets.blue]));
+	}
+
+	rgb32ToGrayScalar(source + 4 * x, target + x, width - x, offsets);
+}
+
+static void rgb24ToGrayNeon(const uchar *source, uchar *target, int width, ChannelOffsets offsets)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		const auto pixels = vld3q_u8(source + 3 * x);
+		vst1q_u8(target + x, grayNeon(pixels.val[offsets.red], pixels.val[offsets.green], pixels.val[offsets.blue]));
+	}
+
+	rgb24ToGrayScalar(source + 3 * x, target + x, width - x, offsets);
+}
+
+static void yuyvToGrayNeon(const uchar *source, uchar *target, int width)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		vst1q_u8(target + x, vld2q_u8(source + 2 * x).val[0]);
+	}
+
+	yuyvToGrayScalar(source + 2 * x, target + x, width - x);
+}
+#endif
+
+bool isSupported(InstructionSet instructionSet)
+{
+	switch (instructionSet) {
+	case InstructionSet::Scalar:
+		return true;
+	case InstructionSet::Sse2:
+#ifdef GRAYSCALE_CONVERSION_SSE2
+		return true;
+#else
+		return false;
+#endif
+	case InstructionSet::Avx2: {
+#ifdef GRAYSCALE_CONVERSION_AVX2
+		static const bool avx2Supported = __builtin_cpu_supports("avx2");
+		return avx2Supported;
+#else
+		return false;
+#endif
+	}
+	case InstructionSet::Neon:
+#ifdef GRAYSCALE_CONVERSION_NEON
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	return false;
+}
+
+InstructionSet bestInstructionSet()
+{
+	static const auto instructionSet = [] {
+		for (const auto instructionSet : { InstructionSet::Avx2, InstructionSet::Sse2, InstructionSet::Neon }) {
+			if (isSupported(instructionSet)) {
+				return instructionSet;
+			}
+		}
+
+		return InstructionSet::Scalar;
+	}();
+
+	return instructionSet;
+}
+
+void rgb32ToGray(const uchar *source, uchar *target, int width, ChannelOffsets offsets, InstructionSet instructionSet)
+{
+	Q_ASSERT(isSupported(instructionSet));
+
+	switch (instructionSet) {
+#ifdef GRAYSCALE_CONVERSION_AVX2
+	case InstructionSet::Avx2:
+		rgb32ToGrayAvx2(source, target, width, offsets);
+		return;
+#endif
+#ifdef GRAYSCALE_CONVERSION_SSE2
+	case InstructionSet::Sse2:
+		rgb32ToGraySse2(source, target, width, offsets);
+		return;
+#endif
+#ifdef GRAYSCALE_CONVERSION_NEON
+	case InstructionSet::Neon:
+		rgb32ToGrayNeon(source, target, width, offsets);
+		return;
+#endif
+	default:
+		rgb32ToGrayScalar(source, target, width, offsets);
+	}
+}
+
+void premultipliedRgb32ToGray(const uchar *source, uchar *target, int width, ChannelOffsets offsets, int alphaOffset)
+{
+	// Since the gray value is a weighted sum of the color channels, it can be unpremultiplied once
+	// instead of unpremultiplying each channel.
+	// Instead of dividing by the alpha value, the gray value is multiplied by the reciprocal in
+	// units of 1/65536.
+	static const auto reciprocals = [] {
+		std::array<uint, 256> reciprocals = {};
+		for (uint alpha = 1; alpha < reciprocals.size(); ++alpha) {
+			reciprocals[alpha] = ((255 << 16) + alpha - 1) / alpha;
+		}
+		return reciprocals;
+	}();
+
+	for (int x = 0; x < width; ++x, source += 4) {
+		// The weighted sum is used before rounding it so that the rounding error is not multiplied.
+		const quint64 weightedSum = RED_WEIGHT * source[offsets.red] + GREEN_WEIGHT * source[offsets.green] + BLUE_WEIGHT * source[offsets.blue];
+		target[x] = uchar(std::min<quint64>(255, (weightedSum * reciprocals[source[alphaOffset]] + (quint64(ROUNDING) << 16)) >> 26));
+	}
+}
+
+void rgb24ToGray(const uchar *source, uchar *target, int width, ChannelOffsets offsets, InstructionSet instructionSet)
+{
+	Q_ASSERT(isSupported(instructionSet));
+
+	switch (instructionSet) {
+#ifdef GRAYSCALE_CONVERSION_NEON
+	case InstructionSet::Neon:
+		rgb24ToGrayNeon(source, target, width, offsets);
+		return;
+#endif
+	default:
+		// SSE2 and AVX2 lack byte shuffles for deinterleaving 3-byte pixels efficiently.
+		rgb24ToGrayScalar(source, target, width, offsets);
+	}
+}
+
+void yuyvToGray(const uchar *source, uchar *target, int width, InstructionSet instructionSet)
+{
+	Q_ASSERT(isSupported(instructionSet));
+
+	switch (instructionSet) {
+#ifdef GRAYSCALE_CONVERSION_SSE2
+	case InstructionSet::Avx2:
+	case InstructionSet::Sse2:
+		// Extracting the luma is limited by the memory bandwidth, so AVX2 would not be faster.
+		yuyvToGraySse2(source, target, width);
+		return;
+#endif
+#ifdef GRAYSCALE_CONVERSION_NEON
+	case InstructionSet::Neon:
+		yuyvToGrayNeon(source, target, width);
+		return;
+#endif
+	default:
+		yuyvToGrayScalar(source, target, width);
+	}
+}
+
+}
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QtGlobal>
+
+/**
+ * Conversion of rows of video frames to 8-bit grayscale
+ *
+ * The conversions are vectorized with the fastest instruction set supported by the CPU, which is
+ * detected at runtime.
+ * All instruction sets produce the same results.
+ */
+namespace GrayscaleConversion {
+
+enum class InstructionSet {
+	Scalar,
+	Sse2,
+	Avx2,
+	Neon,
+};
+
+/**
+ * Positions of the color channels within the bytes of a pixel
+ */
+struct ChannelOffsets
+{
+	int red;
+	int green;
+	int blue;
+};
+
+/**
+ * Returns whether the CPU and the build support an instruction set.
+ */
+bool isSupported(InstructionSet instructionSet);
+
+/**
+ * Returns the fastest instruction set supported by the CPU and the build.
+ */
+InstructionSet bestInstructionSet();
+
+/**
+ * Converts a row of pixels consisting of 4 bytes each.
+ */
+void rgb32ToGray(const uchar *source, uchar *target, int width, ChannelOffsets offsets, InstructionSet instructionSet = bestInstructionSet());
+
+/**
+ * Converts a row of pixels consisting of 4 bytes each whose color channels are premultiplied with
+ * their alpha channel.
+ */
+void premultipliedRgb32ToGray(const uchar *source, uchar *target, int width, ChannelOffsets offsets, int alphaOffset);
+
+/**
+ * Converts a row of pixels consisting of 3 bytes each.
+ */
+void rgb24ToGray(const uchar *source, uchar *target, int width, ChannelOffsets offsets, InstructionSet instructionSet = bestInstructionSet());
+
+/**
+ * Extracts the luma of a row of YUYV pixels.
+ */
+void yuyvToGray(const uchar *source, uchar *target, int width, InstructionSet instructionSet = bestInstructionSet());
+
+}
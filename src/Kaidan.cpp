@@ -80,42 +80,44 @@ Kaidan::Kaidan(bool enableLogging, QObject *parent)
 		Q_EMIT logOutRequested(true);
 	});
 
-	connect(m_msgDb, &MessageDb::messageAdded, this, [this](const Message &message, MessageOrigin origin) {
+	connect(m_msgDb, &MessageDb::messagesAdded, this, [this](const QVector<Message> &messages, MessageOrigin origin) {
 		if (origin != MessageOrigin::UserInput) {
-			if (const auto item = RosterModel::instance()->findItem(message.chatJid)) {
-				const auto contactRule = item->automaticMediaDownloadsRule;
-
-				const auto effectiveRule = [this, contactRule]() -> AccountManager::AutomaticMediaDownloadsRule {
-					switch (contactRule) {
-					case RosterItem::AutomaticMediaDownloadsRule::Account:
-						return settings()->automaticMediaDownloadsRule();
-					case RosterItem::AutomaticMediaDownloadsRule::Never:
-						return AccountManager::AutomaticMediaDownloadsRule::Never;
-					case RosterItem::AutomaticMediaDownloadsRule::Always:
-						return AccountManager::AutomaticMediaDownloadsRule::Always;
-					}
+			for (const auto &message : messages) {
+				if (const auto item = RosterModel::instance()->findItem(message.chatJid)) {
+					const auto contactRule = item->automaticMediaDownloadsRule;
+
+					const auto effectiveRule = [this, contactRule]() -> AccountManager::AutomaticMediaDownloadsRule {
+						switch (contactRule) {
+						case RosterItem::AutomaticMediaDownloadsRule::Account:
+							return settings()->automaticMediaDownloadsRule();
+						case RosterItem::AutomaticMediaDownloadsRule::Never:
+							return AccountManager::AutomaticMediaDownloadsRule::Never;
+						case RosterItem::AutomaticMediaDownloadsRule::Always:
+							return AccountManager::AutomaticMediaDownloadsRule::Always;
+						}
 
-					Q_UNREACHABLE();
-				}();
-
-				const auto automaticDownloadDesired = [effectiveRule, &message]() -> bool {
-					switch (effectiveRule) {
-					case AccountManager::AutomaticMediaDownloadsRule::Never:
-						return false;
-					case AccountManager::AutomaticMediaDownloadsRule::PresenceOnly:
-						return RosterModel::instance()->isPresenceSubscribedByItem(
-							message.accountJid, message.chatJid);
-					case AccountManager::AutomaticMediaDownloadsRule::Always:
-						return true;
-					}
+						Q_UNREACHABLE();
+					}();
+
+					const auto automaticDownloadDesired = [effectiveRule, &message]() -> bool {
+						switch (effectiveRule) {
+						case AccountManager::AutomaticMediaDownloadsRule::Never:
+							return false;
+						case AccountManager::AutomaticMediaDownloadsRule::PresenceOnly:
+							return RosterModel::instance()->isPresenceSubscribedByItem(
+								message.accountJid, message.chatJid);
+						case AccountManager::AutomaticMediaDownloadsRule::Always:
+							return true;
+						}
 
-					Q_UNREACHABLE();
-				}();
+						Q_UNREACHABLE();
+					}();
 
-				if (automaticDownloadDesired) {
-					for (const auto &file : message.files) {
-						if (file.localFilePath.isEmpty() || !QFile::exists(file.localFilePath)) {
-							m_fileSharingController->downloadFile(message.id, file);
+					if (automaticDownloadDesired) {
+						for (const auto &file : message.files) {
+							if (file.localFilePath.isEmpty() || !QFile::exists(file.localFilePath)) {
+								m_fileSharingController->downloadFileAutomatically(message.accountJid, message.id, file);
+							}
 						}
 					}
 				}
@@ -7,21 +7,12 @@
 
 #include "MediaUtils.h"
 #include "Globals.h"
-#include "FutureUtils.h"
 
 #include <QFileInfo>
 #include <QRegularExpression>
 #include <QTime>
 #include <QUrl>
-#include <QBuffer>
 #include <QMimeType>
-#include <QImage>
-#include <QImageReader>
-#include <QPixmap>
-
-// KDE
-#include <KIO/PreviewJob>
-#include <KFileItem>
 
 static QList<QMimeType> mimeTypes(const QList<QMimeType> &mimeTypes, const QString &parent);
 
@@ -455,75 +446,3 @@ Enums::MessageType MediaUtils::messageType(const QMimeType &mimeType)
 
 	return Enums::MessageType::MessageFile;
 }
-
-QByteArray MediaUtils::encodeImageThumbnail(const QPixmap &pixmap)
-{
-	QByteArray output;
-	QBuffer buffer(&output);
-	pixmap.save(&buffer, "PNG");
-	return output;
-}
-
-QByteArray MediaUtils::encodeImageThumbnail(const QImage &image)
-{
-	QByteArray output;
-	QBuffer buffer(&output);
-	image.save(&buffer, "PNG");
-	return output;
-}
-
-QFuture<std::shared_ptr<QXmppFileSharingManager::MetadataGeneratorResult>> MediaUtils::generateMetadata(std::unique_ptr<QIODevice> f)
-{
-	using Result = QXmppFileSharingManager::MetadataGeneratorResult;
-	using Thumnbnail = QXmppFileSharingManager::MetadataThumbnail;
-
-	thread_local static auto allPlugins = KIO::PreviewJob::availablePlugins();
-
-	auto result = std::make_shared<Result>();
-
-	auto *file = dynamic_cast<QFile *>(f.get());
-	if (!file) {
-		// other io devices can't be handled
-		return makeReadyFuture<std::shared_ptr<Result>>(std::move(result));
-	}
-
-	QFutureInterface<std::shared_ptr<Result>> interface;
-
-	// create job
-	auto *job = new KIO::PreviewJob(
-		{ KFileItem(QUrl::fromLocalFile(file->fileName())) },
-		QSize(THUMBNAIL_PIXEL_SIZE, THUMBNAIL_PIXEL_SIZE),
-		&allPlugins
-	);
-	job->setAutoDelete(true);
-
-	connect(job, &KIO::PreviewJob::gotPreview, [=, f = std::move(f)](const KFileItem &, const QPixmap &image) mutable {
-		QByteArray thumbnailData;
-		QBuffer thumbnailBuffer(&thumbnailData);
-		image.save(&thumbnailBuffer, "JPG", JPEG_EXPORT_QUALITY);
-
-		if (const QImageReader reader(file->fileName()); reader.canRead()) {
-			if (const QSize size = reader.size(); !size.isEmpty()) {
-				result->dimensions = size;
-			}
-		}
-
-		result->dataDevice = std::move(f);
-		result->thumbnails.push_back(Thumnbnail {
-			.width = uint32_t(image.size().width()),
-			.height = uint32_t(image.size().height()),
-			.data = thumbnailData,
-			.mimeType = QMimeDatabase().mimeTypeForData(thumbnailData)
-		});
-
-		interface.reportResult(result);
-		interface.reportFinished();
-	});
-
-	connect(job, &KIO::PreviewJob::failed, [interface, result]() mutable {
-		interface.reportResult(result);
-		interface.reportFinished();
-	});
-
-	return interface.future();
-}
@@ -10,9 +10,6 @@
 #include <QGeoCoordinate>
 #include <QMimeDatabase>
 #include <QObject>
-#include <QFuture>
-
-#include <QXmppFileSharingManager.h>
 
 #include "Enums.h"
 
@@ -55,11 +52,6 @@ public:
 	Q_INVOKABLE inline static QString mimeTypeName(const QUrl &url)
 	{ return mimeType(url).name(); }
 
-	static QByteArray encodeImageThumbnail(const QPixmap &pixmap);
-	static QByteArray encodeImageThumbnail(const QImage &image);
-
-	static QFuture<std::shared_ptr<QXmppFileSharingManager::MetadataGeneratorResult>> generateMetadata(std::unique_ptr<QIODevice>);
-
 	static const QMimeDatabase &mimeDatabase()
 	{
 		return s_mimeDB;
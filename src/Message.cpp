@@ -7,6 +7,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "Algorithms.h"
+#include "Globals.h"
 #include "MediaUtils.h"
 #include "Message.h"
 #include <QXmppBitsOfBinaryContentId.h>
@@ -67,10 +68,12 @@ QXmppFileShare File::toQXmpp() const
 	metadata.setMediaType(mimeType);
 	metadata.setSize(size);
 
-	QXmppThumbnail thumb;
-	thumb.setMediaType(QMimeDatabase().mimeTypeForData(thumbnail));
-	thumb.setUri(QXmppBitsOfBinaryData::fromByteArray(thumbnail).cid().toCidUrl());
-	metadata.setThumbnails({thumb});
+	if (!thumbnail.isEmpty()) {
+		QXmppThumbnail thumb;
+		thumb.setMediaType(QMimeDatabase().mimeTypeForData(thumbnail));
+		thumb.setUri(QXmppBitsOfBinaryData::fromByteArray(thumbnail).cid().toCidUrl());
+		metadata.setThumbnails({thumb});
+	}
 
 	QXmppFileShare fs;
 	fs.setDisposition(disposition);
@@ -84,21 +87,14 @@ QXmppFileShare File::toQXmpp() const
 	return fs;
 }
 
-QImage File::thumbnailSquareImage() const
+QUrl File::thumbnailUrl() const
 {
-	auto image = QImage::fromData(thumbnail);
-	auto length = std::min(image.width(), image.height());
-	QImage croppedImage(QSize(length, length), image.format());
-
-	auto delX = (image.width() - length) / 2;
-	auto delY = (image.height() - length) / 2;
+	return QUrl(QStringLiteral("image://" THUMBNAIL_IMAGE_PROVIDER_NAME "/") + fileId());
+}
 
-	for (int x = 0; x < length; x++) {
-		for (int y = 0; y < length; y++) {
-			croppedImage.setPixel(x, y, image.pixel(x + delX, y + delY));
-		}
-	}
-	return croppedImage;
+QUrl File::thumbnailSquareUrl() const
+{
+	return QUrl(QStringLiteral("image://" THUMBNAIL_IMAGE_PROVIDER_NAME "/") + fileId() + QStringLiteral("/square"));
 }
 
 QUrl File::downloadUrl() const
@@ -156,6 +152,11 @@ QString File::details() const
 	return QStringLiteral("%1, %2").arg(formattedSize, formattedDateTime);
 }
 
+bool DisplayedMessageReaction::operator<(const DisplayedMessageReaction &other) const
+{
+	return emoji < other.emoji;
+}
+
 QXmppMessage Message::toQXmpp() const
 {
 	QXmppMessage msg;
@@ -180,7 +181,11 @@ QXmppMessage Message::toQXmpp() const
 	}));
 
 	// attach data for thumbnails
-	msg.setBitsOfBinaryData(transform(files, [](const File &file) {
+	msg.setBitsOfBinaryData(transformFilter(files, [](const File &file) -> std::optional<QXmppBitsOfBinaryData> {
+		if (file.thumbnail.isEmpty()) {
+			return {};
+		}
+
 		return QXmppBitsOfBinaryData::fromByteArray(file.thumbnail);
 	}));
 
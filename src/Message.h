@@ -74,8 +74,8 @@ struct File
 	Q_PROPERTY(QString localFilePath MEMBER localFilePath)
 	Q_PROPERTY(QUrl localFileUrl READ localFileUrl CONSTANT)
 	Q_PROPERTY(bool hasThumbnail READ hasThumbnail CONSTANT)
-	Q_PROPERTY(QImage thumbnail READ thumbnailImage CONSTANT)
-	Q_PROPERTY(QImage thumbnailSquare READ thumbnailSquareImage CONSTANT)
+	Q_PROPERTY(QUrl thumbnailUrl READ thumbnailUrl CONSTANT)
+	Q_PROPERTY(QUrl thumbnailSquareUrl READ thumbnailSquareUrl CONSTANT)
 	Q_PROPERTY(QUrl downloadUrl READ downloadUrl CONSTANT)
 	Q_PROPERTY(Enums::MessageType type READ type CONSTANT)
 	Q_PROPERTY(QString details READ details CONSTANT)
@@ -91,7 +91,9 @@ public:
 	QXmppFileShare::Disposition disposition = QXmppFileShare::Attachment;
 	QString localFilePath;
 	QVector<FileHash> hashes;
+	// Only set if the thumbnail is not stored yet or explicitly fetched
 	QByteArray thumbnail;
+	bool hasStoredThumbnail = false;
 	QVector<HttpSource> httpSources;
 	QVector<EncryptedSource> encryptedSources;
 
@@ -106,9 +108,9 @@ private:
 	[[nodiscard]] QString mimeTypeIcon() const { return mimeType.iconName(); }
 	[[nodiscard]] qint64 _size() const { return size.value_or(-1); }
 	[[nodiscard]] bool displayInline() const { return disposition == QXmppFileShare::Inline; }
-	[[nodiscard]] bool hasThumbnail() const { return !thumbnail.isEmpty(); }
-	[[nodiscard]] QImage thumbnailImage() const { return QImage::fromData(thumbnail); }
-	[[nodiscard]] QImage thumbnailSquareImage() const;
+	[[nodiscard]] bool hasThumbnail() const { return hasStoredThumbnail || !thumbnail.isEmpty(); }
+	[[nodiscard]] QUrl thumbnailUrl() const;
+	[[nodiscard]] QUrl thumbnailSquareUrl() const;
 	[[nodiscard]] QUrl downloadUrl() const;
 	[[nodiscard]] QUrl localFileUrl() const;
 	[[nodiscard]] Enums::MessageType type() const;
@@ -157,6 +159,40 @@ struct MessageReactionSender
 	bool operator==(const MessageReactionSender &other) const = default;
 };
 
+struct DisplayedMessageReaction
+{
+	Q_GADGET
+	Q_PROPERTY(QString emoji MEMBER emoji)
+	Q_PROPERTY(int count MEMBER count)
+	Q_PROPERTY(bool ownReactionIncluded MEMBER ownReactionIncluded)
+	Q_PROPERTY(MessageReactionDeliveryState::Enum deliveryState MEMBER deliveryState)
+
+public:
+	QString emoji;
+	int count;
+	bool ownReactionIncluded;
+	MessageReactionDeliveryState::Enum deliveryState;
+
+	bool operator<(const DisplayedMessageReaction &other) const;
+};
+
+Q_DECLARE_METATYPE(DisplayedMessageReaction)
+
+struct DetailedMessageReaction
+{
+	Q_GADGET
+	Q_PROPERTY(QString senderJid MEMBER senderJid)
+	Q_PROPERTY(QStringList emojis MEMBER emojis)
+
+public:
+	QString senderJid;
+	QStringList emojis;
+
+	bool operator<(const DetailedMessageReaction &other) const;
+};
+
+Q_DECLARE_METATYPE(DetailedMessageReaction)
+
 /**
  * @brief This class is used to load messages from the database and use them in
  * the @c MessageModel. The class inherits from @c QXmppMessage and most
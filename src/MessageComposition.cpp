@@ -10,15 +10,18 @@
 #include "MessageHandler.h"
 #include "Kaidan.h"
 #include "FileSharingController.h"
+#include "FutureUtils.h"
 #include "Algorithms.h"
 #include "MessageModel.h"
 #include "MediaUtils.h"
 #include "MessageDb.h"
+#include "UploadPreparation.h"
 
 // Qt
 #include <QFileDialog>
 #include <QFutureWatcher>
 #include <QGuiApplication>
+#include <QImageReader>
 #include <QMimeDatabase>
 // QXmpp
 #include <QXmppUtils.h>
@@ -351,6 +354,8 @@ void FileSelectionModel::addFile(const QUrl &localFilePath)
 
 void FileSelectionModel::removeFile(int index)
 {
+	m_pendingThumbnailFilePaths.removeOne(m_files.at(index).localFilePath);
+
 	beginRemoveRows({}, index, index);
 	m_files.erase(m_files.begin() + index);
 	endRemoveRows();
@@ -358,6 +363,8 @@ void FileSelectionModel::removeFile(int index)
 
 void FileSelectionModel::clear()
 {
+	m_pendingThumbnailFilePaths.clear();
+
 	beginResetModel();
 	m_files.clear();
 	endResetModel();
@@ -379,32 +386,82 @@ bool FileSelectionModel::setData(const QModelIndex &index, const QVariant &value
 }
 
 void FileSelectionModel::generateThumbnail(const File &file)
+{
+	m_pendingThumbnailFilePaths.append(file.localFilePath);
+	startThumbnailJobs();
+}
+
+void FileSelectionModel::startThumbnailJobs()
 {
 	static auto allPlugins = KIO::PreviewJob::availablePlugins();
-	KFileItemList items {
-		KFileItem {
-			QUrl::fromLocalFile(file.localFilePath),
-			QMimeDatabase().mimeTypeForFile(file.localFilePath).name(),
+
+	// Only a limited number of thumbnails is generated in parallel so that selecting many files at
+	// once does not occupy all cores.
+	while (!m_pendingThumbnailFilePaths.isEmpty() && m_runningThumbnailJobCount < UploadPreparation::instance().maxThumbnailJobs()) {
+		const auto filePath = m_pendingThumbnailFilePaths.takeFirst();
+		const auto mimeType = QMimeDatabase().mimeTypeForFile(filePath);
+
+		++m_runningThumbnailJobCount;
+
+		// The previews are only displayed locally and thus not reduced to the size of thumbnails
+		// sent with files.
+
+		// Images are decoded and scaled by the thread pool in one step.
+		if (QImageReader::supportedMimeTypes().contains(mimeType.name().toUtf8())) {
+			await(UploadPreparation::instance().generateImageThumbnail(filePath, THUMBNAIL_SIZE, UploadPreparation::ThumbnailDataSize::Unlimited), this, [this, filePath](const std::optional<UploadPreparation::Thumbnail> &thumbnail) {
+				if (thumbnail) {
+					setThumbnail(filePath, thumbnail->data);
+				} else {
+					qDebug() << "Could not generate a thumbnail for" << filePath;
+				}
+
+				finishThumbnailJob();
+			});
+			continue;
 		}
-	};
-	auto *job = new KIO::PreviewJob(items, QSize(THUMBNAIL_SIZE, THUMBNAIL_SIZE), &allPlugins);
-	job->setAutoDelete(true);
 
-	connect(job, &KIO::PreviewJob::gotPreview, this, [this](const KFileItem &item, const QPixmap &preview) {
-		auto *file = std::find_if(m_files.begin(), m_files.end(), [&](const auto &file) {
-			return file.localFilePath == item.localPath();
+		// Previews of other files are created by KIO and encoded by the thread pool.
+		KFileItemList items {
+			KFileItem {
+				QUrl::fromLocalFile(filePath),
+				mimeType.name(),
+			}
+		};
+		auto *job = new KIO::PreviewJob(items, QSize(THUMBNAIL_SIZE, THUMBNAIL_SIZE), &allPlugins);
+		job->setAutoDelete(true);
+
+		connect(job, &KIO::PreviewJob::gotPreview, this, [this](const KFileItem &item, const QPixmap &preview) {
+			await(UploadPreparation::instance().encodeThumbnail(preview.toImage(), UploadPreparation::ThumbnailDataSize::Unlimited), this, [this, filePath = item.localPath()](const UploadPreparation::Thumbnail &thumbnail) {
+				setThumbnail(filePath, thumbnail.data);
+			});
+		});
+		connect(job, &KIO::PreviewJob::failed, this, [](const KFileItem &item) {
+			qDebug() << "Could not generate a thumbnail for" << item.url();
 		});
+		connect(job, &KJob::finished, this, &FileSelectionModel::finishThumbnailJob);
 
-		if (file != m_files.cend()) {
-			file->thumbnail = MediaUtils::encodeImageThumbnail(preview);
-			int i = std::distance(m_files.begin(), file);
-			Q_EMIT dataChanged(index(i), index(i), { Thumbnail });
-		}
-	});
-	connect(job, &KIO::PreviewJob::failed, this, [](const KFileItem &item) {
-		qDebug() << "Could not generate a thumbnail for" << item.url();
+		job->start();
+	}
+}
+
+void FileSelectionModel::finishThumbnailJob()
+{
+	--m_runningThumbnailJobCount;
+	startThumbnailJobs();
+}
+
+void FileSelectionModel::setThumbnail(const QString &filePath, const QByteArray &thumbnail)
+{
+	// The file may have been removed in the meantime.
+	auto *file = std::find_if(m_files.begin(), m_files.end(), [&](const auto &file) {
+		return file.localFilePath == filePath;
 	});
-	job->start();
+
+	if (file != m_files.cend()) {
+		file->thumbnail = thumbnail;
+		int i = std::distance(m_files.begin(), file);
+		Q_EMIT dataChanged(index(i), index(i), { Thumbnail });
+	}
 }
 
 const QVector<File> &FileSelectionModel::files() const
@@ -102,6 +102,11 @@ public:
 
 private:
 	void generateThumbnail(const File &file);
+	void startThumbnailJobs();
+	void finishThumbnailJob();
+	void setThumbnail(const QString &filePath, const QByteArray &thumbnail);
 
 	QVector<File> m_files;
+	QStringList m_pendingThumbnailFilePaths;
+	int m_runningThumbnailJobCount = 0;
 };
@@ -8,6 +8,10 @@
 
 #include "MessageDb.h"
 
+// std
+#include <algorithm>
+#include <array>
+
 // Qt
 #include <QSqlDatabase>
 #include <QSqlDriver>
@@ -17,6 +21,9 @@
 #include <QMimeDatabase>
 #include <QBuffer>
 #include <QFile>
+#include <QDebug>
+#include <QRegularExpression>
+#include <QSet>
 // QXmpp
 #include <QXmppUtils.h>
 // Kaidan
@@ -28,8 +35,6 @@ Q_DECLARE_METATYPE(QXmpp::Cipher)
 Q_DECLARE_METATYPE(QXmpp::HashAlgorithm)
 Q_DECLARE_METATYPE(QXmppFileShare::Disposition)
 
-#define CHECK_MESSAGE_EXISTS_DEPTH_LIMIT "20"
-
 template<typename T>
 QVariant optionalToVariant(std::optional<T> value)
 {
@@ -49,6 +54,113 @@ std::optional<T> variantToOptional(QVariant value)
 	return {};
 }
 
+/**
+ * Creates the condition restricting messages to the ones older than a cursor.
+ *
+ * The row value comparison lets SQLite start walking the index on
+ * (accountJid, chatJid, timestamp, id) directly at the cursor's position.
+ */
+static QString cursorCondition(const MessageDb::MessageCursor &cursor)
+{
+	if (cursor.isNull()) {
+		return {};
+	}
+
+	return QStringLiteral("AND (timestamp, id) < (:cursorTimestamp, :cursorId)");
+}
+
+/**
+ * Adds the values for the placeholders created by cursorCondition().
+ */
+static void bindCursor(std::vector<QueryBindValue> &bindValues, const MessageDb::MessageCursor &cursor)
+{
+	if (!cursor.isNull()) {
+		bindValues.push_back({ u":cursorTimestamp", serialize(cursor.timestamp) });
+		bindValues.push_back({ u":cursorId", cursor.id });
+	}
+}
+
+/**
+ * Splits a text into the words compared by the message search.
+ *
+ * Like the tokenizer of the full-text search index, all characters except letters and numbers
+ * separate words, and letter case as well as diacritics are ignored.
+ */
+static QStringList searchWords(const QString &text)
+{
+	static const QRegularExpression diacritic(QStringLiteral("\\p{Mn}"));
+	static const QRegularExpression separator(QStringLiteral("[^\\p{L}\\p{N}]+"));
+
+	auto words = text.normalized(QString::NormalizationForm_D);
+	words.remove(diacritic);
+	return words.toCaseFolded().split(separator, Qt::SkipEmptyParts);
+}
+
+/**
+ * Returns whether each search word is the start of a word of a text.
+ */
+static bool matchesSearchWords(const QString &text, const QStringList &searchWordList)
+{
+	if (searchWordList.isEmpty()) {
+		return false;
+	}
+
+	const auto words = searchWords(text);
+
+	return std::all_of(searchWordList.cbegin(), searchWordList.cend(), [&](const QString &searchWord) {
+		return std::any_of(words.cbegin(), words.cend(), [&](const QString &word) {
+			return word.startsWith(searchWord);
+		});
+	});
+}
+
+/**
+ * Creates a full-text search query matching messages that contain words starting with each search
+ * word.
+ *
+ * The words are quoted so that they are not interpreted as the query syntax (e.g., "AND").
+ * Since search words consist only of letters and numbers, they contain no quotes.
+ */
+static QString ftsMatchQuery(const QStringList &searchWordList)
+{
+	QStringList terms;
+	terms.reserve(searchWordList.size());
+
+	for (const auto &word : searchWordList) {
+		terms.append(QStringLiteral("\"") + word + QStringLiteral("\"*"));
+	}
+
+	return terms.join(u' ');
+}
+
+/**
+ * Creates a snippet of a message body found without the full-text search index as rich text with
+ * the matching words in bold.
+ */
+static QString searchSnippet(const QString &body, const QStringList &searchWordList)
+{
+	static const QRegularExpression wordExpression(QStringLiteral("[\\p{L}\\p{N}\\p{Mn}]+"));
+
+	QString snippet;
+	int end = 0;
+
+	for (auto itr = wordExpression.globalMatch(body); itr.hasNext();) {
+		const auto match = itr.next();
+
+		const auto matches = std::any_of(searchWordList.cbegin(), searchWordList.cend(), [&](const QString &searchWord) {
+			return matchesSearchWords(match.captured(), { searchWord });
+		});
+
+		if (matches) {
+			snippet += body.mid(end, match.capturedStart() - end).toHtmlEscaped();
+			snippet += QStringLiteral("<b>") + match.captured().toHtmlEscaped() + QStringLiteral("</b>");
+			end = match.capturedEnd();
+		}
+	}
+
+	return snippet + body.mid(end).toHtmlEscaped();
+}
+
 MessageDb *MessageDb::s_instance = nullptr;
 
 MessageDb::MessageDb(Database *db, QObject *parent)
@@ -102,10 +214,7 @@ QVector<Message> MessageDb::_fetchMessagesFromQuery(QSqlQuery &query)
 		msg.originId = query.value(idxOriginId).toString();
 		msg.stanzaId = query.value(idxStanzaId).toString();
 		msg.replaceId = query.value(idxReplaceId).toString();
-		msg.timestamp = QDateTime::fromString(
-			query.value(idxTimestamp).toString(),
-			Qt::ISODate
-		);
+		msg.timestamp = parseDateTime(query, idxTimestamp);
 		msg.body = query.value(idxBody).toString();
 		msg.encryption = query.value(idxEncryption).value<Encryption::Enum>();
 		msg.senderKey = query.value(idxSenderKey).toByteArray();
@@ -113,14 +222,14 @@ QVector<Message> MessageDb::_fetchMessagesFromQuery(QSqlQuery &query)
 		msg.isSpoiler = query.value(idxIsSpoiler).toBool();
 		msg.spoilerHint = query.value(idxSpoilerHint).toString();
 		msg.fileGroupId = variantToOptional<qint64>(query.value(idxFileGroupId));
-		if (msg.fileGroupId) {
-			msg.files = _fetchFiles(*msg.fileGroupId);
-		}
 		msg.errorText = query.value(idxErrorText).toString();
 		msg.removed = query.value(idxRemoved).toBool();
 
 		messages << std::move(msg);
 	}
+
+	_fetchFiles(messages);
+
 	return messages;
 }
 
@@ -150,7 +259,7 @@ QSqlRecord MessageDb::createUpdateRecord(const Message &oldMsg, const Message &n
 		rec.append(createSqlField("replaceId", newMsg.replaceId));
 	}
 	if (oldMsg.timestamp != newMsg.timestamp) {
-		rec.append(createSqlField("timestamp", newMsg.timestamp.toString(Qt::ISODateWithMs)));
+		rec.append(createSqlField("timestamp", serialize(newMsg.timestamp)));
 	}
 	if (oldMsg.body != newMsg.body) {
 		rec.append(createSqlField("body", newMsg.body));
@@ -183,25 +292,27 @@ QSqlRecord MessageDb::createUpdateRecord(const Message &oldMsg, const Message &n
 	return rec;
 }
 
-QFuture<QVector<Message>> MessageDb::fetchMessages(const QString &accountJid, const QString &chatJid, int index)
+QFuture<QVector<Message>> MessageDb::fetchMessages(const QString &accountJid, const QString &chatJid, const MessageCursor &cursor)
 {
-	return run([this, accountJid, chatJid, index]() {
+	return runRead([this, accountJid, chatJid, cursor]() {
+		std::vector<QueryBindValue> bindValues = {
+			{ u":accountJid", accountJid },
+			{ u":chatJid", chatJid },
+			{ u":limit", DB_QUERY_LIMIT_MESSAGES },
+		};
+		bindCursor(bindValues, cursor);
+
 		auto query = createQuery();
 		execQuery(
 			query,
 			QStringLiteral(R"(
 				SELECT *
 				FROM chatMessages
-				WHERE accountJid = :accountJid AND chatJid = :chatJid
-				ORDER BY timestamp DESC
-				LIMIT :index, :limit
-			)"),
-			{
-				{ u":accountJid", accountJid },
-				{ u":chatJid", chatJid },
-				{ u":index", index },
-				{ u":limit", DB_QUERY_LIMIT_MESSAGES },
-			}
+				WHERE accountJid = :accountJid AND chatJid = :chatJid %1
+				ORDER BY timestamp DESC, id DESC
+				LIMIT :limit
+			)").arg(cursorCondition(cursor)),
+			bindValues
 		);
 
 		auto messages = _fetchMessagesFromQuery(query);
@@ -214,21 +325,21 @@ QFuture<QVector<Message>> MessageDb::fetchMessages(const QString &accountJid, co
 
 QFuture<QVector<File>> MessageDb::fetchFiles(const QString &accountJid)
 {
-	return run([this, accountJid]() {
+	return runRead([this, accountJid]() {
 		return _fetchFiles(accountJid);
 	});
 }
 
 QFuture<QVector<File>> MessageDb::fetchFiles(const QString &accountJid, const QString &chatJid)
 {
-	return run([this, accountJid, chatJid]() {
+	return runRead([this, accountJid, chatJid]() {
 		return _fetchFiles(accountJid, chatJid);
 	});
 }
 
 QFuture<QVector<File>> MessageDb::fetchDownloadedFiles(const QString &accountJid)
 {
-	return run([this, accountJid]() {
+	return runRead([this, accountJid]() {
 		auto files = _fetchFiles(accountJid);
 		_extractDownloadedFiles(files);
 
@@ -238,7 +349,7 @@ QFuture<QVector<File>> MessageDb::fetchDownloadedFiles(const QString &accountJid
 
 QFuture<QVector<File>> MessageDb::fetchDownloadedFiles(const QString &accountJid, const QString &chatJid)
 {
-	return run([this, accountJid, chatJid]() {
+	return runRead([this, accountJid, chatJid]() {
 		auto files = _fetchFiles(accountJid, chatJid);
 		_extractDownloadedFiles(files);
 
@@ -246,37 +357,133 @@ QFuture<QVector<File>> MessageDb::fetchDownloadedFiles(const QString &accountJid
 	});
 }
 
-QFuture<QVector<Message> > MessageDb::fetchMessagesUntilFirstContactMessage(const QString &accountJid, const QString &chatJid, int index)
+QFuture<QByteArray> MessageDb::fetchThumbnail(qint64 fileId)
+{
+	// The thumbnail is read on the database thread because it may be requested while the
+	// message is being added.
+	return run([this, fileId]() {
+		return _fetchThumbnail(fileId);
+	});
+}
+
+QFuture<bool> MessageDb::referenceLocalFile(const QString &accountJid, const QString &messageId, qint64 fileId, const QVector<FileHash> &hashes)
+{
+	// Hashes of weak algorithms are ignored because files with different content could have
+	// been crafted to have the same hash.
+	constexpr std::array collisionResistantHashAlgorithms = {
+		QXmpp::HashAlgorithm::Sha256,
+		QXmpp::HashAlgorithm::Sha384,
+		QXmpp::HashAlgorithm::Sha512,
+		QXmpp::HashAlgorithm::Sha3_256,
+		QXmpp::HashAlgorithm::Sha3_384,
+		QXmpp::HashAlgorithm::Sha3_512,
+		QXmpp::HashAlgorithm::Blake2b_256,
+		QXmpp::HashAlgorithm::Blake2b_384,
+		QXmpp::HashAlgorithm::Blake2b_512,
+	};
+
+	auto usableHashes = filter(QVector<FileHash>(hashes), [&](const FileHash &hash) {
+		return std::find(collisionResistantHashAlgorithms.cbegin(), collisionResistantHashAlgorithms.cend(), hash.hashType) != collisionResistantHashAlgorithms.cend();
+	});
+
+	// The local file is looked up and referenced by the same job on the database thread.
+	// Otherwise, it could be unreferenced and deleted in between.
+	return run([this, accountJid, messageId, fileId, usableHashes = std::move(usableHashes)]() {
+		const auto localFilePath = [&]() {
+			enum { LocalFilePath };
+			auto query = createQuery();
+			prepareQuery(
+				query,
+				QStringLiteral(R"(
+					SELECT files.localFilePath
+					FROM fileHashes
+					JOIN files ON files.id = fileHashes.dataId
+					JOIN messages ON messages.fileGroupId = files.fileGroupId
+					WHERE fileHashes.hashType = :hashType AND fileHashes.hashValue = :hashValue AND messages.accountJid = :accountJid AND files.localFilePath IS NOT NULL AND files.localFilePath != ''
+				)")
+			);
+
+			for (const auto &hash : usableHashes) {
+				bindValues(
+					query,
+					{
+						{ u":hashType", int(hash.hashType) },
+						{ u":hashValue", hash.hashValue },
+						{ u":accountJid", accountJid },
+					}
+				);
+				execQuery(query);
+
+				// The local file may have been deleted outside of Kaidan.
+				while (query.next()) {
+					if (auto localFilePath = query.value(LocalFilePath).toString(); QFile::exists(localFilePath)) {
+						return localFilePath;
+					}
+				}
+			}
+
+			return QString();
+		}();
+
+		if (localFilePath.isEmpty()) {
+			return false;
+		}
+
+		_updateMessage(messageId, [fileId, &localFilePath](Message &message) {
+			auto file = std::find_if(message.files.begin(), message.files.end(), [fileId](const File &file) {
+				return file.id == fileId;
+			});
+
+			if (file != message.files.end()) {
+				file->localFilePath = localFilePath;
+			}
+		});
+
+		return true;
+	});
+}
+
+QFuture<bool> MessageDb::isLocalFileReferenced(const QString &localFilePath)
 {
-	return run([this, accountJid, chatJid, index]() {
+	// The check is run on the database thread so that updates of the files requested before
+	// are taken into account.
+	return run([this, localFilePath]() {
+		return _isLocalFileReferenced(localFilePath);
+	});
+}
+
+QFuture<QVector<Message> > MessageDb::fetchMessagesUntilFirstContactMessage(const QString &accountJid, const QString &chatJid, const MessageCursor &cursor)
+{
+	return runRead([this, accountJid, chatJid, cursor]() {
+		std::vector<QueryBindValue> bindValues = {
+			{ u":accountJid", accountJid },
+			{ u":chatJid", chatJid },
+			{ u":limit", DB_QUERY_LIMIT_MESSAGES },
+		};
+		bindCursor(bindValues, cursor);
+
 		auto query = createQuery();
 		execQuery(
 			query,
 			QStringLiteral(R"(
 				SELECT *
 				FROM chatMessages
-				WHERE accountJid = :accountJid AND chatJid = :chatJid
-				ORDER BY timestamp DESC
+				WHERE accountJid = :accountJid AND chatJid = :chatJid %1
+				ORDER BY timestamp DESC, id DESC
 				LIMIT
-					:index,
 					:limit + (
 						SELECT COUNT()
 						FROM chatMessages
 						WHERE
-							accountJid = :accountJid AND chatJid = :chatJid AND
+							accountJid = :accountJid AND chatJid = :chatJid %1 AND
 							timestamp >= (
 								SELECT timestamp
 								FROM chatMessages
-								WHERE senderId = :chatJid
+								WHERE accountJid = :accountJid AND chatJid = :chatJid AND senderId = :chatJid
 							)
 					)
-			)"),
-			{
-				{ u":accountJid", accountJid },
-				{ u":chatJid", chatJid },
-				{ u":index", index },
-				{ u":limit", DB_QUERY_LIMIT_MESSAGES },
-			}
+			)").arg(cursorCondition(cursor)),
+			bindValues
 		);
 
 		auto messages = _fetchMessagesFromQuery(query);
@@ -287,36 +494,39 @@ QFuture<QVector<Message> > MessageDb::fetchMessagesUntilFirstContactMessage(cons
 	});
 }
 
-QFuture<QVector<Message>> MessageDb::fetchMessagesUntilId(const QString &accountJid, const QString &chatJid, int index, const QString &limitingId)
+QFuture<QVector<Message>> MessageDb::fetchMessagesUntilId(const QString &accountJid, const QString &chatJid, const MessageCursor &cursor, const QString &limitingId)
 {
-	return run([this, accountJid, chatJid, index, limitingId]() {
+	return runRead([this, accountJid, chatJid, cursor, limitingId]() {
+		std::vector<QueryBindValue> bindValues = {
+			{ u":accountJid", accountJid },
+			{ u":chatJid", chatJid },
+			{ u":limit", DB_QUERY_LIMIT_MESSAGES },
+			{ u":id", limitingId },
+		};
+		bindCursor(bindValues, cursor);
+
 		auto query = createQuery();
 		execQuery(
 			query,
 			QStringLiteral(R"(
 				SELECT *
 				FROM chatMessages
-				WHERE accountJid = :accountJid AND chatJid = :chatJid
-				ORDER BY timestamp DESC
+				WHERE accountJid = :accountJid AND chatJid = :chatJid %1
+				ORDER BY timestamp DESC, id DESC
 				LIMIT
-					:index,
 					:limit + (
 						SELECT COUNT()
 						FROM chatMessages
-						WHERE timestamp >= (
-							SELECT timestamp
-							FROM chatMessages
-							WHERE accountJid = :accountJid AND chatJid = :chatJid AND id = :id
-						)
+						WHERE
+							accountJid = :accountJid AND chatJid = :chatJid %1 AND
+							timestamp >= (
+								SELECT timestamp
+								FROM chatMessages
+								WHERE accountJid = :accountJid AND chatJid = :chatJid AND id = :id
+							)
 					)
-			)"),
-			{
-				{ u":accountJid", accountJid },
-				{ u":chatJid", chatJid },
-				{ u":index", index },
-				{ u":limit", DB_QUERY_LIMIT_MESSAGES },
-				{ u":id", limitingId },
-			}
+			)").arg(cursorCondition(cursor)),
+			bindValues
 		);
 
 		auto messages = _fetchMessagesFromQuery(query);
@@ -327,84 +537,240 @@ QFuture<QVector<Message>> MessageDb::fetchMessagesUntilId(const QString &account
 	});
 }
 
-QFuture<MessageDb::MessageResult> MessageDb::fetchMessagesUntilQueryString(const QString &accountJid, const QString &chatJid, int index, const QString &queryString)
+QFuture<QVector<Message>> MessageDb::fetchMessageStubsUntilId(const QString &accountJid, const QString &chatJid, const MessageCursor &cursor, const QString &limitingId)
 {
-	return run([this, accountJid, chatJid, index, queryString]() -> MessageResult {
-		auto query = createQuery();
+	return runRead([this, accountJid, chatJid, cursor, limitingId]() {
+		enum { SenderId, Id, ReplaceId, Timestamp, DeliveryState };
+
+		std::vector<QueryBindValue> bindValues = {
+			{ u":accountJid", accountJid },
+			{ u":chatJid", chatJid },
+			{ u":id", limitingId },
+		};
+		bindCursor(bindValues, cursor);
 
+		// Only the columns needed for the positions and read markers of the messages are fetched.
+		auto query = createQuery();
 		execQuery(
 			query,
 			QStringLiteral(R"(
-				SELECT COUNT()
+				SELECT senderId, id, replaceId, timestamp, deliveryState
 				FROM chatMessages
 				WHERE
-					accountJid = :accountJid AND chatJid = :chatJid AND
-					timestamp >= (
-						SELECT timestamp
+					accountJid = :accountJid AND chatJid = :chatJid %1 AND
+					(timestamp, id) >= (
+						SELECT timestamp, id
 						FROM chatMessages
-						WHERE
-							accountJid = :accountJid AND chatJid = :chatJid AND
-							body LIKE :queryString AND
-							timestamp <= (
-								SELECT timestamp
-								FROM chatMessages
-								WHERE accountJid = :accountJid AND chatJid = :chatJid
-								ORDER BY timestamp DESC
-								LIMIT :index, 1
-							)
-						ORDER BY timestamp DESC
-						LIMIT 1
+						WHERE accountJid = :accountJid AND chatJid = :chatJid AND id = :id
 					)
-			)"),
-			{
-				{ u":accountJid", accountJid },
-				{ u":chatJid", chatJid },
-				{ u":index", index },
-				// '%' is intended here as a placeholder inside the query for SQL statement "LIKE".
-				{ u":queryString", "%" + queryString + "%" },
-			}
+				ORDER BY timestamp DESC, id DESC
+			)").arg(cursorCondition(cursor)),
+			bindValues
 		);
 
-		query.first();
-		const auto queryStringMessageIndex = query.value(0).toInt();
-		const auto messagesUntilQueryStringCount = queryStringMessageIndex - index;
+		QVector<Message> stubs;
+		reserve(stubs, query);
 
-		// Skip further processing if no message with queryString could be found.
-		if (messagesUntilQueryStringCount <= 0) {
-			return {};
+		while (query.next()) {
+			Message stub;
+			stub.accountJid = accountJid;
+			stub.chatJid = chatJid;
+			stub.senderId = query.value(SenderId).toString();
+			stub.id = query.value(Id).toString();
+			stub.replaceId = query.value(ReplaceId).toString();
+			stub.timestamp = parseDateTime(query, Timestamp);
+			stub.deliveryState = query.value(DeliveryState).value<Enums::DeliveryState>();
+
+			stubs.append(std::move(stub));
 		}
 
-		execQuery(
+		return stubs;
+	});
+}
+
+QFuture<QVector<Message>> MessageDb::fetchMessagesByIds(const QString &accountJid, const QString &chatJid, const QVector<QString> &messageIds, bool withThumbnails)
+{
+	// The messages are read on the database thread because they must include all updates
+	// requested before.
+	return run([this, accountJid, chatJid, messageIds, withThumbnails]() {
+		QVector<Message> messages;
+
+		auto query = createQuery();
+
+		execQueryForIdChunks(
 			query,
 			QStringLiteral(R"(
 				SELECT *
 				FROM chatMessages
-				WHERE accountJid = :accountJid AND chatJid = :chatJid
-				ORDER BY timestamp DESC
-				LIMIT :index, :limit
-			)"),
+				WHERE accountJid = :accountJid AND chatJid = :chatJid AND id IN (%1)
+			)").arg(idPlaceholderList()),
+			messageIds,
+			[&]() {
+				messages.append(_fetchMessagesFromQuery(query));
+			},
 			{
 				{ u":accountJid", accountJid },
 				{ u":chatJid", chatJid },
-				{ u":index", index },
-				{ u":limit", messagesUntilQueryStringCount + DB_QUERY_LIMIT_MESSAGES },
 			}
 		);
 
-		MessageResult result {
-			_fetchMessagesFromQuery(query),
-			// Database index starts at 1, but message model index starts at 0.
-			queryStringMessageIndex - 1
+		_fetchReactions(messages);
+
+		if (withThumbnails) {
+			_fetchThumbnails(messages);
+		}
+
+		return messages;
+	});
+}
+
+QFuture<QVector<MessageDb::MessageSearchResult>> MessageDb::searchMessages(const QString &accountJid, const QString &chatJid, const QString &searchString, const MessageCursor &cursor, int limit)
+{
+	return runRead([this, accountJid, chatJid, searchString, cursor, limit]() {
+		QVector<MessageSearchResult> results;
+
+		const auto searchWordList = searchWords(searchString);
+
+		if (searchWordList.isEmpty()) {
+			return results;
+		}
+
+		if (!_hasFullTextSearchIndex()) {
+			return _searchMessagesWithoutIndex(accountJid, chatJid, searchWordList, cursor, limit);
+		}
+
+		std::vector<QueryBindValue> bindValues = {
+			{ u":accountJid", accountJid },
+			{ u":matchQuery", ftsMatchQuery(searchWordList) },
+			{ u":limit", limit },
 		};
+		bindCursor(bindValues, cursor);
+
+		if (!chatJid.isEmpty()) {
+			bindValues.push_back({ u":chatJid", chatJid });
+		}
 
-		_fetchReactions(result.messages);
+		// "CROSS JOIN" makes SQLite look up the matches in the full-text search index first
+		// instead of checking each message of a chat against the index.
+		// The matches are enclosed by control characters which are replaced after escaping the
+		// snippets.
+		// The results are ordered by time instead of relevance so that the search can step from
+		// one message to the next older one and page through the results by a cursor.
+		auto query = createQuery();
+		execQuery(
+			query,
+			QStringLiteral(R"(
+				SELECT
+					messages.chatJid,
+					messages.id,
+					messages.timestamp,
+					snippet(messagesFts, 0, char(2), char(3), '…', 16)
+				FROM messagesFts CROSS JOIN messages ON messages.rowid = messagesFts.rowid
+				WHERE
+					messagesFts MATCH :matchQuery AND
+					accountJid = :accountJid %1 %2 AND
+					deliveryState != 4 AND removed != 1
+				ORDER BY timestamp DESC, id DESC
+				LIMIT :limit
+			)").arg(chatJid.isEmpty() ? QString() : QStringLiteral("AND chatJid = :chatJid"), cursorCondition(cursor)),
+			bindValues
+		);
 
-		Q_EMIT messagesFetched(result.messages);
+		enum { ChatJid, Id, Timestamp, Snippet };
+
+		reserve(results, query);
+		while (query.next()) {
+			auto snippet = query.value(Snippet).toString().toHtmlEscaped();
+			snippet.replace(QChar(2), QStringLiteral("<b>"));
+			snippet.replace(QChar(3), QStringLiteral("</b>"));
+
+			results.append({
+				query.value(ChatJid).toString(),
+				query.value(Id).toString(),
+				parseDateTime(query, Timestamp),
+				snippet,
+			});
+		}
 
-		return result;
+		return results;
 	});
 }
 
+bool MessageDb::matchesSearchString(const QString &body, const QString &searchString)
+{
+	return matchesSearchWords(body, searchWords(searchString));
+}
+
+bool MessageDb::_hasFullTextSearchIndex()
+{
+	if (const auto index = m_fullTextSearchIndex.load(); index != FullTextSearchIndex::Unknown) {
+		return index == FullTextSearchIndex::Present;
+	}
+
+	// The index can only be used if the SQLite library still supports it.
+	auto query = createQuery();
+	execQuery(
+		query,
+		QStringLiteral(R"(
+			SELECT
+				sqlite_compileoption_used('ENABLE_FTS5') AND
+				EXISTS (SELECT * FROM sqlite_master WHERE type = 'table' AND name = 'messagesFts')
+		)")
+	);
+
+	const auto present = query.next() && query.value(0).toBool();
+	m_fullTextSearchIndex = present ? FullTextSearchIndex::Present : FullTextSearchIndex::Missing;
+
+	if (!present) {
+		qWarning() << "[MessageDb] Searching messages without full-text search index because SQLite does not support FTS5";
+	}
+
+	return present;
+}
+
+QVector<MessageDb::MessageSearchResult> MessageDb::_searchMessagesWithoutIndex(const QString &accountJid, const QString &chatJid, const QStringList &searchWordList, const MessageCursor &cursor, int limit)
+{
+	enum { ChatJid, Id, Timestamp, Body };
+
+	std::vector<QueryBindValue> bindValues = {
+		{ u":accountJid", accountJid },
+	};
+	bindCursor(bindValues, cursor);
+
+	if (!chatJid.isEmpty()) {
+		bindValues.push_back({ u":chatJid", chatJid });
+	}
+
+	// The messages are read one by one until enough of them match so that the bodies of older
+	// messages are not read.
+	auto query = createQuery();
+	execQuery(
+		query,
+		QStringLiteral(R"(
+			SELECT chatJid, id, timestamp, body
+			FROM chatMessages
+			WHERE accountJid = :accountJid %1 %2 AND body IS NOT NULL AND body != ''
+			ORDER BY timestamp DESC, id DESC
+		)").arg(chatJid.isEmpty() ? QString() : QStringLiteral("AND chatJid = :chatJid"), cursorCondition(cursor)),
+		bindValues
+	);
+
+	QVector<MessageSearchResult> results;
+
+	while (results.size() < limit && query.next()) {
+		if (const auto body = query.value(Body).toString(); matchesSearchWords(body, searchWordList)) {
+			results.append({
+				query.value(ChatJid).toString(),
+				query.value(Id).toString(),
+				parseDateTime(query, Timestamp),
+				searchSnippet(body, searchWordList),
+			});
+		}
+	}
+
+	return results;
+}
+
 Message MessageDb::_fetchLastMessage(const QString &accountJid, const QString &chatJid)
 {
 	auto query = createQuery();
@@ -448,10 +814,7 @@ QFuture<QDateTime> MessageDb::fetchLastMessageStamp()
 
 		QDateTime stamp;
 		while (query.next()) {
-			stamp = QDateTime::fromString(
-				query.value(query.record().indexOf("timestamp")).toString(),
-				Qt::ISODate
-			);
+			stamp = parseDateTime(query, 0);
 		}
 
 		return stamp;
@@ -492,25 +855,24 @@ QFuture<int> MessageDb::messageCount(const QString &accountJid, const QString &c
 		auto query = createQuery();
 		execQuery(
 			query,
-			// The double round brackets are needed to evaluate the datetime.
 			QStringLiteral(R"(
 				SELECT COUNT(*)
 				FROM chatMessages DESC
 				WHERE
 					accountJid = :accountJid AND chatJid = :chatJid AND
-					datetime(timestamp) BETWEEN
-						datetime((
+					timestamp BETWEEN
+						(
 							SELECT timestamp
 							FROM chatMessages DESC
 							WHERE accountJid = :accountJid AND chatJid = :chatJid AND id = :messageIdBegin
 							LIMIT 1
-						)) AND
-						datetime((
+						) AND
+						(
 							SELECT timestamp
 							FROM chatMessages DESC
 							WHERE accountJid = :accountJid AND chatJid = :chatJid AND id = :messageIdEnd
 							LIMIT 1
-						))
+						)
 			)"),
 			{
 				{ u":accountJid", accountJid },
@@ -530,24 +892,24 @@ QFuture<int> MessageDb::messageCount(const QString &accountJid, const QString &c
 
 QFuture<void> MessageDb::addMessage(const Message &msg, MessageOrigin origin)
 {
-	Q_ASSERT(msg.deliveryState != DeliveryState::Draft);
+	return addMessages({ msg }, origin);
+}
 
-	return run([this, msg, origin]() {
+QFuture<void> MessageDb::addMessages(const QVector<Message> &messages, MessageOrigin origin)
+{
+	return run([this, messages, origin]() mutable {
 		// deduplication
 		switch (origin) {
 		case MessageOrigin::MamBacklog:
 		case MessageOrigin::MamCatchUp:
 		case MessageOrigin::Stream:
-			if (_checkMessageExists(msg)) {
+			for (const auto &message : _removeExistingMessages(messages)) {
 				// Mark messages sent to oneself as delivered.
-				if (msg.isOwn() && msg.accountJid == msg.chatJid) {
-					updateMessage(msg.id, [](Message &msg) {
+				if (message.isOwn() && message.accountJid == message.chatJid) {
+					updateMessage(message.id, [](Message &msg) {
 						msg.deliveryState = Enums::DeliveryState::Delivered;
 					});
 				}
-
-				// message deduplicated (messageAdded() signal is not emitted)
-				return;
 			}
 			break;
 		case MessageOrigin::MamInitial:
@@ -556,11 +918,27 @@ QFuture<void> MessageDb::addMessage(const Message &msg, MessageOrigin origin)
 			break;
 		}
 
+		if (messages.isEmpty()) {
+			return;
+		}
+
 		// to speed up the whole process emit signal first and do the actual insert after that
-		Q_EMIT messageAdded(msg, origin);
+		Q_EMIT messagesAdded(messages, origin);
+
+		QVector<File> files;
+
+		transaction();
+
+		for (const auto &message : std::as_const(messages)) {
+			Q_ASSERT(message.deliveryState != DeliveryState::Draft);
 
-		_addMessage(msg);
-		_setFiles(msg.files);
+			_addMessage(message);
+			files.append(message.files);
+		}
+
+		_setFiles(files);
+
+		commit();
 	});
 }
 
@@ -570,29 +948,16 @@ QFuture<void> MessageDb::removeAllMessagesFromAccount(const QString &accountJid)
 		auto query = createQuery();
 
 		// remove files
-		{
-			execQuery(
-				query,
-				QStringLiteral(R"(
-					SELECT fileGroupId
-					FROM messages
-					WHERE accountJid = :accountJid AND fileGroupId IS NOT NULL
-				)"),
-				{
-					{ u":accountJid", accountJid },
-				}
-			);
-
-			QVector<qint64> fileIds;
-			reserve(fileIds, query);
-			while (query.next()) {
-				fileIds.append(query.value(0).toLongLong());
-			}
-			if (!fileIds.isEmpty()) {
-				_removeFiles(fileIds);
-				_removeFileHashes(fileIds);
+		const auto unreferencedLocalFilePaths = _removeFileGroups(
+			QStringLiteral(R"(
+				SELECT fileGroupId
+				FROM messages
+				WHERE accountJid = :accountJid AND fileGroupId IS NOT NULL
+			)"),
+			{
+				{ u":accountJid", accountJid },
 			}
-		}
+		);
 
 		execQuery(
 			query,
@@ -605,6 +970,10 @@ QFuture<void> MessageDb::removeAllMessagesFromAccount(const QString &accountJid)
 		);
 
 		allMessagesRemovedFromAccount(accountJid);
+
+		if (!unreferencedLocalFilePaths.isEmpty()) {
+			Q_EMIT localFilesUnreferenced(unreferencedLocalFilePaths);
+		}
 	});
 }
 
@@ -614,30 +983,17 @@ QFuture<void> MessageDb::removeAllMessagesFromChat(const QString &accountJid, co
 		auto query = createQuery();
 
 		// remove files
-		{
-			execQuery(
-				query,
-				QStringLiteral(R"(
-					SELECT fileGroupId
-					FROM messages
-					WHERE accountJid = :accountJid AND chatJid = :chatJid AND fileGroupId IS NOT NULL
-				)"),
-				{
-					{ u":accountJid", accountJid },
-					{ u":chatJid", chatJid },
-				}
-			);
-
-			QVector<qint64> fileIds;
-			reserve(fileIds, query);
-			while (query.next()) {
-				fileIds.append(query.value(0).toLongLong());
-			}
-			if (!fileIds.isEmpty()) {
-				_removeFiles(fileIds);
-				_removeFileHashes(fileIds);
+		const auto unreferencedLocalFilePaths = _removeFileGroups(
+			QStringLiteral(R"(
+				SELECT fileGroupId
+				FROM messages
+				WHERE accountJid = :accountJid AND chatJid = :chatJid AND fileGroupId IS NOT NULL
+			)"),
+			{
+				{ u":accountJid", accountJid },
+				{ u":chatJid", chatJid },
 			}
-		}
+		);
 
 		execQuery(
 			query,
@@ -651,6 +1007,10 @@ QFuture<void> MessageDb::removeAllMessagesFromChat(const QString &accountJid, co
 		);
 
 		allMessagesRemovedFromChat(accountJid, chatJid);
+
+		if (!unreferencedLocalFilePaths.isEmpty()) {
+			Q_EMIT localFilesUnreferenced(unreferencedLocalFilePaths);
+		}
 	});
 }
 
@@ -714,143 +1074,7 @@ QFuture<void> MessageDb::updateMessage(const QString &id,
                                        const std::function<void (Message &)> &updateMsg)
 {
 	return run([this, id, updateMsg]() {
-		// load current message item from db
-		auto query = createQuery();
-		execQuery(
-			query,
-			QStringLiteral(R"(
-				SELECT *
-				FROM chatMessages
-				WHERE id = :messageId OR replaceId = :messageId
-				LIMIT 1
-			)"),
-			{
-				{ u":messageId", id },
-			}
-		);
-
-		auto msgs = _fetchMessagesFromQuery(query);
-		_fetchReactions(msgs);
-
-		// update loaded item
-		if (!msgs.isEmpty()) {
-			const auto &oldMessage = msgs.first();
-			Q_ASSERT(oldMessage.deliveryState != DeliveryState::Draft);
-
-			Message newMessage = oldMessage;
-			updateMsg(newMessage);
-			Q_ASSERT(newMessage.deliveryState != DeliveryState::Draft);
-
-			// Replace the old message's values with the updated ones if the message has changed.
-			if (oldMessage != newMessage) {
-				Q_EMIT messageUpdated(newMessage);
-
-				const auto &oldReactionSenders = oldMessage.reactionSenders;
-				if (const auto &newReactionSenders = newMessage.reactionSenders; oldReactionSenders != newReactionSenders) {
-					// Remove old reactions.
-					for (auto itr = oldReactionSenders.begin(); itr != oldReactionSenders.end(); ++itr) {
-						const auto &senderJid = itr.key();
-						const auto &reactionSender = itr.value();
-
-						for (const auto &reaction : reactionSender.reactions) {
-							if (!newReactionSenders.value(senderJid).reactions.contains(reaction)) {
-								execQuery(
-									query,
-									QStringLiteral(R"(
-										DELETE FROM messageReactions
-										WHERE accountJid = :accountJid AND chatJid = :chatJid AND messageSenderId = :messageSenderId AND messageId = :messageId AND senderJid = :senderJid AND emoji = :emoji
-									)"),
-									{
-										{ u":accountJid", oldMessage.accountJid },
-										{ u":chatJid", oldMessage.chatJid },
-										{ u":messageSenderId", oldMessage.senderId },
-										{ u":messageId", oldMessage.id },
-										{ u":senderJid", senderJid },
-										{ u":emoji", reaction.emoji },
-									}
-								);
-							}
-						}
-					}
-
-					// Add new reactions.
-					for (auto itr = newReactionSenders.begin(); itr != newReactionSenders.end(); ++itr) {
-						const auto &senderJid = itr.key();
-						const auto &reactionSender = itr.value();
-
-						for (const auto &reaction : reactionSender.reactions) {
-							if (!oldReactionSenders.value(senderJid).reactions.contains(reaction)) {
-								execQuery(
-									query,
-									QStringLiteral(R"(
-										INSERT INTO messageReactions (
-											accountJid,
-											chatJid,
-											messageSenderId,
-											messageId,
-											senderJid,
-											timestamp,
-											deliveryState,
-											emoji
-										)
-										VALUES (
-											:accountJid,
-											:chatJid,
-											:messageSenderId,
-											:messageId,
-											:senderJid,
-											:timestamp,
-											:deliveryState,
-											:emoji
-										)
-									)"),
-									{
-										{ u":accountJid", oldMessage.accountJid },
-										{ u":chatJid", oldMessage.chatJid },
-										{ u":messageSenderId", oldMessage.senderId },
-										{ u":messageId", oldMessage.id },
-										{ u":senderJid", senderJid },
-										{ u":timestamp", reactionSender.latestTimestamp },
-										{ u":deliveryState", int(reaction.deliveryState) },
-										{ u":emoji", reaction.emoji },
-									}
-								);
-							}
-						}
-					}
-				} else if (auto rec = createUpdateRecord(oldMessage, newMessage); !rec.isEmpty()) {
-					auto &driver = sqlDriver();
-
-					// Create an SQL record containing only the differences.
-					execQuery(
-						query,
-						driver.sqlStatement(
-							QSqlDriver::UpdateStatement,
-							DB_TABLE_MESSAGES,
-							rec,
-							false
-						) +
-						simpleWhereStatement(&driver, "id", oldMessage.id)
-					);
-				}
-
-				// remove old files
-				auto oldFileIds = transform(oldMessage.files, [](const auto &file) {
-					return file.id;
-				});
-				auto newFileIds = transform(newMessage.files, [](const auto &file) {
-					return file.id;
-				});
-				auto removedFileIds = filter(std::move(oldFileIds), [&](auto id) {
-					return !newFileIds.contains(id);
-				});
-				_removeFiles(removedFileIds);
-				_removeFileHashes(removedFileIds);
-
-				// add new files, replace changed files
-				_setFiles(newMessage.files);
-			}
-		}
+		_updateMessage(id, updateMsg);
 	});
 }
 
@@ -990,7 +1214,7 @@ void MessageDb::_addMessage(const Message &message)
 			{ u":originId", message.originId },
 			{ u":stanzaId", message.stanzaId },
 			{ u":replaceId", message.replaceId },
-			{ u":timestamp", message.timestamp.toString(Qt::ISODateWithMs) },
+			{ u":timestamp", serialize(message.timestamp) },
 			{ u":body", message.body },
 			{ u":encryption", message.encryption },
 			{ u":senderKey", message.senderKey },
@@ -1004,59 +1228,218 @@ void MessageDb::_addMessage(const Message &message)
 	);
 }
 
+void MessageDb::_updateMessage(const QString &id, const std::function<void (Message &)> &updateMsg)
+{
+	// load current message item from db
+	auto query = createQuery();
+	execQuery(
+		query,
+		QStringLiteral(R"(
+			SELECT *
+			FROM chatMessages
+			WHERE id = :messageId OR replaceId = :messageId
+			LIMIT 1
+		)"),
+		{
+			{ u":messageId", id },
+		}
+	);
+
+	auto msgs = _fetchMessagesFromQuery(query);
+	_fetchReactions(msgs);
+
+	// update loaded item
+	if (!msgs.isEmpty()) {
+		const auto &oldMessage = msgs.first();
+		Q_ASSERT(oldMessage.deliveryState != DeliveryState::Draft);
+
+		Message newMessage = oldMessage;
+		updateMsg(newMessage);
+		Q_ASSERT(newMessage.deliveryState != DeliveryState::Draft);
+
+		// Replace the old message's values with the updated ones if the message has changed.
+		if (oldMessage != newMessage) {
+			Q_EMIT messageUpdated(newMessage);
+
+			const auto &oldReactionSenders = oldMessage.reactionSenders;
+			if (const auto &newReactionSenders = newMessage.reactionSenders; oldReactionSenders != newReactionSenders) {
+				// Remove old reactions.
+				for (auto itr = oldReactionSenders.begin(); itr != oldReactionSenders.end(); ++itr) {
+					const auto &senderJid = itr.key();
+					const auto &reactionSender = itr.value();
+
+					for (const auto &reaction : reactionSender.reactions) {
+						if (!newReactionSenders.value(senderJid).reactions.contains(reaction)) {
+							execQuery(
+								query,
+								QStringLiteral(R"(
+									DELETE FROM messageReactions
+									WHERE accountJid = :accountJid AND chatJid = :chatJid AND messageSenderId = :messageSenderId AND messageId = :messageId AND senderJid = :senderJid AND emoji = :emoji
+								)"),
+								{
+									{ u":accountJid", oldMessage.accountJid },
+									{ u":chatJid", oldMessage.chatJid },
+									{ u":messageSenderId", oldMessage.senderId },
+									{ u":messageId", oldMessage.id },
+									{ u":senderJid", senderJid },
+									{ u":emoji", reaction.emoji },
+								}
+							);
+						}
+					}
+				}
+
+				// Add new reactions.
+				for (auto itr = newReactionSenders.begin(); itr != newReactionSenders.end(); ++itr) {
+					const auto &senderJid = itr.key();
+					const auto &reactionSender = itr.value();
+
+					for (const auto &reaction : reactionSender.reactions) {
+						if (!oldReactionSenders.value(senderJid).reactions.contains(reaction)) {
+							execQuery(
+								query,
+								QStringLiteral(R"(
+									INSERT INTO messageReactions (
+										accountJid,
+										chatJid,
+										messageSenderId,
+										messageId,
+										senderJid,
+										timestamp,
+										deliveryState,
+										emoji
+									)
+									VALUES (
+										:accountJid,
+										:chatJid,
+										:messageSenderId,
+										:messageId,
+										:senderJid,
+										:timestamp,
+										:deliveryState,
+										:emoji
+									)
+								)"),
+								{
+									{ u":accountJid", oldMessage.accountJid },
+									{ u":chatJid", oldMessage.chatJid },
+									{ u":messageSenderId", oldMessage.senderId },
+									{ u":messageId", oldMessage.id },
+									{ u":senderJid", senderJid },
+									{ u":timestamp", serialize(reactionSender.latestTimestamp) },
+									{ u":deliveryState", int(reaction.deliveryState) },
+									{ u":emoji", reaction.emoji },
+								}
+							);
+						}
+					}
+				}
+			} else if (auto rec = createUpdateRecord(oldMessage, newMessage); !rec.isEmpty()) {
+				auto &driver = sqlDriver();
+
+				// Create an SQL record containing only the differences.
+				execQuery(
+					query,
+					driver.sqlStatement(
+						QSqlDriver::UpdateStatement,
+						DB_TABLE_MESSAGES,
+						rec,
+						false
+					) +
+					simpleWhereStatement(&driver, "id", oldMessage.id)
+				);
+			}
+
+			// remove old files
+			auto oldFileIds = transform(oldMessage.files, [](const auto &file) {
+				return file.id;
+			});
+			auto newFileIds = transform(newMessage.files, [](const auto &file) {
+				return file.id;
+			});
+			auto removedFileIds = filter(std::move(oldFileIds), [&](auto id) {
+				return !newFileIds.contains(id);
+			});
+			_removeFiles(removedFileIds);
+			_removeFileHashes(removedFileIds);
+
+			// add new files, replace changed files
+			_setFiles(newMessage.files);
+		}
+	}
+}
+
 void MessageDb::_setFiles(const QVector<File> &files)
 {
-	thread_local static auto query = [this]() {
-		auto query = createQuery();
-		prepareQuery(
-			query,
-			QStringLiteral(R"(
-				INSERT OR REPLACE INTO files (
-					id,
-					fileGroupId,
-					name,
-					description,
-					mimeType,
-					size,
-					lastModified,
-					disposition,
-					thumbnail,
-					localFilePath
-				)
-				VALUES (
-					:id,
-					:fileGroupId,
-					:name,
-					:description,
-					:mimeType,
-					:size,
-					:lastModified,
-					:disposition,
-					:thumbnail,
-					:localFilePath
-				)
-			)")
+	// Inserts a file or updates all of its columns except the thumbnail if it has not been
+	// fetched.
+	// That avoids reading the stored thumbnail only to write it back.
+	const auto statement = [](bool withThumbnail) {
+		return QStringLiteral(R"(
+			INSERT INTO files (
+				id,
+				fileGroupId,
+				name,
+				description,
+				mimeType,
+				size,
+				lastModified,
+				disposition,
+				thumbnail,
+				localFilePath
+			)
+			VALUES (
+				:id,
+				:fileGroupId,
+				:name,
+				:description,
+				:mimeType,
+				:size,
+				:lastModified,
+				:disposition,
+				%1,
+				:localFilePath
+			)
+			ON CONFLICT(id) DO UPDATE SET
+				fileGroupId = excluded.fileGroupId,
+				name = excluded.name,
+				description = excluded.description,
+				mimeType = excluded.mimeType,
+				size = excluded.size,
+				lastModified = excluded.lastModified,
+				disposition = excluded.disposition,
+				localFilePath = excluded.localFilePath%2
+		)").arg(
+			withThumbnail ? QStringLiteral(":thumbnail") : QStringLiteral("NULL"),
+			withThumbnail ? QStringLiteral(", thumbnail = excluded.thumbnail") : QString()
 		);
-		return query;
-	}();
+	};
+	static const auto statementWithThumbnail = statement(true);
+	static const auto statementWithoutThumbnail = statement(false);
+
+	auto query = createQuery();
 
 	for (const auto &file : files) {
-		bindValues(
-			query,
-			{
-				{ u":id", file.id },
-				{ u":fileGroupId", file.fileGroupId },
-				{ u":name", optionalToVariant(file.name) },
-				{ u":description", optionalToVariant(file.description) },
-				{ u":mimeType", file.mimeType.name() },
-				{ u":size", optionalToVariant(file.size) },
-				{ u":lastModified", serialize(file.lastModified) },
-				{ u":disposition", int(file.disposition) },
-				{ u":thumbnail", file.thumbnail },
-				{ u":localFilePath", file.localFilePath },
-			}
-		);
-		execQuery(query);
+		// The stored thumbnail must not be replaced if it has not been fetched.
+		const auto withThumbnail = !file.thumbnail.isEmpty() || !file.hasStoredThumbnail;
+
+		std::vector<QueryBindValue> bindValues = {
+			{ u":id", file.id },
+			{ u":fileGroupId", file.fileGroupId },
+			{ u":name", optionalToVariant(file.name) },
+			{ u":description", optionalToVariant(file.description) },
+			{ u":mimeType", file.mimeType.name() },
+			{ u":size", optionalToVariant(file.size) },
+			{ u":lastModified", serialize(file.lastModified) },
+			{ u":disposition", int(file.disposition) },
+			{ u":localFilePath", file.localFilePath },
+		};
+
+		if (withThumbnail) {
+			bindValues.push_back({ u":thumbnail", file.thumbnail });
+		}
+
+		execQuery(query, withThumbnail ? statementWithThumbnail : statementWithoutThumbnail, bindValues);
 
 		_setFileHashes(file.hashes);
 		_setHttpSources(file.httpSources);
@@ -1066,9 +1449,10 @@ void MessageDb::_setFiles(const QVector<File> &files)
 
 void MessageDb::_setFileHashes(const QVector<FileHash> &fileHashes)
 {
-	thread_local static auto query = [this]() {
-		auto query = createQuery();
-		prepareQuery(
+	auto query = createQuery();
+
+	for (const auto &hash : fileHashes) {
+		execQuery(
 			query,
 			QStringLiteral(R"(
 				INSERT OR REPLACE INTO fileHashes (
@@ -1081,29 +1465,22 @@ void MessageDb::_setFileHashes(const QVector<FileHash> &fileHashes)
 					:hashType,
 					:hashValue
 				)
-			)")
-		);
-		return query;
-	}();
-
-	for (const auto &hash : fileHashes) {
-		bindValues(
-			query,
+			)"),
 			{
 				{ u":dataId", hash.dataId },
 				{ u":hashType", int(hash.hashType) },
 				{ u":hashValue", hash.hashValue },
 			}
 		);
-		execQuery(query);
 	}
 }
 
 void MessageDb::_setHttpSources(const QVector<HttpSource> &sources)
 {
-	thread_local static auto query = [this]() {
-		auto query = createQuery();
-		prepareQuery(
+	auto query = createQuery();
+
+	for (const auto &source : sources) {
+		execQuery(
 			query,
 			QStringLiteral(R"(
 				INSERT OR REPLACE INTO fileHttpSources (
@@ -1114,28 +1491,21 @@ void MessageDb::_setHttpSources(const QVector<HttpSource> &sources)
 					:fileId,
 					:url
 				)
-			)")
-		);
-		return query;
-	}();
-
-	for (const auto &source : sources) {
-		bindValues(
-			query,
+			)"),
 			{
 				{ u":fileId", source.fileId },
 				{ u":url", source.url.toEncoded() },
 			}
 		);
-		execQuery(query);
 	}
 }
 
 void MessageDb::_setEncryptedSources(const QVector<EncryptedSource> &sources)
 {
-	thread_local static auto query = [this]() {
-		auto query = createQuery();
-		prepareQuery(
+	auto query = createQuery();
+
+	for (const auto &source : sources) {
+		execQuery(
 			query,
 			QStringLiteral(R"(
 				INSERT OR REPLACE INTO fileEncryptedSources (
@@ -1154,14 +1524,7 @@ void MessageDb::_setEncryptedSources(const QVector<EncryptedSource> &sources)
 					:iv,
 					:encryptedDataId
 				)
-			)")
-		);
-		return query;
-	}();
-
-	for (const auto &source : sources) {
-		bindValues(
-			query,
+			)"),
 			{
 				{ u":fileId", source.fileId },
 				{ u":url", source.url.toEncoded() },
@@ -1171,7 +1534,6 @@ void MessageDb::_setEncryptedSources(const QVector<EncryptedSource> &sources)
 				{ u":encryptedDataId", optionalToVariant(source.encryptedDataId) },
 			}
 		);
-		execQuery(query);
 
 		_setFileHashes(source.encryptedHashes);
 	}
@@ -1217,6 +1579,57 @@ void MessageDb::_removeEncryptedSources(const QVector<qint64> &fileIds)
 	}
 }
 
+QVector<QString> MessageDb::_removeFileGroups(const QString &statement, const std::vector<QueryBindValue> &bindValues)
+{
+	enum { Id, LocalFilePath };
+	auto query = createQuery();
+	execQuery(
+		query,
+		QStringLiteral("SELECT id, localFilePath FROM files WHERE fileGroupId IN (") + statement + QStringLiteral(")"),
+		bindValues
+	);
+
+	QVector<qint64> fileIds;
+	QVector<QString> localFilePaths;
+	reserve(fileIds, query);
+
+	while (query.next()) {
+		fileIds.append(query.value(Id).toLongLong());
+
+		if (auto localFilePath = query.value(LocalFilePath).toString(); !localFilePath.isEmpty() && !localFilePaths.contains(localFilePath)) {
+			localFilePaths.append(localFilePath);
+		}
+	}
+
+	if (fileIds.isEmpty()) {
+		return {};
+	}
+
+	_removeFiles(fileIds);
+	_removeFileHashes(fileIds);
+	_removeHttpSources(fileIds);
+	_removeEncryptedSources(fileIds);
+
+	// Local files shared with files of other messages are kept.
+	return filter(std::move(localFilePaths), [this](const QString &localFilePath) {
+		return !_isLocalFileReferenced(localFilePath);
+	});
+}
+
+bool MessageDb::_isLocalFileReferenced(const QString &localFilePath)
+{
+	auto query = createQuery();
+	execQuery(
+		query,
+		QStringLiteral("SELECT 1 FROM files WHERE localFilePath = :localFilePath LIMIT 1"),
+		{
+			{ u":localFilePath", localFilePath },
+		}
+	);
+
+	return query.next();
+}
+
 QVector<File> MessageDb::_fetchFiles(const QString &accountJid)
 {
 	Q_ASSERT(!accountJid.isEmpty());
@@ -1256,14 +1669,14 @@ QVector<File> MessageDb::_fetchFiles(const QString &statement, const std::vector
 	auto query = createQuery();
 	execQuery(query, statement, bindValues);
 
-	QVector<File> files;
-	reserve(files, query);
+	QVector<qint64> fileGroupIds;
+	reserve(fileGroupIds, query);
 
 	while (query.next()) {
-		files.append(_fetchFiles(query.value(FileGroupId).toLongLong()));
+		fileGroupIds.append(query.value(FileGroupId).toLongLong());
 	}
 
-	return files;
+	return _fetchFiles(fileGroupIds);
 }
 
 void MessageDb::_extractDownloadedFiles(QVector<File> &files)
@@ -1275,166 +1688,303 @@ void MessageDb::_extractDownloadedFiles(QVector<File> &files)
 	);
 }
 
-QVector<File> MessageDb::_fetchFiles(qint64 fileGroupId)
+void MessageDb::_fetchFiles(QVector<Message> &messages)
 {
-	enum { Id, Name, Description, MimeType, Size, LastModified, Disposition, Thumbnail, LocalFilePath };
-	thread_local static auto query = [this]() {
-		auto q = createQuery();
-		prepareQuery(q,
-			"SELECT id, name, description, mimeType, size, lastModified, disposition, "
-			"thumbnail, localFilePath FROM files "
-			"WHERE fileGroupId = :fileGroupId");
-		return q;
-	}();
+	QVector<qint64> fileGroupIds;
 
-	bindValues(query, {{ u":fileGroupId", QVariant(fileGroupId) }});
-	execQuery(query);
+	for (const auto &message : std::as_const(messages)) {
+		if (message.fileGroupId) {
+			fileGroupIds.append(*message.fileGroupId);
+		}
+	}
 
-	QVector<File> files;
-	reserve(files, query);
-	while (query.next()) {
-		auto id = query.value(Id).toLongLong();
-		files << File {
-			query.value(Id).toLongLong(),
-			fileGroupId,
-			variantToOptional<QString>(query.value(Name)),
-			variantToOptional<QString>(query.value(Description)),
-			QMimeDatabase().mimeTypeForName(query.value(MimeType).toString()),
-			variantToOptional<long long>(query.value(Size)),
-			parseDateTime(query, LastModified),
-			query.value(Disposition).value<QXmppFileShare::Disposition>(),
-			query.value(LocalFilePath).toString(),
-			_fetchFileHashes(id),
-			query.value(Thumbnail).toByteArray(),
-			_fetchHttpSource(id),
-			_fetchEncryptedSource(id),
-		};
+	if (fileGroupIds.isEmpty()) {
+		return;
+	}
+
+	QHash<qint64, QVector<File>> groupedFiles;
+	auto files = _fetchFiles(fileGroupIds);
+
+	for (auto &file : files) {
+		groupedFiles[file.fileGroupId].append(std::move(file));
+	}
+
+	for (auto &message : messages) {
+		if (message.fileGroupId) {
+			message.files = groupedFiles.value(*message.fileGroupId);
+		}
 	}
-	return files;
 }
 
-QVector<FileHash> MessageDb::_fetchFileHashes(qint64 fileId)
+QVector<File> MessageDb::_fetchFiles(const QVector<qint64> &fileGroupIds)
 {
-	enum { HashType, HashValue };
-	thread_local static auto query = [this]() {
-		auto q = createQuery();
-		prepareQuery(q, "SELECT hashType, hashValue FROM fileHashes WHERE dataId = :fileId");
-		return q;
-	}();
+	if (fileGroupIds.isEmpty()) {
+		return {};
+	}
 
-	bindValues(query, {{ u":fileId", fileId }});
-	execQuery(query);
+	enum { Id, FileGroupId, Name, Description, MimeType, Size, LastModified, Disposition, HasThumbnail, LocalFilePath };
+	auto query = createQuery();
 
-	QVector<FileHash> hashes;
-	reserve(hashes, query);
-	while (query.next()) {
-		hashes << FileHash {
-			fileId,
-			query.value(HashType).value<QXmpp::HashAlgorithm>(),
-			query.value(HashValue).toByteArray()
-		};
+	QMimeDatabase mimeDatabase;
+	QVector<File> files;
+
+	// The thumbnails are not fetched since they are only needed for the files that are displayed.
+	// SQLite determines the length of a BLOB without reading its content.
+	execQueryForIdChunks(
+		query,
+		QStringLiteral(R"(
+			SELECT id, fileGroupId, name, description, mimeType, size, lastModified, disposition, length(thumbnail) > 0, localFilePath
+			FROM files
+			WHERE fileGroupId IN (%1)
+		)").arg(idPlaceholderList()),
+		fileGroupIds,
+		[&]() {
+			while (query.next()) {
+				files << File {
+					query.value(Id).toLongLong(),
+					query.value(FileGroupId).toLongLong(),
+					variantToOptional<QString>(query.value(Name)),
+					variantToOptional<QString>(query.value(Description)),
+					mimeDatabase.mimeTypeForName(query.value(MimeType).toString()),
+					variantToOptional<long long>(query.value(Size)),
+					parseDateTime(query, LastModified),
+					query.value(Disposition).value<QXmppFileShare::Disposition>(),
+					query.value(LocalFilePath).toString(),
+					{},
+					{},
+					query.value(HasThumbnail).toBool(),
+					{},
+					{},
+				};
+			}
+		}
+	);
+
+	if (files.isEmpty()) {
+		return files;
 	}
-	return hashes;
+
+	// Keep the files in the order in which they were added across all chunks.
+	std::sort(files.begin(), files.end(), [](const File &left, const File &right) {
+		return left.id < right.id;
+	});
+
+	const auto fileIds = transform(files, [](const File &file) {
+		return file.id;
+	});
+
+	const auto httpSources = _fetchHttpSources(fileIds);
+	auto encryptedSources = _fetchEncryptedSources(fileIds);
+
+	// Fetch the hashes of the files and the hashes of their encrypted data at once.
+	auto dataIds = fileIds;
+	for (const auto &sources : std::as_const(encryptedSources)) {
+		for (const auto &source : sources) {
+			if (source.encryptedDataId) {
+				dataIds.append(*source.encryptedDataId);
+			}
+		}
+	}
+
+	const auto hashes = _fetchFileHashes(dataIds);
+
+	for (auto &sources : encryptedSources) {
+		for (auto &source : sources) {
+			if (source.encryptedDataId) {
+				source.encryptedHashes = hashes.value(*source.encryptedDataId);
+			}
+		}
+	}
+
+	for (auto &file : files) {
+		file.hashes = hashes.value(file.id);
+		file.httpSources = httpSources.value(file.id);
+		file.encryptedSources = encryptedSources.value(file.id);
+	}
+
+	return files;
 }
 
-QVector<HttpSource> MessageDb::_fetchHttpSource(qint64 fileId)
+QByteArray MessageDb::_fetchThumbnail(qint64 fileId)
 {
-	enum { Url };
-	thread_local static auto query = [this]() {
-		auto q = createQuery();
-		prepareQuery(q, "SELECT url FROM fileHttpSources WHERE fileId = :fileId");
-		return q;
-	}();
+	auto query = createQuery();
+	execQuery(
+		query,
+		QStringLiteral("SELECT thumbnail FROM files WHERE id = :id"),
+		{
+			{ u":id", fileId },
+		}
+	);
 
-	bindValues(query, {{ u":fileId", fileId }});
-	execQuery(query);
+	if (query.next()) {
+		return query.value(0).toByteArray();
+	}
 
-	QVector<HttpSource> sources;
-	reserve(sources, query);
-	while (query.next()) {
-		sources << HttpSource {
-			fileId,
-			QUrl::fromEncoded(query.value(Url).toByteArray())
-		};
+	return {};
+}
+
+void MessageDb::_fetchThumbnails(QVector<Message> &messages)
+{
+	for (auto &message : messages) {
+		for (auto &file : message.files) {
+			if (file.hasStoredThumbnail && file.thumbnail.isEmpty()) {
+				file.thumbnail = _fetchThumbnail(file.id);
+			}
+		}
 	}
-	return sources;
 }
 
-QVector<EncryptedSource> MessageDb::_fetchEncryptedSource(qint64 fileId)
+QHash<qint64, QVector<FileHash>> MessageDb::_fetchFileHashes(const QVector<qint64> &dataIds)
 {
-	enum { Url, Cipher, Key, Iv, EncryptedDataId };
-	thread_local static auto query = [this]() {
-		auto q = createQuery();
-		prepareQuery(q,
-			"SELECT url, cipher, key, iv, encryptedDataId FROM fileEncryptedSources "
-			"WHERE fileId = :fileId");
-		return q;
-	}();
+	enum { DataId, HashType, HashValue };
+	auto query = createQuery();
 
-	bindValues(query, {{ u":fileId", fileId }});
-	execQuery(query);
+	QHash<qint64, QVector<FileHash>> hashes;
+	execQueryForIdChunks(
+		query,
+		QStringLiteral("SELECT dataId, hashType, hashValue FROM fileHashes WHERE dataId IN (%1)").arg(idPlaceholderList()),
+		dataIds,
+		[&]() {
+			while (query.next()) {
+				const auto dataId = query.value(DataId).toLongLong();
+				hashes[dataId] << FileHash {
+					dataId,
+					query.value(HashType).value<QXmpp::HashAlgorithm>(),
+					query.value(HashValue).toByteArray()
+				};
+			}
+		}
+	);
+	return hashes;
+}
 
-	auto parseHashes = [this](QSqlQuery &query) -> QVector<FileHash> {
-		auto dataId = query.value(EncryptedDataId);
-		if (dataId.isNull()) {
-			return {};
+QHash<qint64, QVector<HttpSource>> MessageDb::_fetchHttpSources(const QVector<qint64> &fileIds)
+{
+	enum { FileId, Url };
+	auto query = createQuery();
+
+	QHash<qint64, QVector<HttpSource>> sources;
+	execQueryForIdChunks(
+		query,
+		QStringLiteral("SELECT fileId, url FROM fileHttpSources WHERE fileId IN (%1)").arg(idPlaceholderList()),
+		fileIds,
+		[&]() {
+			while (query.next()) {
+				const auto fileId = query.value(FileId).toLongLong();
+				sources[fileId] << HttpSource {
+					fileId,
+					QUrl::fromEncoded(query.value(Url).toByteArray())
+				};
+			}
 		}
-		return _fetchFileHashes(dataId.toLongLong());
-	};
+	);
+	return sources;
+}
 
-	QVector<EncryptedSource> sources;
-	reserve(sources, query);
-	while (query.next()) {
-		sources << EncryptedSource {
-			fileId,
-			QUrl::fromEncoded(query.value(Url).toByteArray()),
-			query.value(Cipher).value<QXmpp::Cipher>(),
-			query.value(Key).toByteArray(),
-			query.value(Iv).toByteArray(),
-			variantToOptional<qint64>(query.value(EncryptedDataId)),
-			parseHashes(query),
-		};
-	}
+QHash<qint64, QVector<EncryptedSource>> MessageDb::_fetchEncryptedSources(const QVector<qint64> &fileIds)
+{
+	enum { FileId, Url, Cipher, Key, Iv, EncryptedDataId };
+	auto query = createQuery();
+
+	QHash<qint64, QVector<EncryptedSource>> sources;
+	execQueryForIdChunks(
+		query,
+		QStringLiteral(R"(
+			SELECT fileId, url, cipher, key, iv, encryptedDataId
+			FROM fileEncryptedSources
+			WHERE fileId IN (%1)
+		)").arg(idPlaceholderList()),
+		fileIds,
+		[&]() {
+			while (query.next()) {
+				const auto fileId = query.value(FileId).toLongLong();
+				sources[fileId] << EncryptedSource {
+					fileId,
+					QUrl::fromEncoded(query.value(Url).toByteArray()),
+					query.value(Cipher).value<QXmpp::Cipher>(),
+					query.value(Key).toByteArray(),
+					query.value(Iv).toByteArray(),
+					variantToOptional<qint64>(query.value(EncryptedDataId)),
+					{},
+				};
+			}
+		}
+	);
 	return sources;
 }
 
 void MessageDb::_fetchReactions(QVector<Message> &messages)
 {
-	enum { SenderJid, Emoji, Timestamp, DeliveryState };
+	enum { MessageSenderId, MessageId, SenderJid, Emoji, Timestamp, DeliveryState };
+
+	// Group the indexes of the messages by their chats.
+	// The reactions of each chat are fetched with as few queries as possible.
+	QHash<QPair<QString, QString>, QVector<int>> chatMessageIndexes;
+	for (int i = 0; i < messages.size(); i++) {
+		if (const auto &message = messages.at(i); !message.id.isEmpty()) {
+			chatMessageIndexes[qMakePair(message.accountJid, message.chatJid)].append(i);
+		}
+	}
+
 	auto query = createQuery();
 
-	for (auto &message : messages) {
-		execQuery(
+	for (auto itr = chatMessageIndexes.cbegin(); itr != chatMessageIndexes.cend(); ++itr) {
+		const auto &[accountJid, chatJid] = itr.key();
+		const auto &messageIndexes = itr.value();
+
+		// Indexes of the messages mapped to their senders and IDs
+		QHash<QPair<QString, QString>, int> messageIndexesBySenderAndId;
+		QVector<QString> messageIds;
+		messageIndexesBySenderAndId.reserve(messageIndexes.size());
+		messageIds.reserve(messageIndexes.size());
+
+		for (const auto messageIndex : messageIndexes) {
+			const auto &message = messages.at(messageIndex);
+			messageIndexesBySenderAndId.insert(qMakePair(message.senderId, message.id), messageIndex);
+			messageIds.append(message.id);
+		}
+
+		execQueryForIdChunks(
 			query,
 			QStringLiteral(R"(
-				SELECT senderJid, emoji, timestamp, deliveryState
+				SELECT messageSenderId, messageId, senderJid, emoji, timestamp, deliveryState
 				FROM messageReactions
-				WHERE accountJid = :accountJid AND chatJid = :chatJid AND messageSenderId = :messageSenderId AND messageId = :messageId
-			)"),
-			{
-				{ u":accountJid", message.accountJid },
-				{ u":chatJid", message.chatJid },
-				{ u":messageSenderId", message.senderId },
-				{ u":messageId", message.id },
-			}
-		);
+				WHERE accountJid = :accountJid AND chatJid = :chatJid AND messageId IN (%1)
+			)").arg(idPlaceholderList()),
+			messageIds,
+			[&]() {
+				// Iterate over all found emojis.
+				while (query.next()) {
+					const auto messageIndex = messageIndexesBySenderAndId.value(
+						qMakePair(query.value(MessageSenderId).toString(), query.value(MessageId).toString()),
+						-1
+					);
 
-		// Iterate over all found emojis.
-		while (query.next()) {
-			MessageReaction reaction;
-			reaction.emoji = query.value(Emoji).toString();
-			reaction.deliveryState = query.value(DeliveryState).value<MessageReactionDeliveryState::Enum>();
+					// Skip reactions to messages with the same ID but from other senders.
+					if (messageIndex == -1) {
+						continue;
+					}
 
-			auto &reactionSender = message.reactionSenders[query.value(SenderJid).toString()];
+					MessageReaction reaction;
+					reaction.emoji = query.value(Emoji).toString();
+					reaction.deliveryState = query.value(DeliveryState).value<MessageReactionDeliveryState::Enum>();
 
-			// Use the timestamp of the current emoji as the latest timestamp if the emoji's
-			// timestamp is newer than the latest one.
-			if (const auto timestamp = query.value(Timestamp).toDateTime(); reactionSender.latestTimestamp < timestamp) {
-				reactionSender.latestTimestamp = timestamp;
-			}
+					auto &reactionSender = messages[messageIndex].reactionSenders[query.value(SenderJid).toString()];
 
-			reactionSender.reactions.append(reaction);
-		}
+					// Use the timestamp of the current emoji as the latest timestamp if the
+					// emoji's timestamp is newer than the latest one.
+					if (const auto timestamp = parseDateTime(query, Timestamp); reactionSender.latestTimestamp < timestamp) {
+						reactionSender.latestTimestamp = timestamp;
+					}
+
+					reactionSender.reactions.append(reaction);
+				}
+			},
+			{
+				{ u":accountJid", accountJid },
+				{ u":chatJid", chatJid },
+			}
+		);
 	}
 }
 
@@ -1463,56 +2013,136 @@ std::optional<Message> MessageDb::_fetchDraftMessage(const QString &accountJid,
 	return messages.constFirst();
 }
 
-bool MessageDb::_checkMessageExists(const Message &message)
+QVector<Message> MessageDb::_removeExistingMessages(QVector<Message> &messages)
 {
-	std::vector<QueryBindValue> bindValues = {
-		{ u":accountJid", message.accountJid },
-		{ u":chatJid", message.chatJid },
+	enum { AccountJid, ChatJid, Id, StanzaId, OriginId };
+
+	// Creates a key for an ID of a message within its chat.
+	// The type distinguishes the kinds of IDs.
+	const auto idKey = [](QChar type, const QString &accountJid, const QString &chatJid, const QString &id) -> QString {
+		return type % accountJid % QChar(u'\n') % chatJid % QChar(u'\n') % id;
 	};
 
-	// Check which IDs to check
-	QStringList idChecks;
-	if (!message.stanzaId.isEmpty()) {
-		idChecks << QStringLiteral("stanzaId = :stanzaId");
-		bindValues.push_back({ u":stanzaId", message.stanzaId });
-	}
-	// only check origin IDs if the message was possibly sent by us (since
-	// Kaidan uses random suffixes in the resource, we can't check the resource)
-	if (message.isOwn() && !message.originId.isEmpty()) {
-		idChecks << QStringLiteral("originId = :originId");
-		bindValues.push_back({ u":originId", message.originId });
-	}
-	if (!message.id.isEmpty()) {
-		idChecks << QStringLiteral("id = :id");
-		bindValues.push_back({ u":id", message.id });
-	}
+	QSet<QString> storedIdKeys;
 
-	if (idChecks.isEmpty()) {
-		// if we have no checks because of missing IDs, report that the message
-		// does not exist
-		return false;
+	// Each message binds up to three IDs.
+	// Missing IDs are bound as NULL so that all chunks use the same statement.
+	const auto &ids = idPlaceholders();
+	static const auto stanzaIds = createIdPlaceholders(QStringLiteral(":stanzaId"));
+	static const auto originIds = createIdPlaceholders(QStringLiteral(":originId"));
+	std::vector<QueryBindValue> bindValues(3 * ID_CHUNK_SIZE);
+
+	auto query = createQuery();
+
+	for (int chunkStart = 0; chunkStart < messages.size(); chunkStart += ID_CHUNK_SIZE) {
+		bool hasIds = false;
+
+		for (int i = 0; i < ID_CHUNK_SIZE; i++) {
+			QVariant id;
+			QVariant stanzaId;
+			QVariant originId;
+
+			if (const auto index = chunkStart + i; index < messages.size()) {
+				const auto &message = messages.at(index);
+
+				if (!message.id.isEmpty()) {
+					id = message.id;
+				}
+
+				if (!message.stanzaId.isEmpty()) {
+					stanzaId = message.stanzaId;
+				}
+
+				// only check origin IDs if the message was possibly sent by us (since
+				// Kaidan uses random suffixes in the resource, we can't check the resource)
+				if (message.isOwn() && !message.originId.isEmpty()) {
+					originId = message.originId;
+				}
+			}
+
+			hasIds = hasIds || !id.isNull() || !stanzaId.isNull() || !originId.isNull();
+
+			bindValues[i] = { ids.at(i), id };
+			bindValues[ID_CHUNK_SIZE + i] = { stanzaIds.at(i), stanzaId };
+			bindValues[2 * ID_CHUNK_SIZE + i] = { originIds.at(i), originId };
+		}
+
+		// Messages without IDs cannot be deduplicated.
+		if (!hasIds) {
+			continue;
+		}
+
+		// By querying DB_TABLE_MESSAGES instead of DB_VIEW_CHAT_MESSAGES and excluding drafts, all
+		// sent or received messages are retrieved.
+		// That includes locally removed messages.
+		// It avoids storing messages that were already locally removed again when received via
+		// MAM afterwards.
+		//
+		// The chats are compared afterwards so that the indexes of the ID columns are used.
+		execQuery(
+			query,
+			QStringLiteral(R"(
+				SELECT accountJid, chatJid, id, stanzaId, originId
+				FROM messages
+				WHERE (id IN (%1) OR stanzaId IN (%2) OR originId IN (%3)) AND deliveryState != 4
+			)").arg(placeholderList(ids), placeholderList(stanzaIds), placeholderList(originIds)),
+			bindValues
+		);
+
+		while (query.next()) {
+			const auto accountJid = query.value(AccountJid).toString();
+			const auto chatJid = query.value(ChatJid).toString();
+
+			if (const auto id = query.value(Id).toString(); !id.isEmpty()) {
+				storedIdKeys.insert(idKey(u'i', accountJid, chatJid, id));
+			}
+
+			if (const auto stanzaId = query.value(StanzaId).toString(); !stanzaId.isEmpty()) {
+				storedIdKeys.insert(idKey(u's', accountJid, chatJid, stanzaId));
+			}
+
+			if (const auto originId = query.value(OriginId).toString(); !originId.isEmpty()) {
+				storedIdKeys.insert(idKey(u'o', accountJid, chatJid, originId));
+			}
+		}
 	}
 
-	const QString idConditionSql = idChecks.join(u" OR ");
+	QVector<Message> newMessages;
+	QVector<Message> existingMessages;
+	newMessages.reserve(messages.size());
 
-	// By querying DB_TABLE_MESSAGES instead of DB_VIEW_CHAT_MESSAGES and excluding drafts, all sent or received messages are retrieved.
-	// That includes locally removed messages.
-	// It avoids storing messages that were already locally removed again when received via MAM afterwards.
-	const QString querySql =
-		QStringLiteral("SELECT COUNT(*) FROM " DB_TABLE_MESSAGES " "
-					   "WHERE (accountJid = :accountJid AND chatJid = :chatJid AND (") %
-		idConditionSql %
-		QStringLiteral(")) AND deliveryState != 4 ") %
-		QStringLiteral("ORDER BY timestamp DESC LIMIT " CHECK_MESSAGE_EXISTS_DEPTH_LIMIT);
+	for (auto &message : messages) {
+		const auto &accountJid = message.accountJid;
+		const auto &chatJid = message.chatJid;
 
-	auto query = createQuery();
-	execQuery(query, querySql, bindValues);
+		const auto exists =
+			(!message.stanzaId.isEmpty() && storedIdKeys.contains(idKey(u's', accountJid, chatJid, message.stanzaId))) ||
+			(message.isOwn() && !message.originId.isEmpty() && storedIdKeys.contains(idKey(u'o', accountJid, chatJid, message.originId))) ||
+			(!message.id.isEmpty() && storedIdKeys.contains(idKey(u'i', accountJid, chatJid, message.id)));
 
-	int count = 0;
-	if (query.next()) {
-		count = query.value(0).toInt();
+		if (exists) {
+			existingMessages.append(std::move(message));
+			continue;
+		}
+
+		// Deduplicate the following messages of the batch against the current one as well.
+		if (!message.id.isEmpty()) {
+			storedIdKeys.insert(idKey(u'i', accountJid, chatJid, message.id));
+		}
+
+		if (!message.stanzaId.isEmpty()) {
+			storedIdKeys.insert(idKey(u's', accountJid, chatJid, message.stanzaId));
+		}
+
+		if (!message.originId.isEmpty()) {
+			storedIdKeys.insert(idKey(u'o', accountJid, chatJid, message.originId));
+		}
+
+		newMessages.append(std::move(message));
 	}
-	return count > 0;
+
+	messages = std::move(newMessages);
+	return existingMessages;
 }
 
 QFuture<QVector<Message>> MessageDb::fetchPendingMessages(const QString &accountJid)
@@ -1533,7 +2163,11 @@ QFuture<QVector<Message>> MessageDb::fetchPendingMessages(const QString &account
 			}
 		);
 
-		return _fetchMessagesFromQuery(query);
+		// The thumbnails are sent along with the messages.
+		auto messages = _fetchMessagesFromQuery(query);
+		_fetchThumbnails(messages);
+
+		return messages;
 	});
 }
 
@@ -1591,7 +2225,7 @@ QFuture<QMap<QString, QMap<QString, MessageReactionSender>>> MessageDb::fetchPen
 
 				// Use the timestamp of the current emoji as the latest timestamp if the emoji's
 				// timestamp is newer than the latest one.
-				if (const auto timestamp = reactionQuery.value(Timestamp).toDateTime(); reactionSender.latestTimestamp < timestamp) {
+				if (const auto timestamp = parseDateTime(reactionQuery, Timestamp); reactionSender.latestTimestamp < timestamp) {
 					reactionSender.latestTimestamp = timestamp;
 				}
 
@@ -8,10 +8,13 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <QObject>
 
 #include "Message.h"
 #include "DatabaseComponent.h"
+#include "Globals.h"
 #include "SqlUtils.h"
 
 class Database;
@@ -30,14 +33,33 @@ class MessageDb : public DatabaseComponent
 
 public:
 	/**
-	 * @struct The MessageResult is used inside the MessageDb class to retrieve
-	 * the messages as QVector as well as the queryIndex.
-	 * @brief The default constructor sets queryIndex to -1 which defines that
-	 * the MessageResult is empty.
+	 * Position of a message in a chat used for paging from the most recent to the oldest message.
+	 *
+	 * Messages are ordered by their timestamps and, if their timestamps are equal, by their IDs.
+	 * Pages are fetched relative to the cursor instead of skipping a number of messages.
+	 * That way, the database does not need to walk over all skipped messages and messages added
+	 * in the meantime do not shift the pages.
+	 * A default-constructed cursor points to the position before the most recent message.
+	 */
+	struct MessageCursor {
+		QDateTime timestamp;
+		QString id;
+
+		bool isNull() const
+		{
+			return timestamp.isNull();
+		}
+	};
+
+	/**
+	 * Message found by the full-text search.
 	 */
-	struct MessageResult {
-		QVector<Message> messages;
-		int queryIndex = -1;
+	struct MessageSearchResult {
+		QString chatJid;
+		QString messageId;
+		QDateTime timestamp;
+		// excerpt of the message body as rich text with the matches in bold
+		QString snippet;
 	};
 
 	explicit MessageDb(Database *db, QObject *parent = nullptr);
@@ -59,11 +81,11 @@ public:
 	 *
 	 * @param accountJid bare JID of the user's account
 	 * @param chatJid bare Jid of the chat
-	 * @param index number of entries to be skipped, used for paging
+	 * @param cursor position of the oldest message already fetched, used for paging
 	 *
 	 * @return the fetched messages
 	 */
-	QFuture<QVector<Message>> fetchMessages(const QString &accountJid, const QString &chatJid, int index);
+	QFuture<QVector<Message>> fetchMessages(const QString &accountJid, const QString &chatJid, const MessageCursor &cursor = {});
 
 	/**
 	 * Fetches shared media for an account from the database.
@@ -103,6 +125,49 @@ public:
 	 */
 	QFuture<QVector<File>> fetchDownloadedFiles(const QString &accountJid, const QString &chatJid);
 
+	/**
+	 * Fetches the thumbnail of a file from the database.
+	 *
+	 * Thumbnails are not fetched together with their files in order to read them only for files
+	 * that are actually displayed.
+	 *
+	 * @param fileId ID of the file
+	 *
+	 * @return the encoded thumbnail or an empty byte array if the file has none
+	 */
+	QFuture<QByteArray> fetchThumbnail(qint64 fileId);
+
+	/**
+	 * Lets a file refer to an already downloaded file of the same account with the same content.
+	 *
+	 * Files have the same content if they have an equal hash of a collision-resistant algorithm
+	 * such as SHA-256 or BLAKE2b.
+	 * That way, a file shared multiple times is only downloaded and stored once.
+	 *
+	 * The local file is looked up and referenced by the same database job so that it cannot be
+	 * unreferenced and deleted in between.
+	 * Files of other accounts are not considered in order not to reveal across accounts which
+	 * files have been received.
+	 *
+	 * @param accountJid JID of the account the file's message belongs to
+	 * @param messageId ID of the file's message
+	 * @param fileId ID of the file
+	 * @param hashes hashes of the file
+	 *
+	 * @return whether an existing local file has been referenced
+	 */
+	QFuture<bool> referenceLocalFile(const QString &accountJid, const QString &messageId, qint64 fileId, const QVector<FileHash> &hashes);
+
+	/**
+	 * Returns whether a local file is referenced by any stored file.
+	 *
+	 * Since files with the same content share their local file, it may only be deleted if it is
+	 * not referenced anymore.
+	 *
+	 * @param localFilePath path of the local file
+	 */
+	QFuture<bool> isLocalFileReferenced(const QString &localFilePath);
+
 	/**
 	 * Fetches entries until the first message of chatJid from the database and emits
 	 * messagesFetched() with the results.
@@ -113,11 +178,11 @@ public:
 	 *
 	 * @param accountJid bare JID of the user's account
 	 * @param chatJid bare Jid of the chat
-	 * @param index number of entries to be skipped, used for paging
+	 * @param cursor position of the oldest message already fetched, used for paging
 	 *
 	 * @return the fetched messages
 	 */
-	QFuture<QVector<Message>> fetchMessagesUntilFirstContactMessage(const QString &accountJid, const QString &chatJid, int index);
+	QFuture<QVector<Message>> fetchMessagesUntilFirstContactMessage(const QString &accountJid, const QString &chatJid, const MessageCursor &cursor = {});
 
 	/**
 	 * Fetches entries until a specific ID from the database and emits messagesFetched() with the
@@ -130,33 +195,85 @@ public:
 	 *
 	 * @param accountJid bare JID of the user's account
 	 * @param chatJid bare Jid of the chat
-	 * @param index number of entries to be skipped, used for paging
+	 * @param cursor position of the oldest message already fetched, used for paging
 	 * @param limitingId ID of the message until messages are fetched
 	 *
 	 * @return the fetched messages
 	 */
-	QFuture<QVector<Message>> fetchMessagesUntilId(const QString &accountJid, const QString &chatJid, int index, const QString &limitingId);
+	QFuture<QVector<Message>> fetchMessagesUntilId(const QString &accountJid, const QString &chatJid, const MessageCursor &cursor, const QString &limitingId);
+
+	/**
+	 * Fetches the stubs of the messages of a chat until a specific message.
+	 *
+	 * The stubs only contain the data needed for the positions and read markers of the
+	 * messages.
+	 * That way, the messages between the loaded ones and a message far away can be positioned
+	 * without completely loading them.
+	 * In contrast to the other fetch methods, messagesFetched() is not emitted.
+	 *
+	 * @param accountJid bare JID of the user's account
+	 * @param chatJid bare Jid of the chat
+	 * @param cursor position of the oldest message already fetched
+	 * @param limitingId ID of the oldest message to be fetched
+	 *
+	 * @return the fetched stubs ordered from the most recent to the oldest message or nothing if
+	 *         there is no message with limitingId
+	 */
+	QFuture<QVector<Message>> fetchMessageStubsUntilId(const QString &accountJid, const QString &chatJid, const MessageCursor &cursor, const QString &limitingId);
+
+	/**
+	 * Fetches specific messages of a chat from the database again.
+	 *
+	 * In contrast to the other fetch methods, messagesFetched() is not emitted.
+	 *
+	 * @param accountJid bare JID of the user's account
+	 * @param chatJid bare Jid of the chat
+	 * @param messageIds IDs of the messages to be fetched
+	 * @param withThumbnails whether the thumbnails of the messages' files are fetched as well,
+	 *        e.g., for sending them
+	 *
+	 * @return the fetched messages in no specific order
+	 */
+	QFuture<QVector<Message>> fetchMessagesByIds(const QString &accountJid, const QString &chatJid, const QVector<QString> &messageIds, bool withThumbnails = false);
 
+	/**
+	 * Emitted with the messages fetched by fetchMessages(), fetchMessagesUntilFirstContactMessage()
+	 * and fetchMessagesUntilId().
+	 *
+	 * The messages are shared with all receivers and the futures returned by those methods.
+	 * Receivers must not modify them in place because that would copy all of them.
+	 */
 	Q_SIGNAL void messagesFetched(const QVector<Message> &messages);
 
 	/**
-	 * Fetches more entries from the database and emits messagesFetched() with the results.
+	 * Searches messages containing all words of a search string by the full-text search index.
 	 *
-	 * Entries are fetched until a message with queryString is found.
-	 * Those entries plus DB_QUERY_LIMIT_MESSAGES entries are returned.
-	 * If no message with queryString could be found, no messages are returned.
+	 * A word matches each word of a message that starts with it, regardless of case and
+	 * diacritics (see matchesSearchString()).
+	 * The results are ordered from the most recent to the oldest message.
 	 *
-	 * The returned query index is -1 if no message with queryString could be found,
-	 * otherwise index - 1.
+	 * If SQLite does not support the full-text search index, the messages are compared one by one.
 	 *
 	 * @param accountJid bare JID of the user's account
-	 * @param chatJid bare Jid of the chat
-	 * @param index number of entries to be skipped, used for paging
-	 * @param queryString string to be queried
+	 * @param chatJid bare JID of the chat to search in or an empty string to search in all chats
+	 *        of the account
+	 * @param searchString words to search for
+	 * @param cursor position of the oldest result already fetched, used for paging
+	 * @param limit maximum number of results
+	 *
+	 * @return the found messages
+	 */
+	QFuture<QVector<MessageSearchResult>> searchMessages(const QString &accountJid, const QString &chatJid, const QString &searchString, const MessageCursor &cursor = {}, int limit = DB_QUERY_LIMIT_MESSAGE_SEARCH_RESULTS);
+
+	/**
+	 * Returns whether a message body is found by searchMessages() for a search string.
+	 *
+	 * That is used for searching loaded messages by the same rule as the stored ones.
 	 *
-	 * @return the fetched messages and the found message index - 1
+	 * @param body body of the message
+	 * @param searchString words to search for
 	 */
-	QFuture<MessageResult> fetchMessagesUntilQueryString(const QString &accountJid, const QString &chatJid, int index, const QString &queryString);
+	static bool matchesSearchString(const QString &body, const QString &searchString);
 
 	/**
 	 * Fetches messages that are marked as pending.
@@ -204,7 +321,18 @@ public:
 	 * Adds a message to the database.
 	 */
 	QFuture<void> addMessage(const Message &msg, MessageOrigin origin);
-	Q_SIGNAL void messageAdded(const Message &msg, MessageOrigin origin);
+
+	/**
+	 * Adds multiple messages to the database at once.
+	 *
+	 * Messages that are already stored are skipped.
+	 * messagesAdded() is emitted once for all added messages.
+	 *
+	 * @param messages messages to be added
+	 * @param origin origin of all messages
+	 */
+	QFuture<void> addMessages(const QVector<Message> &messages, MessageOrigin origin);
+	Q_SIGNAL void messagesAdded(const QVector<Message> &messages, MessageOrigin origin);
 
 	/**
 	 * Removes all messages from an account.
@@ -223,6 +351,14 @@ public:
 	QFuture<void> removeAllMessagesFromChat(const QString &accountJid, const QString &chatJid);
 	Q_SIGNAL void allMessagesRemovedFromChat(const QString &accountJid, const QString &chatJid);
 
+	/**
+	 * Emitted when local files are not referenced anymore because all files referring to them
+	 * have been removed along with their messages.
+	 *
+	 * @param localFilePaths paths of the local files
+	 */
+	Q_SIGNAL void localFilesUnreferenced(const QVector<QString> &localFilePaths);
+
 	/**
 	 * Removes a chat message locally.
 	 *
@@ -270,8 +406,11 @@ public:
 
 private:
 	void _addMessage(const Message &message);
+	void _updateMessage(const QString &id, const std::function<void (Message &)> &updateMsg);
 
 	// Setters do INSERT OR REPLACE INTO
+	// _setFiles() updates existing files instead so that thumbnails that have not been fetched are
+	// kept without being read.
 	void _setFiles(const QVector<File> &files);
 	void _setFileHashes(const QVector<FileHash> &fileHashes);
 	void _setHttpSources(const QVector<HttpSource> &sources);
@@ -280,25 +419,84 @@ private:
 	void _removeFileHashes(const QVector<qint64> &fileIds);
 	void _removeHttpSources(const QVector<qint64> &fileIds);
 	void _removeEncryptedSources(const QVector<qint64> &fileIds);
+
+	/**
+	 * Removes the files of file groups including their hashes and sources.
+	 *
+	 * @param statement statement selecting the IDs of the file groups
+	 * @param bindValues values bound to the statement
+	 *
+	 * @return the paths of the local files that are not referenced anymore
+	 */
+	QVector<QString> _removeFileGroups(const QString &statement, const std::vector<QueryBindValue> &bindValues);
+	bool _isLocalFileReferenced(const QString &localFilePath);
+
 	QVector<Message> _fetchMessagesFromQuery(QSqlQuery &query);
 	QVector<File> _fetchFiles(const QString &accountJid);
 	QVector<File> _fetchFiles(const QString &accountJid, const QString &chatJid);
 	QVector<File> _fetchFiles(const QString &statement, const std::vector<QueryBindValue> &bindValues);
 	void _extractDownloadedFiles(QVector<File> &files);
-	QVector<File> _fetchFiles(qint64 fileGroupId);
-	QVector<FileHash> _fetchFileHashes(qint64 dataId);
-	QVector<HttpSource> _fetchHttpSource(qint64 fileId);
-	QVector<EncryptedSource> _fetchEncryptedSource(qint64 fileId);
 
+	/**
+	 * Fetches the files of messages and assigns them to the messages.
+	 *
+	 * The files of all messages are fetched at once in order to keep the number of queries
+	 * independent of the number of messages and files.
+	 */
+	void _fetchFiles(QVector<Message> &messages);
+
+	/**
+	 * Fetches the files of multiple file groups including their hashes and sources with a
+	 * constant number of queries.
+	 */
+	QVector<File> _fetchFiles(const QVector<qint64> &fileGroupIds);
+	QByteArray _fetchThumbnail(qint64 fileId);
+
+	/**
+	 * Fetches the thumbnails of the files of messages, e.g., for sending them.
+	 */
+	void _fetchThumbnails(QVector<Message> &messages);
+	QHash<qint64, QVector<FileHash>> _fetchFileHashes(const QVector<qint64> &dataIds);
+	QHash<qint64, QVector<HttpSource>> _fetchHttpSources(const QVector<qint64> &fileIds);
+	QHash<qint64, QVector<EncryptedSource>> _fetchEncryptedSources(const QVector<qint64> &fileIds);
+
+	/**
+	 * Fetches the reactions of messages and assigns them to the messages.
+	 *
+	 * The reactions of messages belonging to the same chat are fetched with one query per
+	 * ID_CHUNK_SIZE messages.
+	 */
 	void _fetchReactions(QVector<Message> &messages);
 	std::optional<Message> _fetchDraftMessage(const QString &accountJid, const QString &chatJid);
 
 	/**
-	 * Checks whether a message already exists in the database
+	 * Removes messages that already exist in the database or earlier in the same batch.
+	 *
+	 * All messages are checked with one query per ID_CHUNK_SIZE messages.
+	 *
+	 * @param messages messages to be deduplicated
+	 *
+	 * @return the removed messages
 	 */
-	bool _checkMessageExists(const Message &message);
+	QVector<Message> _removeExistingMessages(QVector<Message> &messages);
 
 	Message _initializeLastMessage(const QString &accountJid, const QString &chatJid);
 
+	/**
+	 * Returns whether messages can be searched by the full-text search index.
+	 *
+	 * The index is missing if the SQLite library does not support it.
+	 */
+	bool _hasFullTextSearchIndex();
+	QVector<MessageSearchResult> _searchMessagesWithoutIndex(const QString &accountJid, const QString &chatJid, const QStringList &searchWordList, const MessageCursor &cursor, int limit);
+
+	enum class FullTextSearchIndex {
+		Unknown,
+		Present,
+		Missing,
+	};
+
+	std::atomic<FullTextSearchIndex> m_fullTextSearchIndex = FullTextSearchIndex::Unknown;
+
 	static MessageDb *s_instance;
 };
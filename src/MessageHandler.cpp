@@ -113,6 +113,10 @@ void MessageHandler::handleLastMessageStampFetched(const QDateTime &stamp)
 
 void MessageHandler::handleMessage(const QXmppMessage &msg, MessageOrigin origin)
 {
+	if (msg.type() == QXmppMessage::Error || msg.marker() == QXmppMessage::Displayed || msg.reaction() || !msg.replaceId().isEmpty()) {
+		addBatchedMessages(origin);
+	}
+
 	if (msg.type() == QXmppMessage::Error) {
 		MessageDb::instance()->updateMessage(msg.id(), [errorText { msg.error().text() }](Message &msg) {
 			msg.deliveryState = Enums::DeliveryState::Error;
@@ -183,7 +187,11 @@ void MessageHandler::handleMessage(const QXmppMessage &msg, MessageOrigin origin
 						 ? QDateTime::currentDateTimeUtc()
 						 : msg.stamp().toUTC();
 
-		MessageDb::instance()->addMessage(message, origin);
+		if (m_messageBatch) {
+			m_messageBatch->append(message);
+		} else {
+			MessageDb::instance()->addMessage(message, origin);
+		}
 
 		// Add the message's sender to the roster if not already done and only for direct messages.
 		// Otherwise, the chat could only be opened via the message's notification and could not be
@@ -203,6 +211,18 @@ void MessageHandler::handleMessage(const QXmppMessage &msg, MessageOrigin origin
 	}
 }
 
+void MessageHandler::handleMessages(const QVector<QXmppMessage> &messages, MessageOrigin origin)
+{
+	m_messageBatch.emplace();
+
+	for (const auto &message : messages) {
+		handleMessage(message, origin);
+	}
+
+	addBatchedMessages(origin);
+	m_messageBatch.reset();
+}
+
 void MessageHandler::sendPendingMessages()
 {
 	auto future = MessageDb::instance()->fetchPendingMessages(AccountManager::instance()->jid());
@@ -419,9 +439,7 @@ void MessageHandler::retrieveCatchUpMessages(const QDateTime &stamp)
 
 			// process messages
 			Kaidan::instance()->database()->startTransaction();
-			for (const auto &message : std::as_const(messages.messages)) {
-				handleMessage(message, MessageOrigin::MamCatchUp);
-			}
+			handleMessages(messages.messages, MessageOrigin::MamCatchUp);
 			Kaidan::instance()->database()->commitTransaction();
 		}
 		if (auto *err = std::get_if<QXmppError>(&result)) {
@@ -454,11 +472,8 @@ void MessageHandler::retrieveBacklogMessages(const QString &jid, const QDateTime
 				})->stamp();
 			}();
 
-			// TODO: Do real batch processing (especially in the DB)
 			Kaidan::instance()->database()->startTransaction();
-			for (const auto &message : std::as_const(messages.messages)) {
-				handleMessage(message, MessageOrigin::MamBacklog);
-			}
+			handleMessages(messages.messages, MessageOrigin::MamBacklog);
 			Kaidan::instance()->database()->commitTransaction();
 
 			Q_EMIT MessageModel::instance()->mamBacklogRetrieved(ownJid, jid, lastTimestamp, messages.result.complete());
@@ -506,6 +521,14 @@ bool MessageHandler::handleReadMarker(const QXmppMessage &message, const QString
 	return false;
 }
 
+void MessageHandler::addBatchedMessages(MessageOrigin origin)
+{
+	if (m_messageBatch && !m_messageBatch->isEmpty()) {
+		MessageDb::instance()->addMessages(*m_messageBatch, origin);
+		m_messageBatch->clear();
+	}
+}
+
 bool MessageHandler::handleReaction(const QXmppMessage &message, const QString &senderJid)
 {
 	if (const auto receivedReaction = message.reaction()) {
@@ -638,13 +661,13 @@ QFuture<QXmpp::SendResult> MessageHandler::send(QXmppMessage &&message)
 
 	auto sendEncrypted = [=, this]() mutable {
 		m_client->sendSensitive(std::move(message)).then(this, [=](QXmpp::SendResult result) mutable {
-			reportFinishedResult(interface, result);
+			reportFinishedResult(interface, std::move(result));
 		});
 	};
 
 	auto sendUnencrypted = [=, this]() mutable {
 		m_client->send(std::move(message)).then(this, [=](QXmpp::SendResult result) mutable {
-			reportFinishedResult(interface, result);
+			reportFinishedResult(interface, std::move(result));
 		});
 	};
 
@@ -39,6 +39,13 @@ public:
 	 */
 	void handleMessage(const QXmppMessage &msg, MessageOrigin origin);
 
+	/**
+	 * Handles multiple messages retrieved at once from the server.
+	 *
+	 * New messages are collected and added to the database as one batch.
+	 */
+	void handleMessages(const QVector<QXmppMessage> &messages, MessageOrigin origin);
+
 	/**
 	 * Sends pending messages again after searching them in the database.
 	 */
@@ -83,6 +90,14 @@ private:
 
 	bool handleReaction(const QXmppMessage &message, const QString &senderJid);
 
+	/**
+	 * Adds the messages collected by handleMessages() to the database.
+	 *
+	 * That must be done before changing stored messages since the changes may refer to collected
+	 * messages.
+	 */
+	void addBatchedMessages(MessageOrigin origin);
+
 	static void parseSharedFiles(const QXmppMessage &message, Message &messageToEdit);
 	static std::optional<File> parseOobUrl(const QXmppOutOfBandUrl &url, qint64 fileGroupId);
 
@@ -95,4 +110,7 @@ private:
 	bool m_lastMessageLoaded = false;
 
 	uint m_runningInitialMessageQueries = 0;
+
+	// new messages collected by handleMessages()
+	std::optional<QVector<Message>> m_messageBatch;
 };
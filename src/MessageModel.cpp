@@ -10,15 +10,20 @@
 
 #include "MessageModel.h"
 
+#include <algorithm>
 #include <chrono>
+#include <numeric>
+#include <tuple>
 
 // Qt
 #include <QGuiApplication>
+#include <QLoggingCategory>
 #include <QTimer>
 // QXmpp
 #include <QXmppUtils.h>
 // Kaidan
 #include "AccountManager.h"
+#include "Algorithms.h"
 #include "FutureUtils.h"
 #include "Kaidan.h"
 #include "MessageDb.h"
@@ -28,6 +33,9 @@
 #include "QmlUtils.h"
 #include "RosterModel.h"
 #include "RosterItemWatcher.h"
+#include "Settings.h"
+
+Q_LOGGING_CATEGORY(messageModel_memory, "message-model.memory", QtMsgType::QtWarningMsg)
 
 using namespace std::chrono_literals;
 
@@ -40,9 +48,41 @@ constexpr int MAX_CORRECTION_MESSAGE_COUNT_DEPTH = 20;
 // defines that the message is suitable for correction only if it has ben sent not earlier than N days ago
 constexpr int MAX_CORRECTION_MESSAGE_DAYS_DEPTH = 2;
 
-bool DisplayedMessageReaction::operator<(const DisplayedMessageReaction &other) const
+// minimum number of completely loaded messages if their number is limited, which must be greater
+// than the number of messages displayed at once
+constexpr int MIN_MESSAGE_WINDOW_SIZE = 4 * DB_QUERY_LIMIT_MESSAGES;
+
+static qint64 estimatedSize(const QString &string)
 {
-	return emoji < other.emoji;
+	return string.capacity() * qint64(sizeof(QChar));
+}
+
+static qint64 estimatedSize(const Message &message)
+{
+	auto size = qint64(sizeof(Message)) +
+		estimatedSize(message.senderId) +
+		estimatedSize(message.id) +
+		estimatedSize(message.originId) +
+		estimatedSize(message.stanzaId) +
+		estimatedSize(message.replaceId) +
+		estimatedSize(message.body) +
+		estimatedSize(message.spoilerHint) +
+		estimatedSize(message.errorText) +
+		message.senderKey.capacity();
+
+	for (const auto &file : message.files) {
+		size += qint64(sizeof(File)) +
+			estimatedSize(file._name()) +
+			estimatedSize(file._description()) +
+			estimatedSize(file.localFilePath) +
+			file.thumbnail.capacity();
+	}
+
+	for (const auto &reactionSender : message.reactionSenders) {
+		size += reactionSender.reactions.size() * qint64(sizeof(MessageReaction));
+	}
+
+	return size;
 }
 
 MessageModel *MessageModel::s_instance = nullptr;
@@ -52,7 +92,7 @@ MessageModel *MessageModel::instance()
 	return s_instance;
 }
 
-MessageModel::MessageModel(QObject *parent)
+MessageModel::MessageModel(Settings *settings, QObject *parent)
 	: QAbstractListModel(parent),
 	  m_composingTimer(new QTimer(this)),
 	  m_stateTimeoutTimer(new QTimer(this)),
@@ -106,8 +146,8 @@ MessageModel::MessageModel(QObject *parent)
 	connect(MessageDb::instance(), &MessageDb::messagesFetched, this, &MessageModel::handleMessagesFetched);
 
 	// addMessage requests are forwarded to the MessageDb, are deduplicated there and
-	// added if MessageDb::messageAdded is emitted
-	connect(MessageDb::instance(), &MessageDb::messageAdded, this, &MessageModel::handleMessage);
+	// added if MessageDb::messagesAdded is emitted
+	connect(MessageDb::instance(), &MessageDb::messagesAdded, this, &MessageModel::handleMessagesAdded);
 
 	connect(MessageDb::instance(), &MessageDb::messageUpdated, this, &MessageModel::handleMessageUpdated);
 
@@ -117,6 +157,11 @@ MessageModel::MessageModel(QObject *parent)
 	connect(MessageDb::instance(), &MessageDb::allMessagesRemovedFromChat, this, &MessageModel::removeMessages);
 
 	connect(this, &MessageModel::mamBacklogRetrieved, this, &MessageModel::handleMamBacklogRetrieved);
+
+	setWindowSize(settings->messageWindowSize());
+	connect(settings, &Settings::messageWindowSizeChanged, this, [this, settings]() {
+		setWindowSize(settings->messageWindowSize());
+	});
 }
 
 MessageModel::~MessageModel() = default;
@@ -176,23 +221,15 @@ QVariant MessageModel::data(const QModelIndex &index, int role) const
 	case IsLastRead:
 		// A read marker text is only displayed if the message is the last read message and no
 		// message is received by the contact after it.
-		if (msg.id == m_lastReadOwnMessageId) {
-			for (auto i = index.row(); i >= 0; --i) {
-				if (m_messages.at(i).senderId != m_currentAccountJid) {
-					return false;
-				}
-			}
-			return true;
-		}
-		return false;
+		return msg.id == m_lastReadOwnMessageId && m_rowCache.isFollowedByOwnMessagesOnly(row);
 	case IsEdited:
 		return !msg.replaceId.isEmpty();
 	case Date:
 		return formatDate(msg.timestamp.date());
 	case NextDate:
-		return formatDate(searchNextDate(row));
+		return formatDate(m_rowCache.nextDate(row));
 	case Time:
-		return QLocale::system().toString(msg.timestamp.time(), QLocale::ShortFormat);
+		return m_rowCache.time(row);
 	case Body:
 		return msg.body;
 	case Encryption:
@@ -243,61 +280,10 @@ QVariant MessageModel::data(const QModelIndex &index, int role) const
 		return msg.isOwn();
 	case Files:
 		return QVariant::fromValue(msg.files);
-	case DisplayedReactions: {
-		QVector<DisplayedMessageReaction> displayedMessageReactions;
-
-		const auto &reactionSenders = msg.reactionSenders;
-		for (auto itr = reactionSenders.begin(); itr != reactionSenders.end(); ++itr) {
-			const auto ownReactionsIterated = itr.key() == m_currentAccountJid;
-
-			for (const auto &reaction : std::as_const(itr->reactions)) {
-				auto reactionItr = std::find_if(displayedMessageReactions.begin(), displayedMessageReactions.end(), [=](const DisplayedMessageReaction &displayedMessageReaction) {
-					return displayedMessageReaction.emoji == reaction.emoji;
-				});
-
-				if (ownReactionsIterated) {
-					if (reactionItr == displayedMessageReactions.end()) {
-						displayedMessageReactions.append({ reaction.emoji, 1, ownReactionsIterated, reaction.deliveryState });
-					} else {
-						reactionItr->count++;
-						reactionItr->ownReactionIncluded = ownReactionsIterated;
-						reactionItr->deliveryState = reaction.deliveryState;
-					}
-				} else {
-					if (reactionItr == displayedMessageReactions.end()) {
-						displayedMessageReactions.append({ reaction.emoji, 1, ownReactionsIterated, {} });
-					} else {
-						reactionItr->count++;
-					}
-				}
-			}
-		}
-
-		std::sort(displayedMessageReactions.begin(), displayedMessageReactions.end());
-
-		return QVariant::fromValue(displayedMessageReactions);
-	}
-	case DetailedReactions: {
-		QVector<DetailedMessageReaction> detailedMessageReactions;
-
-		const auto &reactionSenders = msg.reactionSenders;
-		for (auto itr = reactionSenders.begin(); itr != reactionSenders.end(); ++itr) {
-			// Skip own reactions.
-			if (itr.key() != m_currentAccountJid) {
-				QStringList emojis;
-
-				for (const auto &reaction : std::as_const(itr->reactions)) {
-					emojis.append(reaction.emoji);
-				}
-
-				std::sort(emojis.begin(), emojis.end());
-
-				detailedMessageReactions.append({ itr.key(), emojis });
-			}
-		}
-
-		return QVariant::fromValue(detailedMessageReactions);
-	}
+	case DisplayedReactions:
+		return QVariant::fromValue(m_rowCache.displayedReactions(row));
+	case DetailedReactions:
+		return QVariant::fromValue(m_rowCache.detailedReactions(row));
 	case OwnDetailedReactions:
 		return QVariant::fromValue(msg.reactionSenders.value(m_currentAccountJid).reactions);
 	case ErrorText:
@@ -321,18 +307,18 @@ void MessageModel::fetchMore(const QModelIndex &)
 				// the oldest stored contact message is marked as first unread.
 				if (lastReadContactMessageId.isEmpty()) {
 					MessageDb::instance()->fetchMessagesUntilFirstContactMessage(
-							AccountManager::instance()->jid(), m_currentChatJid, 0);
+							AccountManager::instance()->jid(), m_currentChatJid);
 				} else {
 					MessageDb::instance()->fetchMessagesUntilId(
-							AccountManager::instance()->jid(), m_currentChatJid, 0, lastReadContactMessageId);
+							AccountManager::instance()->jid(), m_currentChatJid, {}, lastReadContactMessageId);
 				}
 			} else {
 				MessageDb::instance()->fetchMessages(
-						AccountManager::instance()->jid(), m_currentChatJid, 0);
+						AccountManager::instance()->jid(), m_currentChatJid);
 			}
 		} else {
 			MessageDb::instance()->fetchMessages(
-					AccountManager::instance()->jid(), m_currentChatJid, m_messages.size());
+					AccountManager::instance()->jid(), m_currentChatJid, oldestMessageCursor());
 		}
 	} else if (!m_fetchedAllFromMam) {
 		// use earliest timestamp
@@ -597,13 +583,9 @@ void MessageModel::markMessageAsFirstUnread(int index)
 
 void MessageModel::addMessageReaction(const QString &messageId, const QString &emoji)
 {
-	const auto itr = std::find_if(m_messages.cbegin(), m_messages.cend(), [&](const Message &message) {
-		return message.id == messageId;
-	});
-
-	if (itr != m_messages.cend()) {
+	runWithLoadedMessage(messageId, [=, this](const Message &loadedMessage) {
 		const auto senderJid = m_currentAccountJid;
-		const auto reactions = itr->reactionSenders.value(senderJid).reactions;
+		const auto reactions = loadedMessage.reactionSenders.value(senderJid).reactions;
 
 		if (undoMessageReactionRemoval(messageId, senderJid, emoji, reactions)) {
 			return;
@@ -657,18 +639,14 @@ void MessageModel::addMessageReaction(const QString &messageId, const QString &e
 				});
 			}
 		});
-	}
+	});
 }
 
 void MessageModel::removeMessageReaction(const QString &messageId, const QString &emoji)
 {
-	const auto itr = std::find_if(m_messages.cbegin(), m_messages.cend(), [&](const Message &message) {
-		return message.id == messageId;
-	});
-
-	if (itr != m_messages.cend()) {
+	runWithLoadedMessage(messageId, [=, this](const Message &loadedMessage) {
 		const auto senderJid = m_currentAccountJid;
-		const auto &reactions = itr->reactionSenders.value(senderJid).reactions;
+		const auto reactions = loadedMessage.reactionSenders.value(senderJid).reactions;
 
 		if (undoMessageReactionAddition(messageId, senderJid, emoji, reactions)) {
 			return;
@@ -696,20 +674,22 @@ void MessageModel::removeMessageReaction(const QString &messageId, const QString
 
 		await(future, this, [=, this, chatJid = m_currentChatJid]() {
 			if (ConnectionState(Kaidan::instance()->connectionState()) == Enums::ConnectionState::StateConnected) {
-				auto &reactionSenders = itr->reactionSenders;
-				auto &reactions = reactionSenders[senderJid].reactions;
 				QVector<QString> emojis;
 
-				for (auto &reaction : reactions) {
-					const auto &storedEmoji = reaction.emoji;
-					const auto deliveryState = reaction.deliveryState;
+				// The reactions are taken from before the update because the message's row may
+				// have been reduced to a stub or removed in the meantime.
+				// The removed emoji is pending removal now.
+				for (const auto &reaction : reactions) {
+					if (reaction.emoji == emoji) {
+						continue;
+					}
 
-					switch (deliveryState) {
+					switch (reaction.deliveryState) {
 					case MessageReactionDeliveryState::PendingAddition:
 					case MessageReactionDeliveryState::ErrorOnAddition:
 					case MessageReactionDeliveryState::Sent:
 					case MessageReactionDeliveryState::Delivered:
-						emojis.append(storedEmoji);
+						emojis.append(reaction.emoji);
 						break;
 					default:
 						break;
@@ -748,16 +728,12 @@ void MessageModel::removeMessageReaction(const QString &messageId, const QString
 				});
 			}
 		});
-	}
+	});
 }
 
 void MessageModel::resendMessageReactions(const QString &messageId)
 {
-	const auto itr = std::find_if(m_messages.cbegin(), m_messages.cend(), [&](const Message &message) {
-		return message.id == messageId;
-	});
-
-	if (itr != m_messages.cend()) {
+	runWithLoadedMessage(messageId, [=, this](const Message &loadedMessage) {
 		const auto senderJid = m_currentAccountJid;
 
 		MessageDb::instance()->updateMessage(messageId, [senderJid](Message &message) {
@@ -784,7 +760,7 @@ void MessageModel::resendMessageReactions(const QString &messageId)
 		if (ConnectionState(Kaidan::instance()->connectionState()) == Enums::ConnectionState::StateConnected) {
 			QVector<QString> emojis;
 
-			for (const auto &reaction : itr->reactionSenders.value(m_currentAccountJid).reactions) {
+			for (const auto &reaction : loadedMessage.reactionSenders.value(senderJid).reactions) {
 				if (const auto deliveryState = reaction.deliveryState;
 					deliveryState != MessageReactionDeliveryState::PendingRemovalAfterSent &&
 					deliveryState != MessageReactionDeliveryState::PendingRemovalAfterDelivered &&
@@ -827,7 +803,7 @@ void MessageModel::resendMessageReactions(const QString &messageId)
 				});
 			});
 		}
-	}
+	});
 }
 
 void MessageModel::sendPendingMessageReactions(const QString &accountJid)
@@ -932,15 +908,22 @@ void MessageModel::handleMessagesFetched(const QVector<Message> &msgs)
 		return;
 	}
 
-	beginInsertRows(QModelIndex(), rowCount(), rowCount() + msgs.length() - 1);
-	for (auto msg : msgs) {
+	const auto firstRow = rowCount();
+
+	beginInsertRows(QModelIndex(), firstRow, firstRow + msgs.length() - 1);
+	for (const auto &msg : msgs) {
 		// Skip messages that were not fetched for the current chat.
 		if (msg.accountJid != m_currentAccountJid || msg.chatJid != m_currentChatJid) {
 			continue;
 		}
 
-		processMessage(msg);
-		m_messages << msg;
+		// The fetched messages are shared with the other receivers and must not be modified.
+		// Thus, each message is copied once and processed in place.
+		m_messages.append(msg);
+		processMessage(m_messages.last());
+	}
+	if (const auto lastRow = rowCount() - 1; lastRow >= firstRow) {
+		handleRowsInserted(firstRow, lastRow);
 	}
 	endInsertRows();
 
@@ -996,6 +979,7 @@ void MessageModel::resetCurrentChat(const QString &accountJid, const QString &ch
 	m_accountOmemoWatcher.setJid(accountJid);
 	m_contactOmemoWatcher.setJid(chatJid);
 	m_lastReadOwnMessageId = m_rosterItemWatcher.item().lastReadOwnMessageId;
+	m_rowCache.setAccountJid(accountJid);
 
 	// Reset the chat states of the previous chat.
 	m_ownChatState = QXmppMessage::State::None;
@@ -1020,9 +1004,13 @@ void MessageModel::removeAllMessages()
 	if (!m_messages.isEmpty()) {
 		beginRemoveRows(QModelIndex(), 0, rowCount() - 1);
 		m_messages.clear();
+		m_rowCache.reset();
 		endRemoveRows();
 	}
 
+	m_window.reset();
+	m_visibleRow = 0;
+
 	m_fetchedAllFromDb = false;
 	m_fetchedAllFromMam = false;
 	m_mamBacklogLastStamp = QDateTime();
@@ -1033,24 +1021,173 @@ void MessageModel::insertMessage(int idx, const Message &msg)
 {
 	beginInsertRows(QModelIndex(), idx, idx);
 	m_messages.insert(idx, msg);
+	handleRowsInserted(idx, idx);
 	endInsertRows();
 
 	updateLastReadOwnMessageId();
 }
 
+void MessageModel::handleRowsInserted(int first, int last)
+{
+	m_rowCache.insertRows(first, last);
+
+	if (m_window.insertRows(first, last) && !m_windowUpdateScheduled) {
+		m_windowUpdateScheduled = true;
+		QMetaObject::invokeMethod(this, &MessageModel::updateWindow, Qt::QueuedConnection);
+	}
+}
+
+void MessageModel::handleRowsRemoved(int first, int last)
+{
+	m_rowCache.removeRows(first, last);
+	m_window.removeRows(first, last);
+}
+
+void MessageModel::setWindowSize(int windowSize)
+{
+	m_window.setSize(windowSize > 0 ? std::max(windowSize, MIN_MESSAGE_WINDOW_SIZE) : 0);
+	updateWindow();
+}
+
+void MessageModel::setVisibleRange(int first, int last)
+{
+	if (first < 0) {
+		first = last;
+	} else if (last < 0) {
+		last = first;
+	}
+
+	if (first < 0 || last >= rowCount()) {
+		return;
+	}
+
+	if (first > last) {
+		std::swap(first, last);
+	}
+
+	m_visibleRow = first + (last - first) / 2;
+
+	if (m_windowUpdateScheduled) {
+		return;
+	}
+
+	// The window is moved before its edges are reached so that the messages are loaded before
+	// they are displayed.
+	if (m_window.isCloseToEdge(first) || m_window.isCloseToEdge(last)) {
+		m_windowUpdateScheduled = true;
+		QMetaObject::invokeMethod(this, &MessageModel::updateWindow, Qt::QueuedConnection);
+	}
+}
+
+void MessageModel::updateWindow()
+{
+	m_windowUpdateScheduled = false;
+
+	// The rows are not announced as changed because the messages reduced to stubs have not
+	// changed.
+	// Delegates still displaying them keep their data.
+	const auto messageIds = m_window.moveTo(m_visibleRow, [this](int first, int last) {
+		m_rowCache.updateRows(first, last);
+	});
+
+	if (messageIds.isEmpty()) {
+		logMemoryUsage();
+		return;
+	}
+
+	await(
+		MessageDb::instance()->fetchMessagesByIds(m_currentAccountJid, m_currentChatJid, messageIds),
+		this,
+		[this, accountJid = m_currentAccountJid, chatJid = m_currentChatJid](QVector<Message> messages) {
+			if (isChatCurrentChat(accountJid, chatJid)) {
+				loadMessagesIntoWindow(messages);
+			}
+		}
+	);
+}
+
+void MessageModel::loadMessagesIntoWindow(const QVector<Message> &messages)
+{
+	const auto loadedRows = m_window.load(messages, [this](Message &message) {
+		processMessage(message);
+	});
+
+	if (loadedRows) {
+		const auto [first, last] = *loadedRows;
+		m_rowCache.updateRows(first, last);
+		Q_EMIT dataChanged(index(first), index(last));
+	}
+
+	logMemoryUsage();
+}
+
+void MessageModel::logMemoryUsage() const
+{
+	if (messageModel_memory().isDebugEnabled()) {
+		qCDebug(
+			messageModel_memory,
+			"%d messages, %d in window, about %lld KiB",
+			int(m_messages.size()),
+			std::max(0, m_window.last() - m_window.first() + 1),
+			estimatedMemoryUsage() / 1024
+		);
+	}
+}
+
 void MessageModel::addMessage(const Message &msg)
 {
-	// index where to add the new message
-	int i = 0;
-	for (const auto &message : qAsConst(m_messages)) {
-		if (msg.timestamp > message.timestamp) {
-			insertMessage(i, msg);
-			return;
+	addMessages({ msg });
+}
+
+void MessageModel::addMessages(QVector<Message> messages)
+{
+	int insertedFirst = 0;
+	int insertedLast = 0;
+
+	// Newer messages are placed before older ones.
+	insertSorted(
+		m_messages,
+		std::move(messages),
+		[](const Message &left, const Message &right) {
+			return left.timestamp > right.timestamp;
+		},
+		[&, this](int first, int last) {
+			insertedFirst = first;
+			insertedLast = last;
+			beginInsertRows(QModelIndex(), first, last);
+		},
+		[&, this]() {
+			handleRowsInserted(insertedFirst, insertedLast);
+			endInsertRows();
 		}
-		i++;
+	);
+
+	updateLastReadOwnMessageId();
+}
+
+void MessageModel::addMessageStubs(QVector<Message> stubs)
+{
+	// Stubs of messages that have been fetched in the meantime are skipped.
+	if (!m_messages.isEmpty()) {
+		const auto oldestCursor = oldestMessageCursor();
+
+		stubs.erase(std::remove_if(stubs.begin(), stubs.end(), [&](const Message &stub) {
+			return std::tie(stub.timestamp, stub.id) >= std::tie(oldestCursor.timestamp, oldestCursor.id);
+		}), stubs.end());
 	}
-	// add message to the end of the list
-	insertMessage(i, msg);
+
+	if (stubs.isEmpty()) {
+		return;
+	}
+
+	const auto first = int(m_messages.size());
+	const auto last = first + int(stubs.size()) - 1;
+
+	beginInsertRows(QModelIndex(), first, last);
+	m_messages.append(stubs);
+	m_rowCache.insertRows(first, last);
+	m_window.insertStubRows(first, last);
+	endInsertRows();
 }
 
 void MessageModel::updateLastReadOwnMessageId()
@@ -1088,14 +1225,22 @@ void MessageModel::updateLastReadOwnMessageId()
 	}
 }
 
-void MessageModel::handleMessage(Message msg, MessageOrigin origin)
+void MessageModel::handleMessagesAdded(const QVector<Message> &messages, MessageOrigin origin)
 {
-	processMessage(msg);
+	QVector<Message> currentChatMessages;
+
+	for (auto message : messages) {
+		processMessage(message);
 
-	showMessageNotification(msg, origin);
+		showMessageNotification(message, origin);
+
+		if (message.accountJid == m_currentAccountJid && message.chatJid == m_currentChatJid) {
+			currentChatMessages.append(std::move(message));
+		}
+	}
 
-	if (msg.accountJid == m_currentAccountJid && msg.chatJid == m_currentChatJid) {
-		addMessage(std::move(msg));
+	if (!currentChatMessages.isEmpty()) {
+		addMessages(std::move(currentChatMessages));
 	}
 }
 
@@ -1113,6 +1258,7 @@ void MessageModel::handleMessageUpdated(const Message &message)
 			(!oldReplaceId.isEmpty() && oldReplaceId == message.replaceId)) {
 			beginRemoveRows(QModelIndex(), i, i);
 			m_messages.removeAt(i);
+			handleRowsRemoved(i, i);
 			endRemoveRows();
 
 			// Insert the message at its original position if the date is unchanged.
@@ -1135,17 +1281,58 @@ int MessageModel::searchForMessageFromNewToOld(const QString &searchString, int
 	int foundIndex = startIndex;
 
 	if (foundIndex < m_messages.size()) {
-		for (; foundIndex < m_messages.size(); foundIndex++) {
-			if (foundIndex > -1 && m_messages.at(foundIndex).body.contains(searchString, Qt::CaseInsensitive)) {
+		for (foundIndex = std::max(foundIndex, 0); foundIndex < m_messages.size(); foundIndex++) {
+			// Stubs and messages that are still being fetched cannot be searched locally.
+			if (!m_window.isLoaded(foundIndex)) {
+				break;
+			}
+
+			if (MessageDb::matchesSearchString(m_messages.at(foundIndex).body, searchString)) {
 				return foundIndex;
 			}
 		}
 
+		// Search the remaining messages by the full-text search index and add the stubs of the
+		// messages until the found one if it is not in the list yet.
+		// The window is moved to the found message so that only the messages around it are
+		// completely loaded.
+		const auto accountJid = AccountManager::instance()->jid();
+		const auto chatJid = m_currentChatJid;
+		const auto cursor = foundIndex > 0 ? messageCursor(foundIndex - 1) : MessageDb::MessageCursor();
+
 		await(
-			MessageDb::instance()->fetchMessagesUntilQueryString(AccountManager::instance()->jid(), m_currentChatJid, foundIndex, searchString),
+			MessageDb::instance()->searchMessages(accountJid, chatJid, searchString, cursor, 1),
 			this,
-			[this](auto result) {
-				Q_EMIT messageSearchFinished(result.queryIndex);
+			[this, accountJid, chatJid](QVector<MessageDb::MessageSearchResult> results) {
+				if (results.isEmpty() || !isChatCurrentChat(accountJid, chatJid)) {
+					Q_EMIT messageSearchFinished(-1);
+					return;
+				}
+
+				const auto messageId = results.constFirst().messageId;
+
+				const auto loaded = std::any_of(m_messages.cbegin(), m_messages.cend(), [&](const Message &message) {
+					return message.id == messageId;
+				});
+
+				if (loaded) {
+					finishMessageSearch(messageId);
+					return;
+				}
+
+				await(
+					MessageDb::instance()->fetchMessageStubsUntilId(accountJid, chatJid, oldestMessageCursor(), messageId),
+					this,
+					[this, accountJid, chatJid, messageId](QVector<Message> stubs) {
+						if (!isChatCurrentChat(accountJid, chatJid)) {
+							Q_EMIT messageSearchFinished(-1);
+							return;
+						}
+
+						addMessageStubs(std::move(stubs));
+						finishMessageSearch(messageId);
+					}
+				);
 			}
 		);
 	}
@@ -1155,16 +1342,100 @@ int MessageModel::searchForMessageFromNewToOld(const QString &searchString, int
 
 int MessageModel::searchForMessageFromOldToNew(const QString &searchString, int startIndex)
 {
-	int foundIndex = startIndex;
+	for (int foundIndex = std::min(startIndex, int(m_messages.size()) - 1); foundIndex >= 0; foundIndex--) {
+		if (m_window.isLoaded(foundIndex)) {
+			if (MessageDb::matchesSearchString(m_messages.at(foundIndex).body, searchString)) {
+				return foundIndex;
+			}
 
-	if (foundIndex >= 0) {
-		for (; foundIndex >= 0; foundIndex--) {
-			if (m_messages.at(foundIndex).body.contains(searchString, Qt::CaseInsensitive))
-				break;
+			continue;
+		}
+
+		// Stubs and messages that are still being fetched cannot be searched locally.
+		// Thus, the following ones are fetched in chunks of the window's minimum size so that
+		// not all of them are completely loaded at once.
+		QVector<QString> messageIds;
+		for (int i = foundIndex; i >= 0 && !m_window.isLoaded(i) && messageIds.size() < MIN_MESSAGE_WINDOW_SIZE; i--) {
+			messageIds.append(m_messages.at(i).id);
 		}
+
+		await(
+			MessageDb::instance()->fetchMessagesByIds(m_currentAccountJid, m_currentChatJid, messageIds),
+			this,
+			[this, searchString, messageIds, accountJid = m_currentAccountJid, chatJid = m_currentChatJid](QVector<Message> messages) {
+				if (!isChatCurrentChat(accountJid, chatJid)) {
+					Q_EMIT messageSearchFinished(-1);
+					return;
+				}
+
+				QHash<QString, QString> bodies;
+				bodies.reserve(messages.size());
+				for (const auto &message : std::as_const(messages)) {
+					bodies.insert(message.id, message.body);
+				}
+
+				for (const auto &messageId : messageIds) {
+					if (MessageDb::matchesSearchString(bodies.value(messageId), searchString)) {
+						finishMessageSearch(messageId);
+						return;
+					}
+				}
+
+				// Continue with the messages that are more recent than the searched stubs.
+				const auto lastSearchedMessage = std::find_if(m_messages.cbegin(), m_messages.cend(), [&](const Message &message) {
+					return message.id == messageIds.constLast();
+				});
+
+				if (lastSearchedMessage == m_messages.cend()) {
+					Q_EMIT messageSearchFinished(-1);
+					return;
+				}
+
+				const auto lastSearchedIndex = int(std::distance(m_messages.cbegin(), lastSearchedMessage));
+
+				if (const auto foundIndex = searchForMessageFromOldToNew(searchString, lastSearchedIndex - 1); foundIndex != -1) {
+					Q_EMIT messageSearchFinished(foundIndex);
+				}
+			}
+		);
+
+		return -1;
 	}
 
-	return foundIndex;
+	Q_EMIT messageSearchFinished(-1);
+	return -1;
+}
+
+void MessageModel::finishMessageSearch(const QString &messageId)
+{
+	const auto itr = std::find_if(m_messages.cbegin(), m_messages.cend(), [&](const Message &message) {
+		return message.id == messageId;
+	});
+
+	if (itr == m_messages.cend()) {
+		Q_EMIT messageSearchFinished(-1);
+		return;
+	}
+
+	m_visibleRow = int(std::distance(m_messages.cbegin(), itr));
+	updateWindow();
+
+	Q_EMIT messageSearchFinished(m_visibleRow);
+}
+
+MessageDb::MessageCursor MessageModel::oldestMessageCursor() const
+{
+	if (m_messages.isEmpty()) {
+		return {};
+	}
+
+	return messageCursor(m_messages.size() - 1);
+}
+
+MessageDb::MessageCursor MessageModel::messageCursor(int row) const
+{
+	const auto &message = m_messages.at(row);
+	return { message.timestamp, message.id };
 }
 
 void MessageModel::processMessage(Message &msg)
@@ -1228,6 +1499,8 @@ void MessageModel::correctMessage(const QString &replaceId, const QString &body,
 		message.isSpoiler = !spoilerHint.isEmpty();
 		message.spoilerHint = spoilerHint;
 
+		bool sendingRequired = false;
+
 		if (message.deliveryState != Enums::DeliveryState::Pending) {
 			message.id = QXmppUtils::generateStanzaUuid();
 			// Set replaceId only on first correction, so it's always the original id
@@ -1237,23 +1510,47 @@ void MessageModel::correctMessage(const QString &replaceId, const QString &body,
 			}
 			message.deliveryState = Enums::DeliveryState::Pending;
 
-			if (ConnectionState(Kaidan::instance()->connectionState()) == Enums::ConnectionState::StateConnected) {
-				// the trick with the time is important for the servers
-				// this way they can tell which version of the message is the latest
-				Message copy = message;
-				copy.timestamp = QDateTime::currentDateTimeUtc();
-				Q_EMIT sendCorrectedMessageRequested(copy);
-			}
+			sendingRequired = ConnectionState(Kaidan::instance()->connectionState()) == Enums::ConnectionState::StateConnected;
 		} else if (message.replaceId.isEmpty()) {
 			message.timestamp = QDateTime::currentDateTimeUtc();
 		}
 
-		QModelIndex index = createIndex(std::distance(m_messages.begin(), itr), 0);
+		const auto row = int(std::distance(m_messages.begin(), itr));
+		m_rowCache.updateRows(row, row);
+
+		QModelIndex index = createIndex(row, 0);
 		Q_EMIT dataChanged(index, index);
 
+		// Only the corrected attributes are stored because the message might be a stub.
 		MessageDb::instance()->updateMessage(replaceId, [message](Message &localMessage) {
-			localMessage = message;
+			localMessage.id = message.id;
+			localMessage.replaceId = message.replaceId;
+			localMessage.timestamp = message.timestamp;
+			localMessage.body = message.body;
+			localMessage.deliveryState = message.deliveryState;
+			localMessage.isSpoiler = message.isSpoiler;
+			localMessage.spoilerHint = message.spoilerHint;
 		});
+
+		// The corrected message is fetched after it has been updated because the message in the
+		// model might be a stub lacking data needed for sending it.
+		// The thumbnails are fetched as well since they are sent along with the message but not
+		// kept in the model.
+		if (sendingRequired) {
+			await(
+				MessageDb::instance()->fetchMessagesByIds(message.accountJid, message.chatJid, { message.id }, true),
+				this,
+				[this](QVector<Message> messages) {
+					if (!messages.isEmpty()) {
+						// the trick with the time is important for the servers
+						// this way they can tell which version of the message is the latest
+						auto correctedMessage = messages.constFirst();
+						correctedMessage.timestamp = QDateTime::currentDateTimeUtc();
+						Q_EMIT sendCorrectedMessageRequested(correctedMessage);
+					}
+				}
+			);
+		}
 	}
 }
 
@@ -1314,6 +1611,7 @@ void MessageModel::removeMessage(const QString &messageId)
 
 		beginRemoveRows(QModelIndex(), readMessageIndex, readMessageIndex);
 		m_messages.removeAt(readMessageIndex);
+		handleRowsRemoved(readMessageIndex, readMessageIndex);
 		endRemoveRows();
 
 		Q_EMIT dataChanged(index, index);
@@ -1366,6 +1664,33 @@ void MessageModel::showMessageNotification(const Message &message, MessageOrigin
 	}
 }
 
+void MessageModel::runWithLoadedMessage(const QString &messageId, const std::function<void(const Message &)> &handleMessage)
+{
+	const auto itr = std::find_if(m_messages.cbegin(), m_messages.cend(), [&](const Message &message) {
+		return message.id == messageId;
+	});
+
+	if (itr == m_messages.cend()) {
+		return;
+	}
+
+	if (m_window.isLoaded(int(std::distance(m_messages.cbegin(), itr)))) {
+		handleMessage(*itr);
+		return;
+	}
+
+	// The message is a stub or still being fetched.
+	await(
+		MessageDb::instance()->fetchMessagesByIds(m_currentAccountJid, m_currentChatJid, { messageId }),
+		this,
+		[this, handleMessage, accountJid = m_currentAccountJid, chatJid = m_currentChatJid](QVector<Message> messages) {
+			if (isChatCurrentChat(accountJid, chatJid) && !messages.isEmpty()) {
+				handleMessage(messages.constFirst());
+			}
+		}
+	);
+}
+
 bool MessageModel::undoMessageReactionRemoval(const QString &messageId, const QString &senderJid, const QString &emoji, const QVector<MessageReaction> &reactions)
 {
 	const auto reactionItr = std::find_if(reactions.begin(), reactions.end(), [&](const MessageReaction &reaction) {
@@ -1486,6 +1811,13 @@ void MessageModel::setMamLoading(bool mamLoading)
 	}
 }
 
+qint64 MessageModel::estimatedMemoryUsage() const
+{
+	return std::accumulate(m_messages.cbegin(), m_messages.cend(), qint64(0), [](qint64 size, const Message &message) {
+		return size + estimatedSize(message);
+	});
+}
+
 void MessageModel::handleKeysRetrieved(const QHash<QString, QHash<QByteArray, QXmpp::TrustLevel>> &keys)
 {
 	m_keys = keys;
@@ -1498,19 +1830,6 @@ void MessageModel::handleKeysRetrieved(const QHash<QString, QHash<QByteArray, QX
 	}
 }
 
-QDate MessageModel::searchNextDate(int messageStartIndex) const
-{
-	const auto startDate = m_messages.at(messageStartIndex).timestamp.toLocalTime().date();
-
-	for (int i = messageStartIndex; i >= 0; i--) {
-		if (const auto date = m_messages.at(i).timestamp.toLocalTime().date(); date > startDate) {
-			return date;
-		}
-	}
-
-	return {};
-}
-
 QString MessageModel::formatDate(QDate localDate) const
 {
 	if (localDate.isNull()) {
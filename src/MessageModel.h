@@ -16,12 +16,16 @@
 #include <QXmppMessage.h>
 // Kaidan
 #include "Message.h"
+#include "MessageDb.h"
+#include "MessageRowCache.h"
+#include "MessageWindow.h"
 #include "OmemoWatcher.h"
 #include "PresenceCache.h"
 #include "RosterItemWatcher.h"
 
 class QTimer;
 class Kaidan;
+class Settings;
 
 class ChatState : public QObject
 {
@@ -41,40 +45,6 @@ public:
 
 Q_DECLARE_METATYPE(ChatState::State)
 
-struct DisplayedMessageReaction
-{
-	Q_GADGET
-	Q_PROPERTY(QString emoji MEMBER emoji)
-	Q_PROPERTY(int count MEMBER count)
-	Q_PROPERTY(bool ownReactionIncluded MEMBER ownReactionIncluded)
-	Q_PROPERTY(MessageReactionDeliveryState::Enum deliveryState MEMBER deliveryState)
-
-public:
-	QString emoji;
-	int count;
-	bool ownReactionIncluded;
-	MessageReactionDeliveryState::Enum deliveryState;
-
-	bool operator<(const DisplayedMessageReaction &other) const;
-};
-
-Q_DECLARE_METATYPE(DisplayedMessageReaction)
-
-struct DetailedMessageReaction
-{
-	Q_GADGET
-	Q_PROPERTY(QString senderJid MEMBER senderJid)
-	Q_PROPERTY(QStringList emojis MEMBER emojis)
-
-public:
-	QString senderJid;
-	QStringList emojis;
-
-	bool operator<(const DetailedMessageReaction &other) const;
-};
-
-Q_DECLARE_METATYPE(DetailedMessageReaction)
-
 class MessageModel : public QAbstractListModel
 {
 	Q_OBJECT
@@ -116,7 +86,7 @@ public:
 
 	static MessageModel *instance();
 
-	MessageModel(QObject *parent = nullptr);
+	MessageModel(Settings *settings, QObject *parent = nullptr);
 	~MessageModel();
 
 	Q_REQUIRED_RESULT bool isEmpty() const;
@@ -127,6 +97,17 @@ public:
 	Q_INVOKABLE void fetchMore(const QModelIndex &parent) override;
 	Q_INVOKABLE bool canFetchMore(const QModelIndex &parent) const override;
 
+	/**
+	 * Sets the rows displayed by the view.
+	 *
+	 * The window of completely loaded messages is moved to the center of the displayed rows once
+	 * control returns to the event loop if they are close to an edge of the window.
+	 *
+	 * @param first first displayed row or -1 if it is not known
+	 * @param last last displayed row or -1 if it is not known
+	 */
+	Q_INVOKABLE void setVisibleRange(int first, int last);
+
 	QString currentAccountJid();
 	QString currentChatJid();
 	Q_INVOKABLE void setCurrentChat(const QString &accountJid, const QString &chatJid);
@@ -220,10 +201,13 @@ public:
 	 *
 	 * If no index is passed, the search begins from the oldest message.
 	 *
+	 * Messages outside of the window are fetched from the database for searching them.
+	 * In that case, messageSearchFinished() is emitted once the search is finished.
+	 *
 	 * @param searchString substring to search for
 	 * @param startIndex index of the first message to search for the given string
 	 *
-	 * @return index of the first found message containing the given string or -1 if no message containing the given string could be found
+	 * @return index of the first found message containing the given string or -1 if no message containing the given string could be found yet
 	 */
 	Q_INVOKABLE int searchForMessageFromOldToNew(const QString &searchString, int startIndex = -1);
 
@@ -241,6 +225,13 @@ public:
 	bool mamLoading() const;
 	void setMamLoading(bool mamLoading);
 
+	/**
+	 * Returns the estimated number of bytes used by the loaded messages.
+	 *
+	 * That includes the stubs of messages outside of the window.
+	 */
+	qint64 estimatedMemoryUsage() const;
+
 signals:
 	void currentAccountJidChanged(const QString &accountJid);
 	void currentChatJidChanged(const QString &currentChatJid);
@@ -276,7 +267,19 @@ private:
 
 	void addMessage(const Message &msg);
 
-	void handleMessage(Message msg, MessageOrigin origin);
+	/**
+	 * Adds messages at their positions according to their timestamps.
+	 *
+	 * Messages ending up next to each other are inserted as one range of rows.
+	 */
+	void addMessages(QVector<Message> messages);
+
+	/**
+	 * Appends the stubs of messages older than the loaded ones without completely loading them.
+	 */
+	void addMessageStubs(QVector<Message> stubs);
+
+	void handleMessagesAdded(const QVector<Message> &messages, MessageOrigin origin);
 	void handleMessageUpdated(const Message &message);
 	void handleChatState(const QString &bareJid, QXmppMessage::State state);
 	void handleMessageRemoved(const QString &senderJid, const QString &recipientJid, const QString &messageId);
@@ -295,6 +298,56 @@ private:
 
 	void insertMessage(int i, const Message &msg);
 
+	/**
+	 * Must be called after messages are inserted into m_messages and before the insertion is
+	 * announced.
+	 *
+	 * Inserted messages outside of the window are reduced to stubs.
+	 */
+	void handleRowsInserted(int first, int last);
+
+	/**
+	 * Must be called after messages are removed from m_messages and before the removal is
+	 * announced.
+	 */
+	void handleRowsRemoved(int first, int last);
+
+	/**
+	 * Sets the maximum number of completely loaded messages.
+	 *
+	 * @param windowSize maximum number of messages or 0 for keeping all loaded messages
+	 */
+	void setWindowSize(int windowSize);
+
+	/**
+	 * Moves the window to the most recently displayed row, reduces the messages leaving the window
+	 * to stubs and loads the messages entering it from the database.
+	 */
+	void updateWindow();
+
+	/**
+	 * Replaces the stubs within the window by the fetched messages.
+	 */
+	void loadMessagesIntoWindow(const QVector<Message> &messages);
+
+	void logMemoryUsage() const;
+
+	/**
+	 * Finishes a search by moving the window to the found message and emitting
+	 * messageSearchFinished().
+	 */
+	void finishMessageSearch(const QString &messageId);
+
+	/**
+	 * Returns the position of a loaded message used to fetch the messages before it.
+	 */
+	MessageDb::MessageCursor messageCursor(int row) const;
+
+	/**
+	 * Returns the position of the oldest loaded message used to fetch the next page of messages.
+	 */
+	MessageDb::MessageCursor oldestMessageCursor() const;
+
 	/**
 	 * Shortens messages to 10000 if longer to prevent DoS
 	 * @param message to process
@@ -308,6 +361,19 @@ private:
 	 */
 	void showMessageNotification(const Message &message, MessageOrigin origin) const;
 
+	/**
+	 * Calls a function with the completely loaded message of the current chat that has a specific
+	 * ID.
+	 *
+	 * If the message is not loaded because it is outside of the window, it is fetched from the
+	 * database first.
+	 * The passed message must not be used after the function returns.
+	 *
+	 * @param messageId ID of the message
+	 * @param handleMessage function called with the message if it is found
+	 */
+	void runWithLoadedMessage(const QString &messageId, const std::function<void(const Message &)> &handleMessage);
+
 	/**
 	 * Undoes a pending or failed removal of a message reaction.
 	 *
@@ -342,23 +408,15 @@ private:
 
 	void updateMessageReactionsAfterSending(const QString &messageId, const QString &senderJid);
 
-	/**
-	 * Searches a message with a more recent date and returns that date.
-	 *
-	 * This is needed as a workaround for a bug in Qt Quick's implementation of the ListView section
-	 * for "verticalLayoutDirection: ListView.BottomToTop".
-	 * That bug results in each section label being displayed at the bottom of its corresponding
-	 * section instead of displaying it at the top of it.
-	 *
-	 * @param messageStartIndex index of the message to start the search with
-	 *
-	 * @return the date of the first message with a more recent date
-	 */
-	QDate searchNextDate(int messageStartIndex) const;
-
 	QString formatDate(QDate localDate) const;
 
+	// Messages outside of the window are stubs only containing the data needed for their positions
+	// and read markers.
 	QVector<Message> m_messages;
+	MessageRowCache m_rowCache = MessageRowCache(m_messages);
+	MessageWindow m_window = MessageWindow(m_messages);
+	int m_visibleRow = 0;
+	bool m_windowUpdateScheduled = false;
 	QString m_currentAccountJid;
 	QString m_currentChatJid;
 	RosterItemWatcher m_rosterItemWatcher;
@@ -0,0 +1,230 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "MessageRowCache.h"
+
+#include <QLocale>
+
+MessageRowCache::MessageRowCache(const QVector<Message> &messages)
+	: m_messages(messages),
+	  m_rows(messages.size())
+{
+}
+
+void MessageRowCache::setAccountJid(const QString &accountJid)
+{
+	m_accountJid = accountJid;
+	reset();
+}
+
+void MessageRowCache::insertRows(int first, int last)
+{
+	m_rows.insert(first, last - first + 1, Row());
+	invalidateNextDates(last + 1);
+	m_firstContactMessageRow.reset();
+}
+
+void MessageRowCache::removeRows(int first, int last)
+{
+	m_rows.remove(first, last - first + 1);
+	invalidateNextDates(first);
+	m_firstContactMessageRow.reset();
+}
+
+void MessageRowCache::updateRows(int first, int last)
+{
+	for (int i = first; i <= last; i++) {
+		m_rows[i] = Row();
+	}
+
+	invalidateNextDates(last + 1);
+	m_firstContactMessageRow.reset();
+}
+
+void MessageRowCache::reset()
+{
+	m_rows = QVector<Row>(m_messages.size());
+	m_firstContactMessageRow.reset();
+	m_hasUnsortedRows = false;
+}
+
+QDate MessageRowCache::date(int row) const
+{
+	auto &date = m_rows[row].date;
+
+	if (!date) {
+		date = m_messages.at(row).timestamp.toLocalTime().date();
+	}
+
+	return *date;
+}
+
+QDate MessageRowCache::nextDate(int row) const
+{
+	if (const auto &nextDate = m_rows.at(row).nextDate) {
+		return *nextDate;
+	}
+
+	// Start with the oldest row after the closest more recent row whose next date is cached.
+	auto first = row;
+	while (first > 0 && !m_rows.at(first - 1).nextDate) {
+		--first;
+	}
+
+	// Each row's next date is derived from the row before it.
+	// That way, a row's next date is computed in constant time if the row before it has already
+	// been accessed, which is the case while scrolling.
+	for (int i = first; i <= row; i++) {
+		QDate nextDate;
+
+		if (i > 0) {
+			const auto currentDate = date(i);
+
+			if (const auto previousDate = date(i - 1); previousDate > currentDate) {
+				nextDate = previousDate;
+			} else if (previousDate == currentDate) {
+				nextDate = *m_rows.at(i - 1).nextDate;
+			} else {
+				// The list is not sorted at this position (e.g., after correcting a pending
+				// message).
+				m_hasUnsortedRows = true;
+
+				for (int j = i - 1; j >= 0; j--) {
+					if (const auto date = this->date(j); date > currentDate) {
+						nextDate = date;
+						break;
+					}
+				}
+			}
+		}
+
+		m_rows[i].nextDate = nextDate;
+	}
+
+	return *m_rows.at(row).nextDate;
+}
+
+bool MessageRowCache::isFollowedByOwnMessagesOnly(int row) const
+{
+	if (!m_firstContactMessageRow) {
+		int i = 0;
+		while (i < m_messages.size() && m_messages.at(i).senderId == m_accountJid) {
+			++i;
+		}
+
+		m_firstContactMessageRow = i;
+	}
+
+	return row < *m_firstContactMessageRow;
+}
+
+QString MessageRowCache::time(int row) const
+{
+	auto &time = m_rows[row].time;
+
+	if (!time) {
+		time = QLocale::system().toString(m_messages.at(row).timestamp.time(), QLocale::ShortFormat);
+	}
+
+	return *time;
+}
+
+QVector<DisplayedMessageReaction> MessageRowCache::displayedReactions(int row) const
+{
+	auto &displayedReactions = m_rows[row].displayedReactions;
+
+	if (displayedReactions) {
+		return *displayedReactions;
+	}
+
+	QVector<DisplayedMessageReaction> displayedMessageReactions;
+
+	const auto &reactionSenders = m_messages.at(row).reactionSenders;
+	for (auto itr = reactionSenders.begin(); itr != reactionSenders.end(); ++itr) {
+		const auto ownReactionsIterated = itr.key() == m_accountJid;
+
+		for (const auto &reaction : std::as_const(itr->reactions)) {
+			auto reactionItr = std::find_if(displayedMessageReactions.begin(), displayedMessageReactions.end(), [=](const DisplayedMessageReaction &displayedMessageReaction) {
+				return displayedMessageReaction.emoji == reaction.emoji;
+			});
+
+			if (ownReactionsIterated) {
+				if (reactionItr == displayedMessageReactions.end()) {
+					displayedMessageReactions.append({ reaction.emoji, 1, ownReactionsIterated, reaction.deliveryState });
+				} else {
+					reactionItr->count++;
+					reactionItr->ownReactionIncluded = ownReactionsIterated;
+					reactionItr->deliveryState = reaction.deliveryState;
+				}
+			} else {
+				if (reactionItr == displayedMessageReactions.end()) {
+					displayedMessageReactions.append({ reaction.emoji, 1, ownReactionsIterated, {} });
+				} else {
+					reactionItr->count++;
+				}
+			}
+		}
+	}
+
+	std::sort(displayedMessageReactions.begin(), displayedMessageReactions.end());
+
+	displayedReactions = displayedMessageReactions;
+	return displayedMessageReactions;
+}
+
+QVector<DetailedMessageReaction> MessageRowCache::detailedReactions(int row) const
+{
+	auto &detailedReactions = m_rows[row].detailedReactions;
+
+	if (detailedReactions) {
+		return *detailedReactions;
+	}
+
+	QVector<DetailedMessageReaction> detailedMessageReactions;
+
+	const auto &reactionSenders = m_messages.at(row).reactionSenders;
+	for (auto itr = reactionSenders.begin(); itr != reactionSenders.end(); ++itr) {
+		// Skip own reactions.
+		if (itr.key() != m_accountJid) {
+			QStringList emojis;
+
+			for (const auto &reaction : std::as_const(itr->reactions)) {
+				emojis.append(reaction.emoji);
+			}
+
+			std::sort(emojis.begin(), emojis.end());
+
+			detailedMessageReactions.append({ itr.key(), emojis });
+		}
+	}
+
+	detailedReactions = detailedMessageReactions;
+	return detailedMessageReactions;
+}
+
+void MessageRowCache::invalidateNextDates(int first)
+{
+	// The next date of a row depends on the rows before it up to the closest one with a more
+	// recent date.
+	// Thus, only the next dates of the rows with the same date as the first row can be affected by
+	// changes before the first row.
+	if (first >= m_rows.size()) {
+		return;
+	}
+
+	// The next date of a row that is not sorted can depend on any row before it.
+	if (m_hasUnsortedRows) {
+		for (int i = first; i < m_rows.size(); i++) {
+			m_rows[i].nextDate.reset();
+		}
+
+		return;
+	}
+
+	const auto firstDate = date(first);
+
+	for (int i = first; i < m_rows.size() && date(i) == firstDate; i++) {
+		m_rows[i].nextDate.reset();
+	}
+}
@@ -0,0 +1,107 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <optional>
+
+#include <QDate>
+#include <QVector>
+
+#include "Message.h"
+
+/**
+ * Caches data of the rows of a message list that is derived from several messages or expensive to
+ * compute.
+ *
+ * The list must be sorted from the newest to the oldest message.
+ * The data is computed on first access and cached until the cache is notified about changes of
+ * the rows it depends on.
+ */
+class MessageRowCache
+{
+public:
+	explicit MessageRowCache(const QVector<Message> &messages);
+
+	/**
+	 * Sets the JID of the account whose messages and reactions are regarded as own ones.
+	 *
+	 * All cached data is discarded.
+	 */
+	void setAccountJid(const QString &accountJid);
+
+	/**
+	 * Must be called after rows are inserted into the list.
+	 */
+	void insertRows(int first, int last);
+
+	/**
+	 * Must be called after rows are removed from the list.
+	 */
+	void removeRows(int first, int last);
+
+	/**
+	 * Must be called after messages of the list are modified in place.
+	 */
+	void updateRows(int first, int last);
+
+	/**
+	 * Discards all cached data, e.g., after the list has been replaced.
+	 */
+	void reset();
+
+	/**
+	 * Returns the local date of a message.
+	 */
+	QDate date(int row) const;
+
+	/**
+	 * Returns the local date of the first more recent message with a more recent date or a null
+	 * date if there is none.
+	 *
+	 * This is needed as a workaround for a bug in Qt Quick's implementation of the ListView section
+	 * for "verticalLayoutDirection: ListView.BottomToTop".
+	 * That bug results in each section label being displayed at the bottom of its corresponding
+	 * section instead of displaying it at the top of it.
+	 */
+	QDate nextDate(int row) const;
+
+	/**
+	 * Returns whether a message and all messages that are more recent are own messages.
+	 */
+	bool isFollowedByOwnMessagesOnly(int row) const;
+
+	/**
+	 * Returns the local time of a message formatted for displaying it.
+	 */
+	QString time(int row) const;
+
+	/**
+	 * Returns the reactions to a message grouped by their emojis.
+	 */
+	QVector<DisplayedMessageReaction> displayedReactions(int row) const;
+
+	/**
+	 * Returns the reactions to a message grouped by their senders excluding the own ones.
+	 */
+	QVector<DetailedMessageReaction> detailedReactions(int row) const;
+
+private:
+	struct Row
+	{
+		std::optional<QDate> date;
+		std::optional<QDate> nextDate;
+		std::optional<QString> time;
+		std::optional<QVector<DisplayedMessageReaction>> displayedReactions;
+		std::optional<QVector<DetailedMessageReaction>> detailedReactions;
+	};
+
+	void invalidateNextDates(int first);
+
+	const QVector<Message> &m_messages;
+	QString m_accountJid;
+	mutable QVector<Row> m_rows;
+	mutable std::optional<int> m_firstContactMessageRow;
+	mutable bool m_hasUnsortedRows = false;
+};
@@ -0,0 +1,222 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "MessageWindow.h"
+
+#include <algorithm>
+
+#include <QHash>
+
+// Returns a message reduced to the data needed for its position and read markers.
+static Message createMessageStub(const Message &message)
+{
+	Message stub;
+	stub.accountJid = message.accountJid;
+	stub.chatJid = message.chatJid;
+	stub.senderId = message.senderId;
+	stub.id = message.id;
+	stub.replaceId = message.replaceId;
+	stub.timestamp = message.timestamp;
+	stub.deliveryState = message.deliveryState;
+	return stub;
+}
+
+MessageWindow::MessageWindow(QVector<Message> &messages)
+	: m_messages(messages)
+{
+}
+
+int MessageWindow::size() const
+{
+	return m_size;
+}
+
+void MessageWindow::setSize(int size)
+{
+	m_size = std::max(size, 0);
+}
+
+int MessageWindow::first() const
+{
+	return m_first;
+}
+
+int MessageWindow::last() const
+{
+	return m_last;
+}
+
+bool MessageWindow::contains(int row) const
+{
+	return row >= m_first && row <= m_last;
+}
+
+bool MessageWindow::isStub(int row) const
+{
+	return !contains(row) && !m_messages.at(row).id.isEmpty();
+}
+
+bool MessageWindow::isLoaded(int row) const
+{
+	return !isStub(row) && !m_pendingMessageIds.contains(m_messages.at(row).id);
+}
+
+bool MessageWindow::insertRows(int first, int last)
+{
+	const auto count = last - first + 1;
+
+	if (first < m_first) {
+		// Messages inserted before the window are not displayed.
+		m_first += count;
+		m_last += count;
+		createStubs(first, last);
+	} else if (first <= m_last + 1) {
+		// Messages inserted within the window or directly after it extend the window.
+		// They are completely loaded even if a previous version of them is still being fetched.
+		m_last += count;
+
+		for (int i = first; i <= last; i++) {
+			m_pendingMessageIds.remove(m_messages.at(i).id);
+		}
+
+		return m_size && m_last - m_first + 1 > m_size;
+	} else {
+		// Messages inserted after the window are not displayed.
+		createStubs(first, last);
+	}
+
+	return false;
+}
+
+void MessageWindow::insertStubRows(int first, int last)
+{
+	Q_ASSERT(first <= m_first || first > m_last);
+
+	if (first <= m_first && m_first <= m_last) {
+		const auto count = last - first + 1;
+		m_first += count;
+		m_last += count;
+	}
+}
+
+void MessageWindow::removeRows(int first, int last)
+{
+	const auto count = last - first + 1;
+
+	if (m_first > last) {
+		m_first -= count;
+	} else {
+		m_first = std::min(m_first, first);
+	}
+
+	if (m_last > last) {
+		m_last -= count;
+	} else {
+		m_last = std::min(m_last, first - 1);
+	}
+}
+
+void MessageWindow::reset()
+{
+	m_first = 0;
+	m_last = -1;
+	m_pendingMessageIds.clear();
+}
+
+bool MessageWindow::isCloseToEdge(int row) const
+{
+	if (!m_size) {
+		return false;
+	}
+
+	const auto margin = m_size / 4;
+	const auto closeToFirst = row < m_first + margin && m_first > 0;
+	const auto closeToLast = row > m_last - margin && m_last < m_messages.size() - 1;
+
+	return closeToFirst || closeToLast;
+}
+
+QVector<QString> MessageWindow::moveTo(int row, const std::function<void(int first, int last)> &handleEvictedRows)
+{
+	const int count = m_messages.size();
+	const auto windowSize = m_size ? m_size : count;
+	const auto first = std::clamp(row - windowSize / 2, 0, std::max(0, count - windowSize));
+	const auto last = std::min(first + windowSize, count) - 1;
+
+	if (first == m_first && last == m_last) {
+		return {};
+	}
+
+	evict(m_first, std::min(m_last, first - 1), handleEvictedRows);
+	evict(std::max(m_first, last + 1), m_last, handleEvictedRows);
+
+	QVector<QString> messageIds;
+	for (int i = first; i <= last; i++) {
+		if (isStub(i)) {
+			messageIds.append(m_messages.at(i).id);
+		}
+	}
+
+	m_first = first;
+	m_last = last;
+
+	for (const auto &messageId : std::as_const(messageIds)) {
+		m_pendingMessageIds.insert(messageId);
+	}
+
+	return messageIds;
+}
+
+std::optional<std::pair<int, int>> MessageWindow::load(const QVector<Message> &messages, const std::function<void(Message &)> &processMessage)
+{
+	QHash<QString, int> messageIndexes;
+	messageIndexes.reserve(messages.size());
+	for (int i = 0; i < messages.size(); i++) {
+		messageIndexes.insert(messages.at(i).id, i);
+	}
+
+	int first = -1;
+	int last = -1;
+
+	for (int i = m_first; i <= m_last; i++) {
+		if (const auto itr = messageIndexes.constFind(m_messages.at(i).id); itr != messageIndexes.cend()) {
+			auto message = messages.at(*itr);
+			processMessage(message);
+			m_messages[i] = std::move(message);
+			m_pendingMessageIds.remove(m_messages.at(i).id);
+
+			if (first == -1) {
+				first = i;
+			}
+			last = i;
+		}
+	}
+
+	if (first == -1) {
+		return std::nullopt;
+	}
+
+	return std::pair { first, last };
+}
+
+void MessageWindow::evict(int first, int last, const std::function<void(int first, int last)> &handleEvictedRows)
+{
+	if (first > last) {
+		return;
+	}
+
+	createStubs(first, last);
+	handleEvictedRows(first, last);
+}
+
+void MessageWindow::createStubs(int first, int last)
+{
+	for (int i = first; i <= last; i++) {
+		// Messages without IDs cannot be fetched again.
+		if (auto &message = m_messages[i]; !message.id.isEmpty()) {
+			m_pendingMessageIds.remove(message.id);
+			message = createMessageStub(message);
+		}
+	}
+}
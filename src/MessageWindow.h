@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <utility>
+
+#include <QSet>
+#include <QVector>
+
+#include "Message.h"
+
+/**
+ * Window of completely loaded messages within a message list.
+ *
+ * The messages outside of the window are stubs only containing the data needed for their positions
+ * and read markers.
+ * Messages without IDs are never reduced to stubs because they cannot be fetched again.
+ */
+class MessageWindow
+{
+public:
+	explicit MessageWindow(QVector<Message> &messages);
+
+	/**
+	 * Returns the maximum number of completely loaded messages or 0 if all messages are kept.
+	 */
+	int size() const;
+
+	/**
+	 * Sets the maximum number of completely loaded messages.
+	 *
+	 * The window is not moved until moveTo() is called.
+	 *
+	 * @param size maximum number of messages or 0 for keeping all messages
+	 */
+	void setSize(int size);
+
+	int first() const;
+	int last() const;
+
+	/**
+	 * Returns whether a row is within the window.
+	 */
+	bool contains(int row) const;
+
+	/**
+	 * Returns whether the message of a row is a stub that must be fetched again to be used.
+	 */
+	bool isStub(int row) const;
+
+	/**
+	 * Returns whether the message of a row is completely loaded.
+	 *
+	 * In contrast to isStub(), stubs within the window whose messages are still being fetched are
+	 * not loaded.
+	 */
+	bool isLoaded(int row) const;
+
+	/**
+	 * Must be called after rows are inserted into the list.
+	 *
+	 * Messages inserted within the window or directly after it extend the window.
+	 * Other inserted messages are reduced to stubs.
+	 *
+	 * @return whether the window exceeds its size and should be moved
+	 */
+	bool insertRows(int first, int last);
+
+	/**
+	 * Must be called after stubs are inserted into the list, e.g., for positioning a message that
+	 * is not loaded yet.
+	 *
+	 * In contrast to insertRows(), the window is not extended by stubs inserted directly after
+	 * it.
+	 * Stubs must not be inserted within the window.
+	 */
+	void insertStubRows(int first, int last);
+
+	/**
+	 * Must be called after rows are removed from the list.
+	 */
+	void removeRows(int first, int last);
+
+	/**
+	 * Empties the window, e.g., after all messages have been removed.
+	 */
+	void reset();
+
+	/**
+	 * Returns whether a row is so close to an edge of the window that the window should be moved
+	 * before that edge is reached.
+	 */
+	bool isCloseToEdge(int row) const;
+
+	/**
+	 * Moves the window to a row so that the row is in its center if possible.
+	 *
+	 * The messages leaving the window are reduced to stubs.
+	 * The stubs entering the window are not loaded until they are passed to load().
+	 *
+	 * @param row row to move the window to
+	 * @param handleEvictedRows called for each range of rows whose messages are reduced to stubs
+	 *
+	 * @return the IDs of the stubs entering the window that must be fetched
+	 */
+	QVector<QString> moveTo(int row, const std::function<void(int first, int last)> &handleEvictedRows);
+
+	/**
+	 * Replaces the stubs within the window by fetched messages.
+	 *
+	 * The window may have moved or rows may have been inserted or removed since the messages were
+	 * requested.
+	 * Thus, only the messages that are still within the window are loaded.
+	 *
+	 * @param messages fetched messages
+	 * @param processMessage called for each message before it is loaded
+	 *
+	 * @return the first and the last row of the loaded messages or nothing if no message has been
+	 *         loaded
+	 */
+	std::optional<std::pair<int, int>> load(const QVector<Message> &messages, const std::function<void(Message &)> &processMessage);
+
+private:
+	void evict(int first, int last, const std::function<void(int first, int last)> &handleEvictedRows);
+	void createStubs(int first, int last);
+
+	QVector<Message> &m_messages;
+	int m_size = 0;
+	int m_first = 0;
+	int m_last = -1;
+	// IDs of the stubs within the window whose messages are being fetched
+	QSet<QString> m_pendingMessageIds;
+};
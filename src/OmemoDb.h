@@ -45,7 +45,7 @@ private:
 	template<typename Functor>
 	auto runTask(Functor function) const
 	{
-		return runAsyncTask(m_xmppContext, dbWorker(), function);
+		return runAsyncTask(m_xmppContext, dbWorker(), finishingCachedQueries(std::move(function)));
 	}
 
 	auto _ownDevice() -> std::optional<OwnDevice>;
@@ -19,8 +19,10 @@
 #include "qxmpp-exts/QXmppUri.h"
 // Kaidan
 #include "MessageModel.h"
+#include "SqlUtils.h"
 
 static QmlUtils *s_instance;
+static bool databaseStatisticsAvailable = false;
 
 QmlUtils *QmlUtils::instance()
 {
@@ -304,3 +306,37 @@ QString QmlUtils::osmUserAgent()
 {
 	return u"" APPLICATION_NAME % QChar(u'/') % u"" VERSION_STRING;
 }
+
+void QmlUtils::setDatabaseStatisticsAvailable(bool available)
+{
+	databaseStatisticsAvailable = available;
+}
+
+bool QmlUtils::isDatabaseStatisticsAvailable()
+{
+#ifdef NDEBUG
+	return databaseStatisticsAvailable;
+#else
+	return true;
+#endif
+}
+
+void QmlUtils::setDatabaseInstrumentationEnabled(bool enabled)
+{
+	SqlUtils::setInstrumentationEnabled(enabled);
+}
+
+bool QmlUtils::isDatabaseInstrumentationEnabled()
+{
+	return SqlUtils::isInstrumentationEnabled();
+}
+
+QString QmlUtils::databaseStatisticsReport()
+{
+	return SqlUtils::statisticsReport();
+}
+
+void QmlUtils::resetDatabaseStatistics()
+{
+	SqlUtils::resetStatistics();
+}
@@ -188,6 +188,27 @@ public:
 
 	Q_INVOKABLE static QString osmUserAgent();
 
+	/**
+	 * Makes the statistics about database queries available to the user interface in release
+	 * builds.
+	 *
+	 * They are always available in debug builds.
+	 */
+	static void setDatabaseStatisticsAvailable(bool available);
+	Q_INVOKABLE static bool isDatabaseStatisticsAvailable();
+
+	/**
+	 * Enables or disables the collection of statistics about database queries.
+	 */
+	Q_INVOKABLE static void setDatabaseInstrumentationEnabled(bool enabled);
+	Q_INVOKABLE static bool isDatabaseInstrumentationEnabled();
+
+	/**
+	 * Returns the collected statistics about database queries as human-readable text.
+	 */
+	Q_INVOKABLE static QString databaseStatisticsReport();
+	Q_INVOKABLE static void resetDatabaseStatistics();
+
 private:
 	/**
 	 * Highlights links in a list of words.
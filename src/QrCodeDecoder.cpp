@@ -21,6 +21,27 @@
 
 using namespace ZXing;
 
+// Minimum width and height of images that are decoded at half their resolution first
+constexpr int DOWNSCALING_MIN_SIZE = 480;
+
+// Number of images after which a whole image is decoded at full resolution if no QR code was
+// detected in the downscaled images
+constexpr int FULL_RESOLUTION_INTERVAL = 4;
+
+static ImageView imageView(const QImage &image)
+{
+	return { image.bits(), image.width(), image.height(), ZXing::ImageFormat::Lum, int(image.bytesPerLine()) };
+}
+
+static QString resultText(const Result &result)
+{
+#if ZXING_VERSION < QT_VERSION_CHECK(2, 0, 0)
+	return QString::fromStdString(TextUtfEncoding::ToUtf8(result.text()));
+#else
+	return QString::fromStdString(result.text());
+#endif
+}
+
 QrCodeDecoder::QrCodeDecoder(QObject *parent)
 	: QObject(parent)
 {
@@ -30,7 +51,70 @@ void QrCodeDecoder::decodeImage(const QImage &image)
 {
 	// Advise the decoder to check for QR codes and to try decoding rotated versions of the image.
 	const auto decodeHints = DecodeHints().setFormats(BarcodeFormat::QRCode);
-	const auto result = ReadBarcode({image.bits(), image.width(), image.height(), ZXing::ImageFormat::Lum, image.bytesPerLine()}, decodeHints);
+	const auto fullResolutionImage = imageView(image);
+
+	QString text;
+	const auto decode = [&](const ImageView &view) {
+		const auto result = ReadBarcode(view, decodeHints);
+		if (result.isValid()) {
+			text = resultText(result);
+			return true;
+		}
+		return false;
+	};
+
+	bool decoded = false;
+
+	if (std::min(image.width(), image.height()) < DOWNSCALING_MIN_SIZE) {
+		decoded = decode(fullResolutionImage);
+	} else {
+		downscale(image);
+		bool candidateDetected = false;
+
+#if ZXING_VERSION >= QT_VERSION_CHECK(2, 0, 0)
+		// Results that could not be decoded are returned as well in order to use their positions
+		// as candidate regions.
+		auto candidateHints = decodeHints;
+		candidateHints.setReturnErrors(true);
+		const auto results = ReadBarcodes(imageView(m_downscaledImage), candidateHints);
+
+		for (const auto &result : results) {
+			if (result.isValid()) {
+				text = resultText(result);
+				decoded = true;
+				break;
+			}
+		}
+
+		for (auto it = results.cbegin(); !decoded && it != results.cend(); ++it) {
+			QRect region;
+			for (const auto &point : it->position()) {
+				region |= QRect(point.x * 2, point.y * 2, 2, 2);
+			}
+
+			// The region is enlarged because the detected position may be inaccurate at the lower
+			// resolution.
+			const auto margin = std::max(region.width(), region.height()) / 4;
+			region = region.marginsAdded({ margin, margin, margin, margin }).intersected(image.rect());
+
+			if (!region.isEmpty()) {
+				candidateDetected = true;
+				decoded = decode(fullResolutionImage.cropped(region.x(), region.y(), region.width(), region.height()));
+			}
+		}
+#else
+		decoded = decode(imageView(m_downscaledImage));
+#endif
+
+		// Small QR codes may not be detected at all at half the resolution.
+		// Thus, the whole image is decoded at full resolution from time to time.
+		if (decoded || candidateDetected) {
+			m_imagesSinceFullResolutionDecoding = 0;
+		} else if (++m_imagesSinceFullResolutionDecoding >= FULL_RESOLUTION_INTERVAL) {
+			m_imagesSinceFullResolutionDecoding = 0;
+			decoded = decode(fullResolutionImage);
+		}
+	}
 
 	// FIXME: `this` is not supposed to become nullptr in well-defined C++ code,
 	//        so if we are unlucky, the compiler may optimize the entire check away.
@@ -43,12 +127,28 @@ void QrCodeDecoder::decodeImage(const QImage &image)
 
 	// If a QR code could be found and decoded, emit a signal with the decoded string.
 	// Otherwise, emit a signal for failed decoding.
-	if (result.isValid())
-#if ZXING_VERSION < QT_VERSION_CHECK(2, 0, 0)
-		Q_EMIT decodingSucceeded(QString::fromStdString(TextUtfEncoding::ToUtf8(result.text())));
-#else
-		Q_EMIT decodingSucceeded(QString::fromStdString(result.text()));
-#endif
+	if (decoded)
+		Q_EMIT decodingSucceeded(text);
 	else
 		Q_EMIT decodingFailed();
 }
+
+void QrCodeDecoder::downscale(const QImage &image)
+{
+	const QSize size(image.width() / 2, image.height() / 2);
+
+	// The buffer is only allocated again if the size of the video frames changes.
+	if (m_downscaledImage.size() != size) {
+		m_downscaledImage = QImage(size, QImage::Format_Grayscale8);
+	}
+
+	for (int y = 0; y < size.height(); ++y) {
+		const uchar *upperRow = image.constScanLine(2 * y);
+		const uchar *lowerRow = image.constScanLine(2 * y + 1);
+		uchar *targetRow = m_downscaledImage.scanLine(y);
+
+		for (int x = 0; x < size.width(); ++x) {
+			targetRow[x] = uchar((upperRow[2 * x] + upperRow[2 * x + 1] + lowerRow[2 * x] + lowerRow[2 * x + 1] + 2) >> 2);
+		}
+	}
+}
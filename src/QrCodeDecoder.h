@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <QImage>
 #include <QObject>
 
 /**
@@ -42,8 +43,24 @@ public slots:
 	 * finished @c decodingFinished() will be emitted. In case a QR code was found,
 	 * also @c tagFound() will be emitted.
 	 *
+	 * Large images are decoded at half their resolution first.
+	 * The full resolution is only used around regions where a QR code was detected but could not
+	 * be decoded, and for the whole image only every few images.
+	 *
+	 * This must not be called concurrently since buffers are reused between calls.
+	 *
 	 * @param image image which may contain a QR code to decode to a string.
 	 *        It needs to be in grayscale format (one byte per pixel).
 	 */
 	void decodeImage(const QImage &image);
+
+private:
+	/**
+	 * Downscales an image to half its width and height by averaging blocks of 2x2 pixels into
+	 * m_downscaledImage.
+	 */
+	void downscale(const QImage &image);
+
+	QImage m_downscaledImage;
+	int m_imagesSinceFullResolutionDecoding = 0;
 };
@@ -12,9 +12,14 @@
 #include <QCameraViewfinderSettings>
 #include <QtConcurrent/QtConcurrent>
 
+// Frame rate that is enough for a QR code to be scanned quickly without keeping low-end devices
+// busy with decoding
+constexpr int DEFAULT_TARGET_FRAME_RATE = 10;
+
 QrCodeScannerFilter::QrCodeScannerFilter(QObject *parent)
 	: QAbstractVideoFilter(parent),
-	  m_decoder(new QrCodeDecoder(this))
+	  m_decoder(new QrCodeDecoder(this)),
+	  m_targetFrameRate(DEFAULT_TARGET_FRAME_RATE)
 {
 	connect(m_decoder, &QrCodeDecoder::decodingFailed,
 			this, &QrCodeScannerFilter::scanningFailed);
@@ -24,10 +29,16 @@ QrCodeScannerFilter::QrCodeScannerFilter(QObject *parent)
 
 QrCodeScannerFilter::~QrCodeScannerFilter()
 {
-	if (!m_processThread.isFinished()) {
-		m_processThread.cancel();
-		m_processThread.waitForFinished();
+	QFuture<void> processThread;
+
+	{
+		QMutexLocker locker(&m_frameMutex);
+		m_stopped = true;
+		processThread = m_processThread;
 	}
+
+	// The frame being decoded is finished but no further frame is decoded.
+	processThread.waitForFinished();
 }
 
 QrCodeDecoder *QrCodeScannerFilter::decoder()
@@ -57,71 +68,114 @@ void QrCodeScannerFilter::setCameraDefaultVideoFormat(QObject *qmlCamera)
 	}
 }
 
-QrCodeScannerFilterRunnable::QrCodeScannerFilterRunnable(QrCodeScannerFilter *filter)
-	: QObject(nullptr),
-	m_filter(filter)
+int QrCodeScannerFilter::targetFrameRate() const
 {
+	return m_targetFrameRate;
 }
 
-QVideoFrame QrCodeScannerFilterRunnable::run(
-		QVideoFrame *input,
-		const QVideoSurfaceFormat &,
-		RunFlags
-) {
-	// Only one frame is processed at a time.
-	if (input == nullptr
-			|| !input->isValid()
-			|| !m_filter->m_processThread.isFinished()) {
-		return *input;
+void QrCodeScannerFilter::setTargetFrameRate(int targetFrameRate)
+{
+	targetFrameRate = std::max(0, targetFrameRate);
+
+	if (m_targetFrameRate.exchange(targetFrameRate) != targetFrameRate) {
+		Q_EMIT targetFrameRateChanged();
 	}
+}
 
-	// Copy the data to be filtered.
-	m_filter->m_frame.setData(*input);
+void QrCodeScannerFilter::enqueueFrame(QVideoFrame &frame)
+{
+	QMutexLocker locker(&m_frameMutex);
 
-	// Run a separate thread for processing the data.
-	m_filter->m_processThread = QtConcurrent::run(
-			this,
-			&QrCodeScannerFilterRunnable::processVideoFrameProbed,
-			m_filter->m_frame,
-			m_filter
-	);
+	if (m_stopped) {
+		return;
+	}
 
-	// Create a mirrored video frame on devices without a rear camera.
-	// That way, the QR code can be easily placed in front of the webcam of a desktop device.
-	// TODO: Check if "videoSurfaceFormat.setMirrored(true);" can be used instead of creating a new image and mirroring it
-	return m_filter->m_videoFrameMirrored ? QVideoFrame(input->image().mirrored(true, false)) : *input;
+	// The buffer of the pending frame is reused since it is not shared with the decoding thread.
+	m_pendingFrame.setData(frame);
+	m_framePending = true;
+
+	if (!m_processing) {
+		m_processing = true;
+		m_processThread = QtConcurrent::run([this]() {
+			processFrames();
+		});
+	}
 }
 
-void QrCodeScannerFilterRunnable::processVideoFrameProbed(
-		QrCodeVideoFrame videoFrame,
-		QrCodeScannerFilter *filter
-) {
+void QrCodeScannerFilter::processFrames()
+{
+	forever {
+		{
+			QMutexLocker locker(&m_frameMutex);
+
+			if (!m_framePending || m_stopped) {
+				m_processing = false;
+				return;
+			}
+
+			// The frames are swapped so that the camera can fill the other buffer meanwhile.
+			std::swap(m_pendingFrame, m_processedFrame);
+			m_framePending = false;
+		}
+
+		processFrame(m_processedFrame);
+	}
+}
+
+void QrCodeScannerFilter::processFrame(const QrCodeVideoFrame &videoFrame)
+{
 	// Return if the frame is empty.
 	if (videoFrame.data().isEmpty())
 		return;
 
 	// Create an image from the frame.
-	const QImage *image = videoFrame.toGrayscaleImage();
+	videoFrame.toGrayscaleImage(m_grayscaleImage);
 
 	// Return if conversion from the frame to the image failed.
-	if (image->isNull()) {
+	if (m_grayscaleImage.isNull()) {
 		// dirty hack: write QVideoFrame::PixelFormat as string to format using QDebug
 		//             QMetaEnum::valueToKey() did not work
 		QString format;
 		QDebug(&format).nospace() << videoFrame.pixelFormat();
 
-		qDebug() << "QrCodeScannerFilterRunnable error: Cannot create image file to process.";
+		qDebug() << "QrCodeScannerFilter error: Cannot create image file to process.";
 		qDebug() << "Maybe it was a format conversion problem.";
 		qDebug() << "VideoFrame format:" << format;
 		qDebug() << "Image corresponding format:"
 		         << QVideoFrame::imageFormatFromPixelFormat(videoFrame.pixelFormat());
 
-		Q_EMIT filter->unsupportedFormatReceived(format);
+		Q_EMIT unsupportedFormatReceived(format);
 		return;
 	}
 
 	// Decode the image.
-	m_filter->decoder()->decodeImage(*image);
+	m_decoder->decodeImage(m_grayscaleImage);
+}
+
+QrCodeScannerFilterRunnable::QrCodeScannerFilterRunnable(QrCodeScannerFilter *filter)
+	: QObject(nullptr),
+	m_filter(filter)
+{
+}
+
+QVideoFrame QrCodeScannerFilterRunnable::run(
+		QVideoFrame *input,
+		const QVideoSurfaceFormat &,
+		RunFlags
+) {
+	if (input == nullptr || !input->isValid()) {
+		return *input;
+	}
 
-	delete image;
+	// Skip frames exceeding the target frame rate.
+	const auto targetFrameRate = m_filter->targetFrameRate();
+	if (targetFrameRate == 0 || !m_frameTimer.isValid() || m_frameTimer.elapsed() >= 1000 / targetFrameRate) {
+		m_frameTimer.start();
+		m_filter->enqueueFrame(*input);
+	}
+
+	// Create a mirrored video frame on devices without a rear camera.
+	// That way, the QR code can be easily placed in front of the webcam of a desktop device.
+	// TODO: Check if "videoSurfaceFormat.setMirrored(true);" can be used instead of creating a new image and mirroring it
+	return m_filter->m_videoFrameMirrored ? QVideoFrame(input->image().mirrored(true, false)) : *input;
 }
@@ -6,15 +6,23 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <QObject>
 #include <QAbstractVideoFilter>
+#include <QElapsedTimer>
 #include <QFuture>
+#include <QImage>
+#include <QMutex>
 
 #include "QrCodeDecoder.h"
 #include "QrCodeVideoFrame.h"
 
 /**
  * video filter to be registered in C++, instantiated and attached in QML
+ *
+ * The frames are decoded one after another on a separate thread.
+ * While a frame is decoded, only the latest frame is kept for being decoded next.
  */
 class QrCodeScannerFilter : public QAbstractVideoFilter
 {
@@ -22,6 +30,8 @@ class QrCodeScannerFilter : public QAbstractVideoFilter
 
 	Q_OBJECT
 
+	Q_PROPERTY(int targetFrameRate READ targetFrameRate WRITE setTargetFrameRate NOTIFY targetFrameRateChanged)
+
 public:
 	/**
 	 * Instantiates a QR code scanner filter.
@@ -44,7 +54,17 @@ public:
 	 */
 	Q_INVOKABLE void setCameraDefaultVideoFormat(QObject *qmlCamera);
 
+	/**
+	 * Returns the maximum number of frames per second that are decoded.
+	 *
+	 * 0 means that all frames are decoded as long as the decoding keeps up with the camera.
+	 */
+	int targetFrameRate() const;
+	void setTargetFrameRate(int targetFrameRate);
+
 signals:
+	void targetFrameRateChanged();
+
 	/**
 	 * Emitted when the scanning of an image did not succeed, i.e. no valid QR code was found.
 	 */
@@ -65,14 +85,41 @@ signals:
 	void unsupportedFormatReceived(const QString& format);
 
 private:
-	bool m_videoFrameMirrored = false;
-	QrCodeDecoder *m_decoder;
+	/**
+	 * Copies a frame into the buffer of the frame to be decoded next and starts the decoding
+	 * thread if it is not running.
+	 *
+	 * A frame that is in the buffer and not yet being decoded is replaced.
+	 */
+	void enqueueFrame(QVideoFrame &frame);
+
+	/**
+	 * Decodes the buffered frames until the buffer is empty.
+	 */
+	void processFrames();
 
 	/**
-	 * frame of the video which may contain a QR code
+	 * Converts a given frame, which may contain a QR code, to an image and then tries to decode it.
+	 *
+	 * @param videoFrame frame to be converted and which may contain a QR code to be decoded
 	 */
-	QrCodeVideoFrame m_frame;
+	void processFrame(const QrCodeVideoFrame &videoFrame);
+
+	bool m_videoFrameMirrored = false;
+	QrCodeDecoder *m_decoder;
+	std::atomic<int> m_targetFrameRate;
+
+	QMutex m_frameMutex;
+	// frame of the video which may contain a QR code and is decoded next
+	QrCodeVideoFrame m_pendingFrame;
+	bool m_framePending = false;
+	bool m_processing = false;
+	bool m_stopped = false;
 	QFuture<void> m_processThread;
+
+	// buffers that are only used by the decoding thread and reused for each frame
+	QrCodeVideoFrame m_processedFrame;
+	QImage m_grayscaleImage;
 };
 
 /**
@@ -86,18 +133,11 @@ public:
 	explicit QrCodeScannerFilterRunnable(QrCodeScannerFilter *m_filter);
 
 	/**
-	 * Runs the decoding in a new thread whenever a new frame is taken by the camera.
+	 * Passes new frames taken by the camera to the decoding thread at the target frame rate.
 	 */
 	QVideoFrame run(QVideoFrame *input, const QVideoSurfaceFormat &surfaceFormat, RunFlags flags) override;
 
-	/**
-	 * Converts a given frame, which may contain a QR code, to an image and then tries to decode it.
-	 *
-	 * @param videoFrame frame to be converted and which may contain a QR code to be decoded
-	 * @param filter filter of the current execution
-	 */
-	void processVideoFrameProbed(QrCodeVideoFrame videoFrame, QrCodeScannerFilter *filter);
-
 private:
 	QrCodeScannerFilter *m_filter;
+	QElapsedTimer m_frameTimer;
 };
@@ -23,7 +23,7 @@
 
 #include "QrCodeVideoFrame.h"
 #include <QImage>
-#include <cmath>
+#include "GrayscaleConversion.h"
 
 /**
  * rectangle of the video frame which may contain a QR code
@@ -56,40 +56,21 @@ struct CaptureRect
 	int endY;
 };
 
-uchar gray(uchar r, uchar g, uchar b)
-{
-	return (306 * (r & 0xFF) +
-			601 * (g & 0xFF) +
-			117 * (b & 0xFF) +
-			0x200) >> 10;
-}
-uchar yuvToGray(uchar Y, uchar U, uchar V)
-{
-	const int C = int(Y) - 16;
-	const int D = int(U) - 128;
-	const int E = int(V) - 128;
-	return gray(
-		qBound<uchar>(0, uchar((298 * C + 409 * E + 128) >> 8), 255),
-		qBound<uchar>(0, uchar((298 * C - 100 * D - 208 * E + 128) >> 8), 255),
-		qBound<uchar>(0, uchar((298 * C + 516 * D + 128) >> 8), 255)
-	);
-}
-
-uchar yuvToGray2(uchar y, uchar u, uchar v)
+/**
+ * Prepares an image for the grayscale conversion.
+ *
+ * The image's buffer is reused if it has the right size and format.
+ */
+static void prepareGrayscaleImage(QImage &image, const CaptureRect &captureRect)
 {
-	double rD = y + 1.4075 * (v - 128);
-	double gD = y - 0.3455 * (u - 128) - (0.7169 * (v - 128));
-	double bD = y + 1.7790 * (u - 128);
-
-	return gray(
-		qBound<uchar>(0, uchar(floor(rD)), 255),
-		qBound<uchar>(0, uchar(floor(gD)), 255),
-		qBound<uchar>(0, uchar(floor(bD)), 255)
-	);
+	if (image.width() != captureRect.targetWidth || image.height() != captureRect.targetHeight || image.format() != QImage::Format_Grayscale8) {
+		image = QImage(captureRect.targetWidth, captureRect.targetHeight, QImage::Format_Grayscale8);
+	}
 }
 
-static QImage* rgbDataToGrayscale(
-		const uchar* data,
+static void rgbDataToGrayscale(
+		QImage &image,
+		const uchar *data,
 		const CaptureRect &captureRect,
 		const int alpha,
 		const int red,
@@ -98,40 +79,53 @@ static QImage* rgbDataToGrayscale(
 		const bool isPremultiplied = false
 ) {
 	const int stride = (alpha < 0) ? 3 : 4;
+	const int sourceBytesPerLine = captureRect.sourceWidth * stride;
+	const GrayscaleConversion::ChannelOffsets offsets = { red, green, blue };
 
-	const int endX = captureRect.sourceWidth - captureRect.startX - captureRect.targetWidth;
-	const int skipX = (endX + captureRect.startX) * stride;
+	prepareGrayscaleImage(image, captureRect);
+	data += captureRect.startY * sourceBytesPerLine + captureRect.startX * stride;
 
-	QImage *image_ptr = new QImage(captureRect.targetWidth, captureRect.targetHeight, QImage::Format_Grayscale8);
-	uchar* pixelInit = image_ptr->bits();
-	data += (captureRect.startY * captureRect.sourceWidth + captureRect.startX) * stride;
-
-	for (int y = 1; y <= captureRect.targetHeight; ++y) {
+	for (int y = 1; y <= captureRect.targetHeight; ++y, data += sourceBytesPerLine) {
 		// Quick fix for iOS devices. Will be handled better in the future
 #ifdef Q_OS_IOS
-		uchar* pixel = pixelInit + (y - 1) * captureRect.targetWidth;
+		uchar *row = image.scanLine(y - 1);
 #else
-		uchar* pixel = pixelInit + (captureRect.targetHeight - y) * captureRect.targetWidth;
+		uchar *row = image.scanLine(captureRect.targetHeight - y);
 #endif
 
-		for (int x = 0; x < captureRect.targetWidth; ++x) {
-			uchar r = data[red];
-			uchar g = data[green];
-			uchar b = data[blue];
-			if (isPremultiplied) {
-				uchar a = data[alpha];
-				r = uchar((uint(r) * 255) / a);
-				g = uchar((uint(g) * 255) / a);
-				b = uchar((uint(b) * 255) / a);
-			}
-			*pixel = gray(r, g, b);
-			++pixel;
-			data += stride;
+		if (isPremultiplied) {
+			GrayscaleConversion::premultipliedRgb32ToGray(data, row, captureRect.targetWidth, offsets, alpha);
+		} else if (stride == 3) {
+			GrayscaleConversion::rgb24ToGray(data, row, captureRect.targetWidth, offsets);
+		} else {
+			GrayscaleConversion::rgb32ToGray(data, row, captureRect.targetWidth, offsets);
 		}
-		data += skipX;
 	}
+}
+
+/**
+ * Copies the luma plane at the beginning of planar and semi-planar YUV frames.
+ */
+static void lumaPlaneToGrayscale(QImage &image, const uchar *data, const CaptureRect &captureRect)
+{
+	prepareGrayscaleImage(image, captureRect);
+	data += captureRect.startY * captureRect.sourceWidth + captureRect.startX;
 
-	return image_ptr;
+	for (int y = 0; y < captureRect.targetHeight; ++y, data += captureRect.sourceWidth) {
+		memcpy(image.scanLine(y), data, captureRect.targetWidth);
+	}
+}
+
+static void yuyvDataToGrayscale(QImage &image, const uchar *data, const CaptureRect &captureRect)
+{
+	const int sourceBytesPerLine = captureRect.sourceWidth * 2;
+
+	prepareGrayscaleImage(image, captureRect);
+	data += captureRect.startY * sourceBytesPerLine + captureRect.startX * 2;
+
+	for (int y = 0; y < captureRect.targetHeight; ++y, data += sourceBytesPerLine) {
+		GrayscaleConversion::yuyvToGray(data, image.scanLine(y), captureRect.targetWidth);
+	}
 }
 
 void QrCodeVideoFrame::setData(QVideoFrame &frame)
@@ -151,114 +145,67 @@ void QrCodeVideoFrame::setData(QVideoFrame &frame)
 	frame.unmap();
 }
 
-QImage *QrCodeVideoFrame::toGrayscaleImage()
+void QrCodeVideoFrame::toGrayscaleImage(QImage &image) const
 {
 	const CaptureRect captureRect(QRect(), m_size.width(), m_size.height());
 	const auto* data = reinterpret_cast<const uchar *>(m_data.constData());
-	const auto *yuvPtr = reinterpret_cast<const uint32_t *>(data);
-	uchar *pixel;
-	int wh;
-	int w_2;
-	int wh_54;
-
-	QImage *image;
 	switch (m_pixelFormat) {
 	case QVideoFrame::Format_ARGB32:
-		image = rgbDataToGrayscale(data, captureRect, 0, 1, 2, 3);
+		rgbDataToGrayscale(image, data, captureRect, 0, 1, 2, 3);
 		break;
 	case QVideoFrame::Format_ARGB32_Premultiplied:
-		image = rgbDataToGrayscale(data, captureRect, 0, 1, 2, 3, true);
+		rgbDataToGrayscale(image, data, captureRect, 0, 1, 2, 3, true);
 		break;
 	case QVideoFrame::Format_RGB32:
-		image = rgbDataToGrayscale(data, captureRect, 0, 1, 2, 3);
+		rgbDataToGrayscale(image, data, captureRect, 0, 1, 2, 3);
 		break;
 	case QVideoFrame::Format_RGB24:
-		image = rgbDataToGrayscale(data, captureRect, -1, 0, 1, 2);
+		rgbDataToGrayscale(image, data, captureRect, -1, 0, 1, 2);
 		break;
 	// TODO: QVideoFrame::Format_RGB565
 	// TODO: QVideoFrame::Format_RGB555
 	// TODO: QVideoFrame::Format_ARGB8565_Premultiplied
 	case QVideoFrame::Format_BGRA32:
-		image = rgbDataToGrayscale(data, captureRect, 3, 2, 1, 0);
+		rgbDataToGrayscale(image, data, captureRect, 3, 2, 1, 0);
 		break;
 	case QVideoFrame::Format_BGRA32_Premultiplied:
-		image = rgbDataToGrayscale(data, captureRect, 3, 2, 1, 0, true);
+		rgbDataToGrayscale(image, data, captureRect, 3, 2, 1, 0, true);
 		break;
 	case QVideoFrame::Format_ABGR32:
-		image = rgbDataToGrayscale(data, captureRect, 0, 3, 2, 1);
+		rgbDataToGrayscale(image, data, captureRect, 0, 3, 2, 1);
 		break;
 	case QVideoFrame::Format_BGR32:
-		image = rgbDataToGrayscale(data, captureRect, 3, 2, 1, 0);
+		rgbDataToGrayscale(image, data, captureRect, 3, 2, 1, 0);
 		break;
 	case QVideoFrame::Format_BGR24:
-		image = rgbDataToGrayscale(data, captureRect, -1, 2, 1, 0);
+		rgbDataToGrayscale(image, data, captureRect, -1, 2, 1, 0);
 		break;
 	case QVideoFrame::Format_BGR565:
 		/// This is a forced "conversion", colors end up swapped.
-		image = new QImage(data, m_size.width(), m_size.height(), QImage::Format_RGB16);
+		image = QImage(data, m_size.width(), m_size.height(), QImage::Format_RGB16);
 		break;
 	case QVideoFrame::Format_BGR555:
 		/// This is a forced "conversion", colors end up swapped.
-		image = new QImage(data, m_size.width(), m_size.height(), QImage::Format_RGB555);
+		image = QImage(data, m_size.width(), m_size.height(), QImage::Format_RGB555);
 		break;
 	// TODO: QVideoFrame::Format_BGRA5658_Premultiplied
 	case QVideoFrame::Format_YUV420P:
+	case QVideoFrame::Format_YV12:
 	case QVideoFrame::Format_NV12:
-		/// nv12 format, encountered on macOS
-		image = new QImage(captureRect.targetWidth, captureRect.targetHeight, QImage::Format_Grayscale8);
-		pixel = image->bits();
-		wh = m_size.width() * m_size.height();
-		w_2 = m_size.width() / 2;
-		wh_54 = wh * 5 / 4;
-
-		for (int y = captureRect.startY; y < captureRect.endY; y++) {
-			const int Y_offset = y * m_size.width();
-			const int y_2 = y / 2;
-			const int U_offset = y_2 * w_2 + wh;
-			const int V_offset = y_2 * w_2 + wh_54;
-			for (int x = captureRect.startX; x < captureRect.endX; x++) {
-				const int x_2 = x / 2;
-				const uchar Y = data[Y_offset + x];
-				const uchar U = data[U_offset + x_2];
-				const uchar V = data[V_offset + x_2];
-				*pixel = yuvToGray(Y, U, V);
-				++pixel;
-			}
-		}
-		break;
 	case QVideoFrame::Format_NV21:
-		/// nv21 format, default on android
-		/// image starts with a complete Y image, which we can use directly
-		image = new QImage(data, captureRect.targetWidth, captureRect.targetHeight, QImage::Format_Grayscale8);
+		/// The frame starts with a complete Y plane (NV12 is encountered on macOS and NV21 is the
+		/// default on Android), which is used directly as the grayscale image.
+		lumaPlaneToGrayscale(image, data, captureRect);
 		break;
 	case QVideoFrame::Format_YUYV:
-		image = new QImage(captureRect.targetWidth, captureRect.targetHeight, QImage::Format_Grayscale8);
-		pixel = image->bits();
-
-		for (int y = captureRect.startY; y < captureRect.endY; y++){
-			const uint32_t *row = &yuvPtr[y*(m_size.width()/2)];
-			int end = captureRect.startX/2 + (captureRect.endX - captureRect.startX)/2;
-			for (int x = captureRect.startX/2; x < end; x++){
-				const uint8_t *pxl = reinterpret_cast<const uint8_t *>(&row[x]);
-				const uint8_t y0 = pxl[0];
-				const uint8_t u  = pxl[1];
-				const uint8_t v  = pxl[3];
-				const uint8_t y1 = pxl[2];
-
-				*pixel = yuvToGray2(y0, u, v);
-				++pixel;
-				*pixel = yuvToGray2(y1, u, v);
-				++pixel;
-			}
-		}
-
+		yuyvDataToGrayscale(image, data, captureRect);
 		break;
 	// TODO: QVideoFrame::Format_IMC*
 	// TODO: QVideoFrame::Format_*YUV*
 	// TODO: QVideoFrame::Format_Y*
 	// TODO: QVideoFrame::Format_Jpeg (needed?)
 	default:
-		image = new QImage(
+		image = QImage(
 			data,
 			m_size.width(),
 			m_size.height(),
@@ -266,7 +213,6 @@ QImage *QrCodeVideoFrame::toGrayscaleImage()
 		);
 		break;
 	}
-	return image;
 }
 
 QByteArray QrCodeVideoFrame::data() const
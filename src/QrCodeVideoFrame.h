@@ -50,11 +50,12 @@ public:
 	void setData(QVideoFrame &frame);
 
 	/**
-	 * Converts a given image to a grayscale image.
+	 * Converts the frame to a grayscale image.
 	 *
-	 * @return grayscale image
+	 * @param image image to be filled, whose buffer is reused if it has the frame's size and the
+	 *        grayscale format
 	 */
-	QImage *toGrayscaleImage();
+	void toGrayscaleImage(QImage &image) const;
 
 	/**
 	 * @return content of the frame which may contain a QR code
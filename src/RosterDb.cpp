@@ -13,6 +13,7 @@
 #include "Message.h"
 #include "MessageDb.h"
 // Qt
+#include <QSet>
 #include <QSqlDriver>
 #include <QSqlField>
 #include <QSqlQuery>
@@ -123,36 +124,8 @@ QFuture<void> RosterDb::addItem(const RosterItem &item)
 QFuture<void> RosterDb::addItems(const QVector<RosterItem> &items)
 {
 	return run([this, items]() {
-		auto query = createQuery();
 		transaction();
-
-		prepareQuery(query, sqlDriver().sqlStatement(
-			QSqlDriver::InsertStatement,
-			DB_TABLE_ROSTER,
-			sqlRecord(DB_TABLE_ROSTER),
-			true
-		));
-
-		for (const auto &item : items) {
-			query.addBindValue(item.accountJid);
-			query.addBindValue(item.jid);
-			query.addBindValue(item.name);
-			query.addBindValue(item.subscription);
-			query.addBindValue(item.encryption);
-			query.addBindValue(item.unreadMessages);
-			query.addBindValue(QString()); // lastReadOwnMessageId
-			query.addBindValue(QString()); // lastReadContactMessageId
-			query.addBindValue(item.readMarkerPending);
-			query.addBindValue(item.pinningPosition);
-			query.addBindValue(item.chatStateSendingEnabled);
-			query.addBindValue(item.readMarkerSendingEnabled);
-			query.addBindValue(item.notificationsMuted);
-			query.addBindValue(static_cast<int>(item.automaticMediaDownloadsRule));
-			execQuery(query);
-
-			addGroups(item.accountJid, item.jid, item.groups);
-		}
-
+		insertItems(items);
 		commit();
 	});
 }
@@ -199,40 +172,115 @@ QFuture<void> RosterDb::updateItem(const QString &jid,
 	});
 }
 
-QFuture<void> RosterDb::replaceItems(const QHash<QString, RosterItem> &items)
+QFuture<void> RosterDb::replaceItems(const QString &accountJid, const QHash<QString, RosterItem> &items)
 {
-	return run([this, items]() {
-		// load current items
+	return run([this, accountJid, items]() {
+		// Only the data received from the server is compared.
+		// Local data such as the number of unread messages is kept.
+		struct StoredItem
+		{
+			QString name;
+			QXmppRosterIq::Item::SubscriptionType subscription;
+			QVector<QString> groups;
+		};
+
+		enum { Jid, Name, Subscription };
+		enum { ChatJid, GroupName };
+
+		QHash<QString, StoredItem> storedItems;
 		auto query = createQuery();
-		execQuery(query, "SELECT * FROM roster");
 
-		QVector<RosterItem> currentItems;
-		parseItemsFromQuery(query, currentItems);
-		fetchGroups(currentItems);
+		execQuery(
+			query,
+			QStringLiteral(R"(
+				SELECT jid, name, subscription
+				FROM roster
+				WHERE accountJid = :accountJid
+			)"),
+			{ { u":accountJid", accountJid } }
+		);
 
-		transaction();
+		while (query.next()) {
+			storedItems.insert(query.value(Jid).toString(), StoredItem {
+				query.value(Name).toString(),
+				query.value(Subscription).value<QXmppRosterIq::Item::SubscriptionType>(),
+				{},
+			});
+		}
+
+		execQuery(
+			query,
+			QStringLiteral(R"(
+				SELECT chatJid, name
+				FROM rosterGroups
+				WHERE accountJid = :accountJid
+			)"),
+			{ { u":accountJid", accountJid } }
+		);
+
+		while (query.next()) {
+			if (const auto itr = storedItems.find(query.value(ChatJid).toString()); itr != storedItems.end()) {
+				itr->groups.append(query.value(GroupName).toString());
+			}
+		}
+
+		QVector<RosterItem> addedItems;
+		QVector<std::pair<RosterItem, RosterItem>> changedItems;
+
+		for (const auto &item : items) {
+			const auto itr = storedItems.constFind(item.jid);
+
+			if (itr == storedItems.cend()) {
+				addedItems.append(item);
+				continue;
+			}
+
+			// The groups are compared regardless of their order like by RosterItem::hasSameGroups().
+			const auto groupsChanged = QSet<QString>(itr->groups.cbegin(), itr->groups.cend()) != QSet<QString>(item.groups.cbegin(), item.groups.cend());
+
+			if (itr->name != item.name || itr->subscription != item.subscription || groupsChanged) {
+				RosterItem storedItem;
+				storedItem.accountJid = accountJid;
+				storedItem.jid = item.jid;
+				storedItem.name = itr->name;
+				storedItem.subscription = itr->subscription;
+				storedItem.groups = itr->groups;
 
-		QList<QString> keys = items.keys();
-		QSet<QString> newJids = QSet<QString>(keys.begin(), keys.end());
-
-		for (const auto &oldItem : qAsConst(currentItems)) {
-			// We will remove the already existing JIDs, so we get a set of JIDs that
-			// are completely new.
-			//
-			// By calling remove(), we also find out whether the JID is already
-			// existing or not.
-			if (newJids.remove(oldItem.jid)) {
-				// item is also included in newJids -> update
-				replaceItem(oldItem, items[oldItem.jid]);
-			} else {
-				// item is not included in newJids -> delete
-				removeItems({}, oldItem.jid);
+				changedItems.append({ std::move(storedItem), item });
 			}
+
+			// The remaining stored items are not in the roster anymore.
+			storedItems.erase(itr);
 		}
 
-		// now add the completely new JIDs
-		for (const QString &jid : newJids) {
-			addItem(items[jid]);
+		if (storedItems.isEmpty() && addedItems.isEmpty() && changedItems.isEmpty()) {
+			return;
+		}
+
+		transaction();
+
+		deleteItems(accountJid, storedItems.keys());
+		insertItems(addedItems);
+
+		for (const auto &[storedItem, item] : std::as_const(changedItems)) {
+			if (storedItem.name != item.name || storedItem.subscription != item.subscription) {
+				execQuery(
+					query,
+					QStringLiteral(R"(
+						UPDATE roster
+						SET name = :name, subscription = :subscription
+						WHERE accountJid = :accountJid AND jid = :jid
+					)"),
+					{
+						{ u":name", item.name },
+						{ u":subscription", item.subscription },
+						{ u":accountJid", accountJid },
+						{ u":jid", item.jid },
+					}
+				);
+			}
+
+			updateGroups(storedItem, item);
 		}
 
 		commit();
@@ -290,6 +338,8 @@ QFuture<void> RosterDb::replaceItem(const RosterItem &oldItem, const RosterItem
 
 QFuture<QVector<RosterItem>> RosterDb::fetchItems()
 {
+	// The items are read on the database thread because they must include the items and messages
+	// whose storing has been requested before, e.g., right after logging in.
 	return run([this]() {
 		auto query = createQuery();
 		execQuery(query, "SELECT * FROM roster");
@@ -332,6 +382,69 @@ void RosterDb::updateItemByRecord(const QString &jid, const QSqlRecord &record)
 				);
 }
 
+void RosterDb::insertItems(const QVector<RosterItem> &items)
+{
+	if (items.isEmpty()) {
+		return;
+	}
+
+	auto query = createQuery();
+
+	prepareQuery(query, sqlDriver().sqlStatement(
+		QSqlDriver::InsertStatement,
+		DB_TABLE_ROSTER,
+		sqlRecord(DB_TABLE_ROSTER),
+		true
+	));
+
+	for (const auto &item : items) {
+		query.addBindValue(item.accountJid);
+		query.addBindValue(item.jid);
+		query.addBindValue(item.name);
+		query.addBindValue(item.subscription);
+		query.addBindValue(item.encryption);
+		query.addBindValue(item.unreadMessages);
+		query.addBindValue(QString()); // lastReadOwnMessageId
+		query.addBindValue(QString()); // lastReadContactMessageId
+		query.addBindValue(item.readMarkerPending);
+		query.addBindValue(item.pinningPosition);
+		query.addBindValue(item.chatStateSendingEnabled);
+		query.addBindValue(item.readMarkerSendingEnabled);
+		query.addBindValue(item.notificationsMuted);
+		query.addBindValue(static_cast<int>(item.automaticMediaDownloadsRule));
+		execQuery(query);
+
+		addGroups(item.accountJid, item.jid, item.groups);
+	}
+}
+
+void RosterDb::deleteItems(const QString &accountJid, const QList<QString> &jids)
+{
+	auto query = createQuery();
+
+	execQueryForIdChunks(
+		query,
+		QStringLiteral(R"(
+			DELETE FROM roster
+			WHERE accountJid = :accountJid AND jid IN (%1)
+		)").arg(idPlaceholderList()),
+		jids,
+		[]() {},
+		{ { u":accountJid", accountJid } }
+	);
+
+	execQueryForIdChunks(
+		query,
+		QStringLiteral(R"(
+			DELETE FROM rosterGroups
+			WHERE accountJid = :accountJid AND chatJid IN (%1)
+		)").arg(idPlaceholderList()),
+		jids,
+		[]() {},
+		{ { u":accountJid", accountJid } }
+	);
+}
+
 void RosterDb::fetchGroups(QVector<RosterItem> &items)
 {
 	enum { Group };
@@ -344,7 +457,6 @@ void RosterDb::fetchGroups(QVector<RosterItem> &items)
 				SELECT name
 				FROM rosterGroups
 				WHERE accountJid = :accountJid AND chatJid = :jid
-				LIMIT 1
 			)"),
 			{
 				{ u":accountJid", item.accountJid },
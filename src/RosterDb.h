@@ -34,7 +34,18 @@ public:
 	QFuture<void> addItems(const QVector<RosterItem> &items);
 	QFuture<void> updateItem(const QString &jid,
 	                const std::function<void (RosterItem &)> &updateItem);
-	QFuture<void> replaceItems(const QHash<QString, RosterItem> &items);
+
+	/**
+	 * Replaces the stored roster items of an account by the items received from the server.
+	 *
+	 * Only the differences to the stored items are written.
+	 * Data that is not part of the roster on the server (e.g., the number of unread messages) is
+	 * kept for the items that are still in the roster.
+	 *
+	 * @param accountJid JID of the account whose roster items are replaced
+	 * @param items roster items mapped to their JIDs
+	 */
+	QFuture<void> replaceItems(const QString &accountJid, const QHash<QString, RosterItem> &items);
 
 	/**
 	 * Removes all roster items of an account or a specific roster item.
@@ -50,6 +61,9 @@ public:
 private:
 	void updateItemByRecord(const QString &jid, const QSqlRecord &record);
 
+	void insertItems(const QVector<RosterItem> &items);
+	void deleteItems(const QString &accountJid, const QList<QString> &jids);
+
 	void fetchGroups(QVector<RosterItem> &items);
 	void addGroups(const QString &accountJid, const QString &jid, const QVector<QString> &groups);
 	void updateGroups(const RosterItem &oldItem, const RosterItem &newItem);
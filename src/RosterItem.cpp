@@ -6,6 +6,8 @@
 
 #include "RosterItem.h"
 
+#include <QSet>
+
 #include <QXmppUtils.h>
 
 RosterItem::RosterItem(const QString &accountJid, const QXmppRosterIq::Item &item)
@@ -41,6 +43,11 @@ bool RosterItem::isReceivingPresence() const
 	return subscription == QXmppRosterIq::Item::From || subscription == QXmppRosterIq::Item::Both;
 }
 
+bool RosterItem::hasSameGroups(const RosterItem &other) const
+{
+	return QSet<QString>(groups.cbegin(), groups.cend()) == QSet<QString>(other.groups.cbegin(), other.groups.cend());
+}
+
 bool RosterItem::operator<(const RosterItem &other) const
 {
 	if (pinningPosition == -1 && other.pinningPosition == -1) {
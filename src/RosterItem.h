@@ -54,6 +54,11 @@ public:
 	bool isSendingPresence() const;
 	bool isReceivingPresence() const;
 
+	/**
+	 * Returns whether the item has the same groups as another item regardless of their order.
+	 */
+	bool hasSameGroups(const RosterItem &other) const;
+
 	bool operator==(const RosterItem &other) const = default;
 	bool operator!=(const RosterItem &other) const = default;
 
@@ -118,7 +118,7 @@ void RosterManager::populateRoster()
 	}
 
 	// replace current contacts with new ones from server
-	Q_EMIT RosterModel::instance()->replaceItemsRequested(items);
+	Q_EMIT RosterModel::instance()->replaceItemsRequested(m_client->configuration().jidBare(), items);
 }
 
 void RosterManager::addContact(const QString &jid, const QString &name, const QString &msg)
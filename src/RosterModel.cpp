@@ -11,8 +11,13 @@
 
 #include "RosterModel.h"
 
+// std
+#include <algorithm>
+#include <iterator>
+
 // Kaidan
 #include "AccountManager.h"
+#include "Algorithms.h"
 #include "FutureUtils.h"
 #include "Kaidan.h"
 #include "MessageDb.h"
@@ -44,12 +49,11 @@ RosterModel::RosterModel(QObject *parent)
 	        this, &RosterModel::updateItem);
 	connect(this, &RosterModel::updateItemRequested, RosterDb::instance(), &RosterDb::updateItem);
 
-	connect(this, &RosterModel::replaceItemsRequested,
-	        this, &RosterModel::replaceItems);
+	connect(this, &RosterModel::replaceItemsRequested, this, &RosterModel::replaceItems);
 	connect(this, &RosterModel::replaceItemsRequested, RosterDb::instance(), &RosterDb::replaceItems);
 
-	connect(MessageDb::instance(), &MessageDb::messageAdded,
-	        this, &RosterModel::handleMessageAdded);
+	connect(MessageDb::instance(), &MessageDb::messagesAdded,
+	        this, &RosterModel::handleMessagesAdded);
 	connect(MessageDb::instance(), &MessageDb::messageUpdated, this, &RosterModel::handleMessageUpdated);
 	connect(MessageDb::instance(), &MessageDb::draftMessageAdded, this, &RosterModel::handleDraftMessageAdded);
 	connect(MessageDb::instance(), &MessageDb::draftMessageUpdated, this, &RosterModel::handleDraftMessageUpdated);
@@ -59,6 +63,7 @@ RosterModel::RosterModel(QObject *parent)
 	connect(AccountManager::instance(), &AccountManager::jidChanged, this, [this] {
 		beginResetModel();
 		m_items.clear();
+		rebuildItemIndexes();
 		endResetModel();
 
 		await(RosterDb::instance()->fetchItems(), this, [this](const QVector<RosterItem> &items) {
@@ -153,39 +158,17 @@ QVariant RosterModel::data(const QModelIndex &index, int role) const
 
 bool RosterModel::hasItem(const QString &jid) const
 {
-	return findItem(jid).has_value();
+	return itemRow(jid) != -1;
 }
 
 QStringList RosterModel::accountJids() const
 {
-	QStringList accountJids;
-
-	std::for_each(m_items.cbegin(), m_items.cend(), [&accountJids](const RosterItem &item) {
-		if (const auto accountJid = item.accountJid; !accountJids.contains(accountJid)) {
-			accountJids.append(accountJid);
-		}
-	});
-
-	std::sort(accountJids.begin(), accountJids.end());
-
-	return accountJids;
+	return m_accountJidItemCounts.keys();
 }
 
 QStringList RosterModel::groups() const
 {
-	QStringList groups;
-
-	std::for_each(m_items.cbegin(), m_items.cend(), [&groups](const RosterItem &item) {
-		std::for_each(item.groups.cbegin(), item.groups.cend(), [&](const QString &group) {
-			if (!groups.contains(group)) {
-				groups.append(group);
-			}
-		});
-	});
-
-	std::sort(groups.begin(), groups.end());
-
-	return groups;
+	return m_groupItemCounts.keys();
 }
 
 void RosterModel::updateGroup(const QString &oldGroup, const QString &newGroup)
@@ -213,10 +196,8 @@ void RosterModel::removeGroup(const QString &group)
 
 std::optional<RosterItem> RosterModel::findItem(const QString &jid) const
 {
-	for (const auto &item : std::as_const(m_items)) {
-		if (item.jid == jid) {
-			return item;
-		}
+	if (const auto row = itemRow(jid); row != -1) {
+		return m_items.at(row);
 	}
 
 	return std::nullopt;
@@ -320,6 +301,8 @@ void RosterModel::handleItemsFetched(const QVector<RosterItem> &items)
 	beginResetModel();
 	m_items = items;
 	std::sort(m_items.begin(), m_items.end());
+	m_itemsWithChangedPositions.clear();
+	rebuildItemIndexes();
 	endResetModel();
 
 	for (const auto &item : std::as_const(m_items)) {
@@ -332,79 +315,144 @@ void RosterModel::handleItemsFetched(const QVector<RosterItem> &items)
 
 void RosterModel::addItem(const RosterItem &item)
 {
+	// The position can only be determined while all items are sorted.
+	updateItemPositions();
 	insertItem(positionToAdd(item), item);
 }
 
 void RosterModel::updateItem(const QString &jid,
                              const std::function<void (RosterItem &)> &updateItem)
 {
-	for (int i = 0; i < m_items.length(); i++) {
-		if (m_items.at(i).jid == jid) {
-			// update item
-			RosterItem item = m_items.at(i);
-			updateItem(item);
-
-			// check if item was actually modified
-			if (m_items.at(i) == item)
-				return;
+	const auto i = itemRow(jid);
 
-			// TODO: Uncomment this and see TODO in ContactDetailsContent once fixed in Kirigami Addons.
-//			auto oldGroups = groups();
+	if (i == -1) {
+		return;
+	}
 
-			m_items.replace(i, item);
+	// update item
+	RosterItem item = m_items.at(i);
+	updateItem(item);
 
-			// item was changed: refresh all roles
-			Q_EMIT dataChanged(index(i), index(i), {});
-			RosterItemNotifier::instance().notifyWatchers(jid, item);
+	// check if item was actually modified
+	if (m_items.at(i) == item)
+		return;
 
-			// check, if the position of the new item may be different
-			updateItemPosition(i);
+	// TODO: Uncomment this and see TODO in ContactDetailsContent once fixed in Kirigami Addons.
+//	auto oldGroups = groups();
 
-			// TODO: Uncomment this and see TODO in ContactDetailsContent once fixed in Kirigami Addons.
-//			if (oldGroups != groups()) {
-				Q_EMIT groupsChanged();
-//			}
+	if (const auto &oldItem = m_items.at(i); oldItem.groups != item.groups) {
+		for (const auto &group : oldItem.groups) {
+			changeItemCount(m_groupItemCounts, group, -1);
+		}
 
-			return;
+		for (const auto &group : std::as_const(item.groups)) {
+			changeItemCount(m_groupItemCounts, group, 1);
 		}
 	}
+
+	m_items.replace(i, item);
+
+	// item was changed: refresh all roles
+	Q_EMIT dataChanged(index(i), index(i), {});
+	RosterItemNotifier::instance().notifyWatchers(jid, item);
+
+	// check, if the position of the new item may be different
+	updateItemPosition(i);
+
+	// TODO: Uncomment this and see TODO in ContactDetailsContent once fixed in Kirigami Addons.
+//	if (oldGroups != groups()) {
+		Q_EMIT groupsChanged();
+//	}
 }
 
-void RosterModel::replaceItems(const QHash<QString, RosterItem> &items)
+void RosterModel::replaceItems(const QString &accountJid, const QHash<QString, RosterItem> &items)
 {
-	QVector<RosterItem> newItems;
-	for (auto item : items) {
-		// find old item
-		auto oldItem = std::find_if(
-			m_items.cbegin(),
-			m_items.cend(),
-			[&] (const RosterItem &oldItem) {
-				return oldItem.jid == item.jid;
+	if (AccountManager::instance()->jid() != accountJid) {
+		return;
+	}
+
+	// Loading all items at once is faster than inserting them one by one.
+	if (m_items.isEmpty()) {
+		handleItemsFetched(items.values().toVector());
+		return;
+	}
+
+	bool accountJidRemoved = false;
+	bool groupAddedOrRemoved = false;
+
+	// Remove the items that are not in the roster anymore.
+	const auto removedItems = removeItemsIf([&](const RosterItem &item) {
+		return item.accountJid == accountJid && !items.contains(item.jid);
+	});
+
+	for (const auto &removedItem : removedItems) {
+		RosterItemNotifier::instance().notifyWatchers(removedItem.jid, std::nullopt);
+
+		accountJidRemoved |= changeItemCount(m_accountJidItemCounts, removedItem.accountJid, -1);
+
+		for (const auto &group : removedItem.groups) {
+			groupAddedOrRemoved |= changeItemCount(m_groupItemCounts, group, -1);
+		}
+	}
+
+	QVector<RosterItem> addedItems;
+
+	for (const auto &item : items) {
+		const auto row = itemRow(accountJid, item.jid);
+
+		if (row == -1) {
+			addedItems.append(item);
+			continue;
+		}
+
+		// Only the data received from the server is updated.
+		auto &currentItem = m_items[row];
+
+		// The groups are compared regardless of their order like by RosterDb.
+		const auto groupsChanged = !currentItem.hasSameGroups(item);
+
+		if (currentItem.name == item.name && currentItem.subscription == item.subscription && !groupsChanged) {
+			continue;
+		}
+
+		if (groupsChanged) {
+			for (const auto &group : std::as_const(currentItem.groups)) {
+				groupAddedOrRemoved |= changeItemCount(m_groupItemCounts, group, -1);
+			}
+
+			for (const auto &group : item.groups) {
+				groupAddedOrRemoved |= changeItemCount(m_groupItemCounts, group, 1);
 			}
-		);
-
-		// use the old item's values, if found
-		if (oldItem != m_items.cend()) {
-			item.lastMessage = oldItem->lastMessage;
-			item.lastMessageDateTime = oldItem->lastMessageDateTime;
-			item.unreadMessages = oldItem->unreadMessages;
-			item.lastReadOwnMessageId = oldItem->lastReadOwnMessageId;
-			item.lastReadContactMessageId = oldItem->lastReadContactMessageId;
-			item.encryption = oldItem->encryption;
-			item.pinningPosition = oldItem->pinningPosition;
-			item.chatStateSendingEnabled = oldItem->chatStateSendingEnabled;
-			item.readMarkerSendingEnabled = oldItem->readMarkerSendingEnabled;
-			item.notificationsMuted = oldItem->notificationsMuted;
-			item.lastMessageDeliveryState = oldItem->lastMessageDeliveryState;
-			item.lastMessageSenderId = oldItem->lastMessageSenderId;
-			item.automaticMediaDownloadsRule = oldItem->automaticMediaDownloadsRule;
+
+			currentItem.groups = item.groups;
+		}
+
+		currentItem.name = item.name;
+		currentItem.subscription = item.subscription;
+
+		Q_EMIT dataChanged(index(row), index(row), {});
+		RosterItemNotifier::instance().notifyWatchers(currentItem.jid, currentItem);
+
+		// The position depends on the name.
+		updateItemPosition(row);
+	}
+
+	if (!addedItems.isEmpty()) {
+		// The positions can only be determined while all items are sorted.
+		updateItemPositions();
+
+		for (const auto &item : std::as_const(addedItems)) {
+			insertItem(positionToAdd(item), item);
 		}
+	}
 
-		newItems << item;
+	if (accountJidRemoved) {
+		Q_EMIT accountJidsChanged();
 	}
 
-	// replace all items
-	handleItemsFetched(newItems);
+	if (groupAddedOrRemoved) {
+		Q_EMIT groupsChanged();
+	}
 }
 
 void RosterModel::updateLastMessage(
@@ -438,6 +486,9 @@ void RosterModel::updateLastMessage(
 
 void RosterModel::pinItem(const QString &, const QString &jid)
 {
+	// The first item must be the pinned item with the highest pinning position.
+	updateItemPositions();
+
 	Q_EMIT updateItemRequested(jid, [highestPinningPosition = m_items.at(0).pinningPosition](RosterItem &item) {
 		item.pinningPosition = highestPinningPosition + 1;
 	});
@@ -534,40 +585,90 @@ void RosterModel::setAutomaticMediaDownloadsRule(const QString &, const QString
 
 void RosterModel::removeItems(const QString &accountJid, const QString &jid)
 {
-	for (int i = 0; i < m_items.size(); i++) {
-		const RosterItem &item = m_items.at(i);
+	if (AccountManager::instance()->jid() != accountJid) {
+		return;
+	}
 
-		if (AccountManager::instance()->jid() == accountJid && (item.jid.isEmpty() || item.jid == jid)) {
-			auto oldGroupCount = groups().size();
+	bool accountJidRemoved = false;
+	bool groupRemoved = false;
 
-			beginRemoveRows(QModelIndex(), i, i);
-			m_items.remove(i);
-			endRemoveRows();
+	const auto removedItems = removeItemsIf([&](const RosterItem &item) {
+		return item.accountJid == accountJid && (jid.isEmpty() || item.jid == jid);
+	});
 
-			RosterItemNotifier::instance().notifyWatchers(jid, std::nullopt);
+	for (const auto &item : removedItems) {
+		RosterItemNotifier::instance().notifyWatchers(item.jid, std::nullopt);
 
-			if (!accountJids().contains(accountJid)) {
-				Q_EMIT accountJidsChanged();
-			}
+		accountJidRemoved |= changeItemCount(m_accountJidItemCounts, item.accountJid, -1);
 
-			if (oldGroupCount < groups().size()) {
-				Q_EMIT groupsChanged();
+		for (const auto &group : item.groups) {
+			groupRemoved |= changeItemCount(m_groupItemCounts, group, -1);
+		}
+	}
+
+	if (accountJidRemoved) {
+		Q_EMIT accountJidsChanged();
+	}
+
+	if (groupRemoved) {
+		Q_EMIT groupsChanged();
+	}
+}
+
+void RosterModel::handleMessagesAdded(const QVector<Message> &messages, MessageOrigin origin)
+{
+	struct ChangedItem
+	{
+		QVector<int> changedRoles;
+		bool unreadMessagesChanged = false;
+	};
+
+	// The messages are applied to the items one after another.
+	// Afterwards, each changed item is stored, announced and moved only once per batch.
+	QMap<int, ChangedItem> changedItems;
+
+	for (const auto &message : messages) {
+		const auto i = itemRow(message.accountJid, message.chatJid);
+
+		// contact not found
+		if (i == -1)
+			continue;
+
+		auto &changedItem = changedItems[i];
+		const auto changedRoles = addMessageToItem(i, message, origin);
+
+		for (const auto role : changedRoles) {
+			if (!changedItem.changedRoles.contains(role)) {
+				changedItem.changedRoles.append(role);
 			}
+		}
+
+		changedItem.unreadMessagesChanged |= changedRoles.contains(int(UnreadMessagesRole));
+	}
+
+	for (auto itr = changedItems.cbegin(); itr != changedItems.cend(); ++itr) {
+		const auto i = itr.key();
+		const auto &rosterItem = m_items.at(i);
 
-			return;
+		if (itr->unreadMessagesChanged) {
+			RosterDb::instance()->updateItem(rosterItem.jid, [newCount = rosterItem.unreadMessages](RosterItem &item) {
+				item.unreadMessages = newCount;
+			});
 		}
+
+		// notify gui
+		const auto modelIndex = index(i);
+		Q_EMIT dataChanged(modelIndex, modelIndex, itr->changedRoles);
+		RosterItemNotifier::instance().notifyWatchers(rosterItem.jid, rosterItem);
+
+		// move row to correct position
+		updateItemPosition(i);
 	}
 }
 
-void RosterModel::handleMessageAdded(const Message &message, MessageOrigin origin)
+QVector<int> RosterModel::addMessageToItem(int i, const Message &message, MessageOrigin origin)
 {
-	auto itr = std::find_if(m_items.begin(), m_items.end(), [&message](const RosterItem &item) {
-		return item.jid == message.chatJid;
-	});
-
-	// contact not found
-	if (itr == m_items.end())
-		return;
+	auto itr = m_items.begin() + i;
 
 	QVector<int> changedRoles = {
 		int(LastMessageDateTimeRole)
@@ -596,33 +697,22 @@ void RosterModel::handleMessageAdded(const Message &message, MessageOrigin origi
 	if (newUnreadMessages.has_value()) {
 		itr->unreadMessages = *newUnreadMessages;
 		changedRoles << int(UnreadMessagesRole);
-
-		RosterDb::instance()->updateItem(message.chatJid, [newCount = *newUnreadMessages](RosterItem &item) {
-			item.unreadMessages = newCount;
-		});
 	}
 
-	// notify gui
-	const auto i = std::distance(m_items.begin(), itr);
-	const auto modelIndex = index(i);
-	Q_EMIT dataChanged(modelIndex, modelIndex, changedRoles);
-	RosterItemNotifier::instance().notifyWatchers(itr->jid, *itr);
-
-	// move row to correct position
-	updateItemPosition(i);
+	return changedRoles;
 }
 
 void RosterModel::handleMessageUpdated(const Message &message)
 {
-	auto itr = std::find_if(m_items.begin(), m_items.end(), [&message](const RosterItem &item) {
-		return item.jid == message.chatJid;
-	});
+	const auto i = itemRow(message.accountJid, message.chatJid);
 
 	// Skip further processing if the contact could not be found.
-	if (itr == m_items.end()) {
+	if (i == -1) {
 		return;
 	}
 
+	auto itr = m_items.begin() + i;
+
 	QVector<int> changedRoles = {
 		int(LastMessageRole)
 	};
@@ -630,7 +720,6 @@ void RosterModel::handleMessageUpdated(const Message &message)
 	updateLastMessage(itr, message, changedRoles);
 
 	// Notify the user interface and watchers.
-	const auto i = std::distance(m_items.begin(), itr);
 	const auto modelIndex = index(i);
 	Q_EMIT dataChanged(modelIndex, modelIndex, changedRoles);
 	RosterItemNotifier::instance().notifyWatchers(itr->jid, *itr);
@@ -638,14 +727,14 @@ void RosterModel::handleMessageUpdated(const Message &message)
 
 void RosterModel::handleDraftMessageAdded(const Message &message)
 {
-	auto itr = std::find_if(m_items.begin(), m_items.end(), [&message](const RosterItem &item) {
-		return item.jid == message.chatJid;
-	});
+	const auto i = itemRow(message.accountJid, message.chatJid);
 
 	// contact not found
-	if (itr == m_items.end())
+	if (i == -1)
 		return;
 
+	auto itr = m_items.begin() + i;
+
 	QVector<int> changedRoles = {
 		int(LastMessageDateTimeRole),
 		int(LastMessageRole),
@@ -658,7 +747,6 @@ void RosterModel::handleDraftMessageAdded(const Message &message)
 	itr->lastMessage = lastMessage;
 
 	// notify gui
-	const auto i = std::distance(m_items.begin(), itr);
 	const auto modelIndex = index(i);
 	Q_EMIT dataChanged(modelIndex, modelIndex, changedRoles);
 	RosterItemNotifier::instance().notifyWatchers(itr->jid, *itr);
@@ -669,14 +757,14 @@ void RosterModel::handleDraftMessageAdded(const Message &message)
 
 void RosterModel::handleDraftMessageUpdated(const Message &message)
 {
-	auto itr = std::find_if(m_items.begin(), m_items.end(), [&message](const RosterItem &item) {
-		return item.jid == message.chatJid;
-	});
+	const auto i = itemRow(message.accountJid, message.chatJid);
 
 	// contact not found
-	if (itr == m_items.end())
+	if (i == -1)
 		return;
 
+	auto itr = m_items.begin() + i;
+
 	QVector<int> changedRoles = {
 		int(LastMessageDateTimeRole),
 		int(LastMessageRole),
@@ -690,7 +778,6 @@ void RosterModel::handleDraftMessageUpdated(const Message &message)
 
 
 	// notify gui
-	const auto i = std::distance(m_items.begin(), itr);
 	const auto modelIndex = index(i);
 	Q_EMIT dataChanged(modelIndex, modelIndex, changedRoles);
 	RosterItemNotifier::instance().notifyWatchers(itr->jid, *itr);
@@ -701,15 +788,15 @@ void RosterModel::handleDraftMessageUpdated(const Message &message)
 
 void RosterModel::handleDraftMessageRemoved(const Message &newLastMessage)
 {
-	auto itr = std::find_if(m_items.begin(), m_items.end(), [&newLastMessage](const RosterItem &item) {
-		return item.accountJid == newLastMessage.accountJid && item.jid == newLastMessage.chatJid;
-	});
+	const auto i = itemRow(newLastMessage.accountJid, newLastMessage.chatJid);
 
 	// contact not found
-	if (itr == m_items.end()) {
+	if (i == -1) {
 		return;
 	}
 
+	auto itr = m_items.begin() + i;
+
 	QVector<int> changedRoles = {
 		int(LastMessageDateTimeRole),
 		int(LastMessageRole),
@@ -721,7 +808,6 @@ void RosterModel::handleDraftMessageRemoved(const Message &newLastMessage)
 	itr->lastMessage = newLastMessage.body;
 
 	// notify gui
-	const auto i = std::distance(m_items.begin(), itr);
 	const auto modelIndex = index(i);
 	Q_EMIT dataChanged(modelIndex, modelIndex, changedRoles);
 	RosterItemNotifier::instance().notifyWatchers(itr->jid, *itr);
@@ -732,21 +818,20 @@ void RosterModel::handleDraftMessageRemoved(const Message &newLastMessage)
 
 void RosterModel::handleMessageRemoved(const Message &newLastMessage)
 {
-	auto itr = std::find_if(m_items.begin(), m_items.end(), [&newLastMessage](const RosterItem &item) {
-		return item.jid == newLastMessage.chatJid;
-	});
+	const auto i = itemRow(newLastMessage.accountJid, newLastMessage.chatJid);
 
 	// Skip further processing if the contact could not be found.
-	if (itr == m_items.end()) {
+	if (i == -1) {
 		return;
 	}
 
+	auto itr = m_items.begin() + i;
+
 	QVector<int> changedRoles {};
 
 	updateLastMessage(itr, newLastMessage, changedRoles, false);
 
 	// Notify the user interface and watchers.
-	const auto i = std::distance(m_items.begin(), itr);
 	const auto modelIndex = index(i);
 	Q_EMIT dataChanged(modelIndex, modelIndex, changedRoles);
 	RosterItemNotifier::instance().notifyWatchers(itr->jid, *itr);
@@ -754,81 +839,203 @@ void RosterModel::handleMessageRemoved(const Message &newLastMessage)
 
 void RosterModel::insertItem(int index, const RosterItem &item)
 {
-	auto newAccountJidAdded = !accountJids().contains(item.accountJid);
-	auto oldGroupCount = groups().size();
+	const auto accountJidAdded = changeItemCount(m_accountJidItemCounts, item.accountJid, 1);
+	bool groupAdded = false;
+
+	for (const auto &group : item.groups) {
+		groupAdded |= changeItemCount(m_groupItemCounts, group, 1);
+	}
 
 	beginInsertRows(QModelIndex(), index, index);
 	m_items.insert(index, item);
+	updateItemRows(index, m_items.size() - 1);
 	endInsertRows();
 
 	RosterItemNotifier::instance().notifyWatchers(item.jid, item);
 
-	if (newAccountJidAdded) {
+	if (accountJidAdded) {
 		Q_EMIT accountJidsChanged();
 	}
 
-	if (oldGroupCount < groups().size()) {
+	if (groupAdded) {
 		Q_EMIT groupsChanged();
 	}
 }
 
 void RosterModel::updateItemPosition(int currentIndex)
 {
-	int newIndex = positionToMove(currentIndex);
+	const auto &item = m_items.at(currentIndex);
+	m_itemsWithChangedPositions.insert({ item.accountJid, item.jid });
 
-	if (currentIndex == newIndex) {
-		return;
+	if (m_itemsWithChangedPositions.size() == 1) {
+		QMetaObject::invokeMethod(this, &RosterModel::updateItemPositions, Qt::QueuedConnection);
 	}
+}
 
-	beginMoveRows(QModelIndex(), currentIndex, currentIndex, QModelIndex(), newIndex);
+void RosterModel::updateItemPositions()
+{
+	QVector<int> changedRows;
+	changedRows.reserve(m_itemsWithChangedPositions.size());
 
-	// Cover both cases:
-	// 1. Moving to a higher index
-	// 2. Moving to a lower index
-	if (currentIndex < newIndex) {
-		m_items.move(currentIndex, newIndex - 1);
-	} else {
-		m_items.move(currentIndex, newIndex);
+	for (const auto &key : std::as_const(m_itemsWithChangedPositions)) {
+		// Items removed in the meantime are skipped.
+		if (const auto row = m_itemRows.value(key, -1); row != -1) {
+			changedRows.append(row);
+		}
 	}
 
-	endMoveRows();
+	m_itemsWithChangedPositions.clear();
+
+	moveToSortedPositions(
+		m_items,
+		changedRows,
+		[](const RosterItem &left, const RosterItem &right) {
+			return left < right;
+		},
+		[this](int from, int destination) {
+			beginMoveRows(QModelIndex(), from, from, QModelIndex(), destination);
+
+			// Cover both cases:
+			// 1. Moving to a higher index
+			// 2. Moving to a lower index
+			if (from < destination) {
+				m_items.move(from, destination - 1);
+				updateItemRows(from, destination - 1);
+			} else {
+				m_items.move(from, destination);
+				updateItemRows(destination, from);
+			}
+
+			endMoveRows();
+		}
+	);
 }
 
 int RosterModel::positionToAdd(const RosterItem &item)
 {
-	for (int i = 0; i < m_items.size(); i++) {
-		if (item <= m_items.at(i)) {
-			return i;
+	// The pinned items are followed by the unpinned ones, each sorted on their own.
+	// Thus, the position is found by binary search over both of them.
+	// If the item to be positioned is greater than all other items, it is appended to the list.
+	return std::partition_point(m_items.cbegin(), m_items.cend(), [&item](const RosterItem &listItem) {
+		return !(item <= listItem);
+	}) - m_items.cbegin();
+}
+
+int RosterModel::itemRow(const QString &jid) const
+{
+	return itemRow(AccountManager::instance()->jid(), jid);
+}
+
+int RosterModel::itemRow(const QString &accountJid, const QString &jid) const
+{
+	return m_itemRows.value({ accountJid, jid }, -1);
+}
+
+QVector<RosterItem> RosterModel::removeItemsIf(const std::function<bool(const RosterItem &)> &condition)
+{
+	QVector<RosterItem> removedItems;
+
+	int firstRemovedRow = -1;
+	const int removedItemCount = std::count_if(m_items.cbegin(), m_items.cend(), condition);
+
+	if (removedItemCount == 0) {
+		return removedItems;
+	}
+
+	removedItems.reserve(removedItemCount);
+
+	// Reloading all rows is faster for views than handling many removed ranges.
+	if (removedItemCount > m_items.size() / 2) {
+		beginResetModel();
+
+		QVector<RosterItem> remainingItems;
+		remainingItems.reserve(m_items.size() - removedItemCount);
+
+		for (auto &item : m_items) {
+			if (condition(item)) {
+				removedItems.append(std::move(item));
+			} else {
+				remainingItems.append(std::move(item));
+			}
+		}
+
+		m_items = std::move(remainingItems);
+		firstRemovedRow = 0;
+
+		endResetModel();
+	} else {
+		// Remove each range of contiguous rows at once starting with the last one.
+		for (int last = m_items.size() - 1; last >= 0; last--) {
+			if (!condition(m_items.at(last))) {
+				continue;
+			}
+
+			int first = last;
+
+			while (first > 0 && condition(m_items.at(first - 1))) {
+				first--;
+			}
+
+			beginRemoveRows(QModelIndex(), first, last);
+			std::move(m_items.begin() + first, m_items.begin() + last + 1, std::back_inserter(removedItems));
+			m_items.erase(m_items.begin() + first, m_items.begin() + last + 1);
+			endRemoveRows();
+
+			firstRemovedRow = first;
+			last = first;
 		}
 	}
 
-	// If the item to be positioned is greater than all other items, it is appended to the list.
-	return m_items.size();
+	for (const auto &item : std::as_const(removedItems)) {
+		m_itemRows.remove({ item.accountJid, item.jid });
+	}
+
+	updateItemRows(firstRemovedRow, m_items.size() - 1);
+
+	return removedItems;
 }
 
-int RosterModel::positionToMove(int currentIndex)
+void RosterModel::updateItemRows(int first, int last)
 {
-	const auto &item = m_items.at(currentIndex);
+	for (int i = first; i <= last; i++) {
+		const auto &item = m_items.at(i);
+		m_itemRows.insert({ item.accountJid, item.jid }, i);
+	}
+}
 
-	for (int i = 0; i < m_items.size(); i++) {
-		// In some cases, it is needed to skip the item that is being positioned.
-		// Especially, when the item is at the beginning or at the end of the list, it must not
-		// be compared to itself in order to find the correct position.
-		if (currentIndex != i) {
-			if (item <= m_items.at(i)) {
-				if (i == currentIndex + 1) {
-					return currentIndex;
-				}
-
-				return i;
-			}
+void RosterModel::rebuildItemIndexes()
+{
+	m_itemRows.clear();
+	m_accountJidItemCounts.clear();
+	m_groupItemCounts.clear();
+
+	m_itemRows.reserve(m_items.size());
+	updateItemRows(0, m_items.size() - 1);
+
+	for (const auto &item : std::as_const(m_items)) {
+		changeItemCount(m_accountJidItemCounts, item.accountJid, 1);
+
+		for (const auto &group : item.groups) {
+			changeItemCount(m_groupItemCounts, group, 1);
 		}
 	}
+}
+
+bool RosterModel::changeItemCount(QMap<QString, int> &itemCounts, const QString &key, int difference)
+{
+	auto itr = itemCounts.find(key);
 
-	// If the item to be positioned is the last item but cannot be positioned somewhere else, its
-	// position is not changed.
-	// In all other cases, the item is appended to the list.
-	return currentIndex == m_items.size() - 1 ? currentIndex : m_items.size();
+	if (itr == itemCounts.end()) {
+		itemCounts.insert(key, difference);
+		return true;
+	}
+
+	if ((*itr += difference) == 0) {
+		itemCounts.erase(itr);
+		return true;
+	}
+
+	return false;
 }
 
 QString RosterModel::formatLastMessageDateTime(const QDateTime &lastMessageDateTime) const
@@ -10,10 +10,14 @@
 #pragma once
 
 // std
+#include <functional>
 #include <optional>
 // Qt
 #include <QAbstractListModel>
 #include <QFuture>
+#include <QHash>
+#include <QMap>
+#include <QSet>
 #include <QVector>
 // Kaidan
 #include "RosterItem.h"
@@ -151,7 +155,14 @@ signals:
 	void addItemRequested(const RosterItem &item);
 	void updateItemRequested(const QString &jid,
 	                         const std::function<void (RosterItem &)> &updateItem);
-	void replaceItemsRequested(const QHash<QString, RosterItem> &items);
+
+	/**
+	 * Emitted to replace the roster items of an account by the items received from the server.
+	 *
+	 * @param accountJid JID of the account whose roster items are replaced
+	 * @param items roster items mapped to their JIDs
+	 */
+	void replaceItemsRequested(const QString &accountJid, const QHash<QString, RosterItem> &items);
 
 	/**
 	 * Emitted to remove all roster items of an account or a specific roster item.
@@ -170,7 +181,12 @@ private:
 	void handleItemsFetched(const QVector<RosterItem> &items);
 
 	void addItem(const RosterItem &item);
-	void replaceItems(const QHash<QString, RosterItem> &items);
+
+	/**
+	 * Replaces the roster items of an account by inserting, removing and updating only the items
+	 * that differ.
+	 */
+	void replaceItems(const QString &accountJid, const QHash<QString, RosterItem> &items);
 
 	void updateLastMessage(QVector<RosterItem>::Iterator &itr,
 						   const Message &message,
@@ -185,7 +201,24 @@ private:
 	 */
 	void removeItems(const QString &accountJid, const QString &jid = {});
 
-	void handleMessageAdded(const Message &message, MessageOrigin origin);
+	/**
+	 * Updates the last messages and the numbers of unread messages of the items by added
+	 * messages.
+	 *
+	 * Each item is written to the database and announced once per batch of messages.
+	 */
+	void handleMessagesAdded(const QVector<Message> &messages, MessageOrigin origin);
+
+	/**
+	 * Updates the last message and the number of unread messages of an item in memory.
+	 *
+	 * @param i row of the item
+	 * @param message added message
+	 * @param origin origin of the added message
+	 *
+	 * @return the changed roles of the item
+	 */
+	QVector<int> addMessageToItem(int i, const Message &message, MessageOrigin origin);
 	void handleMessageUpdated(const Message &message);
 	void handleDraftMessageAdded(const Message &message);
 	void handleDraftMessageUpdated(const Message &message);
@@ -193,13 +226,82 @@ private:
 	void handleMessageRemoved(const Message &newLastMessage);
 
 	void insertItem(int index, const RosterItem &item);
+
+	/**
+	 * Marks an item to be moved to its correct position.
+	 *
+	 * All items marked within one iteration of the event loop are moved at once afterwards.
+	 */
 	void updateItemPosition(int currentIndex);
+
+	/**
+	 * Moves all items marked by updateItemPosition() to their correct positions.
+	 */
+	void updateItemPositions();
+
 	int positionToAdd(const RosterItem &item);
-	int positionToMove(int currentIndex);
-	
+
+	/**
+	 * Returns the row of an item of the current account.
+	 *
+	 * @param jid JID of the roster item
+	 *
+	 * @return the item's row or -1 if there is no such item
+	 */
+	int itemRow(const QString &jid) const;
+
+	/**
+	 * Returns the row of an item.
+	 *
+	 * @param accountJid JID of the item's account
+	 * @param jid JID of the roster item
+	 *
+	 * @return the item's row or -1 if there is no such item
+	 */
+	int itemRow(const QString &accountJid, const QString &jid) const;
+
+	/**
+	 * Removes all items fulfilling a condition.
+	 *
+	 * Contiguous rows are removed at once.
+	 * If most items are removed, the model is reset instead.
+	 *
+	 * @param condition condition an item must fulfill in order to be removed
+	 *
+	 * @return the removed items
+	 */
+	QVector<RosterItem> removeItemsIf(const std::function<bool(const RosterItem &)> &condition);
+
+	/**
+	 * Updates the stored rows of the items within a range of rows after they changed.
+	 */
+	void updateItemRows(int first, int last);
+
+	/**
+	 * Recreates the stored rows, account JIDs and groups for all items.
+	 */
+	void rebuildItemIndexes();
+
+	/**
+	 * Changes the number of items having an account JID or group.
+	 *
+	 * @return whether the account JID or group was added or removed
+	 */
+	static bool changeItemCount(QMap<QString, int> &itemCounts, const QString &key, int difference);
+
 	QString formatLastMessageDateTime(const QDateTime &lastMessageDateTime) const;
 
 	QVector<RosterItem> m_items;
 
+	// rows of the items by their account JIDs and JIDs
+	QHash<QPair<QString, QString>, int> m_itemRows;
+
+	// account JIDs and JIDs of the items to be moved by updateItemPositions()
+	QSet<QPair<QString, QString>> m_itemsWithChangedPositions;
+
+	// numbers of items per account JID and per group sorted by account JID or group
+	QMap<QString, int> m_accountJidItemCounts;
+	QMap<QString, int> m_groupItemCounts;
+
 	static RosterModel *s_instance;
 };
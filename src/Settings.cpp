@@ -167,6 +167,26 @@ void Settings::setAutomaticMediaDownloadsRule(AccountManager::AutomaticMediaDown
 	setValue(QStringLiteral(KAIDAN_SETTINGS_AUTOMATIC_MEDIA_DOWNLOADS_RULE), rule, &Settings::automaticMediaDownloadsRuleChanged);
 }
 
+int Settings::messageWindowSize() const
+{
+	return value<int>(QStringLiteral(KAIDAN_SETTINGS_MESSAGE_WINDOW_SIZE), DEFAULT_MESSAGE_WINDOW_SIZE);
+}
+
+void Settings::setMessageWindowSize(int windowSize)
+{
+	setValue(QStringLiteral(KAIDAN_SETTINGS_MESSAGE_WINDOW_SIZE), windowSize, &Settings::messageWindowSizeChanged);
+}
+
+int Settings::maxThumbnailJobs() const
+{
+	return value<int>(QStringLiteral(KAIDAN_SETTINGS_MAX_THUMBNAIL_JOBS), DEFAULT_MAX_THUMBNAIL_JOBS);
+}
+
+void Settings::setMaxThumbnailJobs(int maxThumbnailJobs)
+{
+	setValue(QStringLiteral(KAIDAN_SETTINGS_MAX_THUMBNAIL_JOBS), maxThumbnailJobs, &Settings::maxThumbnailJobsChanged);
+}
+
 void Settings::remove(const QStringList &keys)
 {
 	QMutexLocker locker(&m_mutex);
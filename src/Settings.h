@@ -37,6 +37,8 @@ class Settings : public QObject
 	Q_PROPERTY(QPoint windowPosition READ windowPosition WRITE setWindowPosition NOTIFY windowPositionChanged)
 	Q_PROPERTY(QSize windowSize READ windowSize WRITE setWindowSize NOTIFY windowSizeChanged)
 	Q_PROPERTY(AccountManager::AutomaticMediaDownloadsRule automaticMediaDownloadsRule READ automaticMediaDownloadsRule WRITE setAutomaticMediaDownloadsRule NOTIFY automaticMediaDownloadsRuleChanged)
+	Q_PROPERTY(int messageWindowSize READ messageWindowSize WRITE setMessageWindowSize NOTIFY messageWindowSizeChanged)
+	Q_PROPERTY(int maxThumbnailJobs READ maxThumbnailJobs WRITE setMaxThumbnailJobs NOTIFY maxThumbnailJobsChanged)
 
 public:
 	explicit Settings(QObject *parent = nullptr);
@@ -100,6 +102,34 @@ public:
 	AccountManager::AutomaticMediaDownloadsRule automaticMediaDownloadsRule() const;
 	void setAutomaticMediaDownloadsRule(AccountManager::AutomaticMediaDownloadsRule rule);
 
+	/**
+	 * Retrieves the maximum number of messages of the open chat that are completely kept in
+	 * memory.
+	 *
+	 * Other messages are reduced to what is needed for their positions and loaded again from the
+	 * database when they are displayed.
+	 *
+	 * @return the maximum number of messages or 0 for keeping all loaded messages
+	 */
+	int messageWindowSize() const;
+
+	/**
+	 * Stores the maximum number of messages of the open chat that are completely kept in memory.
+	 *
+	 * @param windowSize maximum number of messages or 0 for keeping all loaded messages
+	 */
+	void setMessageWindowSize(int windowSize);
+
+	/**
+	 * Retrieves the maximum number of file thumbnails generated in parallel.
+	 */
+	int maxThumbnailJobs() const;
+
+	/**
+	 * Stores the maximum number of file thumbnails generated in parallel.
+	 */
+	void setMaxThumbnailJobs(int maxThumbnailJobs);
+
 	void remove(const QStringList &keys);
 
 signals:
@@ -116,6 +146,8 @@ signals:
 	void windowPositionChanged();
 	void windowSizeChanged();
 	void automaticMediaDownloadsRuleChanged();
+	void messageWindowSizeChanged();
+	void maxThumbnailJobsChanged();
 
 private:
 	template<typename T>
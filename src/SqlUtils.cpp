@@ -7,15 +7,85 @@
 
 #include "SqlUtils.h"
 // Qt
+#include <QCache>
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QRegularExpression>
 #include <QSqlDriver>
 #include <QSqlError>
 #include <QSqlField>
 #include <QSqlRecord>
+#include <QTextStream>
+// std
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+using namespace std::chrono_literals;
+
+Q_LOGGING_CATEGORY(database_instrumentation, "database.instrumentation", QtMsgType::QtInfoMsg)
+
+// Maximum number of prepared queries cached per thread
+constexpr auto PREPARED_QUERY_CACHE_SIZE = 64;
+// Maximum number of normalized statements cached per thread
+constexpr auto NORMALIZED_STATEMENT_CACHE_SIZE = 1024;
+constexpr std::chrono::nanoseconds DEFAULT_SLOW_QUERY_THRESHOLD = 100ms;
 
 namespace SqlUtils {
 
+static std::atomic<quint64> s_executedQueryCount = 0;
+static std::atomic<quint64> s_cachedQueryCount = 0;
+static std::atomic_bool s_instrumentationEnabled = false;
+static std::atomic<std::chrono::nanoseconds::rep> s_slowQueryThreshold = DEFAULT_SLOW_QUERY_THRESHOLD.count();
+
+struct Instrumentation
+{
+	QMutex mutex;
+	QHash<QString, StatementStatistics> statements;
+	std::array<QueueWaitStatistics, 2> queueWaits;
+};
+
+static Instrumentation &instrumentation()
+{
+	static Instrumentation instrumentation;
+	return instrumentation;
+}
+
+static QCache<QString, QSqlQuery> &preparedQueries()
+{
+	thread_local static QCache<QString, QSqlQuery> preparedQueries(PREPARED_QUERY_CACHE_SIZE);
+	return preparedQueries;
+}
+
+/**
+ * Prepares a query while reusing a cached query with the same statement if possible.
+ *
+ * A cached query is not reused if its result is still being read (e.g., by an outer loop
+ * executing the same statement).
+ */
+static void prepareCachedQuery(QSqlQuery &query, const QString &sql)
+{
+	auto &cache = preparedQueries();
+
+	if (auto *cachedQuery = cache.object(sql); cachedQuery && cachedQuery->driver() == query.driver()) {
+		if (cachedQuery->isActive() && cachedQuery->isSelect() && cachedQuery->at() != QSql::AfterLastRow) {
+			prepareQuery(query, sql);
+		} else {
+			query = *cachedQuery;
+		}
+
+		return;
+	}
+
+	prepareQuery(query, sql);
+	cache.insert(sql, new QSqlQuery(query));
+	s_cachedQueryCount.fetch_add(1, std::memory_order_relaxed);
+}
+
 void prepareQuery(QSqlQuery &query, const QString &sql)
 {
 	if (!query.prepare(sql)) {
@@ -31,11 +101,77 @@ void bindValues(QSqlQuery &query, const std::vector<QueryBindValue> &values)
 	}
 }
 
-void execQuery(QSqlQuery &query)
+static void handleExecutionError(const QSqlQuery &query)
+{
+	qDebug() << "Failed to execute query:" << query.executedQuery();
+	qFatal("QSqlError: %s", qPrintable(query.lastError().text()));
+}
+
+static void recordExecution(const QString &sql, std::chrono::nanoseconds duration, quint64 rowCount)
 {
+	const auto statement = normalizedStatement(sql);
+
+	if (duration.count() >= s_slowQueryThreshold.load(std::memory_order_relaxed)) {
+		qCWarning(database_instrumentation).noquote()
+			<< "Slow query:" << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() << "ms,"
+			<< rowCount << "rows:" << statement;
+	}
+
+	auto &instrumentation = SqlUtils::instrumentation();
+	QMutexLocker locker(&instrumentation.mutex);
+
+	auto &statistics = instrumentation.statements[statement];
+	statistics.statement = statement;
+	statistics.sql = sql;
+	statistics.executionCount++;
+	statistics.totalDuration += duration;
+	statistics.maxDuration = std::max(statistics.maxDuration, duration);
+	statistics.rowCount += rowCount;
+}
+
+static void execInstrumentedQuery(QSqlQuery &query)
+{
+	// The result of a SELECT statement is read completely during the measurement so that the
+	// duration includes reading all rows and the rows can be counted.
+	// Afterwards, the rows are read again from the query's cache, which requires scrolling.
+	const auto forwardOnly = query.isForwardOnly();
+	query.setForwardOnly(false);
+
+	QElapsedTimer timer;
+	timer.start();
+
 	if (!query.exec()) {
-		qDebug() << "Failed to execute query:" << query.executedQuery();
-		qFatal("QSqlError: %s", qPrintable(query.lastError().text()));
+		handleExecutionError(query);
+	}
+
+	quint64 rowCount = 0;
+
+	if (query.isSelect()) {
+		if (query.last()) {
+			rowCount = query.at() + 1;
+		}
+
+		query.seek(QSql::BeforeFirstRow);
+	} else {
+		rowCount = std::max(query.numRowsAffected(), 0);
+	}
+
+	const auto duration = std::chrono::nanoseconds(timer.nsecsElapsed());
+
+	// The option only affects the next execution.
+	query.setForwardOnly(forwardOnly);
+
+	recordExecution(query.lastQuery(), duration, rowCount);
+}
+
+void execQuery(QSqlQuery &query)
+{
+	s_executedQueryCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (s_instrumentationEnabled.load(std::memory_order_relaxed)) {
+		execInstrumentedQuery(query);
+	} else if (!query.exec()) {
+		handleExecutionError(query);
 	}
 }
 
@@ -45,6 +181,190 @@ void execQuery(QSqlQuery &query, const QString &sql)
 	execQuery(query);
 }
 
+void execQuery(QSqlQuery &query, const QString &sql, const std::vector<QueryBindValue> &values)
+{
+	prepareCachedQuery(query, sql);
+	bindValues(query, values);
+	execQuery(query);
+}
+
+quint64 executedQueryCount()
+{
+	return s_executedQueryCount.load(std::memory_order_relaxed);
+}
+
+quint64 cachedQueryCount()
+{
+	return s_cachedQueryCount.load(std::memory_order_relaxed);
+}
+
+QStringList createIdPlaceholders(const QString &name)
+{
+	QStringList placeholders;
+	placeholders.reserve(ID_CHUNK_SIZE);
+
+	for (int i = 0; i < ID_CHUNK_SIZE; i++) {
+		placeholders.append(name + QString::number(i));
+	}
+
+	return placeholders;
+}
+
+const QStringList &idPlaceholders()
+{
+	static const auto placeholders = createIdPlaceholders(QStringLiteral(":id"));
+	return placeholders;
+}
+
+QString placeholderList(const QStringList &placeholders)
+{
+	return placeholders.join(QStringLiteral(", "));
+}
+
+QString idPlaceholderList()
+{
+	return placeholderList(idPlaceholders());
+}
+
+void setInstrumentationEnabled(bool enabled)
+{
+	s_instrumentationEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool isInstrumentationEnabled()
+{
+	return s_instrumentationEnabled.load(std::memory_order_relaxed);
+}
+
+void setSlowQueryThreshold(std::chrono::milliseconds threshold)
+{
+	s_slowQueryThreshold.store(std::chrono::nanoseconds(threshold).count(), std::memory_order_relaxed);
+}
+
+void recordQueueWait(JobQueue queue, std::chrono::nanoseconds wait)
+{
+	auto &instrumentation = SqlUtils::instrumentation();
+	QMutexLocker locker(&instrumentation.mutex);
+
+	auto &statistics = instrumentation.queueWaits[std::size_t(queue)];
+	statistics.jobCount++;
+	statistics.totalWait += wait;
+	statistics.maxWait = std::max(statistics.maxWait, wait);
+}
+
+std::vector<StatementStatistics> statementStatistics()
+{
+	auto &instrumentation = SqlUtils::instrumentation();
+	QMutexLocker locker(&instrumentation.mutex);
+
+	std::vector<StatementStatistics> statistics(instrumentation.statements.cbegin(), instrumentation.statements.cend());
+	locker.unlock();
+
+	std::sort(statistics.begin(), statistics.end(), [](const StatementStatistics &a, const StatementStatistics &b) {
+		return a.totalDuration > b.totalDuration;
+	});
+
+	return statistics;
+}
+
+QueueWaitStatistics queueWaitStatistics(JobQueue queue)
+{
+	auto &instrumentation = SqlUtils::instrumentation();
+	QMutexLocker locker(&instrumentation.mutex);
+	return instrumentation.queueWaits[std::size_t(queue)];
+}
+
+void resetStatistics()
+{
+	auto &instrumentation = SqlUtils::instrumentation();
+	QMutexLocker locker(&instrumentation.mutex);
+	instrumentation.statements.clear();
+	instrumentation.queueWaits = {};
+}
+
+QString statisticsReport()
+{
+	const auto milliseconds = [](std::chrono::nanoseconds duration) {
+		return QString::number(std::chrono::duration<double, std::milli>(duration).count(), 'f', 3);
+	};
+
+	QString report;
+	QTextStream stream(&report);
+
+	stream << "Queue wait (jobs, total ms, mean ms, max ms):\n";
+
+	for (const auto &[queue, name] : { std::pair { JobQueue::Database, "database thread" }, std::pair { JobQueue::Readers, "reader threads" } }) {
+		const auto statistics = queueWaitStatistics(queue);
+		const auto mean = statistics.jobCount ? statistics.totalWait / qint64(statistics.jobCount) : 0ns;
+
+		stream << QStringLiteral("%1 %2 %3 %4  %5\n")
+			.arg(statistics.jobCount, 8)
+			.arg(milliseconds(statistics.totalWait), 12)
+			.arg(milliseconds(mean), 10)
+			.arg(milliseconds(statistics.maxWait), 10)
+			.arg(QLatin1String(name));
+	}
+
+	stream << "\nStatements (executions, total ms, mean ms, max ms, rows):\n";
+
+	for (const auto &statistics : statementStatistics()) {
+		stream << QStringLiteral("%1 %2 %3 %4 %5  %6\n")
+			.arg(statistics.executionCount, 8)
+			.arg(milliseconds(statistics.totalDuration), 12)
+			.arg(milliseconds(statistics.totalDuration / qint64(statistics.executionCount)), 10)
+			.arg(milliseconds(statistics.maxDuration), 10)
+			.arg(statistics.rowCount, 8)
+			.arg(statistics.statement);
+	}
+
+	return report;
+}
+
+QString normalizedStatement(const QString &sql)
+{
+	thread_local static QHash<QString, QString> normalizedStatements;
+
+	if (const auto itr = normalizedStatements.constFind(sql); itr != normalizedStatements.cend()) {
+		return *itr;
+	}
+
+	static const QRegularExpression stringLiteral(QStringLiteral("'(?:[^']|'')*'"));
+	static const QRegularExpression numericLiteral(QStringLiteral("\\b\\d+(?:\\.\\d+)?\\b"));
+	static const QRegularExpression numberedPlaceholder(QStringLiteral("(:[A-Za-z_]+)\\d+\\b"));
+	static const QRegularExpression list(QStringLiteral("(\\?|:[A-Za-z_]+)(?:\\s*,\\s*\\1)+"));
+
+	auto statement = sql.simplified();
+	statement.replace(stringLiteral, QStringLiteral("?"));
+	statement.replace(numericLiteral, QStringLiteral("?"));
+	statement.replace(numberedPlaceholder, QStringLiteral("\\1"));
+	statement.replace(list, QStringLiteral("\\1, ..."));
+
+	// Statements with varying literals would fill the cache without bounds.
+	if (normalizedStatements.size() >= NORMALIZED_STATEMENT_CACHE_SIZE) {
+		normalizedStatements.clear();
+	}
+
+	normalizedStatements.insert(sql, statement);
+	return statement;
+}
+
+void finishCachedQueries()
+{
+	auto &cache = preparedQueries();
+	const auto sqlStatements = cache.keys();
+
+	for (const auto &sql : sqlStatements) {
+		if (auto *query = cache.object(sql); query->isActive()) {
+			query->finish();
+		}
+	}
+}
+
+void clearCachedQueries()
+{
+	preparedQueries().clear();
+}
+
 QSqlField createSqlField(const QString &key, const QVariant &val)
 {
 	QSqlField field(key, val.type());
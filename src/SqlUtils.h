@@ -5,10 +5,13 @@
 
 #pragma once
 
+#include <QStringList>
 #include <QStringView>
 #include <QSqlQuery>
 #include <QVariant>
 
+#include <algorithm>
+#include <chrono>
 #include <optional>
 #include <vector>
 
@@ -54,16 +57,46 @@ void execQuery(QSqlQuery &query, const QString &sql);
  * Prepares an SQL query, binds values by names, executes the query and handles
  * possible errors.
  *
+ * The prepared query is taken from a cache of the current thread's database connection if the
+ * same statement has already been prepared and is not being read at the moment.
+ * Thus, @c query may be replaced by a shared copy of the cached query.
+ *
  * @param query SQL query
  * @param sql SQL statement
  * @param bindValues values to be bound as key-value pairs
  */
-inline void execQuery(QSqlQuery &query, const QString &sql, const std::vector<QueryBindValue> &values)
-{
-	prepareQuery(query, sql);
-	bindValues(query, values);
-	execQuery(query);
-}
+void execQuery(QSqlQuery &query, const QString &sql, const std::vector<QueryBindValue> &values);
+
+/**
+ * Returns the number of queries executed by all threads since the start of the application.
+ *
+ * That can be used to verify how many queries are needed by an operation.
+ */
+quint64 executedQueryCount();
+
+/**
+ * Returns the number of queries prepared and added to the prepared query caches of all threads
+ * since the start of the application.
+ *
+ * That can be used to verify that an operation reuses its cached queries instead of creating new
+ * statements each time.
+ */
+quint64 cachedQueryCount();
+
+/**
+ * Finishes all cached queries of the current thread so that they do not hold read locks
+ * until they are executed the next time.
+ *
+ * That should be called once a database job has been completed.
+ */
+void finishCachedQueries();
+
+/**
+ * Removes all cached queries of the current thread.
+ *
+ * That must be called before the database connection of the current thread is closed.
+ */
+void clearCachedQueries();
 
 /**
  * Creates an SQL field that may be used for an SQL statement.
@@ -105,6 +138,138 @@ std::optional<QDateTime> parseOptDateTime(QSqlQuery &query, int index);
 /// Parse QDateTime from 'INTEGER NOT NULL'
 QDateTime parseDateTime(QSqlQuery &query, int index);
 
+/**
+ * Queue of database jobs whose waiting times are measured by the instrumentation
+ */
+enum class JobQueue {
+	Database, ///< jobs run on the database thread
+	Readers,  ///< jobs run on the reader threads
+};
+
+/**
+ * Statistics of all executions of an SQL statement collected by the instrumentation
+ */
+struct StatementStatistics
+{
+	/// SQL statement whose literals and lists of placeholders are replaced by placeholders
+	QString statement;
+	/// SQL statement of the last execution as passed to the database
+	QString sql;
+	quint64 executionCount = 0;
+	std::chrono::nanoseconds totalDuration = {};
+	std::chrono::nanoseconds maxDuration = {};
+	/// Rows returned by SELECT statements or affected by other statements
+	quint64 rowCount = 0;
+};
+
+/**
+ * Statistics of the time database jobs waited until they were started
+ */
+struct QueueWaitStatistics
+{
+	quint64 jobCount = 0;
+	std::chrono::nanoseconds totalWait = {};
+	std::chrono::nanoseconds maxWait = {};
+};
+
+/**
+ * Enables or disables the instrumentation of queries executed by @c execQuery.
+ *
+ * The instrumentation is disabled by default because it reads the whole result of a query on
+ * execution in order to measure the duration including all rows and to count them.
+ */
+void setInstrumentationEnabled(bool enabled);
+bool isInstrumentationEnabled();
+
+/**
+ * Sets the duration above which an instrumented query is logged as slow.
+ */
+void setSlowQueryThreshold(std::chrono::milliseconds threshold);
+
+/**
+ * Records the time a database job waited until it was started.
+ */
+void recordQueueWait(JobQueue queue, std::chrono::nanoseconds wait);
+
+/**
+ * Returns the statistics of all instrumented statements ordered by their total duration.
+ */
+std::vector<StatementStatistics> statementStatistics();
+QueueWaitStatistics queueWaitStatistics(JobQueue queue);
+void resetStatistics();
+
+/**
+ * Returns all collected statistics as human-readable text.
+ */
+QString statisticsReport();
+
+/**
+ * Normalizes an SQL statement so that all its executions with different literals or lists of
+ * values are recorded together.
+ */
+QString normalizedStatement(const QString &sql);
+
+/// Number of IDs bound to each query executed by execQueryForIdChunks()
+constexpr int ID_CHUNK_SIZE = 50;
+
+/**
+ * Creates the placeholders for the IDs of one chunk.
+ *
+ * @param name name of the placeholders followed by their positions (e.g., ":id" for ":id0")
+ */
+QStringList createIdPlaceholders(const QString &name);
+
+/**
+ * Returns the placeholders ":id0" to ":id49" for the IDs of one chunk.
+ */
+const QStringList &idPlaceholders();
+
+/**
+ * Creates a comma-separated list of placeholders to be used in an SQL statement (e.g., for
+ * "IN").
+ */
+QString placeholderList(const QStringList &placeholders);
+
+/**
+ * Creates a comma-separated list of the placeholders returned by idPlaceholders().
+ */
+QString idPlaceholderList();
+
+/**
+ * Executes a query for each chunk of IDs.
+ *
+ * Each chunk has the same number of placeholders.
+ * The last chunk is padded with NULL values.
+ * That way, all chunks and all calls use the same cached prepared query instead of creating a
+ * new statement for each number of IDs.
+ *
+ * @param query query to be executed
+ * @param statement SQL statement containing the placeholders created by idPlaceholderList()
+ * @param ids IDs to be bound, duplicates are only bound once
+ * @param processResults function called after the query has been executed for a chunk
+ * @param bindValues values bound to each query in addition to the IDs
+ */
+template<typename Ids, typename Function>
+void execQueryForIdChunks(QSqlQuery &query, const QString &statement, Ids ids, Function processResults, std::vector<QueryBindValue> bindValues = {})
+{
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+	const auto &placeholders = idPlaceholders();
+	const auto idBindValueStart = bindValues.size();
+	bindValues.resize(idBindValueStart + ID_CHUNK_SIZE);
+
+	for (int chunkStart = 0; chunkStart < ids.size(); chunkStart += ID_CHUNK_SIZE) {
+		for (int i = 0; i < ID_CHUNK_SIZE; i++) {
+			const auto index = chunkStart + i;
+			bindValues[idBindValueStart + i] = { placeholders.at(i), index < ids.size() ? QVariant(ids.at(index)) : QVariant() };
+		}
+
+		execQuery(query, statement, bindValues);
+		processResults();
+	}
+}
+
 /// Try to reserve space for a query in a container.
 template<typename Container>
 void reserve(Container &container, const QSqlQuery &query)
@@ -0,0 +1,101 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ThumbnailImageProvider.h"
+
+// Qt
+#include <QMutexLocker>
+#include <QQuickTextureFactory>
+// Kaidan
+#include "FutureUtils.h"
+#include "MessageDb.h"
+
+// Maximum size of all cached thumbnails in KiB
+constexpr int MAX_CACHE_COST = 4 * 1024;
+
+const auto SQUARE_SUFFIX = QStringLiteral("/square");
+
+class ThumbnailImageResponse : public QQuickImageResponse
+{
+public:
+	QQuickTextureFactory *textureFactory() const override
+	{
+		return QQuickTextureFactory::textureFactoryForImage(m_image);
+	}
+
+	/**
+	 * Sets the provided image and emits finished() after returning to the event loop.
+	 *
+	 * The signal must not be emitted before the response is returned by the provider.
+	 */
+	void finish(const QImage &image, bool square, const QSize &requestedSize)
+	{
+		m_image = image;
+
+		if (square) {
+			const auto length = std::min(m_image.width(), m_image.height());
+			m_image = m_image.copy((m_image.width() - length) / 2, (m_image.height() - length) / 2, length, length);
+		}
+
+		if (requestedSize.isValid()) {
+			m_image = m_image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		}
+
+		QMetaObject::invokeMethod(this, &QQuickImageResponse::finished, Qt::QueuedConnection);
+	}
+
+private:
+	QImage m_image;
+};
+
+ThumbnailImageProvider::ThumbnailImageProvider()
+	: m_cache(MAX_CACHE_COST)
+{
+}
+
+QQuickImageResponse *ThumbnailImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+	const auto square = id.endsWith(SQUARE_SUFFIX);
+	const auto fileId = (square ? id.chopped(SQUARE_SUFFIX.size()) : id).toLongLong();
+
+	auto *response = new ThumbnailImageResponse;
+
+	if (auto image = cachedImage(fileId)) {
+		response->finish(*image, square, requestedSize);
+		return response;
+	}
+
+	await(MessageDb::instance()->fetchThumbnail(fileId), response, [this, response, fileId, square, requestedSize](QByteArray &&data) {
+		// The image is decoded on the thread of the response instead of the database thread.
+		const auto image = QImage::fromData(data);
+
+		if (!image.isNull()) {
+			cacheImage(fileId, image);
+		}
+
+		response->finish(image, square, requestedSize);
+	});
+
+	return response;
+}
+
+std::optional<QImage> ThumbnailImageProvider::cachedImage(qint64 fileId)
+{
+	QMutexLocker locker(&m_cacheMutex);
+
+	// QCache::object() marks the image as the most recently used one.
+	if (const auto *image = m_cache.object(fileId)) {
+		return *image;
+	}
+
+	return {};
+}
+
+void ThumbnailImageProvider::cacheImage(qint64 fileId, const QImage &image)
+{
+	QMutexLocker locker(&m_cacheMutex);
+
+	// The least recently used images are removed if the maximum cost would be exceeded.
+	m_cache.insert(fileId, new QImage(image), std::max(1, int(image.sizeInBytes() / 1024)));
+}
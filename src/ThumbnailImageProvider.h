@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+// std
+#include <optional>
+// Qt
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QQuickAsyncImageProvider>
+
+/**
+ * Provider for the thumbnails of files stored in the database
+ *
+ * The thumbnails are not part of the files fetched with their messages.
+ * Instead, they are read from the database when they are displayed via File::thumbnailUrl().
+ * The decoded thumbnails that were requested last are cached.
+ *
+ * @note This class is thread-safe.
+ */
+class ThumbnailImageProvider : public QQuickAsyncImageProvider
+{
+public:
+	ThumbnailImageProvider();
+
+	/**
+	 * Creates a response providing a thumbnail from the cache or the database.
+	 *
+	 * @param id file ID optionally followed by "/square" for a square thumbnail
+	 * @param requestedSize size the image should be scaled to. If this is invalid the image
+	 * is not scaled.
+	 */
+	QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+	std::optional<QImage> cachedImage(qint64 fileId);
+	void cacheImage(qint64 fileId, const QImage &image);
+
+	QMutex m_cacheMutex;
+	QCache<qint64, QImage> m_cache;
+};
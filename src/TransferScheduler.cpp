@@ -0,0 +1,254 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "TransferScheduler.h"
+
+// std
+#include <algorithm>
+// Qt
+#include <QMutexLocker>
+
+// Maximum number of transfers running in parallel by default
+constexpr int DEFAULT_MAX_TRANSFERS = 4;
+
+// Maximum number of transfers running in parallel per host by default
+constexpr int DEFAULT_MAX_TRANSFERS_PER_HOST = 2;
+
+TransferHandle::TransferHandle(TransferScheduler *scheduler, qint64 fileId)
+	: m_scheduler(scheduler), m_fileId(fileId)
+{
+}
+
+qint64 TransferHandle::fileId() const
+{
+	return m_fileId;
+}
+
+void TransferHandle::setCanceller(std::function<void()> canceller)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if (m_cancelled) {
+		locker.unlock();
+		canceller();
+		return;
+	}
+
+	m_canceller = std::move(canceller);
+}
+
+bool TransferHandle::isCancelled() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_cancelled;
+}
+
+void TransferHandle::finish()
+{
+	{
+		QMutexLocker locker(&m_mutex);
+
+		if (m_finished) {
+			return;
+		}
+
+		m_finished = true;
+		m_canceller = {};
+	}
+
+	if (auto *scheduler = m_scheduler.data()) {
+		QMetaObject::invokeMethod(scheduler, [scheduler = m_scheduler, handle = shared_from_this()]() {
+			if (scheduler) {
+				scheduler->finish(handle);
+			}
+		});
+	}
+}
+
+void TransferHandle::cancel()
+{
+	std::function<void()> canceller;
+
+	{
+		QMutexLocker locker(&m_mutex);
+
+		if (m_cancelled || m_finished) {
+			return;
+		}
+
+		m_cancelled = true;
+		canceller = std::move(m_canceller);
+	}
+
+	// The canceller is called without the lock because it may finish the transfer.
+	if (canceller) {
+		canceller();
+	}
+}
+
+TransferScheduler::TransferScheduler(QObject *parent)
+	: QObject(parent),
+	  m_maxTransfers(DEFAULT_MAX_TRANSFERS),
+	  m_maxTransfersPerHost(DEFAULT_MAX_TRANSFERS_PER_HOST)
+{
+}
+
+TransferScheduler::~TransferScheduler() = default;
+
+int TransferScheduler::maxTransfers() const
+{
+	return m_maxTransfers;
+}
+
+void TransferScheduler::setMaxTransfers(int maxTransfers)
+{
+	m_maxTransfers = std::max(1, maxTransfers);
+	startTransfers();
+}
+
+int TransferScheduler::maxTransfersPerHost() const
+{
+	return m_maxTransfersPerHost;
+}
+
+void TransferScheduler::setMaxTransfersPerHost(int maxTransfersPerHost)
+{
+	m_maxTransfersPerHost = std::max(1, maxTransfersPerHost);
+	startTransfers();
+}
+
+bool TransferScheduler::schedule(qint64 fileId, const QString &host, Priority priority, Starter start)
+{
+	if (m_runningTransfers.contains(fileId)) {
+		return false;
+	}
+
+	const auto pendingTransfer = std::find_if(m_pendingTransfers.begin(), m_pendingTransfers.end(), [fileId](const Transfer &transfer) {
+		return transfer.fileId == fileId;
+	});
+
+	if (pendingTransfer != m_pendingTransfers.end()) {
+		pendingTransfer->priority = std::min(pendingTransfer->priority, priority);
+		return false;
+	}
+
+	m_pendingTransfers.push_back(Transfer {
+		fileId,
+		host,
+		priority,
+		m_nextSequenceNumber++,
+		std::move(start),
+		std::make_shared<TransferHandle>(this, fileId),
+	});
+
+	startTransfers();
+	return true;
+}
+
+bool TransferScheduler::contains(qint64 fileId) const
+{
+	return isRunning(fileId) || std::any_of(m_pendingTransfers.cbegin(), m_pendingTransfers.cend(), [fileId](const Transfer &transfer) {
+		return transfer.fileId == fileId;
+	});
+}
+
+bool TransferScheduler::isRunning(qint64 fileId) const
+{
+	return m_runningTransfers.contains(fileId);
+}
+
+void TransferScheduler::setVisible(qint64 fileId, bool visible)
+{
+	if (visible) {
+		++m_visibleFileCounts[fileId];
+	} else if (auto count = m_visibleFileCounts.find(fileId); count != m_visibleFileCounts.end() && --*count == 0) {
+		m_visibleFileCounts.erase(count);
+	}
+}
+
+void TransferScheduler::cancel(qint64 fileId)
+{
+	if (const auto runningTransfer = m_runningTransfers.constFind(fileId); runningTransfer != m_runningTransfers.cend()) {
+		// The transfer is removed as soon as it reports that it finished.
+		runningTransfer->handle->cancel();
+		return;
+	}
+
+	const auto pendingTransfer = std::find_if(m_pendingTransfers.begin(), m_pendingTransfers.end(), [fileId](const Transfer &transfer) {
+		return transfer.fileId == fileId;
+	});
+
+	if (pendingTransfer != m_pendingTransfers.end()) {
+		auto transfer = std::move(*pendingTransfer);
+		m_pendingTransfers.erase(pendingTransfer);
+
+		// The transfer is started despite the limits so that it can report its cancellation.
+		transfer.handle->cancel();
+		start(std::move(transfer));
+	}
+}
+
+TransferScheduler::Priority TransferScheduler::effectivePriority(const Transfer &transfer) const
+{
+	return m_visibleFileCounts.contains(transfer.fileId) ? Priority::Visible : transfer.priority;
+}
+
+void TransferScheduler::startTransfers()
+{
+	while (m_runningTransfers.size() < m_maxTransfers) {
+		auto nextTransfer = m_pendingTransfers.end();
+
+		for (auto transfer = m_pendingTransfers.begin(); transfer != m_pendingTransfers.end(); ++transfer) {
+			if (m_runningTransferCounts.value(transfer->host) >= m_maxTransfersPerHost) {
+				continue;
+			}
+
+			if (nextTransfer == m_pendingTransfers.end() ||
+				std::pair(effectivePriority(*transfer), transfer->sequenceNumber) < std::pair(effectivePriority(*nextTransfer), nextTransfer->sequenceNumber)) {
+				nextTransfer = transfer;
+			}
+		}
+
+		if (nextTransfer == m_pendingTransfers.end()) {
+			return;
+		}
+
+		auto transfer = std::move(*nextTransfer);
+		m_pendingTransfers.erase(nextTransfer);
+
+		++m_runningTransferCounts[transfer.host];
+		start(std::move(transfer));
+	}
+}
+
+void TransferScheduler::start(Transfer &&transfer)
+{
+	const auto fileId = transfer.fileId;
+	const auto handle = transfer.handle;
+	const auto start = transfer.start;
+
+	// Cancelled transfers are not counted as running.
+	if (!handle->isCancelled()) {
+		m_runningTransfers.insert(fileId, std::move(transfer));
+	}
+
+	start(handle);
+}
+
+void TransferScheduler::finish(const std::shared_ptr<TransferHandle> &handle)
+{
+	const auto transfer = m_runningTransfers.find(handle->fileId());
+
+	// Transfers cancelled before being started are not running.
+	if (transfer == m_runningTransfers.end() || transfer->handle != handle) {
+		return;
+	}
+
+	if (auto count = m_runningTransferCounts.find(transfer->host); --*count == 0) {
+		m_runningTransferCounts.erase(count);
+	}
+
+	m_runningTransfers.erase(transfer);
+	startTransfers();
+}
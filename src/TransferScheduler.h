@@ -0,0 +1,169 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+// std
+#include <functional>
+#include <memory>
+#include <vector>
+// Qt
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+
+class TransferScheduler;
+
+/**
+ * Handle of a scheduled transfer shared between the scheduler and the code performing the transfer
+ *
+ * @note This class is thread-safe.
+ */
+class TransferHandle : public std::enable_shared_from_this<TransferHandle>
+{
+public:
+	TransferHandle(TransferScheduler *scheduler, qint64 fileId);
+
+	qint64 fileId() const;
+
+	/**
+	 * Sets the function that cancels the running transfer.
+	 *
+	 * If the transfer has already been cancelled, the function is called immediately.
+	 */
+	void setCanceller(std::function<void()> canceller);
+
+	/**
+	 * Returns whether the transfer has been cancelled.
+	 *
+	 * Transfers cancelled before they were started are still started so that their code can
+	 * report the cancellation.
+	 * They should finish immediately.
+	 */
+	bool isCancelled() const;
+
+	/**
+	 * Informs the scheduler that the transfer is finished so that the next one can be started.
+	 *
+	 * This must be called once for each started transfer, no matter whether it succeeded.
+	 */
+	void finish();
+
+private:
+	friend class TransferScheduler;
+
+	void cancel();
+
+	QPointer<TransferScheduler> m_scheduler;
+	const qint64 m_fileId;
+
+	mutable QMutex m_mutex;
+	bool m_cancelled = false;
+	bool m_finished = false;
+	std::function<void()> m_canceller;
+};
+
+/**
+ * Scheduler limiting the number of file transfers running in parallel
+ *
+ * Transfers are started in the order of their priority and, for the same priority, in the order
+ * of their scheduling.
+ * The number of running transfers is limited overall and per host.
+ *
+ * All methods must be called on the scheduler's thread.
+ */
+class TransferScheduler : public QObject
+{
+	Q_OBJECT
+
+public:
+	/**
+	 * Priority of a transfer, from the highest to the lowest one
+	 */
+	enum class Priority {
+		// The file is displayed to the user.
+		Visible,
+		// The user requested the transfer.
+		UserInitiated,
+		// The transfer was started automatically (e.g., an automatic download).
+		Automatic,
+	};
+
+	using Starter = std::function<void(std::shared_ptr<TransferHandle> handle)>;
+
+	explicit TransferScheduler(QObject *parent = nullptr);
+	~TransferScheduler() override;
+
+	int maxTransfers() const;
+	void setMaxTransfers(int maxTransfers);
+
+	int maxTransfersPerHost() const;
+	void setMaxTransfersPerHost(int maxTransfersPerHost);
+
+	/**
+	 * Schedules a transfer.
+	 *
+	 * If a transfer of the file is already scheduled, only its priority is raised if the new
+	 * priority is higher.
+	 *
+	 * @param fileId ID of the transferred file
+	 * @param host host the file is transferred from or to
+	 * @param priority priority of the transfer
+	 * @param start function starting the transfer, which is called on the scheduler's thread
+	 *
+	 * @return whether the transfer was scheduled
+	 */
+	bool schedule(qint64 fileId, const QString &host, Priority priority, Starter start);
+
+	/**
+	 * Returns whether a transfer of a file is pending or running.
+	 */
+	bool contains(qint64 fileId) const;
+
+	/**
+	 * Returns whether a transfer of a file is running.
+	 */
+	bool isRunning(qint64 fileId) const;
+
+	/**
+	 * Sets whether a file is visible to the user.
+	 *
+	 * Pending transfers of visible files are started before all others.
+	 */
+	void setVisible(qint64 fileId, bool visible);
+
+	/**
+	 * Cancels a pending or running transfer.
+	 */
+	void cancel(qint64 fileId);
+
+private:
+	friend class TransferHandle;
+
+	struct Transfer
+	{
+		qint64 fileId;
+		QString host;
+		Priority priority;
+		// number for starting transfers of the same priority in the order of their scheduling
+		quint64 sequenceNumber;
+		Starter start;
+		std::shared_ptr<TransferHandle> handle;
+	};
+
+	Priority effectivePriority(const Transfer &transfer) const;
+	void startTransfers();
+	void start(Transfer &&transfer);
+	void finish(const std::shared_ptr<TransferHandle> &handle);
+
+	int m_maxTransfers;
+	int m_maxTransfersPerHost;
+	quint64 m_nextSequenceNumber = 0;
+
+	std::vector<Transfer> m_pendingTransfers;
+	QHash<qint64, Transfer> m_runningTransfers;
+	QHash<QString, int> m_runningTransferCounts;
+	QHash<qint64, int> m_visibleFileCounts;
+};
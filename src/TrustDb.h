@@ -93,7 +93,7 @@ private:
 	template<typename Functor>
 	auto runTask(Functor function) const
 	{
-		return runAsyncTask(m_xmppContext, dbWorker(), function);
+		return runAsyncTask(m_xmppContext, dbWorker(), finishingCachedQueries(std::move(function)));
 	}
 
 	auto insertKeys(std::vector<Key> &&) -> QXmppTask<void>;
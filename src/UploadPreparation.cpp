@@ -0,0 +1,284 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "UploadPreparation.h"
+
+// std
+#include <array>
+#include <chrono>
+#include <memory>
+// Qt
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QLoggingCategory>
+#include <QMimeDatabase>
+#include <QPainter>
+#include <QPixmap>
+#include <QtConcurrent>
+// KDE
+#include <KFileItem>
+#include <KIO/PreviewJob>
+// Kaidan
+#include "FutureUtils.h"
+#include "Globals.h"
+
+Q_LOGGING_CATEGORY(uploadPreparation_thumbnails, "upload-preparation.thumbnails", QtMsgType::QtWarningMsg)
+
+using Clock = std::chrono::steady_clock;
+
+// Qualities tried one after another until an encoded thumbnail is small enough
+constexpr std::array THUMBNAIL_JPEG_QUALITIES = { JPEG_EXPORT_QUALITY, 70, 50, 30 };
+
+static double millisecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static QXmppFileSharingManager::MetadataThumbnail toMetadataThumbnail(const UploadPreparation::Thumbnail &thumbnail)
+{
+	return QXmppFileSharingManager::MetadataThumbnail {
+		.width = uint32_t(thumbnail.size.width()),
+		.height = uint32_t(thumbnail.size.height()),
+		.data = thumbnail.data,
+		.mimeType = thumbnail.mimeType,
+	};
+}
+
+UploadPreparation &UploadPreparation::instance()
+{
+	static UploadPreparation preparation;
+	return preparation;
+}
+
+int UploadPreparation::maxThumbnailJobs() const
+{
+	return m_maxThumbnailJobs;
+}
+
+void UploadPreparation::setMaxThumbnailJobs(int maxThumbnailJobs)
+{
+	m_maxThumbnailJobs = std::max(1, maxThumbnailJobs);
+	m_pool.setMaxThreadCount(m_maxThumbnailJobs);
+}
+
+QFuture<std::optional<UploadPreparation::Thumbnail>> UploadPreparation::generateImageThumbnail(const QString &filePath, int maxLength, ThumbnailDataSize dataSize)
+{
+	const auto requestTime = Clock::now();
+
+	return QtConcurrent::run(&m_pool, [filePath, maxLength, dataSize, requestTime]() {
+		qCDebug(uploadPreparation_thumbnails, "Waited %.1f ms to generate thumbnail of %s", millisecondsSince(requestTime), qUtf8Printable(filePath));
+		return createImageThumbnail(filePath, maxLength, dataSize);
+	});
+}
+
+QFuture<UploadPreparation::Thumbnail> UploadPreparation::encodeThumbnail(const QImage &image, ThumbnailDataSize dataSize)
+{
+	const auto requestTime = Clock::now();
+
+	return QtConcurrent::run(&m_pool, [image, dataSize, requestTime]() {
+		const auto encodingStart = Clock::now();
+		auto thumbnail = compressThumbnail(image, dataSize);
+
+		qCDebug(
+			uploadPreparation_thumbnails,
+			"Waited %.1f ms to encode thumbnail, encoded %d bytes in %.1f ms",
+			std::chrono::duration<double, std::milli>(encodingStart - requestTime).count(),
+			int(thumbnail.data.size()),
+			millisecondsSince(encodingStart)
+		);
+
+		return thumbnail;
+	});
+}
+
+std::optional<UploadPreparation::Thumbnail> UploadPreparation::createImageThumbnail(const QString &filePath, int maxLength, ThumbnailDataSize dataSize, ThumbnailStageDurations *durations)
+{
+	ThumbnailStageDurations stageDurations;
+	const auto decodingStart = Clock::now();
+
+	QImageReader reader(filePath);
+	reader.setAutoTransform(true);
+
+	// The size is read from the header of the image without decoding it.
+	// If the image is larger than the thumbnail, it is scaled while it is decoded.
+	// Formats such as JPEG decode only the data needed for the scaled size so that a large photo
+	// is never decoded completely.
+	auto imageSize = reader.size();
+
+	if (imageSize.isValid()) {
+		if (imageSize.width() > maxLength || imageSize.height() > maxLength) {
+			reader.setScaledSize(imageSize.scaled(maxLength, maxLength, Qt::KeepAspectRatio).expandedTo({ 1, 1 }));
+		}
+	} else if (QFileInfo(filePath).size() > THUMBNAIL_GENERATION_MAX_FILE_SIZE) {
+		// An image whose size is unknown would need to be decoded completely.
+		qCDebug(uploadPreparation_thumbnails, "Skipped thumbnail of %s with unknown size", qUtf8Printable(filePath));
+		return {};
+	}
+
+	auto image = reader.read();
+	const auto scalingStart = Clock::now();
+	stageDurations.decoding = scalingStart - decodingStart;
+
+	if (image.isNull()) {
+		qCDebug(uploadPreparation_thumbnails, "Could not decode %s: %s", qUtf8Printable(filePath), qUtf8Printable(reader.errorString()));
+		return {};
+	}
+
+	if (imageSize.isValid()) {
+		// The size from the header does not include the orientation applied while decoding.
+		if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+			imageSize.transpose();
+		}
+	} else {
+		imageSize = image.size();
+
+		if (imageSize.width() > maxLength || imageSize.height() > maxLength) {
+			image = image.scaled(maxLength, maxLength, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		}
+	}
+
+	const auto encodingStart = Clock::now();
+	stageDurations.scaling = encodingStart - scalingStart;
+
+	auto thumbnail = compressThumbnail(image, dataSize);
+	stageDurations.encoding = Clock::now() - encodingStart;
+
+	qCDebug(
+		uploadPreparation_thumbnails,
+		"Decoded %s (%dx%d) in %.1f ms, scaled it in %.1f ms, encoded %d bytes in %.1f ms",
+		qUtf8Printable(filePath),
+		imageSize.width(),
+		imageSize.height(),
+		stageDurations.decoding.count(),
+		stageDurations.scaling.count(),
+		int(thumbnail.data.size()),
+		stageDurations.encoding.count()
+	);
+
+	if (durations) {
+		*durations = stageDurations;
+	}
+
+	if (thumbnail.data.isEmpty()) {
+		return {};
+	}
+
+	thumbnail.imageSize = imageSize;
+	return thumbnail;
+}
+
+UploadPreparation::Thumbnail UploadPreparation::compressThumbnail(const QImage &image, ThumbnailDataSize dataSize)
+{
+	// JPEG is used because it is much smaller than PNG for photos and all clients can decode it.
+	// Since JPEG has no alpha channel, transparent areas are filled with white instead of black.
+	auto opaqueImage = image;
+
+	if (image.hasAlphaChannel()) {
+		opaqueImage = QImage(image.size(), QImage::Format_RGB32);
+		opaqueImage.fill(Qt::white);
+
+		QPainter painter(&opaqueImage);
+		painter.drawImage(0, 0, image);
+	}
+
+	QByteArray data;
+
+	while (!opaqueImage.isNull()) {
+		for (const auto quality : THUMBNAIL_JPEG_QUALITIES) {
+			data.clear();
+			QBuffer buffer(&data);
+
+			if (!opaqueImage.save(&buffer, "JPG", quality)) {
+				qWarning() << "[UploadPreparation] Could not encode thumbnail";
+				return {};
+			}
+
+			// Without a limit, the image is encoded only once with the highest quality.
+			if (dataSize == ThumbnailDataSize::Unlimited || data.size() <= MAX_THUMBNAIL_DATA_SIZE) {
+				return Thumbnail { data, QMimeDatabase().mimeTypeForName(QStringLiteral("image/jpeg")), opaqueImage.size(), {} };
+			}
+		}
+
+		// Even the lowest quality is too large for the current size.
+		if (opaqueImage.width() == 1 && opaqueImage.height() == 1) {
+			break;
+		}
+
+		opaqueImage = opaqueImage.scaled((opaqueImage.size() / 2).expandedTo({ 1, 1 }), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+	}
+
+	return {};
+}
+
+QFuture<std::shared_ptr<QXmppFileSharingManager::MetadataGeneratorResult>> UploadPreparation::generateMetadata(std::unique_ptr<QIODevice> device)
+{
+	using Result = QXmppFileSharingManager::MetadataGeneratorResult;
+
+	thread_local static auto allPlugins = KIO::PreviewJob::availablePlugins();
+
+	auto result = std::make_shared<Result>();
+
+	auto *file = dynamic_cast<QFile *>(device.get());
+	if (!file) {
+		// other io devices can't be handled
+		return makeReadyFuture<std::shared_ptr<Result>>(std::move(result));
+	}
+
+	QFutureInterface<std::shared_ptr<Result>> interface;
+	const auto filePath = file->fileName();
+
+	// Images are decoded by the thread pool, which also provides their dimensions.
+	// The MIME type is determined by the file name so that the file is not read for it.
+	const auto mimeType = QMimeDatabase().mimeTypeForFile(filePath, QMimeDatabase::MatchExtension);
+
+	if (QImageReader::supportedMimeTypes().contains(mimeType.name().toUtf8())) {
+		await(instance().generateImageThumbnail(filePath, THUMBNAIL_PIXEL_SIZE), file, [interface, result, device = std::move(device)](const std::optional<Thumbnail> &thumbnail) mutable {
+			if (thumbnail) {
+				result->dimensions = thumbnail->imageSize;
+				result->thumbnails.push_back(toMetadataThumbnail(*thumbnail));
+			}
+
+			result->dataDevice = std::move(device);
+			reportFinishedResult(interface, result);
+		});
+
+		return interface.future();
+	}
+
+	// Previews of other files such as videos are created by KIO and encoded by the thread pool.
+	auto *job = new KIO::PreviewJob(
+		{ KFileItem(QUrl::fromLocalFile(filePath)) },
+		QSize(THUMBNAIL_PIXEL_SIZE, THUMBNAIL_PIXEL_SIZE),
+		&allPlugins
+	);
+	job->setAutoDelete(true);
+
+	QObject::connect(job, &KIO::PreviewJob::gotPreview, [interface, result, device = std::move(device)](const KFileItem &, const QPixmap &preview) mutable {
+		auto *file = device.get();
+
+		await(instance().encodeThumbnail(preview.toImage()), file, [interface, result, device = std::move(device)](const Thumbnail &thumbnail) mutable {
+			if (!thumbnail.data.isEmpty()) {
+				result->thumbnails.push_back(toMetadataThumbnail(thumbnail));
+			}
+
+			result->dataDevice = std::move(device);
+			reportFinishedResult(interface, result);
+		});
+	});
+
+	QObject::connect(job, &KIO::PreviewJob::failed, [interface, result]() mutable {
+		reportFinishedResult(interface, result);
+	});
+
+	return interface.future();
+}
+
+UploadPreparation::UploadPreparation()
+	: m_maxThumbnailJobs(DEFAULT_MAX_THUMBNAIL_JOBS)
+{
+	m_pool.setMaxThreadCount(m_maxThumbnailJobs);
+}
@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+// std
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+// Qt
+#include <QFuture>
+#include <QMimeType>
+#include <QSize>
+#include <QThreadPool>
+// QXmpp
+#include <QXmppFileSharingManager.h>
+
+class QImage;
+class QIODevice;
+
+/**
+ * Preparation of files before they are uploaded
+ *
+ * Thumbnails are generated on a thread pool with a bounded number of threads so that generating
+ * many thumbnails does not occupy all cores.
+ * Images are decoded only once and already scaled down while decoding if the image format supports
+ * it.
+ * The thumbnails are encoded as JPEG images.
+ * Thumbnails sent with files are limited in size while local previews keep their quality.
+ * The time spent by each stage is logged via the category "upload-preparation.thumbnails" and can be
+ * retrieved by createImageThumbnail().
+ *
+ * @note This class is thread-safe.
+ */
+class UploadPreparation
+{
+public:
+	/**
+	 * Thumbnail encoded in a compact format
+	 */
+	struct Thumbnail
+	{
+		QByteArray data;
+		QMimeType mimeType;
+		QSize size;
+		/// size of the original image or an invalid size if it is not known
+		QSize imageSize;
+	};
+
+	/**
+	 * Time spent by each stage of generating a thumbnail
+	 */
+	struct ThumbnailStageDurations
+	{
+		/// reading the image including scaling it while decoding if the format supports it
+		std::chrono::duration<double, std::milli> decoding {};
+		/// scaling the decoded image if it could not be scaled while decoding
+		std::chrono::duration<double, std::milli> scaling {};
+		/// encoding the thumbnail including reducing its quality and size
+		std::chrono::duration<double, std::milli> encoding {};
+	};
+
+	/**
+	 * Limit of the size of an encoded thumbnail
+	 */
+	enum class ThumbnailDataSize {
+		Limited,   ///< at most MAX_THUMBNAIL_DATA_SIZE bytes so that it can be embedded into a message
+		Unlimited, ///< no limit for previews that are only displayed locally
+	};
+
+	static UploadPreparation &instance();
+
+	/**
+	 * Returns the maximum number of thumbnails generated in parallel.
+	 */
+	int maxThumbnailJobs() const;
+
+	/**
+	 * Sets the maximum number of thumbnails generated in parallel, which is the number of threads
+	 * of the thread pool.
+	 *
+	 * @param maxThumbnailJobs maximum number of thumbnails, at least 1
+	 */
+	void setMaxThumbnailJobs(int maxThumbnailJobs);
+
+	/**
+	 * Generates a thumbnail of an image file.
+	 *
+	 * @param filePath path of the image file
+	 * @param maxLength maximum width and height of the thumbnail
+	 * @param dataSize whether the encoded thumbnail is limited in size
+	 *
+	 * @return the thumbnail including the size of the image or an empty optional if the image
+	 *         could not be decoded
+	 */
+	QFuture<std::optional<Thumbnail>> generateImageThumbnail(const QString &filePath, int maxLength, ThumbnailDataSize dataSize = ThumbnailDataSize::Limited);
+
+	/**
+	 * Encodes an already scaled image, e.g., a preview of a video, as a thumbnail.
+	 */
+	QFuture<Thumbnail> encodeThumbnail(const QImage &image, ThumbnailDataSize dataSize = ThumbnailDataSize::Limited);
+
+	/**
+	 * Decodes an image file scaled down to a maximum size and encodes it as a thumbnail.
+	 *
+	 * @param durations if not null, set to the time spent by each stage
+	 */
+	static std::optional<Thumbnail> createImageThumbnail(const QString &filePath, int maxLength, ThumbnailDataSize dataSize = ThumbnailDataSize::Limited, ThumbnailStageDurations *durations = nullptr);
+
+	/**
+	 * Encodes an image as a thumbnail.
+	 *
+	 * If the size is limited, the quality and, if needed, the size of the image are reduced until
+	 * the encoded image has at most MAX_THUMBNAIL_DATA_SIZE bytes.
+	 */
+	static Thumbnail compressThumbnail(const QImage &image, ThumbnailDataSize dataSize = ThumbnailDataSize::Limited);
+
+	/**
+	 * Generates the metadata of a file to be shared including its thumbnail.
+	 *
+	 * This is used as the metadata generator of QXmppFileSharingManager.
+	 */
+	static QFuture<std::shared_ptr<QXmppFileSharingManager::MetadataGeneratorResult>> generateMetadata(std::unique_ptr<QIODevice> device);
+
+private:
+	UploadPreparation();
+
+	QThreadPool m_pool;
+	std::atomic<int> m_maxThumbnailJobs;
+};
@@ -79,7 +79,9 @@
 #include "RosterManager.h"
 #include "RosterModel.h"
 #include "ServerFeaturesCache.h"
+#include "SqlUtils.h"
 #include "StatusBar.h"
+#include "ThumbnailImageProvider.h"
 #include "UserDevicesModel.h"
 #include "VCardManager.h"
 #include "VCardModel.h"
@@ -148,6 +150,8 @@ CommandLineParseResult parseCommandLine(QCommandLineParser &parser, QString *err
 	QCommandLineOption helpOption = parser.addHelpOption();
 	QCommandLineOption versionOption = parser.addVersionOption();
 	parser.addOption({"disable-xml-log", "Disable output of full XMPP XML stream."});
+	parser.addOption({"database-statistics", "Collect statistics about database queries, show them in the settings and print them on exit."});
+	parser.addOption({"slow-query-threshold", "Log database queries taking longer than <milliseconds> (requires --database-statistics).", "milliseconds"});
 #ifndef NDEBUG
 	parser.addOption({{"m", "multiple"}, "Allow multiple instances to be started."});
 #endif
@@ -166,6 +170,17 @@ CommandLineParseResult parseCommandLine(QCommandLineParser &parser, QString *err
 
 	if (parser.isSet(helpOption))
 		return CommandLineHelpRequested;
+
+	if (parser.isSet("slow-query-threshold")) {
+		bool ok = false;
+		const auto threshold = parser.value("slow-query-threshold").toInt(&ok);
+
+		if (!ok || threshold < 0) {
+			*errorMessage = QStringLiteral("The slow query threshold must be a non-negative number of milliseconds.");
+			return CommandLineError;
+		}
+	}
+
 	// if nothing special happened, return OK
 	return CommandLineOk;
 }
@@ -359,6 +374,15 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
 	}
 #endif
 
+	if (parser.isSet("database-statistics")) {
+		SqlUtils::setInstrumentationEnabled(true);
+		QmlUtils::setDatabaseStatisticsAvailable(true);
+
+		if (parser.isSet("slow-query-threshold")) {
+			SqlUtils::setSlowQueryThreshold(std::chrono::milliseconds(parser.value("slow-query-threshold").toInt()));
+		}
+	}
+
 	//
 	// Kaidan back-end
 	//
@@ -385,6 +409,7 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
 	QQmlApplicationEngine engine;
 
 	engine.addImageProvider(QLatin1String(BITS_OF_BINARY_IMAGE_PROVIDER_NAME), BitsOfBinaryImageProvider::instance());
+	engine.addImageProvider(QLatin1String(THUMBNAIL_IMAGE_PROVIDER_NAME), new ThumbnailImageProvider);
 
 	// QtQuickControls2 Style
 	if (qEnvironmentVariableIsEmpty("QT_QUICK_CONTROLS_STYLE")) {
@@ -512,5 +537,11 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
 #endif
 
 	// enter qt main loop
-	return app.exec();
+	const auto exitCode = app.exec();
+
+	if (parser.isSet("database-statistics")) {
+		qInfo().noquote() << SqlUtils::statisticsReport();
+	}
+
+	return exitCode;
 }
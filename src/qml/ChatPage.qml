@@ -230,7 +230,11 @@ ChatPageBase {
 		// Connect to the database,
 		model: MessageModel
 
-		visibleArea.onYPositionChanged: handleMessageRead()
+		visibleArea.onYPositionChanged: {
+			handleMessageRead()
+			updateVisibleRange()
+		}
+		onHeightChanged: updateVisibleRange()
 		onActiveFocusChanged: {
 			// This makes it possible on desktop devices to directly enter a message after opening
 			// the chat page.
@@ -298,6 +302,13 @@ ChatPageBase {
 			}
 		}
 
+		/**
+		 * Passes the displayed messages to the model so that the messages around them are loaded.
+		 */
+		function updateVisibleRange() {
+			MessageModel.setVisibleRange(indexAt(0, contentY + height - 1), indexAt(0, contentY))
+		}
+
 		ChatMessageContextMenu {
 			id: messageContextMenu
 		}
@@ -50,6 +50,17 @@ Controls.Menu {
 		}
 	}
 
+	Controls.MenuItem {
+		text: qsTr("Cancel transfer")
+		visible: root.file && transferWatcher.isLoading
+		onTriggered: Kaidan.fileSharingController.cancelTransfer(root.file)
+
+		FileProgressWatcher {
+			id: transferWatcher
+			fileId: root.file ? root.file.fileId : ""
+		}
+	}
+
 	Controls.MenuItem {
 		text: qsTr("Delete file")
 		visible: root.file && root.file.localFilePath
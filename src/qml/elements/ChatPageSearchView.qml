@@ -172,9 +172,8 @@ Item {
 
 				if (newIndex !== -1) {
 					messageListView.currentIndex = newIndex
+					searchFieldBusyIndicator.running = false
 				}
-
-				searchFieldBusyIndicator.running = false
 			}
 		}
 	}
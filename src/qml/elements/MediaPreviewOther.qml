@@ -32,6 +32,18 @@ Rectangle {
 
 	color: "transparent"
 
+	// Pending transfers of displayed files are started first.
+	Component.onCompleted: {
+		if (message) {
+			Kaidan.fileSharingController.setFileVisible(file, true)
+		}
+	}
+	Component.onDestruction: {
+		if (message) {
+			Kaidan.fileSharingController.setFileVisible(file, false)
+		}
+	}
+
 	Layout.fillHeight: false
 	Layout.fillWidth: true
 	Layout.alignment: Qt.AlignLeft
@@ -82,10 +94,12 @@ Rectangle {
 						}
 					}
 				}
-				Kirigami.Icon {
+				Image {
 					id: thumbnailIcon
 					visible: file.hasThumbnail
-					source: file.thumbnailSquare
+					source: file.hasThumbnail ? file.thumbnailSquareUrl : ""
+					fillMode: Image.PreserveAspectFit
+					asynchronous: true
 
 					anchors {
 						fill: parent
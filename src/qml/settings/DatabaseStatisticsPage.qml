@@ -0,0 +1,102 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+import QtQuick 2.14
+import QtQuick.Layouts 1.14
+import QtQuick.Controls 2.14 as Controls
+import org.kde.kirigami 2.19 as Kirigami
+
+import im.kaidan.kaidan 1.0
+import org.kde.kirigamiaddons.labs.mobileform 0.1 as MobileForm
+
+/**
+ * This page displays statistics about the database queries for debugging purposes.
+ */
+SettingsPageBase {
+	id: root
+
+	property string title: qsTr("Database Statistics")
+	property string report: Utils.databaseStatisticsReport()
+
+	implicitHeight: layout.implicitHeight
+	implicitWidth: layout.implicitWidth
+
+	Timer {
+		interval: 1000
+		repeat: true
+		running: root.visible && instrumentationSwitch.checked
+		onTriggered: root.report = Utils.databaseStatisticsReport()
+	}
+
+	ColumnLayout {
+		id: layout
+
+		Layout.preferredWidth: 600
+		anchors.fill: parent
+
+		MobileForm.FormCard {
+			Layout.fillWidth: true
+			contentItem: ColumnLayout {
+				spacing: 0
+
+				MobileForm.FormCardHeader {
+					title: qsTr("Collection")
+				}
+
+				MobileForm.FormSwitchDelegate {
+					id: instrumentationSwitch
+					text: qsTr("Collect statistics")
+					description: qsTr("Measure the duration of each database query (slightly slows down the database)")
+					checked: Utils.isDatabaseInstrumentationEnabled()
+					onToggled: Utils.setDatabaseInstrumentationEnabled(checked)
+				}
+
+				MobileForm.FormButtonDelegate {
+					text: qsTr("Reset statistics")
+					icon.name: "edit-clear-history"
+					onClicked: {
+						Utils.resetDatabaseStatistics()
+						root.report = Utils.databaseStatisticsReport()
+					}
+				}
+
+				MobileForm.FormButtonDelegate {
+					text: qsTr("Copy statistics")
+					icon.name: "edit-copy"
+					onClicked: {
+						Utils.copyToClipboard(root.report)
+						passiveNotification(qsTr("Statistics copied to clipboard"))
+					}
+				}
+			}
+		}
+
+		MobileForm.FormCard {
+			Layout.fillWidth: true
+			Layout.fillHeight: true
+			contentItem: ColumnLayout {
+				spacing: 0
+
+				MobileForm.FormCardHeader {
+					title: qsTr("Statistics")
+				}
+
+				Controls.ScrollView {
+					Layout.fillWidth: true
+					Layout.fillHeight: true
+					Layout.minimumHeight: Kirigami.Units.gridUnit * 10
+					Layout.margins: Kirigami.Units.largeSpacing
+
+					Controls.TextArea {
+						text: root.report
+						readOnly: true
+						selectByMouse: true
+						wrapMode: TextEdit.NoWrap
+						font.family: "monospace"
+					}
+				}
+			}
+		}
+	}
+}
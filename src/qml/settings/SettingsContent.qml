@@ -21,6 +21,47 @@ ColumnLayout {
 
 	Layout.fillHeight: true
 
+	MobileForm.FormCard {
+		Layout.fillWidth: true
+		contentItem: ColumnLayout {
+			spacing: 0
+
+			MobileForm.FormCardHeader {
+				title: qsTr("Chats")
+			}
+
+			MobileForm.FormComboBoxDelegate {
+				id: messageWindowSizeDelegate
+				text: qsTr("Messages in memory")
+				description: qsTr("Maximum number of messages of the open chat kept in memory while scrolling")
+				model: [
+					{
+						display: "100",
+						value: 100
+					},
+					{
+						display: "200",
+						value: 200
+					},
+					{
+						display: "500",
+						value: 500
+					},
+					{
+						display: qsTr("All"),
+						value: 0
+					}
+				]
+				textRole: "display"
+				valueRole: "value"
+				currentIndex: model.findIndex((entry) => entry.value === Kaidan.settings.messageWindowSize)
+				onActivated: {
+					Kaidan.settings.messageWindowSize = currentValue
+				}
+			}
+		}
+	}
+
 	MobileForm.FormCard {
 		Layout.fillWidth: true
 		contentItem: ColumnLayout {
@@ -33,6 +74,14 @@ ColumnLayout {
 				icon.name: "emblem-system-symbolic"
 			}
 
+			MobileForm.FormButtonDelegate {
+				text: qsTr("Database Statistics")
+				description: qsTr("View how long the database queries take")
+				visible: Utils.isDatabaseStatisticsAvailable()
+				onClicked: stack.push("qrc:/qml/settings/DatabaseStatisticsPage.qml")
+				icon.name: "view-statistics"
+			}
+
 			MobileForm.FormButtonDelegate {
 				text: qsTr("About Kaidan")
 				description: qsTr("Learn about the current Kaidan version, view the source code and contribute")
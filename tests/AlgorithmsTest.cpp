@@ -0,0 +1,366 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QAbstractItemModelTester>
+#include <QAbstractListModel>
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include "../src/Algorithms.h"
+#include "../src/Message.h"
+#include "../src/RosterItem.h"
+
+constexpr int BENCHMARK_MESSAGE_COUNT = 10000;
+constexpr int BENCHMARK_ROSTER_ITEM_COUNT = 5000;
+constexpr int BENCHMARK_ROSTER_ITEM_UPDATE_COUNT = 50000;
+
+// Model of messages sorted from new to old like MessageModel
+class TestMessageModel : public QAbstractListModel
+{
+public:
+	int rowCount(const QModelIndex &parent = {}) const override
+	{
+		return parent.isValid() ? 0 : m_messages.size();
+	}
+
+	QVariant data(const QModelIndex &index, int role) const override
+	{
+		if (!hasIndex(index.row(), index.column(), index.parent()) || role != Qt::DisplayRole) {
+			return {};
+		}
+
+		return m_messages.at(index.row()).id;
+	}
+
+	void addMessages(QVector<Message> messages)
+	{
+		insertSorted(
+			m_messages,
+			std::move(messages),
+			[](const Message &left, const Message &right) {
+				return left.timestamp > right.timestamp;
+			},
+			[this](int first, int last) {
+				beginInsertRows(QModelIndex(), first, last);
+			},
+			[this]() {
+				endInsertRows();
+			}
+		);
+	}
+
+	const QVector<Message> &messages() const
+	{
+		return m_messages;
+	}
+
+private:
+	QVector<Message> m_messages;
+};
+
+// Model of roster items sorted like RosterModel
+class TestRosterModel : public QAbstractListModel
+{
+public:
+	explicit TestRosterModel(QVector<RosterItem> items)
+		: m_items(std::move(items))
+	{
+		std::sort(m_items.begin(), m_items.end());
+	}
+
+	int rowCount(const QModelIndex &parent = {}) const override
+	{
+		return parent.isValid() ? 0 : m_items.size();
+	}
+
+	QVariant data(const QModelIndex &index, int role) const override
+	{
+		if (!hasIndex(index.row(), index.column(), index.parent()) || role != Qt::DisplayRole) {
+			return {};
+		}
+
+		return m_items.at(index.row()).jid;
+	}
+
+	void setLastMessageDateTime(int row, const QDateTime &lastMessageDateTime)
+	{
+		m_items[row].lastMessageDateTime = lastMessageDateTime;
+		Q_EMIT dataChanged(index(row), index(row));
+		m_changedRows.append(row);
+	}
+
+	void updateItemPositions()
+	{
+		moveToSortedPositions(
+			m_items,
+			std::move(m_changedRows),
+			[](const RosterItem &left, const RosterItem &right) {
+				return left < right;
+			},
+			[this](int from, int destination) {
+				beginMoveRows(QModelIndex(), from, from, QModelIndex(), destination);
+				m_items.move(from, from < destination ? destination - 1 : destination);
+				endMoveRows();
+			}
+		);
+
+		m_changedRows.clear();
+	}
+
+	bool isSorted() const
+	{
+		return std::is_sorted(m_items.cbegin(), m_items.cend());
+	}
+
+private:
+	QVector<RosterItem> m_items;
+	QVector<int> m_changedRows;
+};
+
+class AlgorithmsTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testInsertSorted();
+	Q_SLOT void testInsertSortedRanges();
+	Q_SLOT void benchmarkInsertMessages_data();
+	Q_SLOT void benchmarkInsertMessages();
+	Q_SLOT void testMoveToSortedPositions();
+	Q_SLOT void benchmarkMoveToSortedPositions_data();
+	Q_SLOT void benchmarkMoveToSortedPositions();
+
+	static QVector<Message> createMessages(int count, int firstId, const QDateTime &firstTimestamp, int secsBetween);
+	static QVector<RosterItem> createRosterItems(int count, int pinnedCount, const QDateTime &lastMessageDateTime);
+};
+
+void AlgorithmsTest::testInsertSorted()
+{
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+	auto *generator = QRandomGenerator::global();
+
+	TestMessageModel model;
+	QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+
+	// Inserting messages one by one results in the order MessageModel had before inserting
+	// batches: Newer messages are placed before older ones and messages with equal timestamps are
+	// placed in the order they were inserted.
+	QVector<Message> expectedMessages;
+
+	for (int batch = 0; batch < 20; batch++) {
+		QVector<Message> messages;
+
+		for (int i = 0; i < 10; i++) {
+			Message message;
+			message.id = QString::number(batch * 10 + i);
+			message.timestamp = timestamp.addSecs(generator->bounded(30));
+			messages.append(message);
+
+			const auto position = std::find_if(expectedMessages.cbegin(), expectedMessages.cend(), [&](const Message &expectedMessage) {
+				return message.timestamp > expectedMessage.timestamp;
+			});
+			expectedMessages.insert(position - expectedMessages.cbegin(), message);
+		}
+
+		model.addMessages(messages);
+	}
+
+	QCOMPARE(model.rowCount(), expectedMessages.size());
+
+	for (int i = 0; i < expectedMessages.size(); i++) {
+		QCOMPARE(model.messages().at(i).id, expectedMessages.at(i).id);
+	}
+}
+
+void AlgorithmsTest::testInsertSortedRanges()
+{
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+
+	TestMessageModel model;
+	model.addMessages(createMessages(10, 0, timestamp, 10));
+
+	QSignalSpy insertionSpy(&model, &QAbstractItemModel::rowsInserted);
+
+	// Messages newer and older than all existing ones are inserted as one range each, starting at
+	// the end.
+	auto messages = createMessages(5, 10, timestamp.addSecs(1000), 1);
+	messages.append(createMessages(5, 15, timestamp.addSecs(-1000), 1));
+	model.addMessages(messages);
+
+	QCOMPARE(insertionSpy.size(), 2);
+	QCOMPARE(insertionSpy.at(0).at(1).toInt(), 10);
+	QCOMPARE(insertionSpy.at(0).at(2).toInt(), 14);
+	QCOMPARE(insertionSpy.at(1).at(1).toInt(), 0);
+	QCOMPARE(insertionSpy.at(1).at(2).toInt(), 4);
+}
+
+void AlgorithmsTest::benchmarkInsertMessages_data()
+{
+	QTest::addColumn<bool>("batched");
+	QTest::addColumn<int>("existingMessageCount");
+
+	QTest::newRow("one by one") << false << 0;
+	QTest::newRow("batch") << true << 0;
+	QTest::newRow("batch between existing messages") << true << BENCHMARK_MESSAGE_COUNT;
+}
+
+void AlgorithmsTest::benchmarkInsertMessages()
+{
+	QFETCH(bool, batched);
+	QFETCH(int, existingMessageCount);
+
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+
+	// The messages of the backlog are retrieved from old to new.
+	// Existing messages are interleaved with them.
+	const auto existingMessages = createMessages(existingMessageCount, BENCHMARK_MESSAGE_COUNT, timestamp, 2);
+	const auto messages = createMessages(BENCHMARK_MESSAGE_COUNT, 0, timestamp.addSecs(1), 2);
+
+	QBENCHMARK {
+		TestMessageModel model;
+		model.addMessages(existingMessages);
+
+		if (batched) {
+			model.addMessages(messages);
+		} else {
+			for (const auto &message : messages) {
+				model.addMessages({ message });
+			}
+		}
+
+		QCOMPARE(model.rowCount(), existingMessageCount + BENCHMARK_MESSAGE_COUNT);
+	}
+}
+
+void AlgorithmsTest::testMoveToSortedPositions()
+{
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+	auto *generator = QRandomGenerator::global();
+
+	TestRosterModel model(createRosterItems(100, 5, timestamp));
+	QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+	QSignalSpy moveSpy(&model, &QAbstractItemModel::rowsMoved);
+
+	// Items whose relative order is unchanged are not moved.
+	// The unpinned items are sorted by their last message with one minute in between.
+	model.setLastMessageDateTime(50, timestamp.addSecs(-50 * 60 - 1));
+	model.updateItemPositions();
+	QVERIFY(model.isSorted());
+	QCOMPARE(moveSpy.size(), 0);
+
+	// New messages move the items to the top of the unpinned items.
+	model.setLastMessageDateTime(70, timestamp.addSecs(10));
+	model.setLastMessageDateTime(80, timestamp.addSecs(20));
+	model.updateItemPositions();
+	QVERIFY(model.isSorted());
+	QCOMPARE(moveSpy.size(), 2);
+
+	for (int i = 0; i < 100; i++) {
+		for (int j = 0; j < 10; j++) {
+			model.setLastMessageDateTime(generator->bounded(model.rowCount()), timestamp.addSecs(generator->bounded(-1000, 1000)));
+		}
+
+		model.updateItemPositions();
+		QVERIFY(model.isSorted());
+	}
+}
+
+void AlgorithmsTest::benchmarkMoveToSortedPositions_data()
+{
+	QTest::addColumn<int>("updatesPerBatch");
+
+	QTest::newRow("each update") << 1;
+	QTest::newRow("10 updates per batch") << 10;
+	QTest::newRow("100 updates per batch") << 100;
+}
+
+void AlgorithmsTest::benchmarkMoveToSortedPositions()
+{
+	QFETCH(int, updatesPerBatch);
+
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+	const auto items = createRosterItems(BENCHMARK_ROSTER_ITEM_COUNT, 10, timestamp);
+
+	// Random chats receive messages, which are batched like the updates of one iteration of the
+	// event loop.
+	QRandomGenerator generator(1);
+	QVector<int> updatedRows;
+	updatedRows.reserve(BENCHMARK_ROSTER_ITEM_UPDATE_COUNT);
+	for (int i = 0; i < BENCHMARK_ROSTER_ITEM_UPDATE_COUNT; i++) {
+		updatedRows.append(generator.bounded(BENCHMARK_ROSTER_ITEM_COUNT));
+	}
+
+	const auto countMoves = [&](int batchSize) {
+		TestRosterModel model(items);
+		QSignalSpy moveSpy(&model, &QAbstractItemModel::rowsMoved);
+
+		for (int i = 0; i < BENCHMARK_ROSTER_ITEM_UPDATE_COUNT; i++) {
+			model.setLastMessageDateTime(updatedRows.at(i), timestamp.addSecs(i + 1));
+
+			if ((i + 1) % batchSize == 0) {
+				model.updateItemPositions();
+			}
+		}
+
+		model.updateItemPositions();
+		return int(moveSpy.size());
+	};
+
+	int moveCount = 0;
+
+	QBENCHMARK {
+		moveCount = countMoves(updatesPerBatch);
+	}
+
+	// Each updated item is moved at most once per batch.
+	// The rows do not change within a batch so that the distinct rows are the updated items.
+	int maxMoveCount = 0;
+	for (int batchStart = 0; batchStart < BENCHMARK_ROSTER_ITEM_UPDATE_COUNT; batchStart += updatesPerBatch) {
+		const auto batchRows = updatedRows.mid(batchStart, updatesPerBatch);
+		maxMoveCount += QSet<int>(batchRows.cbegin(), batchRows.cend()).size();
+	}
+
+	QVERIFY(moveCount <= maxMoveCount);
+
+	// Items updated several times within a batch are moved fewer times than without batching.
+	if (updatesPerBatch > 1) {
+		QVERIFY(moveCount < countMoves(1));
+	}
+}
+
+QVector<RosterItem> AlgorithmsTest::createRosterItems(int count, int pinnedCount, const QDateTime &lastMessageDateTime)
+{
+	QVector<RosterItem> items;
+	items.reserve(count);
+
+	for (int i = 0; i < count; i++) {
+		RosterItem item;
+		item.accountJid = QStringLiteral("alice@example.org");
+		item.jid = QStringLiteral("contact%1@example.org").arg(i);
+		item.lastMessageDateTime = lastMessageDateTime.addSecs(-i * 60);
+		item.pinningPosition = i < pinnedCount ? i : -1;
+		items.append(item);
+	}
+
+	return items;
+}
+
+QVector<Message> AlgorithmsTest::createMessages(int count, int firstId, const QDateTime &firstTimestamp, int secsBetween)
+{
+	QVector<Message> messages;
+	messages.reserve(count);
+
+	for (int i = 0; i < count; i++) {
+		Message message;
+		message.id = QString::number(firstId + i);
+		message.timestamp = firstTimestamp.addSecs(i * secsBetween);
+		message.body = QStringLiteral("Message %1").arg(firstId + i);
+		messages.append(message);
+	}
+
+	return messages;
+}
+
+QTEST_GUILESS_MAIN(AlgorithmsTest)
+#include "AlgorithmsTest.moc"
@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include "../src/Database.h"
+#include "../src/DatabaseComponent.h"
+#include "../src/SqlUtils.h"
+
+using namespace SqlUtils;
+
+class DatabaseMigrationTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testConvertToV43();
+
+	static void createV42Database(bool fullTextSearchSupported);
+	static QVector<QString> fetchMessageIds(QSqlQuery &query, const QString &sql);
+};
+
+void DatabaseMigrationTest::testConvertToV43()
+{
+	// The database file is removed when the database is created and must be written before the
+	// database is opened by the first query.
+	Database db;
+	DatabaseComponent component(&db);
+
+	bool fullTextSearchSupported = false;
+	{
+		auto database = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("v42"));
+		database.setDatabaseName(QStringLiteral("tests_db_") + QCoreApplication::applicationName() + QStringLiteral(".sqlite"));
+		QVERIFY2(database.open(), qPrintable(database.lastError().text()));
+
+		QSqlQuery query(database);
+		execQuery(query, QStringLiteral("SELECT sqlite_compileoption_used('ENABLE_FTS5')"));
+		fullTextSearchSupported = query.next() && query.value(0).toBool();
+	}
+	createV42Database(fullTextSearchSupported);
+	QSqlDatabase::removeDatabase(QStringLiteral("v42"));
+
+	// The first query converts the database to the latest version.
+	auto query = component.createQuery();
+
+	// The rows are kept and their timestamps are converted into milliseconds since the epoch.
+	execQuery(query, QStringLiteral("SELECT rowid, id, timestamp FROM messages ORDER BY rowid"));
+	const QVector<std::tuple<qint64, QString, qint64>> expectedMessages = {
+		{ 10, QStringLiteral("message-1"), QDateTime(QDate(2024, 1, 2), QTime(3, 4, 5, 678), Qt::UTC).toMSecsSinceEpoch() },
+		{ 20, QStringLiteral("message-2"), QDateTime(QDate(2024, 1, 2), QTime(3, 4, 6), Qt::UTC).toMSecsSinceEpoch() },
+		{ 30, QStringLiteral("draft"), QDateTime(QDate(2024, 1, 2), QTime(3, 4, 7), Qt::UTC).toMSecsSinceEpoch() },
+	};
+	for (const auto &[rowId, id, timestamp] : expectedMessages) {
+		QVERIFY(query.next());
+		QCOMPARE(query.value(0).toLongLong(), rowId);
+		QCOMPARE(query.value(1).toString(), id);
+		QCOMPARE(query.value(2).userType(), int(QMetaType::LongLong));
+		QCOMPARE(query.value(2).toLongLong(), timestamp);
+	}
+
+	// Missing and invalid timestamps are NULL instead of the start of the epoch.
+	for (const auto &id : { QStringLiteral("without-timestamp"), QStringLiteral("invalid-timestamp") }) {
+		QVERIFY(query.next());
+		QCOMPARE(query.value(1).toString(), id);
+		QVERIFY(query.value(2).isNull());
+	}
+	QVERIFY(!query.next());
+
+	execQuery(query, QStringLiteral("SELECT timestamp FROM messageReactions"));
+	QVERIFY(query.next());
+	QCOMPARE(query.value(0).toLongLong(), QDateTime(QDate(2024, 1, 2), QTime(3, 5, 0), Qt::UTC).toMSecsSinceEpoch());
+
+	// The views refer to the new table.
+	QCOMPARE(fetchMessageIds(query, QStringLiteral("SELECT id FROM chatMessages ORDER BY rowid")), (QVector<QString> { QStringLiteral("message-1") }));
+	QCOMPARE(fetchMessageIds(query, QStringLiteral("SELECT id FROM draftMessages ORDER BY rowid")), (QVector<QString> { QStringLiteral("draft") }));
+
+	if (!fullTextSearchSupported) {
+		return;
+	}
+
+	// The full-text search index still refers to the kept rowids.
+	const auto searchStatement = QStringLiteral(
+		"SELECT messages.id FROM messagesFts JOIN messages ON messages.rowid = messagesFts.rowid "
+		"WHERE messagesFts MATCH '%1' ORDER BY messages.rowid"
+	);
+	QCOMPARE(fetchMessageIds(query, searchStatement.arg(QStringLiteral("hello"))), (QVector<QString> { QStringLiteral("message-1"), QStringLiteral("message-2") }));
+
+	// The triggers keep the index in sync with the new table.
+	execQuery(
+		query,
+		QStringLiteral("INSERT INTO messages (accountJid, chatJid, id, timestamp, body, deliveryState, removed) "
+		               "VALUES ('alice@example.org', 'bob@example.com', 'message-3', 0, 'hello again', 1, 0)")
+	);
+	execQuery(query, QStringLiteral("UPDATE messages SET body = 'goodbye' WHERE id = 'message-1'"));
+	execQuery(query, QStringLiteral("DELETE FROM messages WHERE id = 'message-2'"));
+
+	QCOMPARE(fetchMessageIds(query, searchStatement.arg(QStringLiteral("hello"))), (QVector<QString> { QStringLiteral("message-3") }));
+	QCOMPARE(fetchMessageIds(query, searchStatement.arg(QStringLiteral("goodbye"))), (QVector<QString> { QStringLiteral("message-1") }));
+}
+
+void DatabaseMigrationTest::createV42Database(bool fullTextSearchSupported)
+{
+	QSqlQuery query(QSqlDatabase::database(QStringLiteral("v42")));
+
+	execQuery(query, QStringLiteral("CREATE TABLE dbinfo (version INTEGER NOT NULL)"));
+	execQuery(query, QStringLiteral("INSERT INTO dbinfo (version) VALUES (42)"));
+	execQuery(query, QStringLiteral("CREATE TABLE roster (accountJid TEXT NOT NULL, jid TEXT NOT NULL, PRIMARY KEY(accountJid, jid))"));
+	execQuery(
+		query,
+		QStringLiteral(
+			"CREATE TABLE messages (accountJid TEXT NOT NULL, chatJid TEXT NOT NULL, senderId TEXT, id TEXT, "
+			"originId TEXT, stanzaId TEXT, replaceId TEXT, timestamp TEXT, body TEXT, encryption INTEGER, "
+			"senderKey BLOB, deliveryState INTEGER, isSpoiler BOOL, spoilerHint TEXT, fileGroupId INTEGER, "
+			"errorText TEXT, removed BOOL NOT NULL, "
+			"FOREIGN KEY(accountJid, chatJid) REFERENCES roster (accountJid, jid))"
+		)
+	);
+	execQuery(
+		query,
+		QStringLiteral(
+			"CREATE TABLE messageReactions (accountJid TEXT NOT NULL, chatJid TEXT NOT NULL, "
+			"messageSenderId TEXT NOT NULL, messageId TEXT NOT NULL, senderJid TEXT NOT NULL, emoji TEXT NOT NULL, "
+			"timestamp INTEGER, deliveryState INTEGER, PRIMARY KEY(accountJid, chatJid, messageId, senderJid, emoji))"
+		)
+	);
+	execQuery(
+		query,
+		QStringLiteral(
+			"CREATE TABLE files (id INTEGER NOT NULL, fileGroupId INTEGER NOT NULL, name TEXT, description TEXT, "
+			"mimeType TEXT NOT NULL, size INTEGER, lastModified INTEGER NOT NULL, disposition INTEGER NOT NULL, "
+			"thumbnail BLOB, localFilePath TEXT, PRIMARY KEY(id))"
+		)
+	);
+	execQuery(query, QStringLiteral("CREATE TABLE fileHashes (dataId INTEGER NOT NULL, hashType INTEGER NOT NULL, hashValue BLOB NOT NULL, PRIMARY KEY(dataId, hashType))"));
+	execQuery(query, QStringLiteral("CREATE VIEW chatMessages AS SELECT * FROM messages WHERE deliveryState != 4 AND removed != 1"));
+	execQuery(query, QStringLiteral("CREATE VIEW draftMessages AS SELECT * FROM messages WHERE deliveryState = 4"));
+
+	if (fullTextSearchSupported) {
+		execQuery(
+			query,
+			QStringLiteral("CREATE VIRTUAL TABLE messagesFts USING fts5(body, content='messages', content_rowid='rowid', "
+			               "tokenize='unicode61 remove_diacritics 2')")
+		);
+		execQuery(
+			query,
+			QStringLiteral("CREATE TRIGGER messagesFtsInsert AFTER INSERT ON messages BEGIN "
+			               "INSERT INTO messagesFts (rowid, body) VALUES (new.rowid, new.body); END")
+		);
+	}
+
+	// The rowids have gaps in order to verify that they are kept.
+	execQuery(
+		query,
+		QStringLiteral(
+			"INSERT INTO messages (rowid, accountJid, chatJid, id, timestamp, body, deliveryState, removed) VALUES "
+			"(10, 'alice@example.org', 'bob@example.com', 'message-1', '2024-01-02T03:04:05.678Z', 'hello world', 1, 0), "
+			"(20, 'alice@example.org', 'bob@example.com', 'message-2', '2024-01-02T03:04:06Z', 'hello there', 1, 1), "
+			"(30, 'alice@example.org', 'bob@example.com', 'draft', '2024-01-02T03:04:07Z', 'unsent', 4, 0), "
+			"(40, 'alice@example.org', 'bob@example.com', 'without-timestamp', NULL, 'no time', 1, 1), "
+			"(50, 'alice@example.org', 'bob@example.com', 'invalid-timestamp', 'yesterday', 'wrong time', 1, 1)"
+		)
+	);
+	execQuery(
+		query,
+		QStringLiteral(
+			"INSERT INTO messageReactions (accountJid, chatJid, messageSenderId, messageId, senderJid, emoji, timestamp, deliveryState) "
+			"VALUES ('alice@example.org', 'bob@example.com', 'bob@example.com', 'message-1', 'alice@example.org', '+1', '2024-01-02T03:05:00Z', 0)"
+		)
+	);
+}
+
+QVector<QString> DatabaseMigrationTest::fetchMessageIds(QSqlQuery &query, const QString &sql)
+{
+	execQuery(query, sql);
+
+	QVector<QString> ids;
+	while (query.next()) {
+		ids.append(query.value(0).toString());
+	}
+
+	return ids;
+}
+
+QTEST_GUILESS_MAIN(DatabaseMigrationTest)
+#include "DatabaseMigrationTest.moc"
@@ -0,0 +1,292 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+#include <QMimeDatabase>
+#include <QRegularExpression>
+
+#include "../src/Database.h"
+#include "../src/DatabaseComponent.h"
+#include "../src/MessageDb.h"
+#include "../src/RosterDb.h"
+#include "../src/RosterItem.h"
+#include "../src/SqlUtils.h"
+#include "../src/TrustDb.h"
+#include "utils.h"
+
+using namespace SqlUtils;
+
+class DatabaseTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testQueryPlans();
+	Q_SLOT void testTuningProfile();
+	Q_SLOT void testQueryCache();
+	Q_SLOT void testReaderPool();
+	Q_SLOT void testNormalizedStatement();
+	Q_SLOT void testInstrumentation();
+
+	/**
+	 * Executes database calls and returns the steps of the query plans of their statements that
+	 * walk whole tables.
+	 */
+	QStringList tableScans(const std::function<void()> &calls);
+
+	Database m_db;
+	DatabaseComponent m_component = DatabaseComponent(&m_db);
+	MessageDb m_messageDb = MessageDb(&m_db);
+	RosterDb m_rosterDb = RosterDb(&m_db);
+	TrustDb m_trustDb = TrustDb(&m_db, this, QStringLiteral("alice@example.org"));
+};
+
+void DatabaseTest::testQueryPlans()
+{
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("bob@example.com");
+	const auto encryption = QStringLiteral("urn:xmpp:omemo:2");
+
+	RosterItem item;
+	item.accountJid = accountJid;
+	item.jid = chatJid;
+	item.groups = { QStringLiteral("Friends") };
+	wait(m_rosterDb.addItem(item));
+
+	// The message has a file and a reaction so that those are fetched as well.
+	File file;
+	file.id = 1;
+	file.fileGroupId = 1;
+	file.mimeType = QMimeDatabase().mimeTypeForName(QStringLiteral("image/png"));
+	file.thumbnail = QByteArray(16, 't');
+	file.hashes = { FileHash { file.id, QXmpp::HashAlgorithm::Sha256, QByteArray(32, 'h') } };
+	file.httpSources = { HttpSource { file.id, QUrl(QStringLiteral("https://example.org/1.png")) } };
+	file.encryptedSources = { EncryptedSource { file.id, QUrl(QStringLiteral("https://example.org/1")), QXmpp::Cipher::Aes256GcmNoPad, QByteArray(32, 'k'), QByteArray(12, 'i'), {}, {} } };
+
+	Message message;
+	message.accountJid = accountJid;
+	message.chatJid = chatJid;
+	message.senderId = chatJid;
+	message.id = QStringLiteral("message");
+	message.body = QStringLiteral("Hello");
+	message.timestamp = QDateTime::currentDateTimeUtc();
+	message.fileGroupId = file.fileGroupId;
+	message.files = { file };
+	wait(m_messageDb.addMessage(message, MessageOrigin::UserInput));
+
+	wait(m_messageDb.updateMessage(message.id, [&](Message &message) {
+		MessageReaction reaction;
+		reaction.emoji = QStringLiteral("👍");
+
+		auto &reactionSender = message.reactionSenders[accountJid];
+		reactionSender.latestTimestamp = QDateTime::currentDateTimeUtc();
+		reactionSender.reactions.append(reaction);
+	}));
+
+	// Whether the full-text search index is present is looked up once in the schema, which is
+	// walked completely.
+	wait(m_messageDb.searchMessages(accountJid, chatJid, message.body));
+
+	const MessageDb::MessageCursor cursor { message.timestamp.addSecs(1), message.id };
+
+	const auto scans = tableScans([&]() {
+		wait(m_messageDb.fetchMessages(accountJid, chatJid));
+		wait(m_messageDb.fetchMessages(accountJid, chatJid, cursor));
+		wait(m_messageDb.fetchMessagesUntilFirstContactMessage(accountJid, chatJid, cursor));
+		wait(m_messageDb.fetchMessagesUntilId(accountJid, chatJid, cursor, message.id));
+		wait(m_messageDb.fetchMessageStubsUntilId(accountJid, chatJid, cursor, message.id));
+		wait(m_messageDb.fetchMessagesByIds(accountJid, chatJid, { message.id }, true));
+		wait(m_messageDb.searchMessages(accountJid, chatJid, message.body, cursor));
+		wait(m_messageDb.searchMessages(accountJid, {}, message.body));
+		wait(m_messageDb.fetchLastMessageStamp());
+		wait(m_messageDb.firstContactMessageId(accountJid, chatJid, 0));
+		wait(m_messageDb.referenceLocalFile(accountJid, message.id, file.id, file.hashes));
+		wait(m_messageDb.addMessage(message, MessageOrigin::Stream));
+		wait(m_messageDb.updateMessage(message.id, [](Message &message) {
+			message.body = QStringLiteral("Hello!");
+		}));
+		wait(m_messageDb.removeMessage(accountJid, chatJid, message.id));
+
+		wait(m_rosterDb.updateItem(chatJid, [](RosterItem &item) {
+			item.name = QStringLiteral("Bob");
+		}));
+
+		wait(this, m_trustDb.keys(encryption, { chatJid }));
+		wait(this, m_trustDb.keys(encryption, { chatJid }, QXmpp::TrustLevel::Authenticated | QXmpp::TrustLevel::AutomaticallyTrusted));
+		wait(this, m_trustDb.keysForPostponedTrustDecisions(encryption, { QByteArray(32, 'k') }));
+	});
+
+	QVERIFY2(scans.isEmpty(), qPrintable(scans.join(u'\n')));
+}
+
+void DatabaseTest::testTuningProfile()
+{
+	const auto pragmaValue = [this](const QString &pragma) {
+		auto query = m_component.createQuery();
+		execQuery(query, QStringLiteral("PRAGMA ") + pragma);
+		return query.next() ? query.value(0).toString() : QString();
+	};
+
+	QCOMPARE(pragmaValue(QStringLiteral("journal_mode")), QStringLiteral("wal"));
+	// NORMAL
+	QCOMPARE(pragmaValue(QStringLiteral("synchronous")), QStringLiteral("1"));
+	// MEMORY
+	QCOMPARE(pragmaValue(QStringLiteral("temp_store")), QStringLiteral("2"));
+	QCOMPARE(pragmaValue(QStringLiteral("cache_size")), QStringLiteral("-8192"));
+}
+
+void DatabaseTest::testQueryCache()
+{
+	const auto sql = QStringLiteral("SELECT :value UNION ALL SELECT :value + 1");
+
+	auto outerQuery = m_component.createQuery();
+	execQuery(outerQuery, sql, { { u":value", 1 } });
+	QVERIFY(outerQuery.next());
+	QCOMPARE(outerQuery.value(0).toInt(), 1);
+
+	// Executing the same statement while the first result is still being read must not interfere
+	// with it.
+	auto innerQuery = m_component.createQuery();
+	execQuery(innerQuery, sql, { { u":value", 10 } });
+	QVERIFY(innerQuery.next());
+	QCOMPARE(innerQuery.value(0).toInt(), 10);
+	QVERIFY(innerQuery.next());
+	QCOMPARE(innerQuery.value(0).toInt(), 11);
+	QVERIFY(!innerQuery.next());
+
+	QVERIFY(outerQuery.next());
+	QCOMPARE(outerQuery.value(0).toInt(), 2);
+	QVERIFY(!outerQuery.next());
+
+	// The cached query is reused with new values once it has been read completely.
+	execQuery(outerQuery, sql, { { u":value", 20 } });
+	QVERIFY(outerQuery.next());
+	QCOMPARE(outerQuery.value(0).toInt(), 20);
+	QVERIFY(outerQuery.next());
+	QCOMPARE(outerQuery.value(0).toInt(), 21);
+	QVERIFY(!outerQuery.next());
+
+	finishCachedQueries();
+}
+
+void DatabaseTest::testReaderPool()
+{
+	const auto writerThread = wait(m_component.run([this]() {
+		auto query = m_component.createQuery();
+		execQuery(query, QStringLiteral("CREATE TABLE readerPoolTest (value INTEGER)"));
+		execQuery(query, QStringLiteral("INSERT INTO readerPoolTest VALUES (1), (2)"));
+		return QThread::currentThread();
+	}));
+
+	// Readers see the data written before and run on their own threads.
+	const auto [readerThread, sum] = wait(m_component.runRead([this]() {
+		auto query = m_component.createQuery();
+		execQuery(query, QStringLiteral("SELECT SUM(value) FROM readerPoolTest"));
+		return std::pair { QThread::currentThread(), query.next() ? query.value(0).toInt() : 0 };
+	}));
+
+	QCOMPARE(sum, 3);
+	QVERIFY(readerThread != writerThread);
+	QVERIFY(readerThread != QThread::currentThread());
+
+	wait(m_component.run([this]() {
+		auto query = m_component.createQuery();
+		execQuery(query, QStringLiteral("DROP TABLE readerPoolTest"));
+	}));
+}
+
+void DatabaseTest::testNormalizedStatement()
+{
+	QCOMPARE(
+		normalizedStatement(QStringLiteral("SELECT *\n\tFROM files\n\tWHERE id IN (12, 345) AND name = 'it''s'")),
+		QStringLiteral("SELECT * FROM files WHERE id IN (?, ...) AND name = ?"));
+	QCOMPARE(
+		normalizedStatement(QStringLiteral("DELETE FROM files WHERE id IN (:id0, :id1, :id2)")),
+		QStringLiteral("DELETE FROM files WHERE id IN (:id, ...)"));
+	QCOMPARE(
+		normalizedStatement(QStringLiteral("SELECT * FROM fileHashes WHERE dataId = :dataId")),
+		QStringLiteral("SELECT * FROM fileHashes WHERE dataId = :dataId"));
+}
+
+void DatabaseTest::testInstrumentation()
+{
+	resetStatistics();
+	setInstrumentationEnabled(true);
+
+	wait(m_component.run([this]() {
+		auto query = m_component.createQuery();
+		execQuery(query, QStringLiteral("SELECT 1 UNION ALL SELECT 2 UNION ALL SELECT 3"));
+
+		// The rows are still readable after they have been counted.
+		QVERIFY(query.next());
+		QCOMPARE(query.value(0).toInt(), 1);
+		QVERIFY(query.next());
+		QVERIFY(query.next());
+		QCOMPARE(query.value(0).toInt(), 3);
+		QVERIFY(!query.next());
+
+		execQuery(query, QStringLiteral("SELECT 4 UNION ALL SELECT 5 UNION ALL SELECT 6"));
+	}));
+
+	setInstrumentationEnabled(false);
+
+	const auto allStatistics = statementStatistics();
+	const auto statistics = std::find_if(allStatistics.cbegin(), allStatistics.cend(), [](const StatementStatistics &statistics) {
+		return statistics.statement == QStringLiteral("SELECT ? UNION ALL SELECT ? UNION ALL SELECT ?");
+	});
+	QVERIFY(statistics != allStatistics.cend());
+	QCOMPARE(statistics->executionCount, quint64(2));
+	QCOMPARE(statistics->rowCount, quint64(6));
+	QVERIFY(statistics->maxDuration <= statistics->totalDuration);
+
+	QCOMPARE(queueWaitStatistics(JobQueue::Database).jobCount, quint64(1));
+	QCOMPARE(queueWaitStatistics(JobQueue::Readers).jobCount, quint64(0));
+	QVERIFY(statisticsReport().contains(statistics->statement));
+
+	resetStatistics();
+	QVERIFY(statementStatistics().empty());
+	QCOMPARE(queueWaitStatistics(JobQueue::Database).jobCount, quint64(0));
+}
+
+QStringList DatabaseTest::tableScans(const std::function<void()> &calls)
+{
+	resetStatistics();
+	setInstrumentationEnabled(true);
+	calls();
+	setInstrumentationEnabled(false);
+
+	enum { Detail = 3 };
+	QStringList tableScans;
+	auto query = m_component.createQuery();
+
+	// The query plans do not depend on the values of the placeholders.
+	QRegularExpression placeholderExpression(QStringLiteral(":[A-Za-z]\\w*"));
+
+	for (const auto &statistics : statementStatistics()) {
+		prepareQuery(query, QStringLiteral("EXPLAIN QUERY PLAN ") + statistics.sql);
+
+		auto placeholderMatches = placeholderExpression.globalMatch(statistics.sql);
+		while (placeholderMatches.hasNext()) {
+			query.bindValue(placeholderMatches.next().captured(), QVariant());
+		}
+
+		execQuery(query);
+
+		while (query.next()) {
+			const auto detail = query.value(Detail).toString();
+
+			// A table may only be walked completely if the walk follows an index (e.g., for "ORDER BY"
+			// combined with "LIMIT").
+			// Virtual tables such as the full-text search index are walked by their own indexes.
+			if (detail.startsWith(QStringLiteral("SCAN ")) && !detail.contains(QStringLiteral(" USING ")) && !detail.contains(QStringLiteral(" VIRTUAL TABLE INDEX "))) {
+				tableScans.append(statistics.statement + QStringLiteral(": ") + detail);
+			}
+		}
+	}
+
+	return tableScans;
+}
+
+QTEST_GUILESS_MAIN(DatabaseTest)
+#include "DatabaseTest.moc"
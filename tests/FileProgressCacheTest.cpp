@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+
+#include "../src/FileProgressCache.h"
+
+class FileProgressCacheTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testCoalescing();
+	Q_SLOT void testFinishedTransfer();
+};
+
+void FileProgressCacheTest::testCoalescing()
+{
+	constexpr qint64 fileId = 1;
+	constexpr quint64 bytesTotal = 1000;
+
+	FileProgressWatcher watcher;
+	watcher.setFileId(QString::number(fileId));
+	QSignalSpy progressSpy(&watcher, &FileProgressWatcher::progressChanged);
+
+	for (quint64 bytesSent = 1; bytesSent <= bytesTotal; bytesSent++) {
+		FileProgressCache::instance().reportProgress(fileId, FileProgress { bytesSent, bytesTotal, float(bytesSent) / float(bytesTotal) });
+	}
+
+	// The cache is updated right away while the watchers are notified later.
+	QCOMPARE(FileProgressCache::instance().progress(fileId)->bytesSent, bytesTotal);
+	QCOMPARE(progressSpy.size(), 0);
+
+	// Only the latest progress is notified.
+	QTRY_COMPARE(watcher.bytesSent(), bytesTotal);
+	QCOMPARE(progressSpy.size(), 1);
+	QVERIFY(watcher.isLoading());
+
+	FileProgressCache::instance().reportProgress(fileId, std::nullopt);
+	QTRY_VERIFY(!watcher.isLoading());
+}
+
+void FileProgressCacheTest::testFinishedTransfer()
+{
+	constexpr qint64 fileId = 2;
+
+	FileProgressWatcher watcher;
+	watcher.setFileId(QString::number(fileId));
+
+	FileProgressCache::instance().reportProgress(fileId, FileProgress { 1, 2, 0.5F });
+	QTRY_VERIFY(watcher.isLoading());
+
+	// The end of a transfer is notified without waiting for the notification interval.
+	FileProgressCache::instance().reportProgress(fileId, FileProgress { 2, 2, 1.0F });
+	FileProgressCache::instance().reportProgress(fileId, std::nullopt);
+	QCoreApplication::processEvents();
+	QVERIFY(!watcher.isLoading());
+	QVERIFY(!FileProgressCache::instance().progress(fileId));
+}
+
+QTEST_GUILESS_MAIN(FileProgressCacheTest)
+#include "FileProgressCacheTest.moc"
@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <memory>
+
+#include <QThread>
+#include <QtTest>
+
+#include "../src/FutureUtils.h"
+
+/**
+ * Value counting how often it has been copied on its way to the receiver
+ */
+struct CopyCounter
+{
+	CopyCounter() = default;
+	CopyCounter(const CopyCounter &other)
+		: copyCount(other.copyCount + 1)
+	{
+	}
+	CopyCounter(CopyCounter &&other) noexcept = default;
+	CopyCounter &operator=(const CopyCounter &other)
+	{
+		copyCount = other.copyCount + 1;
+		return *this;
+	}
+	CopyCounter &operator=(CopyCounter &&other) noexcept = default;
+
+	int copyCount = 0;
+};
+
+// QFutureInterface of Qt 5 can only store copies of results.
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+constexpr int FUTURE_STORE_COPY_COUNT = 0;
+#else
+constexpr int FUTURE_STORE_COPY_COUNT = 1;
+#endif
+
+class FutureUtilsTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void initTestCase();
+	Q_SLOT void cleanupTestCase();
+	Q_SLOT void testReportFinishedResult();
+	Q_SLOT void testRunAsync();
+	Q_SLOT void testRunAsyncTask();
+	Q_SLOT void testRunAsyncTaskWithMoveOnlyResult();
+
+	// Returns the result of a finished future without copying it.
+	template<typename T>
+	static const T &resultReference(const QFuture<T> &future);
+
+	QThread m_thread;
+	QObject m_worker;
+};
+
+void FutureUtilsTest::initTestCase()
+{
+	m_worker.moveToThread(&m_thread);
+	m_thread.start();
+}
+
+void FutureUtilsTest::cleanupTestCase()
+{
+	m_thread.quit();
+	m_thread.wait();
+}
+
+void FutureUtilsTest::testReportFinishedResult()
+{
+	QFutureInterface<CopyCounter> interface(QFutureInterfaceBase::Started);
+	reportFinishedResult(interface, CopyCounter());
+
+	const auto future = interface.future();
+	QVERIFY(future.isFinished());
+	QCOMPARE(resultReference(future).copyCount, FUTURE_STORE_COPY_COUNT);
+}
+
+void FutureUtilsTest::testRunAsync()
+{
+	auto future = runAsync(&m_worker, []() {
+		return CopyCounter();
+	});
+
+	QFutureWatcher<CopyCounter> watcher;
+	QSignalSpy finishedSpy(&watcher, &QFutureWatcherBase::finished);
+	watcher.setFuture(future);
+	QVERIFY(finishedSpy.wait());
+
+	QCOMPARE(resultReference(future).copyCount, FUTURE_STORE_COPY_COUNT);
+}
+
+void FutureUtilsTest::testRunAsyncTask()
+{
+	auto task = runAsyncTask(this, &m_worker, []() {
+		return CopyCounter();
+	});
+
+	std::optional<int> copyCount;
+	task.then(this, [&copyCount](CopyCounter &&value) {
+		copyCount = value.copyCount;
+	});
+
+	// The result is moved from the worker's thread into the task.
+	QTRY_VERIFY(copyCount.has_value());
+	QCOMPARE(*copyCount, 0);
+}
+
+void FutureUtilsTest::testRunAsyncTaskWithMoveOnlyResult()
+{
+	auto task = runAsyncTask(this, &m_worker, []() {
+		return std::make_unique<int>(42);
+	});
+
+	std::optional<int> value;
+	task.then(this, [&value](std::unique_ptr<int> &&result) {
+		value = *result;
+	});
+
+	QTRY_VERIFY(value.has_value());
+	QCOMPARE(*value, 42);
+}
+
+template<typename T>
+const T &FutureUtilsTest::resultReference(const QFuture<T> &future)
+{
+	return *future.constBegin();
+}
+
+QTEST_GUILESS_MAIN(FutureUtilsTest)
+#include "FutureUtilsTest.moc"
@@ -0,0 +1,199 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include "../src/GrayscaleConversion.h"
+
+using namespace GrayscaleConversion;
+
+Q_DECLARE_METATYPE(GrayscaleConversion::InstructionSet)
+
+// Width that is not a multiple of any vector width so that the remaining pixels are covered
+constexpr int TEST_WIDTH = 1007;
+constexpr int BENCHMARK_WIDTH = 1920;
+constexpr int BENCHMARK_HEIGHT = 1080;
+constexpr int BENCHMARK_ITERATIONS = 20;
+
+class GrayscaleConversionTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testRgb32ToGray_data();
+	Q_SLOT void testRgb32ToGray();
+	Q_SLOT void testRgb24ToGray_data();
+	Q_SLOT void testRgb24ToGray();
+	Q_SLOT void testYuyvToGray_data();
+	Q_SLOT void testYuyvToGray();
+	Q_SLOT void testPremultipliedRgb32ToGray();
+	Q_SLOT void benchmarkRgb32ToGray_data();
+	Q_SLOT void benchmarkRgb32ToGray();
+
+	static void addInstructionSetRows();
+	static QByteArray randomData(int size);
+	static QByteArray scalarRgb32ToGray(const QByteArray &source, int width, ChannelOffsets offsets);
+};
+
+void GrayscaleConversionTest::testRgb32ToGray_data()
+{
+	addInstructionSetRows();
+}
+
+void GrayscaleConversionTest::testRgb32ToGray()
+{
+	QFETCH(InstructionSet, instructionSet);
+
+	const auto source = randomData(TEST_WIDTH * 4);
+
+	for (const ChannelOffsets offsets : { ChannelOffsets { 1, 2, 3 }, ChannelOffsets { 2, 1, 0 }, ChannelOffsets { 3, 2, 1 }, ChannelOffsets { 0, 1, 2 } }) {
+		QByteArray target(TEST_WIDTH, 0);
+		rgb32ToGray(reinterpret_cast<const uchar *>(source.constData()), reinterpret_cast<uchar *>(target.data()), TEST_WIDTH, offsets, instructionSet);
+		QCOMPARE(target, scalarRgb32ToGray(source, TEST_WIDTH, offsets));
+	}
+}
+
+void GrayscaleConversionTest::testRgb24ToGray_data()
+{
+	addInstructionSetRows();
+}
+
+void GrayscaleConversionTest::testRgb24ToGray()
+{
+	QFETCH(InstructionSet, instructionSet);
+
+	const auto source = randomData(TEST_WIDTH * 3);
+
+	for (const ChannelOffsets offsets : { ChannelOffsets { 0, 1, 2 }, ChannelOffsets { 2, 1, 0 } }) {
+		QByteArray expected(TEST_WIDTH, 0);
+		rgb24ToGray(reinterpret_cast<const uchar *>(source.constData()), reinterpret_cast<uchar *>(expected.data()), TEST_WIDTH, offsets, InstructionSet::Scalar);
+
+		QByteArray target(TEST_WIDTH, 0);
+		rgb24ToGray(reinterpret_cast<const uchar *>(source.constData()), reinterpret_cast<uchar *>(target.data()), TEST_WIDTH, offsets, instructionSet);
+		QCOMPARE(target, expected);
+	}
+}
+
+void GrayscaleConversionTest::testYuyvToGray_data()
+{
+	addInstructionSetRows();
+}
+
+void GrayscaleConversionTest::testYuyvToGray()
+{
+	QFETCH(InstructionSet, instructionSet);
+
+	const auto source = randomData(TEST_WIDTH * 2);
+
+	QByteArray expected(TEST_WIDTH, 0);
+	for (int x = 0; x < TEST_WIDTH; ++x) {
+		expected[x] = source[2 * x];
+	}
+
+	QByteArray target(TEST_WIDTH, 0);
+	yuyvToGray(reinterpret_cast<const uchar *>(source.constData()), reinterpret_cast<uchar *>(target.data()), TEST_WIDTH, instructionSet);
+	QCOMPARE(target, expected);
+}
+
+void GrayscaleConversionTest::testPremultipliedRgb32ToGray()
+{
+	// ARGB pixels: opaque, half transparent, fully transparent
+	const uchar source[] = {
+		255, 200, 100, 50,
+		128, 100, 50, 25,
+		0, 0, 0, 0,
+	};
+	uchar target[3] = {};
+
+	premultipliedRgb32ToGray(source, target, 3, { 1, 2, 3 }, 0);
+
+	QCOMPARE(target[0], uchar((306 * 200 + 601 * 100 + 117 * 50 + 0x200) >> 10));
+	// The unpremultiplied color is about (199, 100, 50).
+	QVERIFY(qAbs(int(target[1]) - int(target[0])) <= 1);
+	QCOMPARE(target[2], uchar(0));
+}
+
+void GrayscaleConversionTest::benchmarkRgb32ToGray_data()
+{
+	addInstructionSetRows();
+}
+
+void GrayscaleConversionTest::benchmarkRgb32ToGray()
+{
+	QFETCH(InstructionSet, instructionSet);
+
+	const auto source = randomData(BENCHMARK_WIDTH * BENCHMARK_HEIGHT * 4);
+	QByteArray target(BENCHMARK_WIDTH * BENCHMARK_HEIGHT, 0);
+
+	const auto convertFrame = [&]() {
+		for (int y = 0; y < BENCHMARK_HEIGHT; ++y) {
+			rgb32ToGray(
+				reinterpret_cast<const uchar *>(source.constData()) + y * BENCHMARK_WIDTH * 4,
+				reinterpret_cast<uchar *>(target.data()) + y * BENCHMARK_WIDTH,
+				BENCHMARK_WIDTH,
+				{ 1, 2, 3 },
+				instructionSet
+			);
+		}
+	};
+
+	QElapsedTimer timer;
+	timer.start();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; ++i) {
+		convertFrame();
+	}
+	const auto elapsed = std::max<qint64>(1, timer.nsecsElapsed());
+	qInfo().noquote() << QTest::currentDataTag() << QStringLiteral("%1 MPix/s").arg(double(BENCHMARK_ITERATIONS) * BENCHMARK_WIDTH * BENCHMARK_HEIGHT * 1000 / elapsed, 0, 'f', 1);
+
+	QBENCHMARK {
+		convertFrame();
+	}
+}
+
+void GrayscaleConversionTest::addInstructionSetRows()
+{
+	QTest::addColumn<InstructionSet>("instructionSet");
+
+	QTest::newRow("scalar") << InstructionSet::Scalar;
+
+	if (isSupported(InstructionSet::Sse2)) {
+		QTest::newRow("SSE2") << InstructionSet::Sse2;
+	}
+	if (isSupported(InstructionSet::Avx2)) {
+		QTest::newRow("AVX2") << InstructionSet::Avx2;
+	}
+	if (isSupported(InstructionSet::Neon)) {
+		QTest::newRow("NEON") << InstructionSet::Neon;
+	}
+}
+
+QByteArray GrayscaleConversionTest::randomData(int size)
+{
+	QByteArray data(size, 0);
+	auto *generator = QRandomGenerator::global();
+
+	for (auto &byte : data) {
+		byte = char(generator->bounded(256));
+	}
+
+	return data;
+}
+
+// Reference implementation of the conversion that was used before it was vectorized
+QByteArray GrayscaleConversionTest::scalarRgb32ToGray(const QByteArray &source, int width, ChannelOffsets offsets)
+{
+	QByteArray target(width, 0);
+	const auto *pixel = reinterpret_cast<const uchar *>(source.constData());
+
+	for (int x = 0; x < width; ++x, pixel += 4) {
+		target[x] = char((306 * pixel[offsets.red] + 601 * pixel[offsets.green] + 117 * pixel[offsets.blue] + 0x200) >> 10);
+	}
+
+	return target;
+}
+
+QTEST_GUILESS_MAIN(GrayscaleConversionTest)
+#include "GrayscaleConversionTest.moc"
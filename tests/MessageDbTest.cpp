@@ -0,0 +1,652 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QMimeDatabase>
+#include <QTemporaryFile>
+#include <QtTest>
+
+#include "../src/Database.h"
+#include "../src/Globals.h"
+#include "../src/MessageDb.h"
+#include "../src/SqlUtils.h"
+#include "utils.h"
+
+// Queries for the messages, the files, the hashes, the HTTP sources, the encrypted sources and
+// the reactions of one chat
+constexpr quint64 MAX_QUERIES_PER_PAGE = 6;
+
+class MessageDbTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testFetchMessagesByCursor();
+	Q_SLOT void testSearchMessages();
+	Q_SLOT void testAddMessages();
+	Q_SLOT void testFetchMessagesByIds();
+	Q_SLOT void testFetchFiles();
+	Q_SLOT void testThumbnails();
+	Q_SLOT void testLocalFileDeduplication();
+	Q_SLOT void benchmarkFetchMessages_data();
+	Q_SLOT void benchmarkFetchMessages();
+	Q_SLOT void benchmarkFetchMessagesUnderInsertLoad_data();
+	Q_SLOT void benchmarkFetchMessagesUnderInsertLoad();
+	Q_SLOT void benchmarkAddMessages_data();
+	Q_SLOT void benchmarkAddMessages();
+
+	Database m_db;
+	MessageDb m_messageDb = MessageDb(&m_db);
+};
+
+void MessageDbTest::testFetchMessagesByCursor()
+{
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("carol@example.net");
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+	const auto messageCount = 3 * DB_QUERY_LIMIT_MESSAGES;
+
+	const auto addMessage = [&](const QString &id, const QDateTime &timestamp) {
+		Message message;
+		message.accountJid = accountJid;
+		message.chatJid = chatJid;
+		message.senderId = chatJid;
+		message.id = id;
+		message.timestamp = timestamp;
+		message.body = id;
+		wait(m_messageDb.addMessage(message, MessageOrigin::UserInput));
+	};
+
+	// Several messages share a timestamp so that pages end between messages with equal
+	// timestamps.
+	for (int i = 0; i < messageCount; i++) {
+		addMessage(QStringLiteral("%1").arg(i, 3, 10, QLatin1Char('0')), timestamp.addSecs(i / 7));
+	}
+
+	QStringList fetchedIds;
+	MessageDb::MessageCursor cursor;
+
+	while (true) {
+		const auto messages = wait(m_messageDb.fetchMessages(accountJid, chatJid, cursor));
+
+		for (const auto &message : messages) {
+			fetchedIds.append(message.id);
+		}
+
+		if (messages.size() < DB_QUERY_LIMIT_MESSAGES) {
+			break;
+		}
+
+		cursor = { messages.constLast().timestamp, messages.constLast().id };
+
+		// A message added after fetching the first page must not shift the following pages.
+		if (fetchedIds.size() == DB_QUERY_LIMIT_MESSAGES) {
+			addMessage(QStringLiteral("new"), timestamp.addDays(1));
+		}
+	}
+
+	QCOMPARE(fetchedIds.size(), messageCount);
+
+	for (int i = 0; i < messageCount; i++) {
+		QCOMPARE(fetchedIds.at(i), QStringLiteral("%1").arg(messageCount - 1 - i, 3, 10, QLatin1Char('0')));
+	}
+
+	// Only the stubs of the messages between a cursor and a specific message are fetched.
+	const auto newestFetchedIndex = messageCount - 1 - DB_QUERY_LIMIT_MESSAGES;
+	const MessageDb::MessageCursor firstPageCursor = { timestamp.addSecs((newestFetchedIndex + 1) / 7), QStringLiteral("%1").arg(newestFetchedIndex + 1, 3, 10, QLatin1Char('0')) };
+	const auto stubs = wait(m_messageDb.fetchMessageStubsUntilId(accountJid, chatJid, firstPageCursor, QStringLiteral("010")));
+	QCOMPARE(stubs.size(), newestFetchedIndex - 10 + 1);
+	QCOMPARE(stubs.constFirst().id, QStringLiteral("%1").arg(newestFetchedIndex, 3, 10, QLatin1Char('0')));
+	QCOMPARE(stubs.constLast().id, QStringLiteral("010"));
+	QVERIFY(stubs.constLast().body.isEmpty());
+
+	// Nothing is fetched if there is no message with the ID.
+	QVERIFY(wait(m_messageDb.fetchMessageStubsUntilId(accountJid, chatJid, firstPageCursor, QStringLiteral("unknown"))).isEmpty());
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+}
+
+void MessageDbTest::testSearchMessages()
+{
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("dave@example.net");
+	const auto otherChatJid = QStringLiteral("erin@example.net");
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+
+	const auto addMessage = [&](const QString &chatJid, const QString &id, const QString &body, int secs) {
+		Message message;
+		message.accountJid = accountJid;
+		message.chatJid = chatJid;
+		message.senderId = chatJid;
+		message.id = id;
+		message.timestamp = timestamp.addSecs(secs);
+		message.body = body;
+		wait(m_messageDb.addMessage(message, MessageOrigin::UserInput));
+	};
+
+	addMessage(chatJid, QStringLiteral("1"), QStringLiteral("Let's meet at the Café <Central>"), 1);
+	addMessage(chatJid, QStringLiteral("2"), QStringLiteral("Which café?"), 2);
+	addMessage(chatJid, QStringLiteral("3"), QStringLiteral("Never mind"), 3);
+	addMessage(otherChatJid, QStringLiteral("4"), QStringLiteral("The cafeteria is closed"), 4);
+
+	const auto ids = [](const QVector<MessageDb::MessageSearchResult> &results) {
+		QStringList ids;
+		for (const auto &result : results) {
+			ids.append(result.messageId);
+		}
+		return ids;
+	};
+
+	// Words match regardless of case and diacritics and as prefixes.
+	auto results = wait(m_messageDb.searchMessages(accountJid, chatJid, QStringLiteral("CAFE")));
+	QCOMPARE(ids(results), QStringList({ QStringLiteral("2"), QStringLiteral("1") }));
+	QCOMPARE(results.constLast().snippet, QStringLiteral("Let's meet at the <b>Café</b> &lt;Central&gt;"));
+
+	// All words must match.
+	results = wait(m_messageDb.searchMessages(accountJid, chatJid, QStringLiteral("caf cent")));
+	QCOMPARE(ids(results), QStringList({ QStringLiteral("1") }));
+
+	// Loaded messages are matched by the same rule.
+	QVERIFY(MessageDb::matchesSearchString(QStringLiteral("Let's meet at the Café <Central>"), QStringLiteral("caf cent")));
+	QVERIFY(!MessageDb::matchesSearchString(QStringLiteral("Which café?"), QStringLiteral("caf cent")));
+	QVERIFY(!MessageDb::matchesSearchString(QStringLiteral("Never mind"), QStringLiteral("ever")));
+
+	// Characters of the query syntax are searched for literally.
+	results = wait(m_messageDb.searchMessages(accountJid, chatJid, QStringLiteral("(\"café\")")));
+	QCOMPARE(ids(results), QStringList({ QStringLiteral("2"), QStringLiteral("1") }));
+
+	// All chats of an account are searched if no chat is specified.
+	results = wait(m_messageDb.searchMessages(accountJid, {}, QStringLiteral("caf")));
+	QCOMPARE(ids(results), QStringList({ QStringLiteral("4"), QStringLiteral("2"), QStringLiteral("1") }));
+
+	// Results are paged by the cursor of the last result.
+	results = wait(m_messageDb.searchMessages(accountJid, {}, QStringLiteral("caf"), { results.at(1).timestamp, results.at(1).messageId }));
+	QCOMPARE(ids(results), QStringList({ QStringLiteral("1") }));
+
+	// The index follows changes of the messages.
+	wait(m_messageDb.updateMessage(QStringLiteral("3"), [](Message &message) {
+		message.body = QStringLiteral("Café Central it is");
+	}));
+	results = wait(m_messageDb.searchMessages(accountJid, chatJid, QStringLiteral("central")));
+	QCOMPARE(ids(results), QStringList({ QStringLiteral("3"), QStringLiteral("1") }));
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+	results = wait(m_messageDb.searchMessages(accountJid, {}, QStringLiteral("caf")));
+	QCOMPARE(ids(results), QStringList({ QStringLiteral("4") }));
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, otherChatJid));
+}
+
+void MessageDbTest::testAddMessages()
+{
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("frank@example.net");
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+
+	const auto message = [&](const QString &id, const QString &stanzaId) {
+		Message message;
+		message.accountJid = accountJid;
+		message.chatJid = chatJid;
+		message.senderId = chatJid;
+		message.id = id;
+		message.stanzaId = stanzaId;
+		message.timestamp = timestamp;
+		message.body = id;
+		return message;
+	};
+
+	wait(m_messageDb.addMessage(message(QStringLiteral("1"), QStringLiteral("s1")), MessageOrigin::UserInput));
+
+	QVector<QVector<Message>> addedBatches;
+	const auto connection = connect(
+		&m_messageDb,
+		&MessageDb::messagesAdded,
+		this,
+		[&addedBatches](const QVector<Message> &messages) {
+			addedBatches.append(messages);
+		},
+		Qt::DirectConnection);
+
+	// Messages already stored or contained twice in the batch are added only once.
+	const auto queryCountBefore = executedQueryCount();
+	wait(m_messageDb.addMessages(
+		{
+			message(QStringLiteral("1"), {}),
+			message(QStringLiteral("2"), QStringLiteral("s1")),
+			message(QStringLiteral("3"), QStringLiteral("s3")),
+			message(QStringLiteral("4"), QStringLiteral("s4")),
+			message(QStringLiteral("5"), QStringLiteral("s3")),
+		},
+		MessageOrigin::MamBacklog));
+	const auto queryCount = executedQueryCount() - queryCountBefore;
+
+	disconnect(connection);
+
+	QCOMPARE(addedBatches.size(), 1);
+	QStringList addedIds;
+	for (const auto &message : addedBatches.constFirst()) {
+		addedIds.append(message.id);
+	}
+	QCOMPARE(addedIds, QStringList({ QStringLiteral("3"), QStringLiteral("4") }));
+
+	// One query for the deduplication and one per added message
+	QVERIFY2(queryCount <= 1 + 2, qPrintable(QStringLiteral("%1 queries").arg(queryCount)));
+
+	const auto messages = wait(m_messageDb.fetchMessages(accountJid, chatJid));
+	QCOMPARE(messages.size(), 3);
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+}
+
+void MessageDbTest::testFetchMessagesByIds()
+{
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("grace@example.net");
+	const auto otherChatJid = QStringLiteral("heidi@example.net");
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+
+	// More messages than IDs can be bound by one query
+	const auto messageCount = DB_MAX_BOUND_VALUES_PER_QUERY + 10;
+
+	QVector<Message> messages;
+	QVector<QString> messageIds;
+
+	for (int i = 0; i < messageCount; i++) {
+		Message message;
+		message.accountJid = accountJid;
+		message.chatJid = chatJid;
+		message.senderId = chatJid;
+		message.id = QString::number(i);
+		message.timestamp = timestamp.addSecs(i);
+		message.body = message.id;
+		messages.append(message);
+		messageIds.append(message.id);
+	}
+
+	wait(m_messageDb.addMessages(messages, MessageOrigin::MamBacklog));
+
+	// A message with the same ID in another chat is not fetched.
+	auto otherMessage = messages.constFirst();
+	otherMessage.chatJid = otherChatJid;
+	otherMessage.senderId = otherChatJid;
+	otherMessage.stanzaId = QStringLiteral("other");
+	wait(m_messageDb.addMessage(otherMessage, MessageOrigin::UserInput));
+
+	const auto fetchedMessages = wait(m_messageDb.fetchMessagesByIds(accountJid, chatJid, messageIds));
+	QCOMPARE(fetchedMessages.size(), messageCount);
+
+	QSet<QString> fetchedIds;
+	for (const auto &message : fetchedMessages) {
+		QCOMPARE(message.chatJid, chatJid);
+		QCOMPARE(message.body, message.id);
+		fetchedIds.insert(message.id);
+	}
+	QCOMPARE(fetchedIds.size(), messageCount);
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, otherChatJid));
+}
+
+void MessageDbTest::testFetchFiles()
+{
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("peggy@example.net");
+
+	// More file groups than IDs are bound by one query
+	constexpr int fileCount = 120;
+	constexpr qint64 firstFileId = 3000000;
+
+	QVector<Message> messages;
+
+	for (int i = 0; i < fileCount; i++) {
+		const auto fileId = firstFileId + i;
+
+		File file;
+		file.id = fileId;
+		file.fileGroupId = fileId;
+		file.mimeType = QMimeDatabase().mimeTypeForName(QStringLiteral("image/png"));
+		file.hashes = { FileHash { fileId, QXmpp::HashAlgorithm::Sha256, QByteArray::number(fileId) } };
+		file.httpSources = { HttpSource { fileId, QUrl(QStringLiteral("https://example.org/") + QString::number(fileId)) } };
+
+		Message message;
+		message.accountJid = accountJid;
+		message.chatJid = chatJid;
+		message.senderId = chatJid;
+		message.id = QString::number(fileId);
+		message.timestamp = QDateTime::currentDateTimeUtc().addSecs(i);
+		message.fileGroupId = file.fileGroupId;
+		message.files = { file };
+		messages.append(message);
+	}
+
+	wait(m_messageDb.addMessages(messages, MessageOrigin::MamBacklog));
+
+	const auto files = wait(m_messageDb.fetchFiles(accountJid, chatJid));
+	QCOMPARE(files.size(), fileCount);
+
+	for (int i = 0; i < fileCount; i++) {
+		const auto &file = files.at(i);
+		QCOMPARE(file.id, firstFileId + i);
+		QCOMPARE(file.hashes.size(), 1);
+		QCOMPARE(file.hashes.constFirst().hashValue, QByteArray::number(file.id));
+		QCOMPARE(file.httpSources.size(), 1);
+		QCOMPARE(file.httpSources.constFirst().url, QUrl(QStringLiteral("https://example.org/") + QString::number(file.id)));
+	}
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+}
+
+void MessageDbTest::testThumbnails()
+{
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("ivan@example.net");
+	const auto thumbnail = QByteArray(2048, 't');
+
+	File file;
+	file.id = 1000000;
+	file.fileGroupId = 1000000;
+	file.mimeType = QMimeDatabase().mimeTypeForName(QStringLiteral("image/jpeg"));
+	file.thumbnail = thumbnail;
+
+	Message message;
+	message.accountJid = accountJid;
+	message.chatJid = chatJid;
+	message.senderId = accountJid;
+	message.id = QStringLiteral("thumbnail");
+	message.timestamp = QDateTime::currentDateTimeUtc();
+	message.deliveryState = Enums::DeliveryState::Pending;
+	message.fileGroupId = file.fileGroupId;
+	message.files = { file };
+
+	wait(m_messageDb.addMessage(message, MessageOrigin::UserInput));
+
+	// The thumbnail is not fetched with its file.
+	const auto fetchedFile = wait(m_messageDb.fetchMessages(accountJid, chatJid)).constFirst().files.constFirst();
+	QVERIFY(fetchedFile.thumbnail.isEmpty());
+	QVERIFY(fetchedFile.hasStoredThumbnail);
+	QCOMPARE(wait(m_messageDb.fetchThumbnail(file.id)), thumbnail);
+
+	// Updating a file whose thumbnail has not been fetched keeps the stored thumbnail.
+	wait(m_messageDb.updateMessage(message.id, [](Message &message) {
+		message.files.first().localFilePath = QStringLiteral("/tmp/thumbnail.jpg");
+	}));
+	QCOMPARE(wait(m_messageDb.fetchThumbnail(file.id)), thumbnail);
+	QCOMPARE(wait(m_messageDb.fetchMessages(accountJid, chatJid)).constFirst().files.constFirst().localFilePath, QStringLiteral("/tmp/thumbnail.jpg"));
+
+	// Pending messages are fetched with their thumbnails in order to send them.
+	const auto pendingMessages = wait(m_messageDb.fetchPendingMessages(accountJid));
+	const auto pendingMessage = std::find_if(pendingMessages.cbegin(), pendingMessages.cend(), [&](const Message &pendingMessage) {
+		return pendingMessage.id == message.id;
+	});
+	QVERIFY(pendingMessage != pendingMessages.cend());
+	QCOMPARE(pendingMessage->files.constFirst().thumbnail, thumbnail);
+
+	// Messages fetched again for sending them, e.g., corrections, include their thumbnails.
+	QVERIFY(wait(m_messageDb.fetchMessagesByIds(accountJid, chatJid, { message.id })).constFirst().files.constFirst().thumbnail.isEmpty());
+	QCOMPARE(wait(m_messageDb.fetchMessagesByIds(accountJid, chatJid, { message.id }, true)).constFirst().files.constFirst().thumbnail, thumbnail);
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+	QVERIFY(wait(m_messageDb.fetchThumbnail(file.id)).isEmpty());
+}
+
+void MessageDbTest::testLocalFileDeduplication()
+{
+	qRegisterMetaType<QVector<QString>>();
+
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("judy@example.net");
+	const auto otherChatJid = QStringLiteral("mallory@example.net");
+	const auto hashValue = QByteArray(32, 'h');
+
+	QTemporaryFile localFile;
+	QVERIFY(localFile.open());
+	const auto localFilePath = localFile.fileName();
+
+	const auto createMessage = [&](const QString &chatJid, qint64 fileId, QXmpp::HashAlgorithm hashType) {
+		File file;
+		file.id = fileId;
+		file.fileGroupId = fileId;
+		file.mimeType = QMimeDatabase().mimeTypeForName(QStringLiteral("image/png"));
+		file.hashes = { FileHash { fileId, hashType, hashValue } };
+
+		Message message;
+		message.accountJid = accountJid;
+		message.chatJid = chatJid;
+		message.senderId = chatJid;
+		message.id = QString::number(fileId);
+		message.timestamp = QDateTime::currentDateTimeUtc();
+		message.fileGroupId = file.fileGroupId;
+		message.files = { file };
+		return message;
+	};
+
+	auto message = createMessage(chatJid, 2000000, QXmpp::HashAlgorithm::Sha256);
+	message.files.first().localFilePath = localFilePath;
+	const auto forwardedMessage = createMessage(otherChatJid, 2000001, QXmpp::HashAlgorithm::Sha256);
+	wait(m_messageDb.addMessages({ message, forwardedMessage }, MessageOrigin::UserInput));
+
+	const auto &forwardedFile = forwardedMessage.files.constFirst();
+
+	// Hashes of weak algorithms are not used.
+	QVERIFY(!wait(m_messageDb.referenceLocalFile(accountJid, forwardedMessage.id, forwardedFile.id, { FileHash { forwardedFile.id, QXmpp::HashAlgorithm::Sha1, hashValue } })));
+
+	// Files of other accounts are not used.
+	QVERIFY(!wait(m_messageDb.referenceLocalFile(QStringLiteral("bob@example.org"), forwardedMessage.id, forwardedFile.id, forwardedFile.hashes)));
+
+	// A file with the same content is found by its hash and referenced.
+	QVERIFY(wait(m_messageDb.referenceLocalFile(accountJid, forwardedMessage.id, forwardedFile.id, forwardedFile.hashes)));
+	const auto forwardedMessages = wait(m_messageDb.fetchMessagesByIds(accountJid, otherChatJid, { forwardedMessage.id }));
+	QCOMPARE(forwardedMessages.size(), 1);
+	QCOMPARE(forwardedMessages.constFirst().files.constFirst().localFilePath, localFilePath);
+
+	QSignalSpy unreferencedSpy(&m_messageDb, &MessageDb::localFilesUnreferenced);
+
+	// The local file is still referenced by the forwarded message.
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+	QCOMPARE(unreferencedSpy.size(), 0);
+	QVERIFY(wait(m_messageDb.isLocalFileReferenced(localFilePath)));
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, otherChatJid));
+	QCOMPARE(unreferencedSpy.size(), 1);
+	QCOMPARE(unreferencedSpy.constFirst().constFirst().value<QVector<QString>>(), QVector<QString> { localFilePath });
+	QVERIFY(!wait(m_messageDb.isLocalFileReferenced(localFilePath)));
+	QVERIFY(!wait(m_messageDb.referenceLocalFile(accountJid, forwardedMessage.id, forwardedFile.id, forwardedFile.hashes)));
+}
+
+void MessageDbTest::benchmarkFetchMessages_data()
+{
+	QTest::addColumn<int>("filesPerMessage");
+
+	QTest::newRow("no files") << 0;
+	QTest::newRow("1 file") << 1;
+	QTest::newRow("5 files") << 5;
+	QTest::newRow("20 files") << 20;
+}
+
+void MessageDbTest::benchmarkFetchMessages()
+{
+	QFETCH(int, filesPerMessage);
+
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("bob@example.com");
+	const auto mimeType = QMimeDatabase().mimeTypeForName(QStringLiteral("image/jpeg"));
+	static qint64 fileGroupId = 0;
+	static qint64 fileId = 0;
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+
+	for (int i = 0; i < DB_QUERY_LIMIT_MESSAGES; i++) {
+		Message message;
+		message.accountJid = accountJid;
+		message.chatJid = chatJid;
+		message.senderId = chatJid;
+		message.id = QString::number(i);
+		message.timestamp = QDateTime::currentDateTimeUtc().addSecs(i);
+		message.body = QStringLiteral("Message %1").arg(i);
+
+		if (filesPerMessage) {
+			message.fileGroupId = ++fileGroupId;
+		}
+
+		for (int j = 0; j < filesPerMessage; j++) {
+			File file;
+			file.id = ++fileId;
+			file.fileGroupId = fileGroupId;
+			file.mimeType = mimeType;
+			file.thumbnail = QByteArray(2048, 't');
+			file.hashes = { FileHash { file.id, QXmpp::HashAlgorithm::Sha256, QByteArray(32, 'a') } };
+			file.httpSources = { HttpSource { file.id, QUrl(QStringLiteral("https://example.org/%1.jpg").arg(file.id)) } };
+			message.files.append(file);
+		}
+
+		wait(m_messageDb.addMessage(message, MessageOrigin::UserInput));
+	}
+
+	const auto queryCountBefore = executedQueryCount();
+	const auto messages = wait(m_messageDb.fetchMessages(accountJid, chatJid));
+	const auto queryCount = executedQueryCount() - queryCountBefore;
+
+	QCOMPARE(messages.size(), DB_QUERY_LIMIT_MESSAGES);
+	for (const auto &message : messages) {
+		QCOMPARE(message.files.size(), filesPerMessage);
+	}
+
+	// The number of queries must not depend on the number of messages and files.
+	QVERIFY2(queryCount <= MAX_QUERIES_PER_PAGE, qPrintable(QStringLiteral("%1 queries per page").arg(queryCount)));
+
+	QBENCHMARK {
+		wait(m_messageDb.fetchMessages(accountJid, chatJid));
+	}
+}
+
+void MessageDbTest::benchmarkFetchMessagesUnderInsertLoad_data()
+{
+	QTest::addColumn<bool>("readerPool");
+
+	QTest::newRow("database thread") << false;
+	QTest::newRow("reader pool") << true;
+}
+
+void MessageDbTest::benchmarkFetchMessagesUnderInsertLoad()
+{
+	QFETCH(bool, readerPool);
+
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("judy@example.net");
+	const auto importedChatJid = QStringLiteral("mallory@example.net");
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+	static int importedMessageCount = 0;
+
+	const auto createMessage = [&](const QString &chatJid, const QString &id) {
+		Message message;
+		message.accountJid = accountJid;
+		message.chatJid = chatJid;
+		message.senderId = chatJid;
+		message.id = id;
+		message.timestamp = timestamp;
+		message.body = QStringLiteral("Message %1").arg(id);
+		return message;
+	};
+
+	QVector<Message> messages;
+	for (int i = 0; i < DB_QUERY_LIMIT_MESSAGES; i++) {
+		messages.append(createMessage(chatJid, QString::number(i)));
+	}
+	wait(m_messageDb.addMessages(messages, MessageOrigin::MamBacklog));
+
+	QVector<QString> messageIds;
+	for (const auto &message : std::as_const(messages)) {
+		messageIds.append(message.id);
+	}
+
+	// Messages are fetched on the reader pool when a chat is opened.
+	// Fetching messages by their IDs is done on the database thread and thus waits for the
+	// insertions.
+	const auto fetchMessages = [this, readerPool, accountJid, chatJid, messageIds]() {
+		return readerPool ? m_messageDb.fetchMessages(accountJid, chatJid) : m_messageDb.fetchMessagesByIds(accountJid, chatJid, messageIds);
+	};
+
+	// The latency of opening a chat while the history of another chat is being imported
+	QBENCHMARK {
+		for (int i = 0; i < 5; i++) {
+			QVector<Message> importedMessages;
+			for (int j = 0; j < 100; j++) {
+				importedMessages.append(createMessage(importedChatJid, QStringLiteral("imported-%1").arg(importedMessageCount++)));
+			}
+
+			m_messageDb.addMessages(importedMessages, MessageOrigin::MamBacklog);
+		}
+
+		QCOMPARE(wait(fetchMessages()).size(), DB_QUERY_LIMIT_MESSAGES);
+	}
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, importedChatJid));
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+}
+
+void MessageDbTest::benchmarkAddMessages_data()
+{
+	QTest::addColumn<int>("batchSize");
+
+	QTest::newRow("1 message") << 1;
+	QTest::newRow("7 messages") << 7;
+	QTest::newRow("100 messages") << 100;
+	QTest::newRow("1000 messages") << 1000;
+}
+
+void MessageDbTest::benchmarkAddMessages()
+{
+	QFETCH(int, batchSize);
+
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("niaj@example.net");
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+	static int messageCount = 0;
+
+	// Creates messages with varying combinations of IDs so that the deduplication has to handle
+	// all of them.
+	const auto createMessages = [&](int count) {
+		QVector<Message> messages;
+		messages.reserve(count);
+
+		for (int i = 0; i < count; i++) {
+			const auto id = QString::number(messageCount++);
+
+			Message message;
+			message.accountJid = accountJid;
+			message.chatJid = chatJid;
+			message.senderId = i % 2 ? accountJid : chatJid;
+			message.id = id;
+			message.timestamp = timestamp.addSecs(i);
+			message.body = QStringLiteral("Message %1").arg(id);
+
+			if (i % 3) {
+				message.stanzaId = QStringLiteral("stanza-") + id;
+			}
+
+			if (i % 4) {
+				message.originId = QStringLiteral("origin-") + id;
+			}
+
+			messages.append(message);
+		}
+
+		return messages;
+	};
+
+	// Prepare all queries needed for adding messages.
+	wait(m_messageDb.addMessages(createMessages(3), MessageOrigin::MamBacklog));
+	const auto cachedQueryCountBefore = cachedQueryCount();
+
+	QBENCHMARK {
+		wait(m_messageDb.addMessages(createMessages(batchSize), MessageOrigin::MamBacklog));
+	}
+
+	// The prepared queries must be reused independently of the batch size and the IDs.
+	QCOMPARE(cachedQueryCount(), cachedQueryCountBefore);
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+}
+
+QTEST_GUILESS_MAIN(MessageDbTest)
+#include "MessageDbTest.moc"
@@ -0,0 +1,242 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include "../src/MessageRowCache.h"
+
+const auto ACCOUNT_JID = QStringLiteral("alice@example.org");
+const auto CONTACT_JID = QStringLiteral("bob@example.com");
+
+class MessageRowCacheTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testNextDate();
+	Q_SLOT void testIsFollowedByOwnMessagesOnly();
+	Q_SLOT void testReactions();
+	Q_SLOT void benchmarkScrolling_data();
+	Q_SLOT void benchmarkScrolling();
+
+	static QVector<Message> createMessages(int count, const QDateTime &firstTimestamp, int secsBetween);
+	static QDate searchNextDate(const QVector<Message> &messages, int row);
+	static bool isFollowedByOwnMessagesOnly(const QVector<Message> &messages, int row);
+};
+
+void MessageRowCacheTest::testNextDate()
+{
+	auto *generator = QRandomGenerator::global();
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+
+	// About five messages per day
+	auto messages = createMessages(200, timestamp, 5 * 60 * 60);
+	MessageRowCache cache(messages);
+
+	const auto verify = [&]() {
+		for (int i = 0; i < messages.size(); i++) {
+			QCOMPARE(cache.nextDate(i), searchNextDate(messages, i));
+		}
+	};
+
+	verify();
+
+	for (int i = 0; i < 100; i++) {
+		const auto row = int(generator->bounded(messages.size()));
+
+		switch (generator->bounded(3)) {
+		case 0: {
+			// Insert a message at its sorted position.
+			Message message;
+			message.senderId = CONTACT_JID;
+			message.timestamp = messages.at(row).timestamp.addSecs(generator->bounded(-2 * 24 * 60 * 60, 2 * 24 * 60 * 60));
+			const auto position = std::find_if(messages.cbegin(), messages.cend(), [&](const Message &other) {
+				return message.timestamp > other.timestamp;
+			}) - messages.cbegin();
+			messages.insert(position, message);
+			cache.insertRows(position, position);
+			break;
+		}
+		case 1:
+			messages.removeAt(row);
+			cache.removeRows(row, row);
+			break;
+		case 2:
+			// Modify a message in place like a correction, which can break the order.
+			messages[row].timestamp = messages.at(row).timestamp.addSecs(generator->bounded(-24 * 60 * 60, 24 * 60 * 60));
+			cache.updateRows(row, row);
+			break;
+		}
+
+		// Access only some rows so that the cache is partially filled before the next change.
+		for (int j = 0; j < 10; j++) {
+			const auto accessedRow = int(generator->bounded(messages.size()));
+			QCOMPARE(cache.nextDate(accessedRow), searchNextDate(messages, accessedRow));
+		}
+	}
+
+	verify();
+}
+
+void MessageRowCacheTest::testIsFollowedByOwnMessagesOnly()
+{
+	auto messages = createMessages(10, QDateTime::currentDateTimeUtc(), 60);
+	for (int i = 0; i < 3; i++) {
+		messages[i].senderId = ACCOUNT_JID;
+	}
+
+	MessageRowCache cache(messages);
+	cache.setAccountJid(ACCOUNT_JID);
+
+	for (int i = 0; i < messages.size(); i++) {
+		QCOMPARE(cache.isFollowedByOwnMessagesOnly(i), isFollowedByOwnMessagesOnly(messages, i));
+	}
+
+	// A contact message after the own messages
+	Message message;
+	message.senderId = CONTACT_JID;
+	message.timestamp = QDateTime::currentDateTimeUtc().addDays(1);
+	messages.prepend(message);
+	cache.insertRows(0, 0);
+
+	for (int i = 0; i < messages.size(); i++) {
+		QVERIFY(!cache.isFollowedByOwnMessagesOnly(i));
+	}
+
+	messages.removeFirst();
+	cache.removeRows(0, 0);
+	QVERIFY(cache.isFollowedByOwnMessagesOnly(2));
+
+	messages[1].senderId = CONTACT_JID;
+	cache.updateRows(1, 1);
+	QVERIFY(cache.isFollowedByOwnMessagesOnly(0));
+	QVERIFY(!cache.isFollowedByOwnMessagesOnly(2));
+}
+
+void MessageRowCacheTest::testReactions()
+{
+	auto messages = createMessages(1, QDateTime::currentDateTimeUtc(), 0);
+	auto &reactionSenders = messages[0].reactionSenders;
+	reactionSenders[CONTACT_JID].reactions = { { QStringLiteral("👍") }, { QStringLiteral("🎉") } };
+	reactionSenders[ACCOUNT_JID].reactions = { { QStringLiteral("👍"), MessageReactionDeliveryState::PendingAddition } };
+
+	MessageRowCache cache(messages);
+	cache.setAccountJid(ACCOUNT_JID);
+
+	auto displayedReactions = cache.displayedReactions(0);
+	QCOMPARE(displayedReactions.size(), 2);
+	const auto thumbsUp = std::find_if(displayedReactions.cbegin(), displayedReactions.cend(), [](const DisplayedMessageReaction &reaction) {
+		return reaction.emoji == QStringLiteral("👍");
+	});
+	QVERIFY(thumbsUp != displayedReactions.cend());
+	QCOMPARE(thumbsUp->count, 2);
+	QVERIFY(thumbsUp->ownReactionIncluded);
+	QCOMPARE(thumbsUp->deliveryState, MessageReactionDeliveryState::PendingAddition);
+
+	auto detailedReactions = cache.detailedReactions(0);
+	QCOMPARE(detailedReactions.size(), 1);
+	QCOMPARE(detailedReactions.constFirst().senderJid, CONTACT_JID);
+	QCOMPARE(detailedReactions.constFirst().emojis.size(), 2);
+
+	// Cached reactions are updated after the message is changed.
+	reactionSenders.remove(CONTACT_JID);
+	cache.updateRows(0, 0);
+
+	displayedReactions = cache.displayedReactions(0);
+	QCOMPARE(displayedReactions.size(), 1);
+	QCOMPARE(displayedReactions.constFirst().count, 1);
+	QVERIFY(cache.detailedReactions(0).isEmpty());
+}
+
+void MessageRowCacheTest::benchmarkScrolling_data()
+{
+	QTest::addColumn<bool>("cached");
+	QTest::addColumn<int>("messageCount");
+
+	QTest::newRow("uncached, 1000 messages") << false << 1000;
+	QTest::newRow("uncached, 10000 messages") << false << 10000;
+	QTest::newRow("cached, 1000 messages") << true << 1000;
+	QTest::newRow("cached, 10000 messages") << true << 10000;
+	QTest::newRow("cached, 100000 messages") << true << 100000;
+}
+
+void MessageRowCacheTest::benchmarkScrolling()
+{
+	QFETCH(bool, cached);
+	QFETCH(int, messageCount);
+
+	// About 500 messages per day, all sent by the user so that the last read marker is searched
+	// through the whole chat
+	auto messages = createMessages(messageCount, QDateTime::currentDateTimeUtc(), 3 * 60);
+	for (auto &message : messages) {
+		message.senderId = ACCOUNT_JID;
+	}
+
+	// Scrolling from the most recent message to the oldest one accesses the roles of each row once.
+	// The time per row has to be constant for the cache, which results in a total time that grows
+	// linearly with the number of messages.
+	QBENCHMARK {
+		MessageRowCache cache(messages);
+		cache.setAccountJid(ACCOUNT_JID);
+
+		for (int i = 0; i < messages.size(); i++) {
+			if (cached) {
+				cache.nextDate(i);
+				cache.isFollowedByOwnMessagesOnly(i);
+				cache.time(i);
+				cache.displayedReactions(i);
+			} else {
+				searchNextDate(messages, i);
+				isFollowedByOwnMessagesOnly(messages, i);
+			}
+		}
+	}
+}
+
+QVector<Message> MessageRowCacheTest::createMessages(int count, const QDateTime &firstTimestamp, int secsBetween)
+{
+	// The messages are sorted from the newest to the oldest one.
+	QVector<Message> messages;
+	messages.reserve(count);
+
+	for (int i = 0; i < count; i++) {
+		Message message;
+		message.accountJid = ACCOUNT_JID;
+		message.chatJid = CONTACT_JID;
+		message.senderId = CONTACT_JID;
+		message.id = QString::number(i);
+		message.timestamp = firstTimestamp.addSecs(-i * secsBetween);
+		messages.append(message);
+	}
+
+	return messages;
+}
+
+QDate MessageRowCacheTest::searchNextDate(const QVector<Message> &messages, int row)
+{
+	const auto startDate = messages.at(row).timestamp.toLocalTime().date();
+
+	for (int i = row; i >= 0; i--) {
+		if (const auto date = messages.at(i).timestamp.toLocalTime().date(); date > startDate) {
+			return date;
+		}
+	}
+
+	return {};
+}
+
+bool MessageRowCacheTest::isFollowedByOwnMessagesOnly(const QVector<Message> &messages, int row)
+{
+	for (int i = row; i >= 0; i--) {
+		if (messages.at(i).senderId != ACCOUNT_JID) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+QTEST_GUILESS_MAIN(MessageRowCacheTest)
+#include "MessageRowCacheTest.moc"
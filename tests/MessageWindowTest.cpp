@@ -0,0 +1,435 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+
+#include "../src/Globals.h"
+#include "../src/MessageWindow.h"
+
+const auto ACCOUNT_JID = QStringLiteral("alice@example.org");
+const auto CONTACT_JID = QStringLiteral("bob@example.com");
+
+class MessageWindowTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testInsertRows();
+	Q_SLOT void testInsertStubRows();
+	Q_SLOT void testRemoveRows();
+	Q_SLOT void testMoveTo();
+	Q_SLOT void testMoveToWithoutIds();
+	Q_SLOT void testLoad();
+	Q_SLOT void testIsCloseToEdge();
+	Q_SLOT void testMemoryUsage();
+
+	static Message createMessage(int number, bool withId = true);
+	static QVector<Message> createMessages(int count);
+	static QVector<Message> fetchMessages(const QVector<Message> &storedMessages, const QVector<QString> &messageIds);
+	static bool isStub(const Message &message);
+};
+
+void MessageWindowTest::testInsertRows()
+{
+	QVector<Message> messages;
+	MessageWindow window(messages);
+	window.setSize(10);
+
+	// Messages inserted into an empty window extend it.
+	messages = createMessages(5);
+	QVERIFY(!window.insertRows(0, 4));
+	QCOMPARE(window.first(), 0);
+	QCOMPARE(window.last(), 4);
+
+	// The window is extended beyond its size until it is moved.
+	const auto moreMessages = createMessages(10);
+	messages.append(moreMessages.mid(5));
+	QVERIFY(!window.insertRows(5, 9));
+	messages.append(createMessage(10));
+	QVERIFY(window.insertRows(10, 10));
+	QCOMPARE(window.last(), 10);
+
+	window.moveTo(10, [](int, int) { });
+	QCOMPARE(window.first(), 1);
+	QCOMPARE(window.last(), 10);
+
+	// Messages inserted before the window are reduced to stubs and move the window.
+	messages.insert(0, createMessage(100));
+	QVERIFY(!window.insertRows(0, 0));
+	QVERIFY(isStub(messages.at(0)));
+	QCOMPARE(window.first(), 2);
+	QCOMPARE(window.last(), 11);
+
+	// Messages without IDs are kept because they cannot be fetched again.
+	messages.insert(0, createMessage(101, false));
+	QVERIFY(!window.insertRows(0, 0));
+	QVERIFY(!isStub(messages.at(0)));
+	QVERIFY(!window.isStub(0));
+	QCOMPARE(window.first(), 3);
+	QCOMPARE(window.last(), 12);
+
+	// Messages inserted within the window extend it.
+	messages.insert(5, createMessage(102));
+	QVERIFY(window.insertRows(5, 5));
+	QVERIFY(!isStub(messages.at(5)));
+	QCOMPARE(window.first(), 3);
+	QCOMPARE(window.last(), 13);
+
+	// Messages inserted after the window are reduced to stubs.
+	window.moveTo(3, [](int, int) { });
+	QCOMPARE(window.first(), 0);
+	QCOMPARE(window.last(), 9);
+
+	messages.insert(12, createMessage(103));
+	QVERIFY(!window.insertRows(12, 12));
+	QVERIFY(isStub(messages.at(12)));
+	QVERIFY(window.isStub(12));
+	QCOMPARE(window.last(), 9);
+
+	// Messages without IDs are kept after the window as well.
+	messages.insert(12, createMessage(104, false));
+	QVERIFY(!window.insertRows(12, 12));
+	QVERIFY(!isStub(messages.at(12)));
+	QVERIFY(!window.isStub(12));
+}
+
+void MessageWindowTest::testInsertStubRows()
+{
+	auto messages = createMessages(10);
+	MessageWindow window(messages);
+	window.setSize(10);
+	window.insertRows(0, 9);
+
+	// Stubs appended directly after the window do not extend it.
+	for (int i = 10; i < 15; i++) {
+		messages.append(createMessage(i));
+		messages.last().body.clear();
+	}
+	window.insertStubRows(10, 14);
+	QCOMPARE(window.first(), 0);
+	QCOMPARE(window.last(), 9);
+	QVERIFY(window.isStub(10));
+	QVERIFY(!window.isLoaded(10));
+
+	// Moving the window to a stub fetches the stubs entering it.
+	const auto messageIds = window.moveTo(14, [](int, int) { });
+	QCOMPARE(window.first(), 5);
+	QCOMPARE(window.last(), 14);
+	QCOMPARE(messageIds.size(), 5);
+
+	// Stubs inserted before the window move it.
+	messages.insert(0, createMessage(100));
+	messages.first().body.clear();
+	window.insertStubRows(0, 0);
+	QCOMPARE(window.first(), 6);
+	QCOMPARE(window.last(), 15);
+}
+
+void MessageWindowTest::testRemoveRows()
+{
+	auto messages = createMessages(30);
+	MessageWindow window(messages);
+	window.setSize(10);
+	window.insertRows(0, 29);
+	window.moveTo(15, [](int, int) { });
+	QCOMPARE(window.first(), 10);
+	QCOMPARE(window.last(), 19);
+
+	// Removing rows before the window moves it.
+	messages.remove(0, 2);
+	window.removeRows(0, 1);
+	QCOMPARE(window.first(), 8);
+	QCOMPARE(window.last(), 17);
+
+	// Removing rows after the window does not change it.
+	messages.remove(20, 2);
+	window.removeRows(20, 21);
+	QCOMPARE(window.first(), 8);
+	QCOMPARE(window.last(), 17);
+
+	// Removing rows within the window shrinks it.
+	messages.remove(10, 2);
+	window.removeRows(10, 11);
+	QCOMPARE(window.first(), 8);
+	QCOMPARE(window.last(), 15);
+
+	// Removing rows overlapping the start of the window shrinks it from the start.
+	messages.remove(6, 4);
+	window.removeRows(6, 9);
+	QCOMPARE(window.first(), 6);
+	QCOMPARE(window.last(), 11);
+
+	// Removing rows overlapping the end of the window shrinks it from the end.
+	messages.remove(10, 4);
+	window.removeRows(10, 13);
+	QCOMPARE(window.first(), 6);
+	QCOMPARE(window.last(), 9);
+
+	// Removing all rows of the window empties it.
+	messages.remove(5, 6);
+	window.removeRows(5, 10);
+	QVERIFY(window.first() > window.last());
+
+	window.reset();
+	QCOMPARE(window.first(), 0);
+	QCOMPARE(window.last(), -1);
+}
+
+void MessageWindowTest::testMoveTo()
+{
+	const auto storedMessages = createMessages(30);
+	auto messages = storedMessages;
+	MessageWindow window(messages);
+	window.setSize(10);
+	window.insertRows(0, 29);
+
+	QVector<std::pair<int, int>> evictedRows;
+	const auto handleEvictedRows = [&](int first, int last) {
+		evictedRows.append({ first, last });
+	};
+
+	// The messages after the window are reduced to stubs.
+	QVERIFY(window.moveTo(0, handleEvictedRows).isEmpty());
+	QCOMPARE(window.first(), 0);
+	QCOMPARE(window.last(), 9);
+	QCOMPARE(evictedRows, (QVector<std::pair<int, int>> { { 10, 29 } }));
+
+	for (int i = 0; i < messages.size(); i++) {
+		QCOMPARE(isStub(messages.at(i)), i > 9);
+		QCOMPARE(window.isStub(i), i > 9);
+	}
+
+	// Moving the window to the same position does not change anything.
+	evictedRows.clear();
+	QVERIFY(window.moveTo(2, handleEvictedRows).isEmpty());
+	QVERIFY(evictedRows.isEmpty());
+
+	// The stubs entering the window must be fetched.
+	auto messageIds = window.moveTo(14, handleEvictedRows);
+	QCOMPARE(window.first(), 9);
+	QCOMPARE(window.last(), 18);
+	QCOMPARE(evictedRows, (QVector<std::pair<int, int>> { { 0, 8 } }));
+	QCOMPARE(messageIds.size(), 9);
+	for (int i = 10; i <= 18; i++) {
+		QVERIFY(messageIds.contains(storedMessages.at(i).id));
+	}
+
+	// The window stays within the list.
+	evictedRows.clear();
+	messageIds = window.moveTo(29, handleEvictedRows);
+	QCOMPARE(window.first(), 20);
+	QCOMPARE(window.last(), 29);
+	QCOMPARE(evictedRows, (QVector<std::pair<int, int>> { { 9, 18 } }));
+	QCOMPARE(messageIds.size(), 10);
+
+	// All messages are kept without a size.
+	evictedRows.clear();
+	window.setSize(0);
+	messageIds = window.moveTo(0, handleEvictedRows);
+	QCOMPARE(window.first(), 0);
+	QCOMPARE(window.last(), 29);
+	QVERIFY(evictedRows.isEmpty());
+	QCOMPARE(messageIds.size(), 20);
+	QVERIFY(!window.isCloseToEdge(0));
+}
+
+void MessageWindowTest::testMoveToWithoutIds()
+{
+	auto messages = createMessages(30);
+	messages[25] = createMessage(25, false);
+	MessageWindow window(messages);
+	window.setSize(10);
+	window.insertRows(0, 29);
+
+	window.moveTo(0, [](int, int) { });
+	QVERIFY(!isStub(messages.at(25)));
+	QVERIFY(!window.isStub(25));
+
+	// Messages without IDs cannot be fetched.
+	const auto messageIds = window.moveTo(29, [](int, int) { });
+	QCOMPARE(messageIds.size(), 9);
+	QVERIFY(!messageIds.contains(QString()));
+}
+
+void MessageWindowTest::testLoad()
+{
+	const auto storedMessages = createMessages(30);
+	auto messages = storedMessages;
+	MessageWindow window(messages);
+	window.setSize(10);
+	window.insertRows(0, 29);
+	window.moveTo(0, [](int, int) { });
+
+	auto messageIds = window.moveTo(14, [](int, int) { });
+	auto fetchedMessages = fetchMessages(storedMessages, messageIds);
+
+	// Stubs entering the window are not loaded until their messages are fetched.
+	QVERIFY(!window.isStub(10));
+	QVERIFY(!window.isLoaded(10));
+	QVERIFY(window.isLoaded(9));
+
+	int processedMessageCount = 0;
+	const auto processMessage = [&](Message &message) {
+		message.spoilerHint = QStringLiteral("processed");
+		processedMessageCount++;
+	};
+
+	const auto loadedRows = window.load(fetchedMessages, processMessage);
+	QVERIFY(loadedRows);
+	QCOMPARE(loadedRows->first, 10);
+	QCOMPARE(loadedRows->second, 18);
+	QCOMPARE(processedMessageCount, 9);
+
+	for (int i = 10; i <= 18; i++) {
+		QCOMPARE(messages.at(i).body, storedMessages.at(i).body);
+		QCOMPARE(messages.at(i).spoilerHint, QStringLiteral("processed"));
+		QVERIFY(window.isLoaded(i));
+	}
+
+	// Only the fetched messages that are still within the window are loaded.
+	messageIds = window.moveTo(22, [](int, int) { });
+	fetchedMessages = fetchMessages(storedMessages, messageIds);
+	window.moveTo(26, [](int, int) { });
+
+	processedMessageCount = 0;
+	const auto partiallyLoadedRows = window.load(fetchedMessages, processMessage);
+	QVERIFY(partiallyLoadedRows);
+	QCOMPARE(partiallyLoadedRows->first, 20);
+	QCOMPARE(partiallyLoadedRows->second, 26);
+	QCOMPARE(processedMessageCount, 7);
+	QVERIFY(isStub(messages.at(19)));
+	QVERIFY(!window.isLoaded(19));
+
+	// Nothing is loaded if the window has left all fetched messages.
+	window.moveTo(0, [](int, int) { });
+	QVERIFY(!window.load(fetchedMessages, processMessage));
+}
+
+void MessageWindowTest::testIsCloseToEdge()
+{
+	auto messages = createMessages(100);
+	MessageWindow window(messages);
+	window.setSize(20);
+	window.insertRows(0, 99);
+	window.moveTo(50, [](int, int) { });
+	QCOMPARE(window.first(), 40);
+	QCOMPARE(window.last(), 59);
+
+	QVERIFY(window.isCloseToEdge(40));
+	QVERIFY(window.isCloseToEdge(44));
+	QVERIFY(!window.isCloseToEdge(45));
+	QVERIFY(!window.isCloseToEdge(54));
+	QVERIFY(window.isCloseToEdge(55));
+	QVERIFY(window.isCloseToEdge(59));
+
+	// The edges of the list cannot be exceeded.
+	window.moveTo(0, [](int, int) { });
+	QVERIFY(!window.isCloseToEdge(0));
+	QVERIFY(window.isCloseToEdge(19));
+
+	window.moveTo(99, [](int, int) { });
+	QVERIFY(!window.isCloseToEdge(99));
+	QVERIFY(window.isCloseToEdge(80));
+}
+
+void MessageWindowTest::testMemoryUsage()
+{
+	constexpr int messageCount = 5000;
+	constexpr int bodyLength = 1000;
+
+	auto storedMessages = createMessages(messageCount);
+	for (auto &message : storedMessages) {
+		message.body = QString(bodyLength, u'a');
+	}
+
+	QVector<Message> messages;
+	MessageWindow window(messages);
+	window.setSize(DEFAULT_MESSAGE_WINDOW_SIZE);
+
+	int maxLoadedRowCount = 0;
+	qint64 maxBodySize = 0;
+
+	// Scroll through the whole history page by page like the chat view does.
+	for (int first = 0; first < messageCount; first += DB_QUERY_LIMIT_MESSAGES) {
+		const auto last = first + DB_QUERY_LIMIT_MESSAGES - 1;
+		messages.append(storedMessages.mid(first, DB_QUERY_LIMIT_MESSAGES));
+
+		if (window.insertRows(first, last)) {
+			const auto messageIds = window.moveTo(last, [](int, int) { });
+			window.load(fetchMessages(storedMessages, messageIds), [](Message &) { });
+		}
+
+		int loadedRowCount = 0;
+		qint64 bodySize = 0;
+
+		for (const auto &message : std::as_const(messages)) {
+			if (!isStub(message)) {
+				loadedRowCount++;
+				bodySize += message.body.size() * qint64(sizeof(QChar));
+			}
+		}
+
+		maxLoadedRowCount = std::max(maxLoadedRowCount, loadedRowCount);
+		maxBodySize = std::max(maxBodySize, bodySize);
+	}
+
+	const auto totalBodySize = qint64(messageCount) * bodyLength * qint64(sizeof(QChar));
+	qInfo(
+		"%d of %d messages loaded at most, %lld of %lld KiB of message bodies",
+		maxLoadedRowCount,
+		messageCount,
+		maxBodySize / 1024,
+		totalBodySize / 1024
+	);
+
+	// The window may exceed its size by the page inserted before it is moved.
+	QCOMPARE(messages.size(), messageCount);
+	QVERIFY(maxLoadedRowCount <= DEFAULT_MESSAGE_WINDOW_SIZE + DB_QUERY_LIMIT_MESSAGES);
+	QVERIFY(maxBodySize <= qint64(DEFAULT_MESSAGE_WINDOW_SIZE + DB_QUERY_LIMIT_MESSAGES) * bodyLength * qint64(sizeof(QChar)));
+}
+
+Message MessageWindowTest::createMessage(int number, bool withId)
+{
+	Message message;
+	message.accountJid = ACCOUNT_JID;
+	message.chatJid = CONTACT_JID;
+	message.senderId = CONTACT_JID;
+	message.id = withId ? QStringLiteral("message-%1").arg(number) : QString();
+	message.timestamp = QDateTime::fromMSecsSinceEpoch(1700000000000 - number * 1000, Qt::UTC);
+	message.body = QStringLiteral("Message %1").arg(number);
+	return message;
+}
+
+QVector<Message> MessageWindowTest::createMessages(int count)
+{
+	QVector<Message> messages;
+	messages.reserve(count);
+
+	for (int i = 0; i < count; i++) {
+		messages.append(createMessage(i));
+	}
+
+	return messages;
+}
+
+QVector<Message> MessageWindowTest::fetchMessages(const QVector<Message> &storedMessages, const QVector<QString> &messageIds)
+{
+	QVector<Message> messages;
+
+	for (const auto &message : storedMessages) {
+		if (messageIds.contains(message.id)) {
+			messages.append(message);
+		}
+	}
+
+	return messages;
+}
+
+bool MessageWindowTest::isStub(const Message &message)
+{
+	return message.body.isEmpty();
+}
+
+QTEST_GUILESS_MAIN(MessageWindowTest)
+#include "MessageWindowTest.moc"
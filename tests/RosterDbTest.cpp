@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+
+#include "../src/Database.h"
+#include "../src/MessageDb.h"
+#include "../src/RosterDb.h"
+#include "../src/RosterItem.h"
+#include "utils.h"
+
+class RosterDbTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testReplaceItems();
+
+	QVector<RosterItem> fetchItems(const QString &accountJid);
+
+	Database m_db;
+	MessageDb m_messageDb = MessageDb(&m_db);
+	RosterDb m_rosterDb = RosterDb(&m_db);
+};
+
+void RosterDbTest::testReplaceItems()
+{
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto otherAccountJid = QStringLiteral("bob@example.com");
+
+	const auto createItem = [](const QString &accountJid, const QString &jid, const QString &group) {
+		RosterItem item;
+		item.accountJid = accountJid;
+		item.jid = jid;
+		item.name = jid.section(QLatin1Char('@'), 0, 0);
+		item.subscription = QXmppRosterIq::Item::Both;
+		item.groups = { group };
+		return item;
+	};
+
+	const auto carol = createItem(accountJid, QStringLiteral("carol@example.net"), QStringLiteral("Family"));
+	const auto dave = createItem(accountJid, QStringLiteral("dave@example.net"), QStringLiteral("Friends"));
+	const auto eve = createItem(accountJid, QStringLiteral("eve@example.net"), QStringLiteral("Friends"));
+	const auto frank = createItem(accountJid, QStringLiteral("frank@example.net"), QStringLiteral("Work"));
+	const auto otherCarol = createItem(otherAccountJid, carol.jid, QStringLiteral("Family"));
+
+	wait(m_rosterDb.addItems({ carol, dave, eve, otherCarol }));
+	wait(m_rosterDb.updateItem(dave.jid, [](RosterItem &item) {
+		item.unreadMessages = 3;
+	}));
+
+	auto renamedDave = dave;
+	renamedDave.name = QStringLiteral("David");
+	auto movedEve = eve;
+	movedEve.groups = { QStringLiteral("Work"), QStringLiteral("Family") };
+
+	// carol is removed, dave is renamed, eve is moved to other groups and frank is added.
+	wait(m_rosterDb.replaceItems(accountJid, {
+		{ renamedDave.jid, renamedDave },
+		{ movedEve.jid, movedEve },
+		{ frank.jid, frank },
+	}));
+
+	const auto items = fetchItems(accountJid);
+	QCOMPARE(items.size(), 3);
+
+	const auto findItem = [&items](const QString &jid) {
+		return *std::find_if(items.cbegin(), items.cend(), [&jid](const RosterItem &item) {
+			return item.jid == jid;
+		});
+	};
+
+	QCOMPARE(findItem(dave.jid).name, QStringLiteral("David"));
+	// All groups of an item are fetched.
+	QVERIFY(findItem(eve.jid).hasSameGroups(movedEve));
+	QCOMPARE(findItem(frank.jid).name, QStringLiteral("frank"));
+
+	// Data that is not part of the roster on the server is kept.
+	QCOMPARE(findItem(dave.jid).unreadMessages, 3);
+
+	// The roster of another account is not affected.
+	QCOMPARE(fetchItems(otherAccountJid).size(), 1);
+
+	// Replacing the items by the same ones does not change anything regardless of the order of
+	// their groups.
+	auto reorderedEve = movedEve;
+	std::reverse(reorderedEve.groups.begin(), reorderedEve.groups.end());
+
+	wait(m_rosterDb.replaceItems(accountJid, {
+		{ renamedDave.jid, renamedDave },
+		{ reorderedEve.jid, reorderedEve },
+		{ frank.jid, frank },
+	}));
+	QCOMPARE(fetchItems(accountJid), items);
+
+	wait(m_rosterDb.removeItems(accountJid));
+	wait(m_rosterDb.removeItems(otherAccountJid));
+}
+
+QVector<RosterItem> RosterDbTest::fetchItems(const QString &accountJid)
+{
+	auto items = wait(m_rosterDb.fetchItems());
+	items.erase(std::remove_if(items.begin(), items.end(), [&accountJid](const RosterItem &item) {
+		return item.accountJid != accountJid;
+	}), items.end());
+	std::sort(items.begin(), items.end(), [](const RosterItem &left, const RosterItem &right) {
+		return left.jid < right.jid;
+	});
+	return items;
+}
+
+QTEST_GUILESS_MAIN(RosterDbTest)
+#include "RosterDbTest.moc"
@@ -0,0 +1,188 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+
+#include "../src/TransferScheduler.h"
+
+using Priority = TransferScheduler::Priority;
+
+class TransferSchedulerTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void testLimits();
+	Q_SLOT void testPriorities();
+	Q_SLOT void testVisibleFiles();
+	Q_SLOT void testCancelPendingTransfer();
+	Q_SLOT void testCancelRunningTransfer();
+
+	// Schedules a transfer that records its start and stores its handle.
+	bool schedule(TransferScheduler &scheduler, qint64 fileId, const QString &host, Priority priority);
+
+	QVector<qint64> m_startedFileIds;
+	QHash<qint64, std::shared_ptr<TransferHandle>> m_handles;
+};
+
+void TransferSchedulerTest::testLimits()
+{
+	m_startedFileIds.clear();
+	m_handles.clear();
+
+	TransferScheduler scheduler;
+	scheduler.setMaxTransfers(3);
+	scheduler.setMaxTransfersPerHost(2);
+
+	QVERIFY(schedule(scheduler, 1, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 2, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 3, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 4, QStringLiteral("b.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 5, QStringLiteral("b.example"), Priority::Automatic));
+
+	// The third transfer from a.example exceeds the limit per host.
+	QCOMPARE(m_startedFileIds, (QVector<qint64> { 1, 2, 4 }));
+
+	// Transfers that are already scheduled are not scheduled again.
+	QVERIFY(!schedule(scheduler, 1, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(!schedule(scheduler, 5, QStringLiteral("b.example"), Priority::Automatic));
+
+	// The next transfer from the same host is started once one is finished.
+	m_handles.value(1)->finish();
+	QTRY_COMPARE(m_startedFileIds, (QVector<qint64> { 1, 2, 4, 3 }));
+	QVERIFY(!scheduler.contains(1));
+
+	m_handles.value(4)->finish();
+	QTRY_COMPARE(m_startedFileIds, (QVector<qint64> { 1, 2, 4, 3, 5 }));
+
+	// Finishing a transfer twice has no effect.
+	m_handles.value(4)->finish();
+	QCoreApplication::processEvents();
+	QCOMPARE(m_startedFileIds.size(), 5);
+}
+
+void TransferSchedulerTest::testPriorities()
+{
+	m_startedFileIds.clear();
+	m_handles.clear();
+
+	TransferScheduler scheduler;
+	scheduler.setMaxTransfers(1);
+
+	QVERIFY(schedule(scheduler, 1, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 2, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 3, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 4, QStringLiteral("a.example"), Priority::UserInitiated));
+
+	// Scheduling a pending transfer again raises its priority.
+	QVERIFY(!schedule(scheduler, 3, QStringLiteral("a.example"), Priority::UserInitiated));
+
+	// Transfers of the same priority are started in the order of their scheduling.
+	m_handles.value(1)->finish();
+	QTRY_COMPARE(m_startedFileIds, (QVector<qint64> { 1, 3 }));
+
+	m_handles.value(3)->finish();
+	QTRY_COMPARE(m_startedFileIds, (QVector<qint64> { 1, 3, 4 }));
+
+	m_handles.value(4)->finish();
+	QTRY_COMPARE(m_startedFileIds, (QVector<qint64> { 1, 3, 4, 2 }));
+}
+
+void TransferSchedulerTest::testVisibleFiles()
+{
+	m_startedFileIds.clear();
+	m_handles.clear();
+
+	TransferScheduler scheduler;
+	scheduler.setMaxTransfers(1);
+
+	QVERIFY(schedule(scheduler, 1, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 2, QStringLiteral("a.example"), Priority::UserInitiated));
+	QVERIFY(schedule(scheduler, 3, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 4, QStringLiteral("a.example"), Priority::Automatic));
+
+	// A file displayed twice stays visible until both are hidden.
+	scheduler.setVisible(3, true);
+	scheduler.setVisible(4, true);
+	scheduler.setVisible(4, true);
+	scheduler.setVisible(3, false);
+	scheduler.setVisible(4, false);
+
+	m_handles.value(1)->finish();
+	QTRY_COMPARE(m_startedFileIds, (QVector<qint64> { 1, 4 }));
+
+	m_handles.value(4)->finish();
+	QTRY_COMPARE(m_startedFileIds, (QVector<qint64> { 1, 4, 2 }));
+}
+
+void TransferSchedulerTest::testCancelPendingTransfer()
+{
+	m_startedFileIds.clear();
+	m_handles.clear();
+
+	TransferScheduler scheduler;
+	scheduler.setMaxTransfers(1);
+
+	QVERIFY(schedule(scheduler, 1, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 2, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 3, QStringLiteral("a.example"), Priority::Automatic));
+
+	// A cancelled transfer is started immediately to report its cancellation.
+	scheduler.cancel(2);
+	QCOMPARE(m_startedFileIds, (QVector<qint64> { 1, 2 }));
+	QVERIFY(m_handles.value(2)->isCancelled());
+	QVERIFY(!scheduler.contains(2));
+
+	// It does not occupy a slot.
+	m_handles.value(2)->finish();
+	QCoreApplication::processEvents();
+	QCOMPARE(m_startedFileIds.size(), 2);
+
+	m_handles.value(1)->finish();
+	QTRY_COMPARE(m_startedFileIds, (QVector<qint64> { 1, 2, 3 }));
+}
+
+void TransferSchedulerTest::testCancelRunningTransfer()
+{
+	m_startedFileIds.clear();
+	m_handles.clear();
+
+	TransferScheduler scheduler;
+	scheduler.setMaxTransfers(1);
+
+	QVERIFY(schedule(scheduler, 1, QStringLiteral("a.example"), Priority::Automatic));
+	QVERIFY(schedule(scheduler, 2, QStringLiteral("a.example"), Priority::Automatic));
+
+	int cancellerCalls = 0;
+	m_handles.value(1)->setCanceller([&cancellerCalls]() {
+		++cancellerCalls;
+	});
+
+	scheduler.cancel(1);
+	QCOMPARE(cancellerCalls, 1);
+	QVERIFY(m_handles.value(1)->isCancelled());
+
+	// The transfer occupies its slot until it reports that it finished.
+	QVERIFY(scheduler.isRunning(1));
+	m_handles.value(1)->finish();
+	QTRY_COMPARE(m_startedFileIds, (QVector<qint64> { 1, 2 }));
+
+	// Cancellers set after the cancellation are called immediately.
+	scheduler.cancel(2);
+	m_handles.value(2)->setCanceller([&cancellerCalls]() {
+		++cancellerCalls;
+	});
+	QCOMPARE(cancellerCalls, 2);
+}
+
+bool TransferSchedulerTest::schedule(TransferScheduler &scheduler, qint64 fileId, const QString &host, Priority priority)
+{
+	return scheduler.schedule(fileId, host, priority, [this](const std::shared_ptr<TransferHandle> &handle) {
+		m_startedFileIds.append(handle->fileId());
+		m_handles.insert(handle->fileId(), handle);
+	});
+}
+
+QTEST_GUILESS_MAIN(TransferSchedulerTest)
+#include "TransferSchedulerTest.moc"
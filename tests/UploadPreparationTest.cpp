@@ -0,0 +1,213 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QImage>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "../src/Globals.h"
+#include "../src/UploadPreparation.h"
+#include "utils.h"
+
+class UploadPreparationTest : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void initTestCase();
+	Q_SLOT void testCreateImageThumbnail();
+	Q_SLOT void testCompressThumbnail();
+	Q_SLOT void benchmarkGenerateImageThumbnails_data();
+	Q_SLOT void benchmarkGenerateImageThumbnails();
+	Q_SLOT void benchmarkThumbnailStages_data();
+	Q_SLOT void benchmarkThumbnailStages();
+
+	QString createFile(const QString &fileName, const QByteArray &content);
+
+	/**
+	 * Creates an image file with varying content so that it is not trivial to decode, unless it
+	 * already exists.
+	 *
+	 * The image has an aspect ratio of 4:3 and its format is determined by the file name.
+	 */
+	QString createImageFile(const QString &fileName, int width);
+
+	QTemporaryDir m_dir;
+};
+
+void UploadPreparationTest::initTestCase()
+{
+	QVERIFY(m_dir.isValid());
+}
+
+void UploadPreparationTest::testCreateImageThumbnail()
+{
+	const auto filePath = m_dir.filePath(QStringLiteral("photo.jpg"));
+	QImage image(4000, 3000, QImage::Format_RGB32);
+	image.fill(Qt::darkCyan);
+	QVERIFY(image.save(filePath));
+
+	const auto thumbnail = wait(UploadPreparation::instance().generateImageThumbnail(filePath, THUMBNAIL_PIXEL_SIZE));
+	QVERIFY(thumbnail);
+	QCOMPARE(thumbnail->imageSize, QSize(4000, 3000));
+	QCOMPARE(thumbnail->size, QSize(THUMBNAIL_PIXEL_SIZE, THUMBNAIL_PIXEL_SIZE * 3 / 4));
+	QCOMPARE(thumbnail->mimeType.name(), QStringLiteral("image/jpeg"));
+	QVERIFY(thumbnail->data.size() <= MAX_THUMBNAIL_DATA_SIZE);
+	QCOMPARE(QImage::fromData(thumbnail->data).size(), thumbnail->size);
+
+	// Files that are no images do not have thumbnails.
+	QVERIFY(!UploadPreparation::createImageThumbnail(createFile(QStringLiteral("no-image"), QByteArrayLiteral("no image")), THUMBNAIL_PIXEL_SIZE));
+}
+
+void UploadPreparationTest::testCompressThumbnail()
+{
+	// Noise cannot be compressed well so that the quality and size need to be reduced.
+	QImage image(400, 400, QImage::Format_ARGB32);
+	QRandomGenerator::global()->fillRange(reinterpret_cast<quint32 *>(image.bits()), int(image.sizeInBytes() / sizeof(quint32)));
+
+	const auto thumbnail = UploadPreparation::compressThumbnail(image);
+	QVERIFY(!thumbnail.data.isEmpty());
+	QVERIFY(thumbnail.data.size() <= MAX_THUMBNAIL_DATA_SIZE);
+	QVERIFY(thumbnail.size.width() <= image.width());
+	QCOMPARE(thumbnail.size.width(), thumbnail.size.height());
+
+	// Thumbnails without a size limit keep their size and quality.
+	const auto preview = UploadPreparation::compressThumbnail(image, UploadPreparation::ThumbnailDataSize::Unlimited);
+	QVERIFY(preview.data.size() > MAX_THUMBNAIL_DATA_SIZE);
+	QCOMPARE(preview.size, image.size());
+}
+
+void UploadPreparationTest::benchmarkGenerateImageThumbnails_data()
+{
+	QTest::addColumn<int>("fileCount");
+	QTest::addColumn<int>("imageWidth");
+	QTest::addColumn<int>("jobs");
+
+	const auto allJobs = QThread::idealThreadCount();
+
+	for (const auto fileCount : { 1, 8, 32 }) {
+		for (const auto imageWidth : { 1000, 4000 }) {
+			QTest::addRow("%d files of %d px, 1 job", fileCount, imageWidth) << fileCount << imageWidth << 1;
+			QTest::addRow("%d files of %d px, %d jobs", fileCount, imageWidth, allJobs) << fileCount << imageWidth << allJobs;
+		}
+	}
+}
+
+void UploadPreparationTest::benchmarkGenerateImageThumbnails()
+{
+	QFETCH(int, fileCount);
+	QFETCH(int, imageWidth);
+	QFETCH(int, jobs);
+
+	auto &preparation = UploadPreparation::instance();
+	const auto maxThumbnailJobs = preparation.maxThumbnailJobs();
+
+	QStringList filePaths;
+	for (int i = 0; i < fileCount; i++) {
+		filePaths.append(createImageFile(QStringLiteral("benchmark-%1-%2.jpg").arg(imageWidth).arg(i), imageWidth));
+	}
+
+	preparation.setMaxThumbnailJobs(jobs);
+
+	// The thumbnails of all files are requested at once like when files are selected for an
+	// upload.
+	QBENCHMARK {
+		QVector<QFuture<std::optional<UploadPreparation::Thumbnail>>> futures;
+		futures.reserve(fileCount);
+
+		for (const auto &filePath : std::as_const(filePaths)) {
+			futures.append(preparation.generateImageThumbnail(filePath, THUMBNAIL_PIXEL_SIZE));
+		}
+
+		for (auto &future : futures) {
+			future.waitForFinished();
+			QVERIFY(future.result());
+		}
+	}
+
+	preparation.setMaxThumbnailJobs(maxThumbnailJobs);
+}
+
+void UploadPreparationTest::benchmarkThumbnailStages_data()
+{
+	QTest::addColumn<QString>("format");
+	QTest::addColumn<int>("imageWidth");
+	QTest::addColumn<QString>("stage");
+
+	for (const auto &format : { QStringLiteral("jpg"), QStringLiteral("png") }) {
+		for (const auto imageWidth : { 1000, 4000 }) {
+			for (const auto &stage : { QStringLiteral("decoding"), QStringLiteral("scaling"), QStringLiteral("encoding") }) {
+				QTest::addRow("%s, %d px, %s", qPrintable(format), imageWidth, qPrintable(stage)) << format << imageWidth << stage;
+			}
+		}
+	}
+}
+
+void UploadPreparationTest::benchmarkThumbnailStages()
+{
+	QFETCH(QString, format);
+	QFETCH(int, imageWidth);
+	QFETCH(QString, stage);
+
+	// JPEG images are scaled while decoding them.
+	// PNG images are decoded completely and scaled by QImageReader, which is part of the decoding
+	// stage as well.
+	// The scaling stage is only needed for images whose size is not known before decoding them.
+	const auto filePath = createImageFile(QStringLiteral("stages-%1.%2").arg(imageWidth).arg(format), imageWidth);
+
+	constexpr int runCount = 5;
+	std::chrono::duration<double, std::milli> stageDuration {};
+
+	for (int i = 0; i < runCount; i++) {
+		UploadPreparation::ThumbnailStageDurations durations;
+		QVERIFY(UploadPreparation::createImageThumbnail(filePath, THUMBNAIL_PIXEL_SIZE, UploadPreparation::ThumbnailDataSize::Limited, &durations));
+
+		if (stage == QLatin1String("decoding")) {
+			stageDuration += durations.decoding;
+		} else if (stage == QLatin1String("scaling")) {
+			stageDuration += durations.scaling;
+		} else {
+			stageDuration += durations.encoding;
+		}
+	}
+
+	QTest::setBenchmarkResult(stageDuration.count() / runCount, QTest::WalltimeMilliseconds);
+}
+
+QString UploadPreparationTest::createFile(const QString &fileName, const QByteArray &content)
+{
+	const auto filePath = m_dir.filePath(fileName);
+
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size()) {
+		qFatal("Could not create %s", qPrintable(filePath));
+	}
+
+	return filePath;
+}
+
+QString UploadPreparationTest::createImageFile(const QString &fileName, int width)
+{
+	const auto filePath = m_dir.filePath(fileName);
+
+	if (!QFile::exists(filePath)) {
+		QImage image(width, width * 3 / 4, QImage::Format_RGB32);
+		for (int y = 0; y < image.height(); y++) {
+			auto *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+			for (int x = 0; x < image.width(); x++) {
+				line[x] = qRgb(x % 256, y % 256, (x + y) % 256);
+			}
+		}
+
+		if (!image.save(filePath)) {
+			qFatal("Could not create %s", qPrintable(filePath));
+		}
+	}
+
+	return filePath;
+}
+
+QTEST_GUILESS_MAIN(UploadPreparationTest)
+#include "UploadPreparationTest.moc"
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2026 Kaidan developers and contributors
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Counts the heap allocations needed for fetching a page of messages.
+//
+// This is not part of MessageDbTest because it replaces the allocation functions of the whole
+// process.
+
+#include <atomic>
+
+#include <QtTest>
+
+#include "../../src/Database.h"
+#include "../../src/Globals.h"
+#include "../../src/MessageDb.h"
+#include "../utils.h"
+
+// Number of heap allocations of all threads
+static std::atomic<quint64> s_allocationCount = 0;
+
+#ifdef __GLIBC__
+// Qt's containers allocate their data via malloc() instead of operator new.
+// Thus, the allocations are counted by wrapping glibc's allocation functions.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size)
+{
+	s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+	s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(pointer, size);
+}
+}
+#endif
+
+class MessageDbAllocationsBenchmark : public QObject
+{
+	Q_OBJECT
+
+private:
+	Q_SLOT void benchmarkFetchedPageAllocations();
+
+	Database m_db;
+	MessageDb m_messageDb = MessageDb(&m_db);
+};
+
+void MessageDbAllocationsBenchmark::benchmarkFetchedPageAllocations()
+{
+#ifndef __GLIBC__
+	QSKIP("Allocations can only be counted with glibc");
+#endif
+
+	const auto accountJid = QStringLiteral("alice@example.org");
+	const auto chatJid = QStringLiteral("oscar@example.net");
+	const auto timestamp = QDateTime::currentDateTimeUtc();
+
+	QVector<Message> messages;
+	for (int i = 0; i < DB_QUERY_LIMIT_MESSAGES; i++) {
+		Message message;
+		message.accountJid = accountJid;
+		message.chatJid = chatJid;
+		message.senderId = chatJid;
+		message.id = QStringLiteral("allocations-%1").arg(i);
+		message.timestamp = timestamp.addSecs(i);
+		message.body = QStringLiteral("Message %1").arg(i);
+		messages.append(message);
+	}
+	wait(m_messageDb.addMessages(messages, MessageOrigin::MamBacklog));
+
+	QVector<Message> emittedMessages;
+	const auto connection = connect(&m_messageDb, &MessageDb::messagesFetched, this, [&](const QVector<Message> &page) {
+		emittedMessages = page;
+	});
+
+	constexpr int pageCount = 10;
+	QVector<Message> fetchedMessages;
+
+	const auto allocationCountBefore = s_allocationCount.load();
+	for (int i = 0; i < pageCount; i++) {
+		fetchedMessages = wait(m_messageDb.fetchMessages(accountJid, chatJid));
+	}
+	const auto allocationCount = s_allocationCount.load() - allocationCountBefore;
+
+	disconnect(connection);
+
+	// The page is handed over to the future and to the receivers of the signal without copying it.
+	QCOMPARE(fetchedMessages.size(), DB_QUERY_LIMIT_MESSAGES);
+	QVERIFY(emittedMessages.constData() == fetchedMessages.constData());
+
+	QTest::setBenchmarkResult(qreal(allocationCount) / pageCount, QTest::Events);
+
+	wait(m_messageDb.removeAllMessagesFromChat(accountJid, chatJid));
+}
+
+QTEST_GUILESS_MAIN(MessageDbAllocationsBenchmark)
+#include "message-db-allocations.moc"